@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+"""Record benchmark baselines and check new runs against them.
+
+Works with any benchmark binary that accepts `--json <path>` and writes
+{"benchmarks": [{"name", "elements", "iterations", "ns_per_op",
+"allocs_per_op", "bytes_per_op"}, ...]} — today that is
+package_manager_conversion_bench (tests/bench/bench_conversions.cpp).
+
+Each benchmark process gives one sample per case, so the binary is run
+`--runs` times and every case gets a sample set. Time is judged on a 95%
+confidence interval of the difference in means (Welch): a case regresses
+only when even the optimistic end of that interval is slower than the
+baseline by more than `--threshold` percent, so ordinary run-to-run noise
+does not fail a build. Allocation counts are deterministic and are
+compared directly against `--alloc-threshold`.
+
+    # on the reference machine, Release build
+    scripts/bench_compare.py record --bench build-bench/package_manager_conversion_bench \\
+        --out tests/bench/baselines/conversions.json
+
+    # later, same machine class
+    scripts/bench_compare.py compare --bench build-bench/package_manager_conversion_bench \\
+        --baseline tests/bench/baselines/conversions.json --threshold 10
+
+Exit status: 0 no regressions, 1 at least one tracked case regressed or
+went missing, 2 usage / run errors.
+"""
+
+import argparse
+import datetime
+import json
+import math
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+
+SCHEMA_VERSION = 1
+
+# Two-sided 95% Student t critical values by degrees of freedom; beyond the
+# table the normal approximation is close enough.
+_T95 = {
+    1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365,
+    8: 2.306, 9: 2.262, 10: 2.228, 11: 2.201, 12: 2.179, 13: 2.160,
+    14: 2.145, 15: 2.131, 16: 2.120, 17: 2.110, 18: 2.101, 19: 2.093,
+    20: 2.086, 25: 2.060, 30: 2.042, 40: 2.021, 60: 2.000, 120: 1.980,
+}
+
+
+def t95(df):
+    if df < 1:
+        return float("inf")
+    keys = sorted(_T95)
+    for k in keys:
+        if df <= k:
+            return _T95[k]
+    return 1.960
+
+
+def mean(xs):
+    return sum(xs) / len(xs)
+
+
+def variance(xs):
+    if len(xs) < 2:
+        return 0.0
+    m = mean(xs)
+    return sum((x - m) ** 2 for x in xs) / (len(xs) - 1)
+
+
+def ci95(xs):
+    """Half-width of the 95% confidence interval of the mean."""
+    if len(xs) < 2:
+        return float("inf")
+    return t95(len(xs) - 1) * math.sqrt(variance(xs) / len(xs))
+
+
+def welch_diff_ci(base, new):
+    """(difference in means new - base, 95% half-width) via Welch's t."""
+    diff = mean(new) - mean(base)
+    vb, vn = variance(base) / len(base), variance(new) / len(new)
+    se2 = vb + vn
+    if se2 == 0:
+        return diff, 0.0
+    denom = 0.0
+    if len(base) > 1:
+        denom += vb * vb / (len(base) - 1)
+    if len(new) > 1:
+        denom += vn * vn / (len(new) - 1)
+    df = se2 * se2 / denom if denom > 0 else 1
+    return diff, t95(int(df)) * math.sqrt(se2)
+
+
+# ---------------------------------------------------------------------------
+# Collecting samples
+# ---------------------------------------------------------------------------
+
+def load_run(path):
+    with open(path) as f:
+        doc = json.load(f)
+    return doc.get("benchmarks", [])
+
+
+def run_binary(binary, runs, extra_args):
+    """Run the benchmark `runs` times; returns a list of per-run result lists."""
+    results = []
+    with tempfile.TemporaryDirectory() as tmp:
+        for i in range(runs):
+            out = os.path.join(tmp, "run%d.json" % i)
+            cmd = [binary, "--json", out] + extra_args
+            print("[%d/%d] %s" % (i + 1, runs, " ".join(cmd)), file=sys.stderr)
+            proc = subprocess.run(cmd, stdout=subprocess.DEVNULL)
+            if proc.returncode != 0:
+                raise RuntimeError("%s exited with %d" % (binary, proc.returncode))
+            results.append(load_run(out))
+    return results
+
+
+def collect(args):
+    """Per-case samples from either --bench runs or pre-recorded --from-json files."""
+    if args.from_json:
+        runs = [load_run(p) for p in args.from_json]
+    elif args.bench:
+        extra = []
+        if args.filter:
+            extra += ["--filter", args.filter]
+        if args.min_time_ms:
+            extra += ["--min-time-ms", str(args.min_time_ms)]
+        runs = run_binary(args.bench, args.runs, extra)
+    else:
+        raise RuntimeError("need --bench <binary> or --from-json <files>")
+
+    cases = {}
+    for run in runs:
+        for r in run:
+            c = cases.setdefault(r["name"], {"elements": r.get("elements", 0),
+                                             "ns_per_op": [], "allocs_per_op": [],
+                                             "bytes_per_op": []})
+            c["ns_per_op"].append(float(r["ns_per_op"]))
+            c["allocs_per_op"].append(float(r.get("allocs_per_op", 0)))
+            c["bytes_per_op"].append(float(r.get("bytes_per_op", 0)))
+    if not cases:
+        raise RuntimeError("no benchmark results collected")
+    return cases
+
+
+def host_info():
+    return {"machine": platform.machine(), "system": platform.system(),
+            "node": platform.node(), "cpus": os.cpu_count()}
+
+
+def git_revision():
+    try:
+        return subprocess.run(["git", "rev-parse", "--short", "HEAD"], capture_output=True,
+                              text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+
+# ---------------------------------------------------------------------------
+# Commands
+# ---------------------------------------------------------------------------
+
+def cmd_record(args):
+    cases = collect(args)
+    if args.track:
+        tracked = sorted(n for n in cases if any(p in n for p in args.track))
+    else:
+        tracked = sorted(cases)
+    doc = {
+        "schema": SCHEMA_VERSION,
+        "recorded": datetime.datetime.now(datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ"),
+        "revision": git_revision(),
+        "host": host_info(),
+        "tracked": tracked,
+        "cases": {name: cases[name] for name in sorted(cases)},
+    }
+    os.makedirs(os.path.dirname(os.path.abspath(args.out)), exist_ok=True)
+    with open(args.out, "w") as f:
+        json.dump(doc, f, indent=2, sort_keys=False)
+        f.write("\n")
+    print("recorded %d cases (%d tracked) from %d run(s) into %s"
+          % (len(cases), len(tracked), len(next(iter(cases.values()))["ns_per_op"]), args.out))
+    return 0
+
+
+def fmt_ns(ns):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if ns >= scale:
+            return "%.2f%s" % (ns / scale, unit)
+    return "%.0fns" % ns
+
+
+def cmd_compare(args):
+    with open(args.baseline) as f:
+        base = json.load(f)
+    if base.get("schema") != SCHEMA_VERSION:
+        print("baseline %s has schema %r, expected %d — re-record it"
+              % (args.baseline, base.get("schema"), SCHEMA_VERSION), file=sys.stderr)
+        return 2
+
+    new = collect(args)
+    tracked = base.get("tracked") or sorted(base["cases"])
+    if args.filter:
+        tracked = [n for n in tracked if args.filter in n]
+
+    if base.get("host", {}).get("machine") != platform.machine() or \
+            base.get("host", {}).get("cpus") != os.cpu_count():
+        print("warning: baseline was recorded on %s; timings are only comparable on the same "
+              "machine class" % base.get("host"), file=sys.stderr)
+
+    threshold = args.threshold / 100.0
+    alloc_threshold = args.alloc_threshold / 100.0
+    rows = []
+    failures = 0
+    for name in tracked:
+        b = base["cases"].get(name)
+        n = new.get(name)
+        if b is None or n is None:
+            rows.append((name, "-", "-", "-", "MISSING"))
+            failures += 1
+            continue
+
+        bt, nt = b["ns_per_op"], n["ns_per_op"]
+        bm = mean(bt) or 1e-9
+        diff, half = welch_diff_ci(bt, nt)
+        change, lo, hi = diff / bm, (diff - half) / bm, (diff + half) / bm
+
+        if lo > threshold:
+            verdict = "REGRESSED"
+        elif hi < -threshold:
+            verdict = "improved"
+        elif half / bm > threshold:
+            verdict = "noisy"  # interval too wide to call either way; add --runs
+        else:
+            verdict = "ok"
+
+        ba, na = mean(b["allocs_per_op"]), mean(n["allocs_per_op"])
+        alloc_note = ""
+        if na > ba * (1 + alloc_threshold) + 0.5:
+            verdict = "REGRESSED"
+            alloc_note = " (allocs/op %.1f -> %.1f)" % (ba, na)
+        if verdict == "REGRESSED":
+            failures += 1
+
+        rows.append((name,
+                     "%s ±%s" % (fmt_ns(bm), fmt_ns(ci95(bt)) if len(bt) > 1 else "?"),
+                     "%s ±%s" % (fmt_ns(mean(nt)), fmt_ns(ci95(nt)) if len(nt) > 1 else "?"),
+                     "%+.1f%% [%+.1f, %+.1f]" % (change * 100, lo * 100, hi * 100)
+                     if not math.isinf(half) else "%+.1f%% [n/a]" % (change * 100),
+                     verdict + alloc_note))
+
+    header = ("case", "baseline", "current", "change [95% CI]", "verdict")
+    widths = [max(len(str(r[i])) for r in rows + [header]) for i in range(len(header))]
+    for r in [header] + rows:
+        print("  ".join(str(c).ljust(w) for c, w in zip(r, widths)).rstrip())
+
+    untracked = sorted(set(new) - set(base["cases"]))
+    if untracked:
+        print("\n%d case(s) not in the baseline (re-record to track them): %s"
+              % (len(untracked), ", ".join(untracked[:5]) + (" ..." if len(untracked) > 5 else "")))
+    print("\n%d tracked case(s), %d regression(s) past %.1f%% time / %.1f%% allocations "
+          "(baseline %s, revision %s)"
+          % (len(tracked), failures, args.threshold, args.alloc_threshold,
+             base.get("recorded", "?"), base.get("revision") or "?"))
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    def add_source(p):
+        p.add_argument("--bench", help="benchmark binary to run")
+        p.add_argument("--runs", type=int, default=5, help="benchmark processes to run (default 5)")
+        p.add_argument("--min-time-ms", type=float, help="passed through to the binary")
+        p.add_argument("--filter", help="only cases whose name contains this")
+        p.add_argument("--from-json", nargs="+", metavar="RUN",
+                       help="use existing --json outputs instead of running --bench")
+
+    rec = sub.add_parser("record", help="write a baseline")
+    add_source(rec)
+    rec.add_argument("--out", required=True, help="baseline file to write")
+    rec.add_argument("--track", nargs="+", metavar="SUBSTR",
+                     help="only track cases containing one of these (default: all)")
+    rec.set_defaults(func=cmd_record)
+
+    cmp_ = sub.add_parser("compare", help="compare a new run against a baseline")
+    add_source(cmp_)
+    cmp_.add_argument("--baseline", required=True)
+    cmp_.add_argument("--threshold", type=float, default=10.0,
+                      help="allowed slowdown in percent (default 10)")
+    cmp_.add_argument("--alloc-threshold", type=float, default=5.0,
+                      help="allowed allocations/op growth in percent (default 5)")
+    cmp_.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    if args.runs < 1:
+        parser.error("--runs must be at least 1")
+    try:
+        return args.func(args)
+    except (OSError, RuntimeError, ValueError, KeyError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,106 @@
+#include "conversions.h"
+
+#include <package_manager_lib.h>
+#include <string>
+#include <utility>
+
+namespace conversions {
+
+LogosMap toLogosMap(const Hashes& h)
+{
+    LogosMap m = LogosMap::object();
+    m["root"] = h.root;
+    return m;
+}
+
+LogosMap toLogosMap(const InstalledPackage& p)
+{
+    LogosMap m = LogosMap::object();
+    m["name"]         = p.name;
+    m["displayName"]  = p.displayName;
+    m["version"]      = p.version;
+    m["description"]  = p.description;
+    m["type"]         = p.type;
+    m["category"]     = p.category;
+    m["author"]       = p.author;
+    m["license"]      = p.license;
+    m["icon"]         = p.icon;
+    m["view"]         = p.view;
+
+    LogosList deps = LogosList::array();
+    for (const auto& d : p.dependencies) deps.push_back(d);
+    m["dependencies"] = std::move(deps);
+
+    m["hashes"]       = toLogosMap(p.hashes);
+    m["installType"]  = std::string(installTypeToString(p.installType));
+    m["installDir"]   = p.installDir;
+    m["mainFilePath"] = p.mainFilePath;
+    return m;
+}
+
+LogosList toLogosList(const std::vector<InstalledPackage>& v)
+{
+    LogosList out = LogosList::array();
+    for (const auto& p : v) out.push_back(toLogosMap(p));
+    return out;
+}
+
+LogosMap toFlatLogosMap(const DependencyTreeNode& n)
+{
+    LogosMap m = LogosMap::object();
+    m["name"]   = n.name;
+    m["status"] = std::string(dependencyStatusToString(n.status));
+    if (n.status == DependencyStatus::Installed) {
+        m["version"]     = n.version;
+        m["installType"] = std::string(installTypeToString(n.installType));
+    } else {
+        m["version"]     = "";
+        m["installType"] = "";
+    }
+    return m;
+}
+
+LogosMap toFlatLogosMap(const DependentTreeNode& n)
+{
+    LogosMap m = LogosMap::object();
+    m["name"]        = n.name;
+    m["version"]     = n.version;
+    m["type"]        = n.type;
+    m["installType"] = std::string(installTypeToString(n.installType));
+    m["installDir"]  = n.installDir;
+    return m;
+}
+
+namespace {
+
+template <typename Node>
+LogosMap treeMap(const Node& n, int maxDepth)
+{
+    LogosMap m = toFlatLogosMap(n);
+    LogosList children = LogosList::array();
+    if (maxDepth > 0) {
+        for (const auto& c : n.children)
+            children.push_back(treeMap(c, maxDepth - 1));
+    }
+    // Moved, not copied: a copy here re-copies every subtree at each level.
+    m["children"] = std::move(children);
+    return m;
+}
+
+template <typename Node>
+LogosList flatList(const std::vector<Node>& v)
+{
+    LogosList out = LogosList::array();
+    for (const auto& n : v) out.push_back(toFlatLogosMap(n));
+    return out;
+}
+
+} // namespace
+
+LogosMap toLogosTreeMap(const DependencyTreeNode& n, int maxDepth) { return treeMap(n, maxDepth); }
+LogosMap toLogosTreeMap(const DependentTreeNode& n, int maxDepth)  { return treeMap(n, maxDepth); }
+
+LogosList toFlatLogosList(const std::vector<DependencyTreeNode>& v) { return flatList(v); }
+LogosList toFlatLogosList(const std::vector<DependentTreeNode>& v)  { return flatList(v); }
+
+} // namespace conversions
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <logos_json.h>
+
+struct Hashes;
+struct InstalledPackage;
+struct DependencyTreeNode;
+struct DependentTreeNode;
+
+// ---------------------------------------------------------------------------
+// Struct → LogosMap / LogosList conversion helpers
+// ---------------------------------------------------------------------------
+//
+// Wire format is identical to what PackageManagerLib / the lgpm CLI emit via
+// package_manager_json.cpp's nlohmann ADL hooks. We re-hand-roll here (rather
+// than reuse those hooks) so the unit tests can compile against the stub
+// header in tests/stubs/package_manager_lib.h without pulling in the lib's
+// JSON module.
+//
+// Keep these in sync with package_manager_json.cpp's to_json definitions.
+//
+// Every query slot funnels its result through one of these, which is why
+// they live in their own translation unit: tests/bench/bench_conversions.cpp
+// measures them directly.
+// ---------------------------------------------------------------------------
+
+namespace conversions {
+
+LogosMap toLogosMap(const Hashes& h);
+LogosMap toLogosMap(const InstalledPackage& p);
+LogosList toLogosList(const std::vector<InstalledPackage>& v);
+
+// Flat per-node projection — just the node's own fields, no `children`.
+// Shared between the flat list APIs (resolveFlatDependencies /
+// resolveFlatDependents) and the tree APIs (where each recursive step is
+// "this node's fields plus its children").
+LogosMap toFlatLogosMap(const DependencyTreeNode& n);
+LogosMap toFlatLogosMap(const DependentTreeNode& n);
+
+// Depth-clipped tree serialisation — root always emitted with its own
+// fields; `maxDepth` bounds how far we recurse into `children`. Used by
+// resolveDependencies/resolveDependents: maxDepth=1 for !recursive (root
+// + direct children with empty children arrays), maxDepth=INT_MAX for
+// the full tree.
+LogosMap toLogosTreeMap(const DependencyTreeNode& n, int maxDepth);
+LogosMap toLogosTreeMap(const DependentTreeNode& n, int maxDepth);
+
+LogosList toFlatLogosList(const std::vector<DependencyTreeNode>& v);
+LogosList toFlatLogosList(const std::vector<DependentTreeNode>& v);
+
+} // namespace conversions
@@ -0,0 +1,299 @@
+#include "embedded_index.h"
+#include "integrity.h"
+
+#include <package_manager_lib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace embeddedindex {
+
+namespace {
+
+constexpr char     kMagic[8] = {'L', 'P', 'M', 'E', 'I', 'D', 'X', '1'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+struct Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t payloadSize;
+    uint8_t  checksum[32];
+};
+static_assert(sizeof(Header) == 56, "Header layout is part of the file format");
+
+enum Kind : uint8_t { KindModule = 0, KindUiPlugin = 1 };
+
+class Writer {
+public:
+    explicit Writer(const fs::path& base) : m_base(base) {}
+
+    void u8(uint8_t v) { m_out.push_back(static_cast<char>(v)); }
+    void u32(uint32_t v) { m_out.append(reinterpret_cast<const char*>(&v), sizeof(v)); }
+    void str(const std::string& s)
+    {
+        u32(static_cast<uint32_t>(s.size()));
+        m_out.append(s);
+    }
+    // Relative to the index's directory when under it.
+    void path(const std::string& p)
+    {
+        if (p.empty()) return str(p);
+        const fs::path abs = fs::absolute(p).lexically_normal();
+        const fs::path rel = abs.lexically_relative(m_base);
+        const bool under = !rel.empty() && *rel.begin() != "..";
+        str(under ? rel.generic_string() : abs.string());
+    }
+    void package(const InstalledPackage& p, Kind kind)
+    {
+        u8(kind);
+        u8(static_cast<uint8_t>(p.installType));
+        for (const std::string* s : {&p.name, &p.displayName, &p.version, &p.description, &p.type,
+                                     &p.category, &p.author, &p.license, &p.icon, &p.view,
+                                     &p.hashes.root})
+            str(*s);
+        path(p.installDir);
+        path(p.mainFilePath);
+        u32(static_cast<uint32_t>(p.dependencies.size()));
+        for (const auto& d : p.dependencies) str(d);
+    }
+
+    const std::string& bytes() const { return m_out; }
+
+private:
+    fs::path    m_base;
+    std::string m_out;
+};
+
+// Bounds-checked cursor over the mapped payload.
+class Reader {
+public:
+    Reader(const char* data, size_t size, const fs::path& base) : m_p(data), m_end(data + size), m_base(base) {}
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_p == m_end; }
+
+    uint8_t u8()
+    {
+        if (!need(1)) return 0;
+        return static_cast<uint8_t>(*m_p++);
+    }
+    uint32_t u32()
+    {
+        uint32_t v = 0;
+        if (!need(sizeof(v))) return 0;
+        std::memcpy(&v, m_p, sizeof(v));
+        m_p += sizeof(v);
+        return v;
+    }
+    std::string str()
+    {
+        const uint32_t n = u32();
+        if (!need(n)) return std::string();
+        std::string s(m_p, n);
+        m_p += n;
+        return s;
+    }
+    std::string path()
+    {
+        const std::string s = str();
+        if (s.empty() || fs::path(s).is_absolute()) return s;
+        return (m_base / s).string();
+    }
+    bool package(InstalledPackage& p, Kind& kind)
+    {
+        kind = static_cast<Kind>(u8());
+        p.installType = static_cast<InstallType>(u8());
+        for (std::string* s : {&p.name, &p.displayName, &p.version, &p.description, &p.type,
+                               &p.category, &p.author, &p.license, &p.icon, &p.view, &p.hashes.root})
+            *s = str();
+        p.installDir = path();
+        p.mainFilePath = path();
+        const uint32_t deps = u32();
+        // Every name costs at least its length prefix: a count the rest of
+        // the payload cannot hold is corrupt, not a huge allocation.
+        if (!need(size_t(deps) * sizeof(uint32_t))) return false;
+        p.dependencies.reserve(deps);
+        for (uint32_t i = 0; i < deps && m_ok; ++i) p.dependencies.push_back(str());
+        return m_ok && (kind == KindModule || kind == KindUiPlugin);
+    }
+
+private:
+    bool need(size_t n)
+    {
+        if (!m_ok || static_cast<size_t>(m_end - m_p) < n) m_ok = false;
+        return m_ok;
+    }
+
+    const char* m_p;
+    const char* m_end;
+    fs::path    m_base;
+    bool        m_ok = true;
+};
+
+fs::path indexBase(const fs::path& file)
+{
+    return fs::absolute(file).lexically_normal().parent_path();
+}
+
+std::vector<std::string> canonicalSorted(const std::vector<std::string>& dirs)
+{
+    std::vector<std::string> out;
+    out.reserve(dirs.size());
+    for (const auto& d : dirs) {
+        std::error_code ec;
+        fs::path p = fs::weakly_canonical(d, ec);
+        if (ec) p = fs::absolute(d).lexically_normal();
+        std::string s = p.string();
+        while (s.size() > 1 && s.back() == '/') s.pop_back();
+        out.push_back(std::move(s));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+// The mapped file, unmapped on every exit path.
+struct Mapping {
+    void*  data = MAP_FAILED;
+    size_t size = 0;
+    ~Mapping()
+    {
+        if (data != MAP_FAILED) ::munmap(data, size);
+    }
+};
+
+} // namespace
+
+bool write(const fs::path& file, const Index& index, std::string& checksum, size_t& bytes,
+           std::string& error)
+{
+    Writer w(indexBase(file));
+    w.u32(static_cast<uint32_t>(index.moduleDirs.size()));
+    for (const auto& d : index.moduleDirs) w.path(d);
+    w.u32(static_cast<uint32_t>(index.uiPluginDirs.size()));
+    for (const auto& d : index.uiPluginDirs) w.path(d);
+    w.u32(static_cast<uint32_t>(index.modules.size() + index.uiPlugins.size()));
+    for (const auto& p : index.modules) w.package(p, KindModule);
+    for (const auto& p : index.uiPlugins) w.package(p, KindUiPlugin);
+
+    const std::string& payload = w.bytes();
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kFormatVersion;
+    h.byteOrder = kByteOrderMark;
+    h.payloadSize = payload.size();
+    const integrity::Digest digest = integrity::sha256(payload.data(), payload.size());
+    std::memcpy(h.checksum, digest.data(), digest.size());
+
+    // Write-then-rename so a reader never maps a half-written index.
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    const fs::path tmp = file.string() + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            error = "Failed to write '" + tmp.string() + "'";
+            return false;
+        }
+    }
+    fs::rename(tmp, file, ec);
+    if (ec) {
+        error = "Failed to replace '" + file.string() + "': " + ec.message();
+        fs::remove(tmp, ec);
+        return false;
+    }
+    checksum = integrity::toHex(digest);
+    bytes = sizeof(h) + payload.size();
+    return true;
+}
+
+bool load(const fs::path& file, Index& out, std::string& checksum, std::string& error)
+{
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "Failed to open '" + file.string() + "': " + std::strerror(errno);
+        return false;
+    }
+    struct stat st {};
+    Mapping map;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        map.size = static_cast<size_t>(st.st_size);
+        map.data = ::mmap(nullptr, map.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    const int mapErrno = errno;
+    ::close(fd);
+    if (map.data == MAP_FAILED) {
+        error = "Failed to map '" + file.string() + "': "
+              + (map.size ? std::strerror(mapErrno) : "empty file");
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(map.data);
+    Header h;
+    if (map.size < sizeof(h)) {
+        error = "Embedded index is truncated";
+        return false;
+    }
+    std::memcpy(&h, data, sizeof(h));
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+        error = "Not an embedded package index";
+        return false;
+    }
+    if (h.version != kFormatVersion || h.byteOrder != kByteOrderMark) {
+        error = "Embedded index format or byte order does not match this build";
+        return false;
+    }
+    if (h.payloadSize != map.size - sizeof(h)) {
+        error = "Embedded index is truncated";
+        return false;
+    }
+    const integrity::Digest digest = integrity::sha256(data + sizeof(h), h.payloadSize);
+    if (std::memcmp(digest.data(), h.checksum, digest.size()) != 0) {
+        error = "Embedded index checksum mismatch";
+        return false;
+    }
+
+    Reader r(data + sizeof(h), h.payloadSize, indexBase(file));
+    Index index;
+    for (auto* dirs : {&index.moduleDirs, &index.uiPluginDirs}) {
+        const uint32_t n = r.u32();
+        for (uint32_t i = 0; i < n && r.ok(); ++i) dirs->push_back(r.path());
+    }
+    const uint32_t count = r.u32();
+    for (uint32_t i = 0; i < count && r.ok(); ++i) {
+        InstalledPackage p;
+        Kind kind = KindModule;
+        if (!r.package(p, kind)) break;
+        (kind == KindModule ? index.modules : index.uiPlugins).push_back(std::move(p));
+    }
+    if (!r.ok() || !r.atEnd() || index.modules.size() + index.uiPlugins.size() != count) {
+        error = "Embedded index is malformed";
+        return false;
+    }
+    out = std::move(index);
+    checksum = integrity::toHex(digest);
+    return true;
+}
+
+bool covers(const Index& index, const std::vector<std::string>& moduleDirs,
+            const std::vector<std::string>& uiPluginDirs)
+{
+    return canonicalSorted(index.moduleDirs) == canonicalSorted(moduleDirs)
+        && canonicalSorted(index.uiPluginDirs) == canonicalSorted(uiPluginDirs);
+}
+
+} // namespace embeddedindex
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct InstalledPackage;
+
+// ---------------------------------------------------------------------------
+// Prebuilt index of the embedded package directories
+// ---------------------------------------------------------------------------
+//
+// Embedded directories ship read-only inside the app bundle, so what they
+// contain is fixed when the bundle is built. The bundle step writes every
+// embedded package (the library's own scan, dependency edges included) to
+// one file; at runtime the file is mapped and decoded in place of scanning
+// and parsing every embedded manifest.
+//
+// Layout (host byte order; the header records it):
+//   header   magic "LPMEIDX1", format version, byte-order mark,
+//            payload size, SHA-256 of the payload
+//   payload  the embedded modules and UI plugin directories the index
+//            covers, then one record per package: its kind (module / UI
+//            plugin), installType, its strings, and its dependency names
+// Strings are a u32 length followed by the bytes. Paths under the index
+// file's own directory are stored relative to it, so a bundle can be
+// mounted or unpacked anywhere (AppImage mounts, relocated install trees).
+//
+// load() rejects a file with the wrong magic, version or byte order, a
+// truncated payload, or a checksum mismatch; the caller then scans as
+// before.
+// ---------------------------------------------------------------------------
+
+namespace embeddedindex {
+
+struct Index {
+    std::vector<std::string>      moduleDirs;   // absolute once loaded
+    std::vector<std::string>      uiPluginDirs;
+    std::vector<InstalledPackage> modules;
+    std::vector<InstalledPackage> uiPlugins;
+};
+
+// Writes `index` to `file` (write-then-rename). `checksum` receives the hex
+// SHA-256 of the payload and `bytes` the file size.
+bool write(const std::filesystem::path& file, const Index& index, std::string& checksum,
+           size_t& bytes, std::string& error);
+
+bool load(const std::filesystem::path& file, Index& out, std::string& checksum, std::string& error);
+
+// Whether `index` was built from exactly these directories (compared after
+// resolving symlinks, in any order).
+bool covers(const Index& index, const std::vector<std::string>& moduleDirs,
+            const std::vector<std::string>& uiPluginDirs);
+
+} // namespace embeddedindex
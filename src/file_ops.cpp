@@ -0,0 +1,486 @@
+#include "file_ops.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <cstdio>  // renamex_np
+#include <sys/clonefile.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace fileops {
+
+namespace {
+
+std::string errnoMessage(const char* what, const fs::path& p)
+{
+    return std::string(what) + " '" + p.string() + "': " + std::strerror(errno);
+}
+
+// Plain read/write loop — the portable floor every other strategy falls
+// back to.
+bool copyByReadWrite(int in, int out, const fs::path& src, std::string& error)
+{
+    char buf[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(in, buf, sizeof(buf));
+        if (n == 0) return true;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = errnoMessage("Failed to read", src);
+            return false;
+        }
+        for (ssize_t off = 0; off < n;) {
+            ssize_t w = ::write(out, buf + off, static_cast<size_t>(n - off));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                error = errnoMessage("Failed to write copy of", src);
+                return false;
+            }
+            off += w;
+        }
+    }
+}
+
+bool copyContents(int in, int out, off_t size, const fs::path& src, std::string& error)
+{
+#if defined(__linux__)
+    // copy_file_range keeps the data in the kernel (and lets filesystems that
+    // support it share extents server-side). Older kernels and cross-device
+    // copies on pre-5.3 kernels reject it outright; only then fall back.
+    off_t remaining = size;
+    while (remaining > 0) {
+        ssize_t n = ::copy_file_range(in, nullptr, out, nullptr,
+                                      static_cast<size_t>(remaining), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (remaining == size && (errno == ENOSYS || errno == EXDEV
+                                      || errno == EINVAL || errno == EOPNOTSUPP))
+                return copyByReadWrite(in, out, src, error);
+            error = errnoMessage("Failed to copy", src);
+            return false;
+        }
+        if (n == 0) break;  // source shrank underneath us
+        remaining -= n;
+    }
+    return true;
+#else
+    (void)size;
+    return copyByReadWrite(in, out, src, error);
+#endif
+}
+
+// Returns true only when the destination now shares the source's extents.
+// Any failure leaves no destination file behind so the caller can copy.
+bool tryReflink(const fs::path& src, const fs::path& dst, mode_t perms)
+{
+#if defined(__linux__)
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, perms);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    bool ok = ::ioctl(out, FICLONE, in) == 0;
+    ::close(in);
+    ::close(out);
+    if (!ok) ::unlink(dst.c_str());
+    return ok;
+#elif defined(__APPLE__)
+    (void)perms;  // clonefile carries the source mode across
+    return ::clonefile(src.c_str(), dst.c_str(), 0) == 0;
+#else
+    (void)src; (void)dst; (void)perms;
+    return false;
+#endif
+}
+
+bool sameContents(const fs::path& a, const fs::path& b, bool& equal, std::string& error)
+{
+    equal = false;
+    int fa = ::open(a.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fa < 0) {
+        error = errnoMessage("Failed to open", a);
+        return false;
+    }
+    int fb = ::open(b.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fb < 0) {
+        error = errnoMessage("Failed to open", b);
+        ::close(fa);
+        return false;
+    }
+    char bufA[32 * 1024];
+    char bufB[32 * 1024];
+    bool ok = true;
+    for (;;) {
+        ssize_t na = ::read(fa, bufA, sizeof(bufA));
+        if (na < 0 && errno == EINTR) continue;
+        if (na < 0) { error = errnoMessage("Failed to read", a); ok = false; break; }
+        // Fill bufB to the same length (short reads are legal on any fd).
+        ssize_t nb = 0;
+        while (nb < na) {
+            ssize_t r = ::read(fb, bufB + nb, static_cast<size_t>(na - nb));
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            nb += r;
+        }
+        if (nb != na || std::memcmp(bufA, bufB, static_cast<size_t>(na)) != 0) break;
+        if (na == 0) { equal = true; break; }
+    }
+    ::close(fa);
+    ::close(fb);
+    return ok;
+}
+
+// Moves a leaf into place, degrading to a copy across devices.
+bool moveOrCopy(const fs::path& src, const fs::path& dst, std::string& error)
+{
+    if (::rename(src.c_str(), dst.c_str()) == 0) return true;
+    if (errno != EXDEV) {
+        error = errnoMessage("Failed to move", src);
+        return false;
+    }
+    bool fb = false;
+    return copyFile(src, dst, CopyMode::Copy, fb, error);
+}
+
+} // namespace
+
+bool listTree(const fs::path& root, TreeListing& out, std::string& error)
+{
+    std::error_code ec;
+    // The root itself may be a symlink (a developer install); walk its target.
+    for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path rel = it->path().lexically_relative(root);
+        auto st = it->symlink_status(ec);
+        if (ec) break;
+        if (fs::is_symlink(st))           out.links.push_back(rel);
+        else if (fs::is_directory(st))    out.dirs.push_back(rel);
+        else if (fs::is_regular_file(st)) out.files.push_back(rel);
+    }
+    if (ec) {
+        error = "Failed to walk '" + root.string() + "': " + ec.message();
+        return false;
+    }
+    // Sorted lexical order puts every parent before its children, so each
+    // directory is created exactly once and no worker ever races another on
+    // mkdir. It also makes any "first error" a caller reports deterministic.
+    std::sort(out.dirs.begin(), out.dirs.end());
+    std::sort(out.files.begin(), out.files.end());
+    std::sort(out.links.begin(), out.links.end());
+    return true;
+}
+
+bool copyFile(const fs::path& src, const fs::path& dst, CopyMode mode,
+              bool& usedFallback, std::string& error)
+{
+    usedFallback = false;
+
+    struct stat st {};
+    if (::stat(src.c_str(), &st) != 0) {
+        error = errnoMessage("Failed to stat", src);
+        return false;
+    }
+    const mode_t perms = st.st_mode & 07777;
+
+    std::error_code ec;
+    fs::remove(dst, ec);
+
+    if (mode == CopyMode::Reflink) {
+        if (tryReflink(src, dst, perms)) return true;
+        usedFallback = true;
+    }
+
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        error = errnoMessage("Failed to open", src);
+        return false;
+    }
+    int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, perms);
+    if (out < 0) {
+        error = errnoMessage("Failed to create", dst);
+        ::close(in);
+        return false;
+    }
+    bool ok = copyContents(in, out, st.st_size, src, error);
+    ::close(in);
+    if (::close(out) != 0 && ok) {
+        error = errnoMessage("Failed to finish writing", dst);
+        ok = false;
+    }
+    if (ok) ::chmod(dst.c_str(), perms);  // O_CREAT honours umask; restore exact bits
+    return ok;
+}
+
+bool copyTree(const fs::path& srcDir, const fs::path& dstDir, CopyMode mode,
+              WorkerPool* pool, CopyStats& stats, std::string& error)
+{
+    std::error_code ec;
+    TreeListing tree;
+    if (!listTree(srcDir, tree, error)) return false;
+    const auto& dirs = tree.dirs;
+    const auto& files = tree.files;
+    const auto& links = tree.links;
+
+    if (!fs::create_directories(dstDir, ec) && ec) {
+        error = "Failed to create '" + dstDir.string() + "': " + ec.message();
+        return false;
+    }
+    for (const auto& d : dirs) {
+        fs::create_directory(dstDir / d, ec);
+        if (ec) {
+            error = "Failed to create '" + (dstDir / d).string() + "': " + ec.message();
+            return false;
+        }
+    }
+    stats.directories += dirs.size();
+
+    for (const auto& l : links) {
+        fs::path target = fs::read_symlink(srcDir / l, ec);
+        if (!ec) fs::create_symlink(target, dstDir / l, ec);
+        if (ec) {
+            error = "Failed to recreate symlink '" + (dstDir / l).string() + "': " + ec.message();
+            return false;
+        }
+    }
+
+    std::vector<std::string> errors(files.size());
+    std::vector<uint8_t>     fallbacks(files.size(), 0);
+    std::vector<uint64_t>    sizes(files.size(), 0);
+    auto copyOne = [&](size_t i) {
+        bool fb = false;
+        if (copyFile(srcDir / files[i], dstDir / files[i], mode, fb, errors[i])) {
+            std::error_code sizeEc;
+            sizes[i] = fs::file_size(dstDir / files[i], sizeEc);
+        }
+        fallbacks[i] = fb ? 1 : 0;
+    };
+    if (pool && files.size() > 1) {
+        pool->parallelFor(files.size(), copyOne);
+    } else {
+        for (size_t i = 0; i < files.size(); ++i) copyOne(i);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!errors[i].empty()) {
+            error = errors[i];
+            return false;
+        }
+        stats.files += 1;
+        stats.bytes += sizes[i];
+        stats.reflinkFallbacks += fallbacks[i];
+    }
+    return true;
+}
+
+bool diffTrees(const fs::path& oldDir, const fs::path& newDir, WorkerPool* pool,
+               TreeDiff& out, std::string& error, const KnownLeaf& known)
+{
+    TreeListing oldTree, newTree;
+    if (!listTree(oldDir, oldTree, error) || !listTree(newDir, newTree, error))
+        return false;
+
+    // Both lists are sorted — one merge pass classifies every leaf.
+    std::vector<fs::path> common;
+    size_t i = 0, j = 0;
+    while (i < oldTree.files.size() || j < newTree.files.size()) {
+        if (j == newTree.files.size()
+            || (i < oldTree.files.size() && oldTree.files[i] < newTree.files[j])) {
+            out.removed.push_back(oldTree.files[i++]);
+        } else if (i == oldTree.files.size() || newTree.files[j] < oldTree.files[i]) {
+            out.added.push_back(newTree.files[j++]);
+        } else {
+            common.push_back(newTree.files[j]);
+            ++i; ++j;
+        }
+    }
+
+    std::vector<uint8_t>     equal(common.size(), 0);
+    std::vector<uint8_t>     settled(common.size(), 0);
+    std::vector<std::string> errors(common.size());
+    auto compareOne = [&](size_t k) {
+        std::error_code ec;
+        auto oldSize = fs::file_size(oldDir / common[k], ec);
+        auto newSize = ec ? 0 : fs::file_size(newDir / common[k], ec);
+        if (ec) {
+            errors[k] = "Failed to stat '" + common[k].string() + "': " + ec.message();
+            return;
+        }
+        if (oldSize != newSize) return;
+        bool same = false;
+        if (known && known(common[k], same)) {
+            equal[k] = same ? 1 : 0;
+            settled[k] = 1;
+            return;
+        }
+        if (sameContents(oldDir / common[k], newDir / common[k], same, errors[k]))
+            equal[k] = same ? 1 : 0;
+    };
+    if (pool && common.size() > 1) {
+        pool->parallelFor(common.size(), compareOne);
+    } else {
+        for (size_t k = 0; k < common.size(); ++k) compareOne(k);
+    }
+
+    for (size_t k = 0; k < common.size(); ++k) {
+        if (!errors[k].empty()) {
+            error = errors[k];
+            return false;
+        }
+        (equal[k] ? out.unchanged : out.changed).push_back(common[k]);
+        out.settledByKnown += settled[k];
+    }
+
+    std::error_code ec;
+    for (const auto& p : out.added)   out.bytesToWrite += fs::file_size(newDir / p, ec);
+    for (const auto& p : out.changed) out.bytesToWrite += fs::file_size(newDir / p, ec);
+    return true;
+}
+
+bool stageFromDiff(const fs::path& oldDir, const fs::path& newDir, const TreeDiff& diff,
+                   const fs::path& stagedDir, WorkerPool* pool, CopyStats& stats,
+                   std::string& error)
+{
+    TreeListing newTree;
+    if (!listTree(newDir, newTree, error)) return false;
+
+    std::error_code ec;
+    if (!fs::create_directories(stagedDir, ec) && ec) {
+        error = "Failed to create '" + stagedDir.string() + "': " + ec.message();
+        return false;
+    }
+    for (const auto& d : newTree.dirs) {
+        fs::create_directory(stagedDir / d, ec);
+        if (ec) {
+            error = "Failed to create '" + (stagedDir / d).string() + "': " + ec.message();
+            return false;
+        }
+    }
+    stats.directories += newTree.dirs.size();
+    for (const auto& l : newTree.links) {
+        fs::path target = fs::read_symlink(newDir / l, ec);
+        if (!ec) fs::create_symlink(target, stagedDir / l, ec);
+        if (ec) {
+            error = "Failed to recreate symlink '" + (stagedDir / l).string() + "': " + ec.message();
+            return false;
+        }
+    }
+
+    // Unchanged leaves: a hard link costs no data I/O and keeps the inode the
+    // running process may already have mapped.
+    for (const auto& p : diff.unchanged) {
+        fs::create_hard_link(oldDir / p, stagedDir / p, ec);
+        if (ec) {
+            bool fb = false;
+            if (!copyFile(oldDir / p, stagedDir / p, CopyMode::Reflink, fb, error))
+                return false;
+            ec.clear();
+        }
+    }
+
+    std::vector<fs::path> incoming;
+    incoming.reserve(diff.added.size() + diff.changed.size());
+    incoming.insert(incoming.end(), diff.added.begin(), diff.added.end());
+    incoming.insert(incoming.end(), diff.changed.begin(), diff.changed.end());
+
+    std::vector<std::string> errors(incoming.size());
+    auto placeOne = [&](size_t k) {
+        moveOrCopy(newDir / incoming[k], stagedDir / incoming[k], errors[k]);
+    };
+    if (pool && incoming.size() > 1) {
+        pool->parallelFor(incoming.size(), placeOne);
+    } else {
+        for (size_t k = 0; k < incoming.size(); ++k) placeOne(k);
+    }
+    for (const auto& e : errors) {
+        if (!e.empty()) {
+            error = e;
+            return false;
+        }
+    }
+    stats.files += incoming.size();
+    stats.bytes += diff.bytesToWrite;
+    return true;
+}
+
+bool exchangePaths(const fs::path& a, const fs::path& b, bool& atomic, std::string& error)
+{
+    atomic = false;
+#if defined(__linux__) && defined(SYS_renameat2)
+    // Called through syscall() so older glibc without the wrapper still
+    // builds; the flag value is fixed ABI.
+    constexpr unsigned kRenameExchange = 1u << 1;
+    if (::syscall(SYS_renameat2, AT_FDCWD, a.c_str(), AT_FDCWD, b.c_str(), kRenameExchange) == 0) {
+        atomic = true;
+        return true;
+    }
+    if (errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP) {
+        error = errnoMessage("Failed to exchange", a);
+        return false;
+    }
+#elif defined(__APPLE__)
+    if (::renamex_np(a.c_str(), b.c_str(), RENAME_SWAP) == 0) {
+        atomic = true;
+        return true;
+    }
+    if (errno != ENOTSUP && errno != EINVAL) {
+        error = errnoMessage("Failed to exchange", a);
+        return false;
+    }
+#endif
+    return exchangeByRenames(a, b, error);
+}
+
+bool exchangeByRenames(const fs::path& a, const fs::path& b, std::string& error, RenameFn rename)
+{
+    if (!rename) {
+        rename = [](const fs::path& from, const fs::path& to, std::error_code& ec) {
+            fs::rename(from, to, ec);
+        };
+    }
+    const fs::path tmp = b.parent_path() / (b.filename().string() + ".pm-swap");
+    std::error_code ec;
+    rename(b, tmp, ec);
+    if (!ec) {
+        rename(a, b, ec);
+        if (ec) {
+            std::error_code undo;
+            rename(tmp, b, undo);
+        } else {
+            rename(tmp, a, ec);
+            if (ec) {
+                // `a` is already live at `b`: move it back, then the old `b`,
+                // rather than report a failure that has half happened.
+                std::error_code undo;
+                rename(b, a, undo);
+                if (!undo) rename(tmp, b, undo);
+                if (undo) {
+                    error = "Failed to exchange '" + a.string() + "': " + ec.message()
+                          + "; could not undo (" + undo.message() + "), '" + b.string()
+                          + "' was left at '" + tmp.string() + "'";
+                    return false;
+                }
+            }
+        }
+    }
+    if (ec) {
+        error = "Failed to exchange '" + a.string() + "': " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+} // namespace fileops
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+class WorkerPool;
+
+// ---------------------------------------------------------------------------
+// Filesystem helpers for the module-side install paths
+// ---------------------------------------------------------------------------
+//
+// Everything that installs through package_manager_lib (installPlugin) never
+// touches these. They back the paths where the module itself places files on
+// disk — developer installs from an unpacked directory, staged upgrades, and
+// rollbacks. All functions report failure through a bool + error string
+// rather than throwing, matching the LogosMap { success, error } shape the
+// calling slots return.
+// ---------------------------------------------------------------------------
+
+namespace fileops {
+
+enum class CopyMode {
+    Copy,     // copy_file_range on Linux, a read/write loop elsewhere or when it is refused
+    Reflink,  // FICLONE / clonefile; per-file fallback to Copy when unsupported
+};
+
+struct CopyStats {
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    uint64_t directories = 0;
+    uint64_t reflinkFallbacks = 0;  // Reflink mode only — files that had to be copied
+};
+
+// Entries below a root, as paths relative to it, each list sorted so
+// parents precede children.
+struct TreeListing {
+    std::vector<std::filesystem::path> dirs;
+    std::vector<std::filesystem::path> files;  // regular files only
+    std::vector<std::filesystem::path> links;  // symlinks, not followed
+};
+
+bool listTree(const std::filesystem::path& root, TreeListing& out, std::string& error);
+
+// Copy one regular file, replacing `dst` if it exists. Preserves the
+// permission bits of `src` (plugins rely on the executable bit surviving).
+bool copyFile(const std::filesystem::path& src, const std::filesystem::path& dst,
+              CopyMode mode, bool& usedFallback, std::string& error);
+
+// Recreate `srcDir` under `dstDir` (which must not exist yet). Directories
+// are created once each, parent-before-child, on the calling thread; file
+// copies are then fanned out across `pool` when one is given. Symlinks
+// inside the tree are recreated as symlinks, not followed.
+bool copyTree(const std::filesystem::path& srcDir, const std::filesystem::path& dstDir,
+              CopyMode mode, WorkerPool* pool, CopyStats& stats, std::string& error);
+
+// Leaf-level comparison of two trees (relative paths, each list sorted).
+// Regular files are compared by size first and only then byte-for-byte, so
+// a typical patch release reads just the few files whose sizes match.
+// `known` may settle a same-size leaf without reading oldDir's copy (the
+// caller already holds its digest, say): it returns false to fall back to
+// the byte compare. It is called from pool threads.
+struct TreeDiff {
+    std::vector<std::filesystem::path> added;      // only in the new tree
+    std::vector<std::filesystem::path> changed;    // in both, contents differ
+    std::vector<std::filesystem::path> removed;    // only in the old tree
+    std::vector<std::filesystem::path> unchanged;  // in both, identical
+    uint64_t bytesToWrite = 0;                     // size of added + changed
+    uint64_t settledByKnown = 0;                   // same-size leaves `known` decided
+};
+
+using KnownLeaf = std::function<bool(const std::filesystem::path& rel, bool& equal)>;
+
+bool diffTrees(const std::filesystem::path& oldDir, const std::filesystem::path& newDir,
+               WorkerPool* pool, TreeDiff& out, std::string& error, const KnownLeaf& known = {});
+
+// Assemble `stagedDir` (which must not exist yet) with exactly newDir's
+// contents, writing only the diff: unchanged leaves are hard-linked from
+// oldDir (copied if the filesystem refuses), added/changed leaves are moved
+// out of newDir (copied when it sits on another device). Directory and
+// symlink structure comes from newDir. newDir is consumed.
+bool stageFromDiff(const std::filesystem::path& oldDir, const std::filesystem::path& newDir,
+                   const TreeDiff& diff, const std::filesystem::path& stagedDir,
+                   WorkerPool* pool, CopyStats& stats, std::string& error);
+
+// Atomically exchange two existing paths (files, directories or symlinks):
+// renameat2(RENAME_EXCHANGE) on Linux, renamex_np(RENAME_SWAP) on Apple.
+// Where neither is available (old kernel, filesystem without support) it
+// degrades to three renames through a temporary name and sets
+// `atomic = false`; observers may then briefly see `b` missing.
+bool exchangePaths(const std::filesystem::path& a, const std::filesystem::path& b,
+                   bool& atomic, std::string& error);
+
+// exchangePaths' degraded path: b -> "<b>.pm-swap", a -> b, "<b>.pm-swap" -> a.
+// When a step fails the earlier ones are undone, so on false both paths
+// hold what they held before. `rename` replaces std::filesystem::rename,
+// for tests that need a step to fail.
+using RenameFn = void (*)(const std::filesystem::path& from, const std::filesystem::path& to,
+                          std::error_code& ec);
+bool exchangeByRenames(const std::filesystem::path& a, const std::filesystem::path& b,
+                       std::string& error, RenameFn rename = nullptr);
+
+} // namespace fileops
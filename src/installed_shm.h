@@ -0,0 +1,372 @@
+#pragma once
+
+// ---------------------------------------------------------------------------
+// Shared-memory view of the installed index — layout and reader
+// ---------------------------------------------------------------------------
+//
+// Header-only and self-contained (C++17 and POSIX only), so any process on
+// the same host can copy or include it and read the installed packages and
+// their dependency graph straight out of the package manager's segment: no
+// IPC round trip, and nothing copied that the caller does not ask for.
+//
+// The package manager publishes with setSharedIndexPublishing (see
+// installed_shm_publisher.h) into a POSIX shared-memory object, by default
+// kDefaultName. The segment is created 0644 and readers map it read-only.
+//
+// Layout (host byte order):
+//   Header   64 bytes, see below
+//   payload  Record[packageCount]    sorted by name
+//            Edge[edgeCount]         forward dependency edges, by record
+//            uint32_t[reverseCount]  reverse edges (dependent records)
+//            string bytes            Str slices point in here
+//
+// Consistency is a seqlock: the publisher makes `seq` odd, rewrites the
+// payload in place and makes it even again. A read copies `seq`, reads,
+// and retries when `seq` was odd or has moved. Every View accessor bounds-
+// checks against the payload it was given, so a read that overlaps a write
+// sees garbage but never faults; the retry then discards it. The segment
+// only ever grows; a reader remaps when the payload outgrows its mapping.
+//
+// When the publisher shuts down it sets FlagRetired and unlinks the name:
+// reads then fail and a client reopens later (or falls back to IPC). A
+// publisher that died without retiring is detected by publisherAlive().
+// ---------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace installed_shm {
+
+constexpr char     kMagic[8] = {'L', 'P', 'M', 'S', 'H', 'M', '0', '1'};
+constexpr uint32_t kLayoutVersion = 1;
+constexpr const char* kDefaultName = "/logos-package-manager";
+constexpr uint32_t kNone = UINT32_MAX;
+
+enum : uint32_t { FlagRetired = 1 };
+enum : uint8_t { InstallEmbedded = 0, InstallUser = 1 };
+enum : uint8_t { KindCore = 0, KindUi = 1 };
+
+struct Header {
+    char                  magic[8];
+    uint32_t              layoutVersion;
+    uint32_t              headerSize;    // payload offset
+    std::atomic<uint64_t> seq;           // odd while the publisher writes; generation = seq / 2
+    uint64_t              capacity;      // payload bytes the segment has room for
+    uint64_t              payloadSize;
+    uint32_t              packageCount;
+    uint32_t              edgeCount;
+    uint32_t              reverseCount;
+    uint32_t              flags;
+    uint32_t              publisherPid;
+    uint32_t              reserved;
+};
+static_assert(sizeof(Header) == 64, "Header layout is shared between processes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "seq must be address-free");
+
+struct Str {
+    uint32_t offset;  // into the string bytes
+    uint32_t length;
+};
+
+struct Record {
+    Str      name, displayName, version, type, category, installDir, mainFilePath, hashRoot;
+    uint8_t  installType;  // InstallEmbedded / InstallUser
+    uint8_t  kind;         // KindCore / KindUi
+    uint16_t reserved;
+    uint32_t depBegin, depCount;          // into Edge[]
+    uint32_t dependentBegin, dependentCount;  // into the reverse edges
+};
+static_assert(sizeof(Record) == 84, "Record layout is shared between processes");
+
+struct Edge {
+    Str      name;    // dependency as named in the manifest
+    uint32_t target;  // record of the installed package of that name, or kNone
+};
+static_assert(sizeof(Edge) == 12, "Edge layout is shared between processes");
+
+// The header fields a read copies between its two looks at `seq`.
+struct Counts {
+    uint64_t payloadSize;
+    uint32_t packageCount;
+    uint32_t edgeCount;
+    uint32_t reverseCount;
+    uint32_t flags;
+};
+
+// One snapshot of the payload. Only valid inside Reader::read's callback.
+class View {
+public:
+    View(const char* payload, size_t size, const Counts& h, uint64_t generation)
+        : m_generation(generation)
+    {
+        // Sections are carved out of what was actually mapped, so counts
+        // torn by a concurrent write can only shrink what is visible.
+        size_t at = 0;
+        auto take = [&](size_t count, size_t width, size_t& outCount) {
+            const size_t room = at <= size ? (size - at) / width : 0;
+            outCount = std::min(count, room);
+            const char* p = payload + at;
+            at += outCount * width;
+            return p;
+        };
+        m_records = reinterpret_cast<const Record*>(take(h.packageCount, sizeof(Record), m_recordCount));
+        m_edges = reinterpret_cast<const Edge*>(take(h.edgeCount, sizeof(Edge), m_edgeCount));
+        m_reverse = reinterpret_cast<const uint32_t*>(take(h.reverseCount, sizeof(uint32_t), m_reverseCount));
+        m_strings = payload + std::min(at, size);
+        m_stringBytes = at <= size ? size - at : 0;
+    }
+
+    uint64_t generation() const { return m_generation; }
+    uint32_t size() const { return static_cast<uint32_t>(m_recordCount); }
+
+    // First record called `name`, or kNone. A package installed both
+    // embedded and user has a record for each, embedded first.
+    uint32_t find(std::string_view name) const
+    {
+        size_t lo = 0, hi = m_recordCount;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (str(m_records[mid].name) < name) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < m_recordCount && str(m_records[lo].name) == name ? static_cast<uint32_t>(lo) : kNone;
+    }
+
+    std::string_view name(uint32_t i) const { return i < m_recordCount ? str(m_records[i].name) : std::string_view(); }
+    std::string_view displayName(uint32_t i) const { return field(i, &Record::displayName); }
+    std::string_view version(uint32_t i) const { return field(i, &Record::version); }
+    std::string_view type(uint32_t i) const { return field(i, &Record::type); }
+    std::string_view category(uint32_t i) const { return field(i, &Record::category); }
+    std::string_view installDir(uint32_t i) const { return field(i, &Record::installDir); }
+    std::string_view mainFilePath(uint32_t i) const { return field(i, &Record::mainFilePath); }
+    std::string_view hashRoot(uint32_t i) const { return field(i, &Record::hashRoot); }
+    bool embedded(uint32_t i) const { return i < m_recordCount && m_records[i].installType == InstallEmbedded; }
+    bool uiPlugin(uint32_t i) const { return i < m_recordCount && m_records[i].kind == KindUi; }
+
+    uint32_t dependencyCount(uint32_t i) const { return i < m_recordCount ? m_records[i].depCount : 0; }
+    std::string_view dependencyName(uint32_t i, uint32_t k) const
+    {
+        const Edge* e = edge(i, k);
+        return e ? str(e->name) : std::string_view();
+    }
+    // Record of the k-th dependency, or kNone when it is not installed.
+    uint32_t dependencyTarget(uint32_t i, uint32_t k) const
+    {
+        const Edge* e = edge(i, k);
+        return e && e->target < m_recordCount ? e->target : kNone;
+    }
+
+    uint32_t dependentCount(uint32_t i) const { return i < m_recordCount ? m_records[i].dependentCount : 0; }
+    uint32_t dependent(uint32_t i, uint32_t k) const
+    {
+        if (i >= m_recordCount || k >= m_records[i].dependentCount) return kNone;
+        const size_t at = size_t(m_records[i].dependentBegin) + k;
+        return at < m_reverseCount && m_reverse[at] < m_recordCount ? m_reverse[at] : kNone;
+    }
+
+private:
+    std::string_view str(Str s) const
+    {
+        if (s.offset > m_stringBytes || s.length > m_stringBytes - s.offset) return std::string_view();
+        return std::string_view(m_strings + s.offset, s.length);
+    }
+    std::string_view field(uint32_t i, Str Record::*member) const
+    {
+        return i < m_recordCount ? str(m_records[i].*member) : std::string_view();
+    }
+    const Edge* edge(uint32_t i, uint32_t k) const
+    {
+        if (i >= m_recordCount || k >= m_records[i].depCount) return nullptr;
+        const size_t at = size_t(m_records[i].depBegin) + k;
+        return at < m_edgeCount ? &m_edges[at] : nullptr;
+    }
+
+    uint64_t        m_generation;
+    const Record*   m_records;
+    size_t          m_recordCount;
+    const Edge*     m_edges;
+    size_t          m_edgeCount;
+    const uint32_t* m_reverse;
+    size_t          m_reverseCount;
+    const char*     m_strings;
+    size_t          m_stringBytes;
+};
+
+// A package copied out of a snapshot.
+struct Package {
+    std::string              name, displayName, version, type, category, installDir, mainFilePath, hashRoot;
+    bool                     embedded = false;
+    bool                     uiPlugin = false;
+    std::vector<std::string> dependencies;
+};
+
+class Reader {
+public:
+    Reader() = default;
+    ~Reader() { close(); }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    bool open(const std::string& name = kDefaultName, std::string* error = nullptr)
+    {
+        close();
+        m_fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (m_fd < 0) return fail(error, "Failed to open '" + name + "': " + std::strerror(errno));
+        if (!remap()) {
+            close();
+            return fail(error, "Failed to map '" + name + "' (not yet initialised?)");
+        }
+        const Header* h = header();
+        if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->layoutVersion != kLayoutVersion
+            || h->headerSize != sizeof(Header)) {
+            close();
+            return fail(error, "'" + name + "' is not a package manager index of this layout");
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (m_map != MAP_FAILED) ::munmap(m_map, m_mapped);
+        if (m_fd >= 0) ::close(m_fd);
+        m_map = MAP_FAILED;
+        m_mapped = 0;
+        m_fd = -1;
+    }
+
+    bool isOpen() const { return m_map != MAP_FAILED; }
+
+    // Runs fn(const View&) over one consistent snapshot, rerunning it while
+    // the publisher is mid-write. fn must only read; what it does on a
+    // discarded run must be overwritten by the next. Returns false when
+    // closed, retired, or still contended after many attempts.
+    template <typename Fn>
+    bool read(Fn&& fn)
+    {
+        if (!isOpen()) return false;
+        for (int attempt = 0; attempt < 10000; ++attempt) {
+            const Header* h = header();
+            const uint64_t s1 = h->seq.load(std::memory_order_acquire);
+            if (s1 & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            const Counts c{h->payloadSize, h->packageCount, h->edgeCount, h->reverseCount, h->flags};
+            if (c.flags & FlagRetired) return false;
+            if (c.payloadSize > m_mapped - sizeof(Header)) {
+                if (!remap()) return false;
+                continue;
+            }
+            fn(View(static_cast<const char*>(m_map) + sizeof(Header), c.payloadSize, c, s1 / 2));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (h->seq.load(std::memory_order_relaxed) == s1) return true;
+        }
+        return false;
+    }
+
+    // Publish count of the last consistent snapshot (0 before the first).
+    uint64_t generation()
+    {
+        uint64_t g = 0;
+        read([&](const View& v) { g = v.generation(); });
+        return g;
+    }
+
+    // False once the publishing process has exited without retiring.
+    bool publisherAlive() const
+    {
+        if (!isOpen()) return false;
+        const pid_t pid = static_cast<pid_t>(header()->publisherPid);
+        return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM);
+    }
+
+    std::optional<Package> find(std::string_view name)
+    {
+        std::optional<Package> out;
+        const bool ok = read([&](const View& v) {
+            out.reset();
+            const uint32_t i = v.find(name);
+            if (i == kNone) return;
+            Package p;
+            p.name = std::string(v.name(i));
+            p.displayName = std::string(v.displayName(i));
+            p.version = std::string(v.version(i));
+            p.type = std::string(v.type(i));
+            p.category = std::string(v.category(i));
+            p.installDir = std::string(v.installDir(i));
+            p.mainFilePath = std::string(v.mainFilePath(i));
+            p.hashRoot = std::string(v.hashRoot(i));
+            p.embedded = v.embedded(i);
+            p.uiPlugin = v.uiPlugin(i);
+            for (uint32_t k = 0; k < v.dependencyCount(i); ++k) p.dependencies.emplace_back(v.dependencyName(i, k));
+            out = std::move(p);
+        });
+        return ok ? out : std::nullopt;
+    }
+
+    std::vector<std::string> names()
+    {
+        std::vector<std::string> out;
+        read([&](const View& v) {
+            out.clear();
+            for (uint32_t i = 0; i < v.size(); ++i) out.emplace_back(v.name(i));
+        });
+        return out;
+    }
+
+    // Installed packages that list `name` as a dependency.
+    std::vector<std::string> dependents(std::string_view name)
+    {
+        std::vector<std::string> out;
+        read([&](const View& v) {
+            out.clear();
+            const uint32_t i = v.find(name);
+            for (uint32_t k = 0; i != kNone && k < v.dependentCount(i); ++k) {
+                const uint32_t d = v.dependent(i, k);
+                if (d != kNone) out.emplace_back(v.name(d));
+            }
+        });
+        return out;
+    }
+
+private:
+    const Header* header() const { return static_cast<const Header*>(m_map); }
+
+    bool remap()
+    {
+        struct stat st {};
+        if (::fstat(m_fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) return false;
+        if (m_map != MAP_FAILED) ::munmap(m_map, m_mapped);
+        // On failure the reader is left closed to reads (isOpen() false).
+        m_mapped = static_cast<size_t>(st.st_size);
+        m_map = ::mmap(nullptr, m_mapped, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (m_map == MAP_FAILED) m_mapped = 0;
+        return m_map != MAP_FAILED;
+    }
+
+    static bool fail(std::string* error, const std::string& message)
+    {
+        if (error) *error = message;
+        return false;
+    }
+
+    int    m_fd = -1;
+    void*  m_map = MAP_FAILED;
+    size_t m_mapped = 0;
+};
+
+} // namespace installed_shm
@@ -0,0 +1,243 @@
+#include "installed_shm_publisher.h"
+#include "installed_shm.h"
+#include "package_index.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using installed_shm::Header;
+
+constexpr size_t kInitialCapacity = 64 * 1024;
+
+// Runs `write` inside the seqlock's write window.
+template <typename Fn>
+void writeWindow(Header* h, Fn&& write)
+{
+    const uint64_t s = h->seq.load(std::memory_order_relaxed);
+    h->seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    write();
+    h->seq.store(s + 2, std::memory_order_release);
+}
+
+// Clears the way for a new segment under `name`. One left by a publisher
+// that has exited is marked retired, so readers still mapping it stop
+// trusting it, and unlinked; one whose publisher is still running is left
+// alone and reported.
+bool retireExisting(const std::string& name, std::string& error)
+{
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) return true;
+    bool live = false;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+        void* map = ::mmap(nullptr, sizeof(Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            auto* h = static_cast<Header*>(map);
+            if (std::memcmp(h->magic, installed_shm::kMagic, sizeof(installed_shm::kMagic)) == 0) {
+                const pid_t pid = static_cast<pid_t>(h->publisherPid);
+                live = !(h->flags & installed_shm::FlagRetired) && pid > 0
+                    && (::kill(pid, 0) == 0 || errno == EPERM);
+                if (live) {
+                    error = "'" + name + "' is already published by process " + std::to_string(pid);
+                } else {
+                    writeWindow(h, [h]() { h->flags |= installed_shm::FlagRetired; });
+                }
+            }
+            ::munmap(map, sizeof(Header));
+        }
+    }
+    ::close(fd);
+    if (live) return false;
+    ::shm_unlink(name.c_str());
+    return true;
+}
+
+} // namespace
+
+bool InstalledShmPublisher::open(const std::string& name, std::string& error)
+{
+    close();
+    if (name.size() < 2 || name[0] != '/' || name.find('/', 1) != std::string::npos) {
+        error = "Shared memory name must be '/' followed by a name without '/'";
+        return false;
+    }
+    if (!retireExisting(name, error)) return false;
+    m_fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        error = "Failed to create '" + name + "': " + std::strerror(errno);
+        return false;
+    }
+    // Readable by co-located processes regardless of the umask.
+    ::fchmod(m_fd, 0644);
+    m_name = name;
+    if (!resize(kInitialCapacity, error)) {
+        close();
+        return false;
+    }
+    auto* h = new (m_map) Header{};
+    std::memcpy(h->magic, installed_shm::kMagic, sizeof(installed_shm::kMagic));
+    h->layoutVersion = installed_shm::kLayoutVersion;
+    h->headerSize = sizeof(Header);
+    h->capacity = kInitialCapacity;
+    h->publisherPid = static_cast<uint32_t>(::getpid());
+    m_generation = 0;
+    return true;
+}
+
+void InstalledShmPublisher::close()
+{
+    if (m_map) {
+        auto* h = static_cast<Header*>(m_map);
+        writeWindow(h, [h]() { h->flags |= installed_shm::FlagRetired; });
+        ::munmap(m_map, m_mapped);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        ::shm_unlink(m_name.c_str());
+    }
+    m_map = nullptr;
+    m_mapped = 0;
+    m_fd = -1;
+    m_name.clear();
+}
+
+bool InstalledShmPublisher::resize(size_t payloadCapacity, std::string& error)
+{
+    const size_t size = sizeof(Header) + payloadCapacity;
+    if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+        error = "Failed to size '" + m_name + "': " + std::strerror(errno);
+        return false;
+    }
+    void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED) {
+        error = "Failed to map '" + m_name + "': " + std::strerror(errno);
+        return false;
+    }
+    if (m_map) ::munmap(m_map, m_mapped);
+    m_map = map;
+    m_mapped = size;
+    return true;
+}
+
+bool InstalledShmPublisher::publish(const PackageIndex& index, std::string& error)
+{
+    using installed_shm::Edge;
+    using installed_shm::Record;
+    using installed_shm::Str;
+    if (!isOpen()) {
+        error = "Shared index is not open";
+        return false;
+    }
+
+    // Records sorted by name (embedded before user on a tie) so readers
+    // can binary search; position[row] is a row's record.
+    const size_t n = index.size();
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const int c = index.name(a).compare(index.name(b));
+        return c != 0 ? c < 0 : index.installType(a) < index.installType(b);
+    });
+    std::vector<uint32_t> position(n);
+    for (uint32_t i = 0; i < n; ++i) position[order[i]] = i;
+
+    // Equal strings (a dependency and the package it names) share bytes.
+    std::string strings;
+    std::unordered_map<std::string_view, Str> seen;
+    auto add = [&](std::string_view s) {
+        auto [it, inserted] = seen.try_emplace(s, Str{0, 0});
+        if (inserted) {
+            it->second = Str{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(s.size())};
+            strings.append(s);
+        }
+        return it->second;
+    };
+
+    std::vector<Record> records(n);
+    std::vector<Edge> edges;
+    std::vector<uint32_t> dependentCount(n, 0);
+    for (uint32_t i = 0; i < n; ++i) {
+        const uint32_t row = order[i];
+        Record& r = records[i];
+        std::memset(&r, 0, sizeof(r));
+        r.name = add(index.name(row));
+        r.displayName = add(index.displayName(row));
+        r.version = add(index.version(row));
+        r.type = add(index.type(row));
+        r.category = add(index.category(row));
+        r.installDir = add(index.installDir(row));
+        r.mainFilePath = add(index.mainFilePath(row));
+        r.hashRoot = add(index.hashRoot(row));
+        r.installType = index.installType(row) == 0 ? installed_shm::InstallEmbedded : installed_shm::InstallUser;
+        r.kind = index.kind(row) == PackageIndex::KindUi ? installed_shm::KindUi : installed_shm::KindCore;
+        r.depBegin = static_cast<uint32_t>(edges.size());
+        r.depCount = static_cast<uint32_t>(index.dependencyCount(row));
+        for (size_t k = 0; k < index.dependencyCount(row); ++k) {
+            const std::string_view dep = index.str(index.dependencyId(row, k));
+            const uint32_t targetRow = index.findRow(dep);
+            const uint32_t target = targetRow == PackageIndex::kNoId ? installed_shm::kNone : position[targetRow];
+            edges.push_back(Edge{add(dep), target});
+            if (target != installed_shm::kNone) ++dependentCount[target];
+        }
+    }
+
+    // Reverse edges as CSR over the forward ones.
+    std::vector<uint32_t> reverse(edges.size());
+    uint32_t begin = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        records[i].dependentBegin = begin;
+        begin += dependentCount[i];
+    }
+    size_t reverseCount = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        for (uint32_t k = 0; k < records[i].depCount; ++k) {
+            const uint32_t t = edges[records[i].depBegin + k].target;
+            if (t == installed_shm::kNone) continue;
+            reverse[records[t].dependentBegin + records[t].dependentCount++] = i;
+            ++reverseCount;
+        }
+    }
+    reverse.resize(reverseCount);
+
+    const size_t payload = records.size() * sizeof(Record) + edges.size() * sizeof(Edge)
+                         + reverse.size() * sizeof(uint32_t) + strings.size();
+    if (sizeof(Header) + payload > m_mapped) {
+        const size_t grown = std::max(payload, 2 * (m_mapped - sizeof(Header)));
+        if (!resize(grown, error)) return false;
+    }
+
+    auto* h = static_cast<Header*>(m_map);
+    char* out = static_cast<char*>(m_map) + sizeof(Header);
+    writeWindow(h, [&]() {
+        auto put = [&out](const void* data, size_t bytes) {
+            if (bytes) std::memcpy(out, data, bytes);
+            out += bytes;
+        };
+        put(records.data(), records.size() * sizeof(Record));
+        put(edges.data(), edges.size() * sizeof(Edge));
+        put(reverse.data(), reverse.size() * sizeof(uint32_t));
+        put(strings.data(), strings.size());
+        h->capacity = m_mapped - sizeof(Header);
+        h->payloadSize = payload;
+        h->packageCount = static_cast<uint32_t>(records.size());
+        h->edgeCount = static_cast<uint32_t>(edges.size());
+        h->reverseCount = static_cast<uint32_t>(reverse.size());
+    });
+    m_generation = h->seq.load(std::memory_order_relaxed) / 2;
+    return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class PackageIndex;
+
+// ---------------------------------------------------------------------------
+// Publisher side of the shared-memory installed index (layout and reader in
+// installed_shm.h)
+// ---------------------------------------------------------------------------
+//
+// open() creates the named POSIX shared-memory object. A segment left
+// under that name by a publisher that has since exited is retired and
+// unlinked first, never truncated: its readers may still have it mapped,
+// and shrinking a mapped object faults them. A segment whose publisher is
+// still running is not taken over; open() fails instead. publish() encodes an index off to the side,
+// grows the segment if the payload no longer fits (geometrically, never
+// shrinking), then rewrites the payload inside the seqlock's write window.
+// close() retires the segment and unlinks the name.
+//
+// One publisher per object; not synchronised (the module calls it from
+// the module thread).
+// ---------------------------------------------------------------------------
+
+class InstalledShmPublisher {
+public:
+    InstalledShmPublisher() = default;
+    ~InstalledShmPublisher() { close(); }
+    InstalledShmPublisher(const InstalledShmPublisher&) = delete;
+    InstalledShmPublisher& operator=(const InstalledShmPublisher&) = delete;
+
+    bool open(const std::string& name, std::string& error);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    const std::string& name() const { return m_name; }
+
+    bool publish(const PackageIndex& index, std::string& error);
+
+    // Publishes so far (readers' View::generation()).
+    uint64_t generation() const { return m_generation; }
+    // Size of the segment.
+    size_t bytes() const { return m_mapped; }
+
+private:
+    bool resize(size_t payloadCapacity, std::string& error);
+
+    std::string m_name;
+    int         m_fd = -1;
+    void*       m_map = nullptr;
+    size_t      m_mapped = 0;
+    uint64_t    m_generation = 0;
+};
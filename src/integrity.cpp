@@ -0,0 +1,416 @@
+#include "integrity.h"
+#include "file_ops.h"
+#include "worker_pool.h"
+
+#include <logos_json.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace integrity {
+
+namespace {
+
+// ---- SHA-256 (FIPS 180-4) --------------------------------------------------
+
+const uint32_t kRound[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+class Sha256 {
+public:
+    void update(const void* data, size_t size)
+    {
+        const auto* p = static_cast<const uint8_t*>(data);
+        m_length += size;
+        if (m_buffered) {
+            const size_t take = std::min(size, sizeof(m_buffer) - m_buffered);
+            std::memcpy(m_buffer + m_buffered, p, take);
+            m_buffered += take;
+            p += take;
+            size -= take;
+            if (m_buffered < sizeof(m_buffer)) return;
+            block(m_buffer);
+            m_buffered = 0;
+        }
+        for (; size >= 64; p += 64, size -= 64) block(p);
+        std::memcpy(m_buffer, p, size);
+        m_buffered = size;
+    }
+
+    Digest finish()
+    {
+        const uint64_t bits = m_length * 8;
+        const uint8_t pad = 0x80;
+        const uint8_t zero = 0;
+        update(&pad, 1);
+        while (m_buffered != 56) update(&zero, 1);
+        uint8_t len[8];
+        for (int i = 0; i < 8; ++i) len[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        update(len, 8);
+        Digest out;
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 4; ++j) out[i * 4 + j] = static_cast<uint8_t>(m_state[i] >> (24 - 8 * j));
+        }
+        return out;
+    }
+
+private:
+    void block(const uint8_t* p)
+    {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = uint32_t(p[i * 4]) << 24 | uint32_t(p[i * 4 + 1]) << 16
+                 | uint32_t(p[i * 4 + 2]) << 8 | uint32_t(p[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+        uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g))
+                              + kRound[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+        m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+    }
+
+    uint32_t m_state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    uint8_t  m_buffer[64] = {};
+    size_t   m_buffered = 0;
+    uint64_t m_length = 0;
+};
+
+// ---- Tree walking ----------------------------------------------------------
+
+// Regular files under `root`, '/'-separated and sorted by that string.
+bool listFiles(const fs::path& root, std::vector<std::string>& out, std::string& error)
+{
+    fileops::TreeListing tree;
+    if (!fileops::listTree(root, tree, error)) return false;
+    out.reserve(tree.files.size());
+    for (const auto& f : tree.files) out.push_back(f.generic_string());
+    std::sort(out.begin(), out.end());
+    return true;
+}
+
+// Hashes records[i] for every i in `which`, in parallel when there is a
+// pool; fills digest, size and mtime.
+bool hashFiles(const fs::path& root, std::vector<FileRecord>& records,
+               const std::vector<size_t>& which, WorkerPool* pool, uint64_t& bytes,
+               std::string& error, const Pacer& pace)
+{
+    std::vector<std::string> errors(which.size());
+    auto hashOne = [&](size_t k) {
+        FileRecord& r = records[which[k]];
+        const fs::path p = root / r.path;
+        if (fingerprint(p, r.size, r.mtimeNs, errors[k])) sha256File(p, r.digest, errors[k], pace);
+    };
+    if (pace) {
+        // Sequential, so a cancelled pass stops at the file it is on.
+        for (size_t k = 0; k < which.size(); ++k) {
+            hashOne(k);
+            if (!errors[k].empty()) break;
+        }
+    } else if (pool && which.size() > 1) {
+        pool->parallelFor(which.size(), hashOne);
+    } else {
+        for (size_t k = 0; k < which.size(); ++k) hashOne(k);
+    }
+    for (size_t k = 0; k < which.size(); ++k) {
+        if (!errors[k].empty()) {
+            error = errors[k];
+            return false;
+        }
+        bytes += records[which[k]].size;
+    }
+    return true;
+}
+
+} // namespace
+
+Digest sha256(const void* data, size_t size)
+{
+    Sha256 h;
+    h.update(data, size);
+    return h.finish();
+}
+
+bool sha256File(const fs::path& path, Digest& out, std::string& error, const Pacer& pace)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "Failed to open '" + path.string() + "': " + std::strerror(errno);
+        return false;
+    }
+    Sha256 h;
+    char buf[64 * 1024];
+    for (;;) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = "Failed to read '" + path.string() + "': " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        h.update(buf, static_cast<size_t>(n));
+        if (pace && !pace(static_cast<uint64_t>(n))) {
+            error = "cancelled";
+            ::close(fd);
+            return false;
+        }
+    }
+    ::close(fd);
+    out = h.finish();
+    return true;
+}
+
+std::string toHex(const Digest& digest)
+{
+    static const char kHex[] = "0123456789abcdef";
+    std::string out(digest.size() * 2, '0');
+    for (size_t i = 0; i < digest.size(); ++i) {
+        out[i * 2] = kHex[digest[i] >> 4];
+        out[i * 2 + 1] = kHex[digest[i] & 0xf];
+    }
+    return out;
+}
+
+bool fromHex(std::string_view hex, Digest& out)
+{
+    if (hex.size() != out.size() * 2) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < out.size(); ++i) {
+        const int hi = nibble(hex[i * 2]);
+        const int lo = nibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+    return true;
+}
+
+Digest merkleRoot(const std::vector<FileRecord>& files)
+{
+    if (files.empty()) return sha256(nullptr, 0);
+    std::vector<Digest> level;
+    level.reserve(files.size());
+    for (const auto& f : files) {
+        Sha256 h;
+        const uint8_t tag = 0x00;
+        h.update(&tag, 1);
+        h.update(f.path.data(), f.path.size());
+        h.update(&tag, 1);
+        h.update(f.digest.data(), f.digest.size());
+        level.push_back(h.finish());
+    }
+    while (level.size() > 1) {
+        size_t out = 0;
+        for (size_t i = 0; i + 1 < level.size(); i += 2) {
+            Sha256 h;
+            const uint8_t tag = 0x01;
+            h.update(&tag, 1);
+            h.update(level[i].data(), level[i].size());
+            h.update(level[i + 1].data(), level[i + 1].size());
+            level[out++] = h.finish();
+        }
+        if (level.size() % 2) level[out++] = level.back();
+        level.resize(out);
+    }
+    return level[0];
+}
+
+bool fingerprint(const fs::path& path, uint64_t& size, int64_t& mtimeNs, std::string& error)
+{
+    std::error_code ec;
+    size = fs::file_size(path, ec);
+    if (!ec) {
+        const auto t = fs::last_write_time(path, ec);
+        mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+    if (ec) {
+        error = "Failed to stat '" + path.string() + "': " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+bool snapshot(const fs::path& installDir, WorkerPool* pool, Baseline& out, std::string& error,
+              const Pacer& pace)
+{
+    std::vector<std::string> paths;
+    if (!listFiles(installDir, paths, error)) return false;
+    out.files.assign(paths.size(), FileRecord{});
+    std::vector<size_t> all(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        out.files[i].path = std::move(paths[i]);
+        all[i] = i;
+    }
+    uint64_t bytes = 0;
+    return hashFiles(installDir, out.files, all, pool, bytes, error, pace);
+}
+
+bool verify(const fs::path& installDir, Baseline& baseline, bool rehash, WorkerPool* pool,
+            Report& out, bool& refreshed, std::string& error, const Pacer& pace)
+{
+    refreshed = false;
+    std::vector<std::string> paths;
+    if (!listFiles(installDir, paths, error)) return false;
+
+    // Merge the listing with the baseline. `found` is the tree as it is now;
+    // expected[k] is the baseline record for found[k], or -1 for extras.
+    std::vector<FileRecord> found;
+    std::vector<long> expected;
+    std::vector<size_t> toHash;
+    found.reserve(paths.size());
+    expected.reserve(paths.size());
+    const auto& files = baseline.files;
+    size_t i = 0, j = 0;
+    while (i < files.size() || j < paths.size()) {
+        if (j == paths.size() || (i < files.size() && files[i].path < paths[j])) {
+            out.missing.push_back(files[i++].path);
+            continue;
+        }
+        FileRecord r;
+        r.path = std::move(paths[j]);
+        if (i < files.size() && files[i].path == r.path) {
+            std::string statError;
+            if (!rehash && fingerprint(installDir / r.path, r.size, r.mtimeNs, statError)
+                && r.size == files[i].size && r.mtimeNs == files[i].mtimeNs) {
+                r.digest = files[i].digest;
+                ++out.filesSkipped;
+            } else {
+                toHash.push_back(found.size());
+            }
+            expected.push_back(static_cast<long>(i++));
+        } else {
+            toHash.push_back(found.size());
+            expected.push_back(-1);
+        }
+        found.push_back(std::move(r));
+        ++j;
+    }
+
+    if (!hashFiles(installDir, found, toHash, pool, out.bytesHashed, error, pace)) return false;
+    out.filesHashed = toHash.size();
+
+    for (size_t k = 0; k < found.size(); ++k) {
+        if (expected[k] < 0) {
+            out.extra.push_back(found[k].path);
+            continue;
+        }
+        FileRecord& want = baseline.files[static_cast<size_t>(expected[k])];
+        if (found[k].digest != want.digest) {
+            out.mismatched.push_back(found[k].path);
+        } else if (found[k].size != want.size || found[k].mtimeNs != want.mtimeNs) {
+            // Same content, touched: trust the new fingerprint next time.
+            want.size = found[k].size;
+            want.mtimeNs = found[k].mtimeNs;
+            refreshed = true;
+        }
+    }
+    out.root = merkleRoot(found);
+    return true;
+}
+
+bool loadBaseline(const fs::path& file, Baseline& out)
+{
+    try {
+        std::ifstream in(file);
+        if (!in) return false;
+        std::stringstream buf;
+        buf << in.rdbuf();
+        const LogosMap doc = LogosMap::parse(buf.str());
+        Baseline b;
+        b.installTime = doc.value("installTime", false);
+        b.manifestRoot = doc.value("manifestRoot", "");
+        b.manifestSize = doc.value("manifestSize", uint64_t(0));
+        b.manifestMtimeNs = doc.value("manifestMtimeNs", int64_t(0));
+        for (const auto& f : doc.at("files")) {
+            FileRecord r;
+            r.path = f.at("path").get<std::string>();
+            r.size = f.at("size").get<uint64_t>();
+            r.mtimeNs = f.at("mtimeNs").get<int64_t>();
+            if (!fromHex(f.at("sha256").get<std::string>(), r.digest)) return false;
+            b.files.push_back(std::move(r));
+        }
+        if (!std::is_sorted(b.files.begin(), b.files.end(),
+                            [](const FileRecord& x, const FileRecord& y) { return x.path < y.path; }))
+            return false;
+        out = std::move(b);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool saveBaseline(const fs::path& file, const Baseline& baseline, std::string& error)
+{
+    LogosMap doc = LogosMap::object();
+    doc["installTime"] = baseline.installTime;
+    doc["manifestRoot"] = baseline.manifestRoot;
+    doc["manifestSize"] = baseline.manifestSize;
+    doc["manifestMtimeNs"] = baseline.manifestMtimeNs;
+    LogosList files = LogosList::array();
+    for (const auto& f : baseline.files) {
+        LogosMap entry;
+        entry["path"] = f.path;
+        entry["size"] = f.size;
+        entry["mtimeNs"] = f.mtimeNs;
+        entry["sha256"] = toHex(f.digest);
+        files.push_back(entry);
+    }
+    doc["files"] = files;
+
+    // Write-then-rename so a crash never leaves a truncated baseline.
+    std::error_code ec;
+    fs::create_directories(file.parent_path(), ec);
+    const fs::path tmp = file.string() + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << doc.dump();
+        if (!out) {
+            error = "Failed to write '" + tmp.string() + "'";
+            return false;
+        }
+    }
+    fs::rename(tmp, file, ec);
+    if (ec) {
+        error = "Failed to replace '" + file.string() + "': " + ec.message();
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace integrity
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class WorkerPool;
+
+// ---------------------------------------------------------------------------
+// Installed-package integrity audits
+// ---------------------------------------------------------------------------
+//
+// The Merkle root in manifest.hashes.root is computed by the lgx packer over
+// the archive, with an algorithm this module has no access to, so it cannot
+// be recomputed from the installed files. Instead a package's files are
+// audited against a baseline: the SHA-256 of every regular file under the
+// install directory plus its size and mtime, and a Merkle root over those
+// leaves. The module takes it when it places the files itself (install,
+// upgrade, rollback), never on a later audit, so damage already present
+// when auditing starts is not taken as the reference. The baseline also
+// remembers manifest.hashes.root; a package with no install-time baseline,
+// or whose root has changed since, is reported unverified. Any other
+// change, manifest.json included, is reported.
+//
+// Verification lists the tree and merges it with the baseline (both sorted
+// by path):
+//   - files whose size and mtime still match their record are trusted
+//     (unless a full rehash is asked for), so re-verifying an unchanged
+//     install reads no file contents;
+//   - every other file is hashed, fanned out across a WorkerPool;
+//   - the result is mismatched / missing / extra paths and the current root.
+//
+// Leaves are H(0x00 || path || 0x00 || sha256(content)), inner nodes
+// H(0x01 || left || right), an odd node is carried up unchanged, and an
+// empty tree has the root sha256("").
+//
+// Hashing can be paced: a Pacer is called after every read with the bytes
+// just read, may sleep to hold a budget, and returns false to abandon the
+// pass (the call then fails with "cancelled"). A paced pass hashes on the
+// calling thread only; the pool is not used.
+// ---------------------------------------------------------------------------
+
+namespace integrity {
+
+using Digest = std::array<uint8_t, 32>;
+using Pacer = std::function<bool(uint64_t bytes)>;
+
+Digest sha256(const void* data, size_t size);
+bool sha256File(const std::filesystem::path& path, Digest& out, std::string& error,
+                const Pacer& pace = {});
+std::string toHex(const Digest& digest);
+bool fromHex(std::string_view hex, Digest& out);
+
+struct FileRecord {
+    std::string path;     // relative to the install directory, '/'-separated
+    uint64_t    size = 0;
+    int64_t     mtimeNs = 0;
+    Digest      digest{};
+};
+
+struct Baseline {
+    bool                    installTime = false;  // taken when the module placed the files
+    std::string             manifestRoot;   // manifest.hashes.root when taken
+    uint64_t                manifestSize = 0;
+    int64_t                 manifestMtimeNs = 0;
+    std::vector<FileRecord> files;          // sorted by path
+};
+
+struct Report {
+    std::vector<std::string> mismatched;
+    std::vector<std::string> missing;
+    std::vector<std::string> extra;
+    uint64_t filesHashed = 0;
+    uint64_t filesSkipped = 0;  // trusted on size + mtime
+    uint64_t bytesHashed = 0;
+    Digest   root{};            // over the files as found
+    bool clean() const { return mismatched.empty() && missing.empty() && extra.empty(); }
+};
+
+Digest merkleRoot(const std::vector<FileRecord>& files);
+
+// Size and mtime (ns since the file clock's epoch) of one file.
+bool fingerprint(const std::filesystem::path& path, uint64_t& size, int64_t& mtimeNs,
+                 std::string& error);
+
+// Records installDir's current contents as a baseline.
+bool snapshot(const std::filesystem::path& installDir, WorkerPool* pool, Baseline& out,
+              std::string& error, const Pacer& pace = {});
+
+// Checks installDir against `baseline`. Files that hash equal to their
+// record but whose size / mtime moved get their fingerprint refreshed in
+// `baseline`; `refreshed` reports whether that happened.
+bool verify(const std::filesystem::path& installDir, Baseline& baseline, bool rehash,
+            WorkerPool* pool, Report& out, bool& refreshed, std::string& error,
+            const Pacer& pace = {});
+
+bool loadBaseline(const std::filesystem::path& file, Baseline& out);
+bool saveBaseline(const std::filesystem::path& file, const Baseline& baseline, std::string& error);
+
+} // namespace integrity
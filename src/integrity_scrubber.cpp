@@ -0,0 +1,188 @@
+#include "integrity_scrubber.h"
+
+#include <logos_json.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+// From linux/ioprio.h, which not every libc exposes.
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+#endif
+
+bool loadState(const std::string& file, uint64_t& cycle, std::string& after)
+{
+    try {
+        std::ifstream in(file);
+        if (!in) return false;
+        std::stringstream buf;
+        buf << in.rdbuf();
+        const LogosMap doc = LogosMap::parse(buf.str());
+        cycle = doc.value("cycle", uint64_t(0));
+        after = doc.value("resumeAfter", "");
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool byName(const IntegrityScrubber::Target& a, const IntegrityScrubber::Target& b)
+{
+    return a.name < b.name;
+}
+
+} // namespace
+
+void IntegrityScrubber::start(const Options& options, AuditFn audit)
+{
+    stop();
+    Status fresh;
+    fresh.running = true;
+    fresh.options = options;
+    if (fresh.options.bytesPerSecond == 0) fresh.options.bytesPerSecond = 1;
+    // A missing or unreadable state file starts from the top.
+    if (!options.stateFile.empty()) loadState(options.stateFile, fresh.cycle, fresh.resumeAfter);
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stopping = false;
+        m_status = std::move(fresh);
+    }
+    m_thread = std::thread([this, audit = std::move(audit)]() { run(audit); });
+}
+
+bool IntegrityScrubber::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (!m_thread.joinable()) return false;
+    m_thread.join();
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_status.running = false;
+    return true;
+}
+
+bool IntegrityScrubber::running() const
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_status.running;
+}
+
+void IntegrityScrubber::setTargets(std::vector<Target> targets)
+{
+    std::sort(targets.begin(), targets.end(), byName);
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_targets = std::move(targets);
+}
+
+IntegrityScrubber::Status IntegrityScrubber::status() const
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_status;
+}
+
+void IntegrityScrubber::applyHints()
+{
+    bool niced = false;
+    bool idle = false;
+#ifdef __linux__
+    // On Linux both are per-thread when addressed by thread id (or 0).
+    const int niceness = m_status.options.niceness;
+    if (niceness > 0) {
+        const id_t tid = static_cast<id_t>(::syscall(SYS_gettid));
+        errno = 0;
+        const int current = ::getpriority(PRIO_PROCESS, tid);
+        niced = (errno == 0 && current >= niceness)
+             || ::setpriority(PRIO_PROCESS, tid, std::min(niceness, 19)) == 0;
+    }
+#ifdef SYS_ioprio_set
+    if (m_status.options.idleIo)
+        idle = ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift) == 0;
+#endif
+#endif
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_status.niceApplied = niced;
+    m_status.idleIoApplied = idle;
+}
+
+bool IntegrityScrubber::pace(uint64_t bytes)
+{
+    using namespace std::chrono;
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_status.bytesHashed += bytes;
+    const auto now = steady_clock::now();
+    if (m_due < now) m_due = now;
+    m_due += nanoseconds(bytes * 1000000000ull / m_status.options.bytesPerSecond);
+    return !m_cv.wait_until(lk, m_due, [this]() { return m_stopping; });
+}
+
+void IntegrityScrubber::saveState(const std::string& file, uint64_t cycle, const std::string& after) const
+{
+    if (file.empty()) return;
+    namespace fs = std::filesystem;
+    LogosMap doc = LogosMap::object();
+    doc["cycle"] = cycle;
+    doc["resumeAfter"] = after;
+    std::error_code ec;
+    fs::create_directories(fs::path(file).parent_path(), ec);
+    const std::string tmp = file + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << doc.dump();
+        if (!out) return;
+    }
+    fs::rename(tmp, file, ec);
+}
+
+void IntegrityScrubber::run(AuditFn audit)
+{
+    applyHints();
+    const integrity::Pacer pacer = [this](uint64_t bytes) { return pace(bytes); };
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_due = std::chrono::steady_clock::now();
+    const std::string stateFile = m_status.options.stateFile;
+    while (!m_stopping) {
+        Target probe;
+        probe.name = m_status.resumeAfter;
+        const auto next = std::upper_bound(m_targets.begin(), m_targets.end(), probe, byName);
+        if (next == m_targets.end()) {
+            ++m_status.cycle;
+            m_status.resumeAfter.clear();
+            const uint64_t cycle = m_status.cycle;
+            lk.unlock();
+            saveState(stateFile, cycle, std::string());
+            lk.lock();
+            m_cv.wait_for(lk, m_status.options.cycleInterval, [this]() { return m_stopping; });
+            continue;
+        }
+
+        const Target target = *next;
+        lk.unlock();
+        const Result result = audit(target, pacer);
+        lk.lock();
+        if (result == Result::Cancelled) break;
+        ++m_status.packagesScrubbed;
+        if (result == Result::Violation) ++m_status.violations;
+        if (result == Result::Failed) ++m_status.failures;
+        m_status.resumeAfter = target.name;
+        const uint64_t cycle = m_status.cycle;
+        lk.unlock();
+        saveState(stateFile, cycle, target.name);
+        lk.lock();
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "integrity.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Background integrity scrubber
+// ---------------------------------------------------------------------------
+//
+// A dedicated thread that audits installed packages one after another, in
+// name order, through a caller-supplied audit function (PackageManagerImpl
+// passes its verifyInstalled audit). Reads are paced to a bytes-per-second
+// budget: the audit is handed an integrity::Pacer that sleeps after each
+// read until the bytes read so far are within budget, so a package of any
+// size is spread out rather than read in a burst. Idle time earns no
+// credit. When a pass over every package finishes, the next starts after
+// `cycleInterval`.
+//
+// The thread lowers its own priority when it starts: a niceness of
+// `niceness` (only ever raised) and, on Linux, the idle I/O scheduling
+// class, so its reads are served only when the disk is otherwise idle.
+// Both are best effort; status() reports which took.
+//
+// Progress — the pass number and the last package finished — is written
+// to `stateFile` (write-then-rename) after every package. A scrubber
+// started on the same file continues with the first package named after
+// that one, so restarts do not keep re-reading the start of the list.
+// Naming the position rather than indexing it keeps it valid when the
+// package set changes between runs.
+//
+// Threading: setTargets / status / start / stop may be called from any
+// thread; the audit function runs on the scrubber thread only. stop()
+// interrupts a paced read, and the package being audited is redone next
+// time.
+// ---------------------------------------------------------------------------
+
+class IntegrityScrubber {
+public:
+    struct Target {
+        std::string name;
+        std::string installDir;
+        std::string manifestRoot;
+    };
+
+    enum class Result { Clean, Violation, Failed, Cancelled };
+    using AuditFn = std::function<Result(const Target& target, const integrity::Pacer& pace)>;
+
+    struct Options {
+        uint64_t                  bytesPerSecond = 4 << 20;
+        std::string               stateFile;     // empty = no resume
+        int                       niceness = 10; // 0 leaves the priority alone
+        bool                      idleIo = true;
+        std::chrono::milliseconds cycleInterval{std::chrono::hours(1)};
+    };
+
+    struct Status {
+        bool        running = false;
+        Options     options;
+        uint64_t    cycle = 0;        // completed passes
+        std::string resumeAfter;      // last package finished this pass
+        uint64_t    packagesScrubbed = 0;
+        uint64_t    violations = 0;
+        uint64_t    failures = 0;
+        uint64_t    bytesHashed = 0;
+        bool        niceApplied = false;
+        bool        idleIoApplied = false;
+    };
+
+    IntegrityScrubber() = default;
+    ~IntegrityScrubber() { stop(); }
+    IntegrityScrubber(const IntegrityScrubber&) = delete;
+    IntegrityScrubber& operator=(const IntegrityScrubber&) = delete;
+
+    // Replaces any running scrubber. Counters restart; the position comes
+    // from options.stateFile when it holds one.
+    void start(const Options& options, AuditFn audit);
+    // Returns whether a scrubber was running.
+    bool stop();
+
+    bool running() const;
+    void setTargets(std::vector<Target> targets);
+    Status status() const;
+
+private:
+    void run(AuditFn audit);
+    void applyHints();
+    bool pace(uint64_t bytes);
+    void saveState(const std::string& file, uint64_t cycle, const std::string& after) const;
+
+    std::thread                     m_thread;
+    mutable std::mutex              m_mutex;
+    std::condition_variable         m_cv;
+    bool                            m_stopping = false;
+    std::vector<Target>             m_targets;  // sorted by name
+    Status                          m_status;
+    std::chrono::steady_clock::time_point m_due{};  // when the bytes read so far are paid for
+};
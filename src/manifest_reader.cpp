@@ -0,0 +1,593 @@
+#include "manifest_reader.h"
+#include "worker_pool.h"
+#include <package_manager_lib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace manifest {
+
+namespace {
+
+struct StringField {
+    const char*                    key;
+    std::string InstalledPackage::*member;
+};
+
+const StringField kStringFields[] = {
+    {"name", &InstalledPackage::name},         {"displayName", &InstalledPackage::displayName},
+    {"version", &InstalledPackage::version},   {"description", &InstalledPackage::description},
+    {"type", &InstalledPackage::type},         {"category", &InstalledPackage::category},
+    {"author", &InstalledPackage::author},     {"license", &InstalledPackage::license},
+    {"icon", &InstalledPackage::icon},         {"view", &InstalledPackage::view},
+};
+
+std::string mainPath(const std::string& installDir, const std::string& file)
+{
+    return (fs::path(installDir) / file).string();
+}
+
+// Whether any of the 8 bytes in `w` ends or interrupts a plain string run:
+// a quote, a backslash, a control character or a non-ASCII byte.
+inline bool special(uint64_t w)
+{
+    constexpr uint64_t kOnes = 0x0101010101010101ull;
+    constexpr uint64_t kHighs = 0x8080808080808080ull;
+    const uint64_t quote = w ^ (kOnes * '"');
+    const uint64_t slash = w ^ (kOnes * '\\');
+    return (((quote - kOnes) & ~quote) | ((slash - kOnes) & ~slash) | (w - kOnes * 0x20) | w) & kHighs;
+}
+
+void appendUtf8(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+// A forward-only cursor over JSON text. Values are either decoded into a
+// caller's string or validated and stepped over; nothing is built.
+class Cursor {
+public:
+    explicit Cursor(std::string_view text)
+        : m_begin(text.data()), m_p(text.data()), m_end(text.data() + text.size())
+    {
+        if (m_end - m_p >= 3 && std::memcmp(m_p, "\xEF\xBB\xBF", 3) == 0) m_p += 3;
+    }
+
+    bool failed() const { return !m_error.empty(); }
+    const std::string& error() const { return m_error; }
+
+    bool fail(const char* what)
+    {
+        if (m_error.empty()) m_error = std::string(what) + " at offset " + std::to_string(m_p - m_begin);
+        return false;
+    }
+
+    // The next significant character, or '\0' at the end.
+    char peek()
+    {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) ++m_p;
+        return m_p < m_end ? *m_p : '\0';
+    }
+    void advance() { ++m_p; }
+    bool atEnd() { return peek() == '\0' && m_p == m_end; }
+
+    // Object members, after its '{' has been consumed: true with the next
+    // key decoded into `key` and the cursor at its value, false past the
+    // closing brace or on error (see failed()).
+    bool member(bool& first, std::string& key)
+    {
+        const char c = peek();
+        if (c == '}') {
+            ++m_p;
+            return false;
+        }
+        if (!first) {
+            if (c != ',') return fail("expected ',' or '}'");
+            ++m_p;
+        }
+        first = false;
+        return memberKey(key);
+    }
+
+    // Array elements, after its '[' has been consumed: true with the cursor
+    // at the next element, false past the closing bracket or on error.
+    bool element(bool& first)
+    {
+        const char c = peek();
+        if (c == ']') {
+            ++m_p;
+            return false;
+        }
+        if (!first) {
+            if (c != ',') return fail("expected ',' or ']'");
+            ++m_p;
+        }
+        first = false;
+        return true;
+    }
+
+    // The string at the cursor, appended to `out` when given.
+    bool string(std::string* out)
+    {
+        ++m_p;  // opening quote
+        const char* run = m_p;
+        for (;;) {
+            while (m_end - m_p >= 8) {
+                uint64_t w;
+                std::memcpy(&w, m_p, sizeof w);
+                if (special(w)) break;
+                m_p += 8;
+            }
+            if (m_p >= m_end) return fail("unterminated string");
+            const unsigned char c = static_cast<unsigned char>(*m_p);
+            if (c == '"') break;
+            if (c == '\\') {
+                if (out) out->append(run, m_p);
+                if (!escape(out)) return false;
+                run = m_p;
+            } else if (c < 0x20) {
+                return fail("control character in string");
+            } else if (c >= 0x80) {
+                if (!utf8()) return false;
+            } else {
+                ++m_p;
+            }
+        }
+        if (out) out->append(run, m_p);
+        ++m_p;
+        return true;
+    }
+
+    // Validates and steps over the value at the cursor.
+    bool skipValue()
+    {
+        std::vector<char> open;  // closing brackets still owed
+        for (;;) {
+            const char c = peek();
+            bool nested = false;
+            switch (c) {
+            case '"':
+                if (!string(nullptr)) return false;
+                break;
+            case '{':
+                ++m_p;
+                if (peek() == '}') {
+                    ++m_p;
+                    break;
+                }
+                open.push_back('}');
+                if (!memberKey(m_scratch)) return false;
+                nested = true;
+                break;
+            case '[':
+                ++m_p;
+                if (peek() == ']') {
+                    ++m_p;
+                    break;
+                }
+                open.push_back(']');
+                nested = true;
+                break;
+            case 't':
+                if (!literal("true", 4)) return false;
+                break;
+            case 'f':
+                if (!literal("false", 5)) return false;
+                break;
+            case 'n':
+                if (!literal("null", 4)) return false;
+                break;
+            default:
+                if (c != '-' && (c < '0' || c > '9')) return fail("unexpected character");
+                if (!number()) return false;
+            }
+            if (nested) continue;
+            // Close every container this value ended, then move to the
+            // next element or member.
+            for (;;) {
+                if (open.empty()) return true;
+                const char d = peek();
+                if (d == open.back()) {
+                    ++m_p;
+                    open.pop_back();
+                    continue;
+                }
+                if (d != ',') return fail("expected ',' or a closing bracket");
+                ++m_p;
+                if (open.back() == '}' && !memberKey(m_scratch)) return false;
+                break;
+            }
+        }
+    }
+
+private:
+    bool memberKey(std::string& key)
+    {
+        if (peek() != '"') return fail("expected a key");
+        key.clear();
+        if (!string(&key)) return false;
+        if (peek() != ':') return fail("expected ':'");
+        ++m_p;
+        return true;
+    }
+
+    bool escape(std::string* out)
+    {
+        if (m_end - m_p < 2) return fail("unterminated escape");
+        char c;
+        switch (m_p[1]) {
+        case '"':  c = '"'; break;
+        case '\\': c = '\\'; break;
+        case '/':  c = '/'; break;
+        case 'b':  c = '\b'; break;
+        case 'f':  c = '\f'; break;
+        case 'n':  c = '\n'; break;
+        case 'r':  c = '\r'; break;
+        case 't':  c = '\t'; break;
+        case 'u':
+            m_p += 2;
+            return unicode(out);
+        default:
+            return fail("invalid escape");
+        }
+        m_p += 2;
+        if (out) out->push_back(c);
+        return true;
+    }
+
+    bool hex4(uint32_t& value)
+    {
+        if (m_end - m_p < 4) return fail("truncated \\u escape");
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char h = m_p[i];
+            value <<= 4;
+            if (h >= '0' && h <= '9') value |= h - '0';
+            else if (h >= 'a' && h <= 'f') value |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') value |= h - 'A' + 10;
+            else return fail("invalid \\u escape");
+        }
+        m_p += 4;
+        return true;
+    }
+
+    bool unicode(std::string* out)
+    {
+        uint32_t cp = 0;
+        if (!hex4(cp)) return false;
+        if (cp >= 0xDC00 && cp <= 0xDFFF) return fail("unpaired surrogate");
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            if (m_end - m_p < 2 || m_p[0] != '\\' || m_p[1] != 'u') return fail("unpaired surrogate");
+            m_p += 2;
+            uint32_t low = 0;
+            if (!hex4(low)) return false;
+            if (low < 0xDC00 || low > 0xDFFF) return fail("unpaired surrogate");
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        if (out) appendUtf8(*out, cp);
+        return true;
+    }
+
+    // One well-formed UTF-8 sequence (no overlongs, surrogates or code
+    // points past U+10FFFF), left in place for the caller's run.
+    bool utf8()
+    {
+        const auto* s = reinterpret_cast<const unsigned char*>(m_p);
+        unsigned char lo = 0x80, hi = 0xBF;
+        size_t n;
+        if (s[0] >= 0xC2 && s[0] <= 0xDF) n = 2;
+        else if (s[0] == 0xE0) n = 3, lo = 0xA0;
+        else if (s[0] == 0xED) n = 3, hi = 0x9F;
+        else if (s[0] >= 0xE1 && s[0] <= 0xEF) n = 3;
+        else if (s[0] == 0xF0) n = 4, lo = 0x90;
+        else if (s[0] == 0xF4) n = 4, hi = 0x8F;
+        else if (s[0] >= 0xF1 && s[0] <= 0xF3) n = 4;
+        else return fail("invalid UTF-8");
+        if (static_cast<size_t>(m_end - m_p) < n || s[1] < lo || s[1] > hi) return fail("invalid UTF-8");
+        for (size_t i = 2; i < n; ++i) {
+            if (s[i] < 0x80 || s[i] > 0xBF) return fail("invalid UTF-8");
+        }
+        m_p += n;
+        return true;
+    }
+
+    bool literal(const char* word, size_t n)
+    {
+        if (static_cast<size_t>(m_end - m_p) < n || std::memcmp(m_p, word, n) != 0) return fail("invalid literal");
+        m_p += n;
+        return true;
+    }
+
+    bool digits()
+    {
+        if (m_p >= m_end || *m_p < '0' || *m_p > '9') return fail("invalid number");
+        while (m_p < m_end && *m_p >= '0' && *m_p <= '9') ++m_p;
+        return true;
+    }
+
+    bool number()
+    {
+        const char* start = m_p;
+        bool isFloat = false;
+        if (*m_p == '-') ++m_p;
+        if (m_p < m_end && *m_p == '0') {
+            ++m_p;
+        } else if (!digits()) {
+            return false;
+        }
+        if (m_p < m_end && *m_p == '.') {
+            ++m_p;
+            isFloat = true;
+            if (!digits()) return false;
+        }
+        if (m_p < m_end && (*m_p == 'e' || *m_p == 'E')) {
+            ++m_p;
+            isFloat = true;
+            if (m_p < m_end && (*m_p == '+' || *m_p == '-')) ++m_p;
+            if (!digits()) return false;
+        }
+        // Like the document parser, reject what does not fit a double.
+        // Integers of up to 18 digits always fit 64 bits.
+        if ((isFloat || m_p - start > 18) && !std::isfinite(std::strtod(std::string(start, m_p).c_str(), nullptr)))
+            return fail("number overflow");
+        return true;
+    }
+
+    const char* m_begin;
+    const char* m_p;
+    const char* m_end;
+    std::string m_error;
+    std::string m_scratch;  // keys of skipped objects
+};
+
+// A string-valued field: the string, or empty for any other value.
+bool stringValue(Cursor& c, std::string& out)
+{
+    out.clear();
+    if (c.peek() != '"') return c.skipValue();
+    return c.string(&out);
+}
+
+bool mainValue(Cursor& c, const std::string& installDir, const std::vector<std::string>& variants,
+               std::string& out)
+{
+    out.clear();
+    const char t = c.peek();
+    if (t == '"') {
+        std::string file;
+        if (!c.string(&file)) return false;
+        if (!file.empty()) out = mainPath(installDir, file);
+        return true;
+    }
+    if (t != '{') return c.skipValue();
+    c.advance();
+    std::vector<std::optional<std::string>> byVariant(variants.size());
+    std::string variant;
+    bool first = true;
+    while (c.member(first, variant)) {
+        const auto it = std::find(variants.begin(), variants.end(), variant);
+        if (it == variants.end()) {
+            if (!c.skipValue()) return false;
+            continue;
+        }
+        auto& file = byVariant[static_cast<size_t>(it - variants.begin())];
+        file.reset();
+        if (c.peek() != '"') {
+            if (!c.skipValue()) return false;
+            continue;
+        }
+        file.emplace();
+        if (!c.string(&*file)) return false;
+    }
+    if (c.failed()) return false;
+    for (const auto& file : byVariant) {
+        if (file) {
+            out = mainPath(installDir, *file);
+            break;
+        }
+    }
+    return true;
+}
+
+bool field(Cursor& c, const std::string& key, const std::string& installDir,
+           const std::vector<std::string>& variants, InstalledPackage& p)
+{
+    for (const auto& f : kStringFields) {
+        if (key == f.key) return stringValue(c, p.*f.member);
+    }
+    if (key == "dependencies") {
+        p.dependencies.clear();
+        if (c.peek() != '[') return c.skipValue();
+        c.advance();
+        bool first = true;
+        while (c.element(first)) {
+            if (c.peek() != '"') {
+                if (!c.skipValue()) return false;
+                continue;
+            }
+            p.dependencies.emplace_back();
+            if (!c.string(&p.dependencies.back())) return false;
+        }
+        return !c.failed();
+    }
+    if (key == "hashes") {
+        p.hashes.root.clear();
+        if (c.peek() != '{') return c.skipValue();
+        c.advance();
+        std::string inner;
+        bool first = true;
+        while (c.member(first, inner)) {
+            if (!(inner == "root" ? stringValue(c, p.hashes.root) : c.skipValue())) return false;
+        }
+        return !c.failed();
+    }
+    if (key == "main") return mainValue(c, installDir, variants, p.mainFilePath);
+    return c.skipValue();
+}
+
+bool readFile(const fs::path& path, std::string& out)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    const bool ok = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (ok) {
+        out.resize(static_cast<size_t>(st.st_size));
+        size_t got = 0;
+        while (got < out.size()) {
+            const ssize_t n = ::read(fd, &out[got], out.size() - got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+        out.resize(got);
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+bool read(std::string_view json, const std::string& installDir, InstallType installType,
+          const std::vector<std::string>& variants, InstalledPackage& out, std::string& error)
+{
+    Cursor c(json);
+    if (c.peek() != '{') {
+        error = c.peek() == '\0' ? "manifest is empty" : "manifest is not a JSON object";
+        return false;
+    }
+    c.advance();
+    InstalledPackage p;
+    std::string key;
+    bool first = true;
+    while (c.member(first, key)) {
+        if (!field(c, key, installDir, variants, p)) break;
+    }
+    if (!c.failed() && !c.atEnd()) c.fail("unexpected text after the manifest");
+    if (c.failed()) {
+        error = c.error();
+        return false;
+    }
+    p.installType = installType;
+    p.installDir = installDir;
+    out = std::move(p);
+    return true;
+}
+
+bool readDom(std::string_view json, const std::string& installDir, InstallType installType,
+             const std::vector<std::string>& variants, InstalledPackage& out, std::string& error)
+{
+    LogosMap parsed;
+    try {
+        parsed = LogosMap::parse(std::string(json));
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+    const LogosMap& doc = parsed;
+    if (!doc.is_object()) {
+        error = "manifest is not a JSON object";
+        return false;
+    }
+    InstalledPackage p;
+    for (const auto& f : kStringFields) {
+        if (doc.contains(f.key) && doc[f.key].is_string()) p.*f.member = doc[f.key].get<std::string>();
+    }
+    if (doc.contains("dependencies") && doc["dependencies"].is_array()) {
+        for (const auto& d : doc["dependencies"]) {
+            if (d.is_string()) p.dependencies.push_back(d.get<std::string>());
+        }
+    }
+    if (doc.contains("hashes") && doc["hashes"].is_object()) {
+        const LogosMap& hashes = doc["hashes"];
+        if (hashes.contains("root") && hashes["root"].is_string()) p.hashes.root = hashes["root"].get<std::string>();
+    }
+    p.mainFilePath = mainFile(doc, installDir, variants);
+    p.installType = installType;
+    p.installDir = installDir;
+    out = std::move(p);
+    return true;
+}
+
+std::string mainFile(const LogosMap& manifest, const fs::path& installDir, const std::vector<std::string>& variants)
+{
+    if (!manifest.contains("main")) return {};
+    const auto& main = manifest["main"];
+    if (main.is_string()) {
+        std::string file = main.get<std::string>();
+        return file.empty() ? std::string() : (installDir / file).string();
+    }
+    if (main.is_object()) {
+        for (const auto& variant : variants) {
+            if (main.contains(variant) && main[variant].is_string())
+                return (installDir / main[variant].get<std::string>()).string();
+        }
+    }
+    return {};
+}
+
+std::vector<InstalledPackage> scanDirectory(const std::string& dir, InstallType installType,
+                                            const std::vector<std::string>& variants, Reader reader,
+                                            WorkerPool* pool, size_t fanOut)
+{
+    std::vector<std::string> entries;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        std::error_code typeEc;
+        if (name.empty() || name[0] == '.' || !it->is_directory(typeEc)) continue;
+        entries.push_back(std::move(name));
+    }
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<InstalledPackage> found(entries.size());
+    std::vector<char> ok(entries.size(), 0);
+    auto one = [&](size_t i) {
+        const std::string installDir = (fs::path(dir) / entries[i]).string();
+        std::string text;
+        std::string error;
+        if (!readFile(fs::path(installDir) / "manifest.json", text)) return;
+        ok[i] = reader == Reader::OnDemand ? read(text, installDir, installType, variants, found[i], error)
+                                           : readDom(text, installDir, installType, variants, found[i], error);
+    };
+    if (pool && entries.size() >= fanOut) {
+        pool->parallelFor(entries.size(), one);
+    } else {
+        for (size_t i = 0; i < entries.size(); ++i) one(i);
+    }
+
+    std::vector<InstalledPackage> out;
+    out.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (ok[i]) out.push_back(std::move(found[i]));
+    }
+    return out;
+}
+
+} // namespace manifest
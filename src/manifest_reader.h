@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <logos_json.h>
+
+class WorkerPool;
+struct InstalledPackage;
+enum class InstallType;
+
+// ---------------------------------------------------------------------------
+// Reading manifest.json into InstalledPackage
+// ---------------------------------------------------------------------------
+//
+// A library scan parses each manifest into a generic JSON document and then
+// copies a dozen fields out of it. read() instead walks the text once with
+// a cursor and decodes only the values InstalledPackage keeps; everything
+// else is validated and stepped over without being built. String bodies
+// are scanned a word (8 bytes) at a time for quotes, backslashes, control
+// characters and non-ASCII bytes, so the common all-ASCII string costs a
+// few word operations rather than a branch per byte.
+//
+// readDom() is the document path — LogosMap::parse, then copy — kept as
+// the reference read() must match and for benchmarking against. Both
+// produce the same package, field for field, and reject the same inputs:
+//   - the text must be one JSON object (a leading UTF-8 BOM is skipped);
+//     malformed JSON anywhere, skipped values included, is an error
+//   - name, displayName, version, description, type, category, author,
+//     license, icon, view: copied when a string, otherwise left empty
+//   - dependencies: the string elements of an array
+//   - hashes.root: when hashes is an object and root a string
+//   - main: a file name, or an object keyed by platform variant whose
+//     first entry in `variants` with a string value wins; resolved against
+//     installDir into mainFilePath, as installFromDirectory does
+//   - a key given twice counts with its last value
+// installType and installDir come from the arguments.
+// ---------------------------------------------------------------------------
+
+namespace manifest {
+
+enum class Reader { OnDemand, Dom };
+
+bool read(std::string_view json, const std::string& installDir, InstallType installType,
+          const std::vector<std::string>& variants, InstalledPackage& out, std::string& error);
+bool readDom(std::string_view json, const std::string& installDir, InstallType installType,
+             const std::vector<std::string>& variants, InstalledPackage& out, std::string& error);
+
+// The file a manifest's `main` names inside installDir; empty when nothing
+// resolves.
+std::string mainFile(const LogosMap& manifest, const std::filesystem::path& installDir,
+                     const std::vector<std::string>& variants);
+
+// The packages of every <dir>/<entry>/manifest.json, entries in name order
+// (dot-entries skipped, symlinked entries followed). Manifests are read and
+// parsed across `pool` when there are at least `fanOut` entries; one that
+// is missing or malformed leaves its entry out.
+std::vector<InstalledPackage> scanDirectory(const std::string& dir, InstallType installType,
+                                            const std::vector<std::string>& variants, Reader reader,
+                                            WorkerPool* pool, size_t fanOut);
+
+} // namespace manifest
@@ -0,0 +1,81 @@
+#include "memory_stats.h"
+
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace memstats {
+
+void Account::set(size_t bytes)
+{
+    const int64_t previous = m_current.exchange(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+    const int64_t delta = static_cast<int64_t>(bytes) - previous;
+    int64_t peak = m_peak.load(std::memory_order_relaxed);
+    while (static_cast<int64_t>(bytes) > peak
+           && !m_peak.compare_exchange_weak(peak, static_cast<int64_t>(bytes), std::memory_order_relaxed)) {
+    }
+    if (m_parent && delta != 0) m_parent->adjust(delta);
+}
+
+void Account::adjust(int64_t delta)
+{
+    const int64_t now = m_current.fetch_add(delta, std::memory_order_relaxed) + delta;
+    int64_t peak = m_peak.load(std::memory_order_relaxed);
+    while (now > peak && !m_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+    if (m_parent) m_parent->adjust(delta);
+}
+
+size_t heapBytes(const std::string& s)
+{
+    // Short strings live inside the object (SSO); anything else owns
+    // capacity() + 1 bytes on the heap.
+    const char* data = s.data();
+    const char* self = reinterpret_cast<const char*>(&s);
+    if (data >= self && data < self + sizeof(s)) return 0;
+    return s.capacity() + 1;
+}
+
+size_t heapBytes(const std::filesystem::path& p)
+{
+    return heapBytes(p.native());
+}
+
+size_t heapBytes(const std::vector<std::string>& v)
+{
+    size_t bytes = v.capacity() * sizeof(std::string);
+    for (const auto& s : v) bytes += heapBytes(s);
+    return bytes;
+}
+
+size_t heapBytes(const std::vector<std::filesystem::path>& v)
+{
+    size_t bytes = v.capacity() * sizeof(std::filesystem::path);
+    for (const auto& p : v) bytes += heapBytes(p);
+    return bytes;
+}
+
+ProcessMemory processMemory()
+{
+    ProcessMemory out;
+#ifdef __linux__
+    // statm: size resident shared text lib data dt, in pages.
+    if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+        unsigned long long size = 0, resident = 0;
+        if (std::fscanf(f, "%llu %llu", &size, &resident) == 2)
+            out.residentBytes = resident * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+        std::fclose(f);
+    }
+#endif
+    struct rusage usage {};
+    if (::getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        out.peakResidentBytes = static_cast<uint64_t>(usage.ru_maxrss);         // bytes
+#else
+        out.peakResidentBytes = static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // kilobytes
+#endif
+    }
+    return out;
+}
+
+} // namespace memstats
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Per-subsystem heap accounting
+// ---------------------------------------------------------------------------
+//
+// An Account tracks the bytes a subsystem currently holds and the most it
+// has held at once. Updating it is two relaxed atomic operations plus a
+// compare-exchange when a new peak is reached, so it can stay on in
+// production. Accounts may roll up into a parent (the module total); the
+// parent's peak is the peak of the sum, not the sum of the peaks.
+//
+// Byte counts are estimates of the heap each structure owns: sizeof of the
+// elements plus out-of-line string storage. Allocator overhead is ignored.
+// ---------------------------------------------------------------------------
+
+namespace memstats {
+
+class Account {
+public:
+    explicit Account(Account* parent = nullptr) : m_parent(parent) {}
+    Account(const Account&) = delete;
+    Account& operator=(const Account&) = delete;
+
+    void add(size_t bytes) { adjust(static_cast<int64_t>(bytes)); }
+    void sub(size_t bytes) { adjust(-static_cast<int64_t>(bytes)); }
+    // For subsystems that are sampled rather than tracked on every change.
+    void set(size_t bytes);
+
+    int64_t current() const { return m_current.load(std::memory_order_relaxed); }
+    int64_t peak() const { return m_peak.load(std::memory_order_relaxed); }
+
+private:
+    void adjust(int64_t delta);
+
+    Account*             m_parent;
+    std::atomic<int64_t> m_current{0};
+    std::atomic<int64_t> m_peak{0};
+};
+
+// Holds `bytes` against an account for the lifetime of the scope — for
+// transient structures such as scan results.
+class Charge {
+public:
+    Charge(Account& account, size_t bytes) : m_account(&account), m_bytes(bytes) { account.add(bytes); }
+    ~Charge() { if (m_account) m_account->sub(m_bytes); }
+    Charge(Charge&& other) noexcept : m_account(other.m_account), m_bytes(other.m_bytes)
+    {
+        other.m_account = nullptr;
+    }
+    Charge(const Charge&) = delete;
+    Charge& operator=(const Charge&) = delete;
+    Charge& operator=(Charge&&) = delete;
+
+private:
+    Account* m_account;
+    size_t   m_bytes;
+};
+
+// Out-of-line storage only; the object itself is counted by its owner.
+size_t heapBytes(const std::string& s);
+size_t heapBytes(const std::filesystem::path& p);
+size_t heapBytes(const std::vector<std::string>& v);
+size_t heapBytes(const std::vector<std::filesystem::path>& v);
+
+// Process-wide figures for context: resident set size now (0 where the
+// platform offers no cheap way to read it) and at its peak.
+struct ProcessMemory {
+    uint64_t residentBytes = 0;
+    uint64_t peakResidentBytes = 0;
+};
+ProcessMemory processMemory();
+
+} // namespace memstats
@@ -0,0 +1,277 @@
+#include "metrics.h"
+#include "memory_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace metrics {
+
+namespace {
+
+// Prometheus float formatting: shortest round-trippable decimal, +Inf spelt
+// the way the exposition format expects.
+std::string formatDouble(double v)
+{
+    if (std::isinf(v)) return v > 0 ? "+Inf" : "-Inf";
+    if (std::isnan(v)) return "NaN";
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", v);
+    // Prefer the short form when it round-trips (0.005 rather than 0.0050000000000000001).
+    for (int precision = 1; precision < 17; ++precision) {
+        char shortBuf[32];
+        std::snprintf(shortBuf, sizeof(shortBuf), "%.*g", precision, v);
+        if (std::strtod(shortBuf, nullptr) == v) return shortBuf;
+    }
+    return buf;
+}
+
+std::string escapeLabelValue(const std::string& v)
+{
+    std::string out;
+    out.reserve(v.size());
+    for (char c : v) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+std::string escapeHelp(const std::string& v)
+{
+    std::string out;
+    out.reserve(v.size());
+    for (char c : v) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+// `{a="x",b="y"}` — plus an optional extra label (histogram `le`); empty
+// string when there are no labels at all.
+std::string labelSet(const Labels& labels, const char* extraKey = nullptr,
+                     const std::string& extraValue = std::string())
+{
+    if (labels.empty() && !extraKey) return {};
+    std::string out = "{";
+    bool first = true;
+    for (const auto& kv : labels) {
+        if (!first) out += ",";
+        first = false;
+        out += kv.first + "=\"" + escapeLabelValue(kv.second) + "\"";
+    }
+    if (extraKey) {
+        if (!first) out += ",";
+        out += std::string(extraKey) + "=\"" + escapeLabelValue(extraValue) + "\"";
+    }
+    out += "}";
+    return out;
+}
+
+} // namespace
+
+Histogram::Histogram(std::vector<double> bounds)
+    : m_bounds(std::move(bounds))
+    , m_buckets(new std::atomic<uint64_t>[m_bounds.size() + 1])
+{
+    std::sort(m_bounds.begin(), m_bounds.end());
+    for (size_t i = 0; i <= m_bounds.size(); ++i) m_buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void Histogram::observe(double v)
+{
+    // Linear scan over a handful of bounds: bucket i is the first whose
+    // bound is >= v, matching Prometheus' `le` semantics.
+    size_t i = 0;
+    while (i < m_bounds.size() && v > m_bounds[i]) ++i;
+    m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    double cur = m_sum.load(std::memory_order_relaxed);
+    while (!m_sum.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+    }
+}
+
+std::vector<uint64_t> Histogram::bucketCounts() const
+{
+    std::vector<uint64_t> out(m_bounds.size() + 1);
+    for (size_t i = 0; i < out.size(); ++i) out[i] = m_buckets[i].load(std::memory_order_relaxed);
+    return out;
+}
+
+const std::vector<double>& durationBuckets()
+{
+    static const std::vector<double> buckets = {
+        0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60,
+    };
+    return buckets;
+}
+
+Registry::Series& Registry::seriesFor(const std::string& name, const std::string& help,
+                                      Kind kind, const Labels& labels)
+{
+    // Caller holds m_mutex.
+    Family* family = nullptr;
+    for (auto& f : m_families) {
+        if (f.name == name) {
+            family = &f;
+            break;
+        }
+    }
+    if (!family) {
+        m_families.push_back(Family{name, help, kind, {}});
+        family = &m_families.back();
+    }
+    for (auto& s : family->series) {
+        if (s.labels == labels) return s;
+    }
+    family->series.push_back(Series{labels, nullptr, nullptr, nullptr});
+    return family->series.back();
+}
+
+Counter& Registry::counter(const std::string& name, const std::string& help, const Labels& labels)
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    Series& s = seriesFor(name, help, Kind::Counter, labels);
+    if (!s.counter) s.counter = std::make_unique<Counter>();
+    return *s.counter;
+}
+
+Gauge& Registry::gauge(const std::string& name, const std::string& help, const Labels& labels)
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    Series& s = seriesFor(name, help, Kind::Gauge, labels);
+    if (!s.gauge) s.gauge = std::make_unique<Gauge>();
+    return *s.gauge;
+}
+
+Histogram& Registry::histogram(const std::string& name, const std::string& help,
+                               const Labels& labels, const std::vector<double>& bounds)
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    Series& s = seriesFor(name, help, Kind::Histogram, labels);
+    if (!s.histogram) s.histogram = std::make_unique<Histogram>(bounds);
+    return *s.histogram;
+}
+
+std::string Registry::render() const
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    std::ostringstream out;
+    for (const auto& f : m_families) {
+        out << "# HELP " << f.name << " " << escapeHelp(f.help) << "\n";
+        switch (f.kind) {
+        case Kind::Counter:   out << "# TYPE " << f.name << " counter\n"; break;
+        case Kind::Gauge:     out << "# TYPE " << f.name << " gauge\n"; break;
+        case Kind::Histogram: out << "# TYPE " << f.name << " histogram\n"; break;
+        }
+        for (const auto& s : f.series) {
+            if (s.counter) {
+                out << f.name << labelSet(s.labels) << " " << s.counter->value() << "\n";
+            } else if (s.gauge) {
+                out << f.name << labelSet(s.labels) << " " << s.gauge->value() << "\n";
+            } else if (s.histogram) {
+                const auto counts = s.histogram->bucketCounts();
+                const auto& bounds = s.histogram->bounds();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    cumulative += counts[i];
+                    const std::string le = i < bounds.size()
+                        ? formatDouble(bounds[i]) : std::string("+Inf");
+                    out << f.name << "_bucket" << labelSet(s.labels, "le", le)
+                        << " " << cumulative << "\n";
+                }
+                out << f.name << "_sum" << labelSet(s.labels) << " "
+                    << formatDouble(s.histogram->sum()) << "\n";
+                out << f.name << "_count" << labelSet(s.labels) << " " << cumulative << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+size_t Registry::memoryBytes() const
+{
+    std::lock_guard<std::mutex> lk(m_mutex);
+    // std::deque blocks are not counted; they are small next to the series.
+    size_t bytes = 0;
+    for (const auto& f : m_families) {
+        bytes += sizeof(Family) + memstats::heapBytes(f.name) + memstats::heapBytes(f.help);
+        for (const auto& s : f.series) {
+            bytes += sizeof(Series) + s.labels.capacity() * sizeof(Labels::value_type);
+            for (const auto& kv : s.labels)
+                bytes += memstats::heapBytes(kv.first) + memstats::heapBytes(kv.second);
+            if (s.counter) bytes += sizeof(Counter);
+            if (s.gauge) bytes += sizeof(Gauge);
+            if (s.histogram) {
+                bytes += sizeof(Histogram) + s.histogram->bounds().capacity() * sizeof(double)
+                       + (s.histogram->bounds().size() + 1) * sizeof(std::atomic<uint64_t>);
+            }
+        }
+    }
+    return bytes;
+}
+
+bool TextfileWriter::writeOnce(const std::string& path, const std::string& text, std::string& error)
+{
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) {
+            error = "Cannot open '" + tmp + "' for writing";
+            return false;
+        }
+        f << text;
+        if (!f.flush()) {
+            error = "Failed to write '" + tmp + "'";
+            return false;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        error = "Failed to rename '" + tmp + "' to '" + path + "'";
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void TextfileWriter::start(const std::string& path, std::chrono::milliseconds interval,
+                           std::function<std::string()> render)
+{
+    stop();
+    if (path.empty()) return;
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stopping = false;
+    }
+    m_thread = std::thread([this, path, interval, render = std::move(render)]() {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        for (;;) {
+            // Render and write without the lock so stop() is never held up
+            // by a slow filesystem for longer than one write.
+            lk.unlock();
+            std::string error;
+            writeOnce(path, render(), error);
+            lk.lock();
+            if (m_cv.wait_for(lk, interval, [this]() { return m_stopping; })) return;
+        }
+    });
+}
+
+void TextfileWriter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+} // namespace metrics
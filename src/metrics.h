@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// In-process metrics with Prometheus text exposition
+// ---------------------------------------------------------------------------
+//
+// Metrics are registered once (Registry::counter / gauge / histogram, which
+// take a mutex) and the returned references are kept by the caller. Recording
+// through those references is a handful of relaxed atomic operations — no
+// locks, no allocation — so it is safe on every slot and from pool workers.
+// Registered metrics live as long as the Registry and never move.
+//
+// render() produces the Prometheus text format (version 0.0.4): one
+// # HELP / # TYPE block per metric name, series in registration order,
+// histograms as cumulative _bucket{le=...} / _sum / _count.
+// ---------------------------------------------------------------------------
+
+namespace metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+class Gauge {
+public:
+    void set(int64_t v) { m_value.store(v, std::memory_order_relaxed); }
+    void add(int64_t d) { m_value.fetch_add(d, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{0};
+};
+
+class Histogram {
+public:
+    // `bounds` are the bucket upper limits, ascending; +Inf is implicit.
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    const std::vector<double>& bounds() const { return m_bounds; }
+    // Per-bucket (non-cumulative) counts; the last entry is the +Inf bucket.
+    std::vector<uint64_t> bucketCounts() const;
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    double sum() const { return m_sum.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<double> m_bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<double>   m_sum{0.0};
+};
+
+// Default buckets for durations in seconds: 1ms .. 60s.
+const std::vector<double>& durationBuckets();
+
+class Registry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const Labels& labels = {},
+                         const std::vector<double>& bounds = durationBuckets());
+
+    std::string render() const;
+    // Estimated heap held by the registered series.
+    size_t memoryBytes() const;
+
+private:
+    enum class Kind { Counter, Gauge, Histogram };
+    struct Series {
+        Labels labels;
+        std::unique_ptr<Counter>   counter;
+        std::unique_ptr<Gauge>     gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+    struct Family {
+        std::string name;
+        std::string help;
+        Kind kind;
+        std::deque<Series> series;
+    };
+    Series& seriesFor(const std::string& name, const std::string& help, Kind kind,
+                      const Labels& labels);
+
+    mutable std::mutex m_mutex;
+    std::deque<Family> m_families;
+};
+
+// Observes the elapsed wall time, in seconds, into `histogram` on destruction.
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) : ScopedTimer(&histogram) {}
+    // A null histogram times nothing.
+    explicit ScopedTimer(Histogram* histogram)
+        : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        if (m_histogram)
+            m_histogram->observe(std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - m_start).count());
+    }
+    ScopedTimer(ScopedTimer&& other) noexcept
+        : m_histogram(other.m_histogram), m_start(other.m_start) { other.m_histogram = nullptr; }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+private:
+    Histogram* m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Periodically writes render output to a file for node_exporter's textfile
+// collector. Each write goes to "<path>.tmp" and is renamed over `path`, so
+// a scrape never sees a partial file.
+class TextfileWriter {
+public:
+    TextfileWriter() = default;
+    ~TextfileWriter() { stop(); }
+    TextfileWriter(const TextfileWriter&) = delete;
+    TextfileWriter& operator=(const TextfileWriter&) = delete;
+
+    // Replaces any running writer. Writes once immediately, then every
+    // `interval`. An empty path only stops.
+    void start(const std::string& path, std::chrono::milliseconds interval,
+               std::function<std::string()> render);
+    void stop();
+
+    static bool writeOnce(const std::string& path, const std::string& text, std::string& error);
+
+private:
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    bool                    m_stopping = false;
+};
+
+} // namespace metrics
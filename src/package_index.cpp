@@ -0,0 +1,319 @@
+#include "package_index.h"
+#include "memory_stats.h"
+
+#include <package_manager_lib.h>
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+PackageIndex::PackageIndex(const std::vector<InstalledPackage>& packages)
+{
+    // Reserve the blob up front: m_ids keys are views into it, so it must
+    // never reallocate while rows are appended.
+    size_t blobBytes = 0;
+    size_t depCount = 0;
+    for (const auto& p : packages) {
+        blobBytes += p.name.size() + p.displayName.size() + p.version.size() + p.description.size()
+                   + p.type.size() + p.category.size() + p.author.size() + p.license.size()
+                   + p.icon.size() + p.view.size() + p.hashes.root.size() + p.installDir.size()
+                   + p.mainFilePath.size();
+        for (const auto& d : p.dependencies) blobBytes += d.size();
+        depCount += p.dependencies.size();
+    }
+    m_blob.reserve(blobBytes);
+
+    const size_t n = packages.size();
+    m_installType.reserve(n);
+    m_kind.reserve(n);
+    m_name.reserve(n);
+    m_type.reserve(n);
+    m_category.reserve(n);
+    m_author.reserve(n);
+    m_license.reserve(n);
+    for (auto& column : m_text) column.reserve(n);
+    m_versionKey.reserve(n);
+    m_depOffsets.reserve(n + 1);
+    m_deps.reserve(depCount);
+
+    m_depOffsets.push_back(0);
+    for (const auto& p : packages) {
+        m_installType.push_back(static_cast<uint8_t>(p.installType));
+        m_kind.push_back(p.type == "core" ? KindCore : KindUi);
+        m_name.push_back(intern(p.name));
+        m_type.push_back(intern(p.type));
+        m_category.push_back(intern(p.category));
+        m_author.push_back(intern(p.author));
+        m_license.push_back(intern(p.license));
+        m_text[DisplayName].push_back(append(p.displayName));
+        m_text[Version].push_back(append(p.version));
+        m_versionKey.push_back(semver::key(p.version));
+        m_text[Description].push_back(append(p.description));
+        m_text[Icon].push_back(append(p.icon));
+        m_text[View].push_back(append(p.view));
+        m_text[HashRoot].push_back(append(p.hashes.root));
+        m_text[InstallDir].push_back(append(p.installDir));
+        m_text[MainFilePath].push_back(append(p.mainFilePath));
+        for (const auto& d : p.dependencies) m_deps.push_back(intern(d));
+        m_depOffsets.push_back(static_cast<uint32_t>(m_deps.size()));
+    }
+
+    m_rowByName.assign(m_strings.size(), kNoId);
+    for (size_t row = n; row-- > 0;)  // first row wins
+        m_rowByName[m_name[row]] = static_cast<uint32_t>(row);
+
+    // Posting lists: (value, row) pairs sorted by value, rows stay ascending.
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    pairs.reserve(n);
+    for (int f = 0; f < FacetCount; ++f) {
+        pairs.clear();
+        for (size_t row = 0; row < n; ++row)
+            pairs.emplace_back(facetValue(row, static_cast<Facet>(f)), static_cast<uint32_t>(row));
+        std::sort(pairs.begin(), pairs.end());
+        Postings& postings = m_postings[f];
+        postings.rows.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (i == 0 || pairs[i].first != pairs[i - 1].first) {
+                const uint32_t at = static_cast<uint32_t>(i);
+                postings.ranges.emplace(pairs[i].first, std::make_pair(at, at));
+            }
+            postings.rows.push_back(pairs[i].second);
+            ++postings.ranges[pairs[i].first].second;
+        }
+    }
+}
+
+uint32_t PackageIndex::facetValue(size_t row, Facet facet) const
+{
+    switch (facet) {
+    case FacetInstallType: return m_installType[row];
+    case FacetType:        return m_type[row];
+    case FacetCategory:    return m_category[row];
+    case FacetAuthor:      return m_author[row];
+    case FacetLicense:     return m_license[row];
+    case FacetCount:       break;
+    }
+    return kNoId;
+}
+
+uint32_t PackageIndex::findRow(std::string_view name) const
+{
+    const uint32_t id = find(name);
+    return id == kNoId ? kNoId : m_rowByName[id];
+}
+
+PackageIndex::Slice PackageIndex::append(const std::string& value)
+{
+    Slice s{static_cast<uint32_t>(m_blob.size()), static_cast<uint32_t>(value.size())};
+    m_blob.append(value);
+    return s;
+}
+
+uint32_t PackageIndex::intern(const std::string& value)
+{
+    auto it = m_ids.find(value);
+    if (it != m_ids.end()) return it->second;
+    const Slice s = append(value);
+    const uint32_t id = static_cast<uint32_t>(m_strings.size());
+    m_strings.push_back(s);
+    m_ids.emplace(std::string_view(m_blob.data() + s.offset, s.length), id);
+    return id;
+}
+
+uint32_t PackageIndex::find(std::string_view value) const
+{
+    auto it = m_ids.find(value);
+    return it == m_ids.end() ? kNoId : it->second;
+}
+
+std::string_view PackageIndex::str(uint32_t id) const
+{
+    return slice(m_strings[id]);
+}
+
+std::string PackageIndex::text(size_t row, Text field) const
+{
+    const Slice s = m_text[field][row];
+    return std::string(m_blob, s.offset, s.length);
+}
+
+namespace {
+
+// A filter as xor/mask pairs: row i passes when every
+// ((column[i] ^ want) & mask) is zero. A wildcard has mask 0, so every
+// predicate is evaluated for every row without branches and the loops
+// below vectorise.
+struct Predicates {
+    uint8_t  installType = 0, installTypeMask = 0;
+    uint8_t  kind = 0, kindMask = 0;
+    uint32_t category = 0, categoryMask = 0;
+
+    explicit Predicates(const PackageIndex::Filter& f)
+    {
+        if (f.installType >= 0) {
+            installType = static_cast<uint8_t>(f.installType);
+            installTypeMask = 0xff;
+        }
+        if (f.kind >= 0) {
+            kind = static_cast<uint8_t>(f.kind);
+            kindMask = 0xff;
+        }
+        if (f.category != PackageIndex::kNoId) {
+            category = f.category;
+            categoryMask = 0xffffffffu;
+        }
+    }
+
+    uint32_t passes(uint8_t it, uint8_t k, uint32_t cat) const
+    {
+        const uint32_t miss = (static_cast<uint32_t>((it ^ installType) & installTypeMask)
+                               | static_cast<uint32_t>((k ^ kind) & kindMask)
+                               | ((cat ^ category) & categoryMask));
+        return miss == 0;
+    }
+};
+
+} // namespace
+
+size_t PackageIndex::count(const Filter& filter) const
+{
+    const Predicates pred(filter);
+    const uint8_t* installType = m_installType.data();
+    const uint8_t* kind = m_kind.data();
+    const uint32_t* category = m_category.data();
+    const size_t n = size();
+    uint32_t total = 0;
+    for (size_t i = 0; i < n; ++i) total += pred.passes(installType[i], kind[i], category[i]);
+    return total;
+}
+
+std::vector<uint32_t> PackageIndex::rows(const Filter& filter) const
+{
+    const Predicates pred(filter);
+    std::vector<uint32_t> out;
+    for (size_t i = 0; i < size(); ++i) {
+        if (pred.passes(m_installType[i], m_kind[i], m_category[i])) out.push_back(static_cast<uint32_t>(i));
+    }
+    return out;
+}
+
+std::vector<uint32_t> PackageIndex::match(const Query& q, int skip, bool& all) const
+{
+    struct Span {
+        const uint32_t* begin;
+        const uint32_t* end;
+        size_t size() const { return static_cast<size_t>(end - begin); }
+    };
+    std::vector<Span> spans;
+    for (int f = 0; f < FacetCount; ++f) {
+        if (f == skip || q.value[f] == kAny) continue;
+        const Postings& postings = m_postings[f];
+        auto it = postings.ranges.find(q.value[f]);
+        if (it == postings.ranges.end()) {
+            all = false;
+            return {};
+        }
+        spans.push_back(Span{postings.rows.data() + it->second.first,
+                             postings.rows.data() + it->second.second});
+    }
+    all = spans.empty();
+    if (all) return {};
+
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.size() < b.size(); });
+    std::vector<uint32_t> out(spans[0].begin, spans[0].end);
+    std::vector<uint32_t> next;
+    for (size_t i = 1; i < spans.size() && !out.empty(); ++i) {
+        const Span& list = spans[i];
+        next.clear();
+        if (out.size() * 16 < list.size()) {
+            // Much shorter than the list: binary-search each survivor.
+            const uint32_t* from = list.begin;
+            for (uint32_t row : out) {
+                from = std::lower_bound(from, list.end, row);
+                if (from == list.end) break;
+                if (*from == row) next.push_back(row);
+            }
+        } else {
+            std::set_intersection(out.begin(), out.end(), list.begin, list.end, std::back_inserter(next));
+        }
+        out.swap(next);
+    }
+    return out;
+}
+
+std::vector<uint32_t> PackageIndex::query(const Query& q) const
+{
+    bool all = false;
+    std::vector<uint32_t> out = match(q, FacetCount, all);
+    if (all) {
+        out.resize(size());
+        std::iota(out.begin(), out.end(), 0u);
+    }
+    return out;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> PackageIndex::facetCounts(const Query& q, Facet facet) const
+{
+    bool all = false;
+    const std::vector<uint32_t> rows = match(q, facet, all);
+    std::vector<std::pair<uint32_t, uint32_t>> counts;
+    if (all) {
+        // Nothing else constrains the rows: the posting list lengths are the counts.
+        for (const auto& kv : m_postings[facet].ranges)
+            counts.emplace_back(kv.first, kv.second.second - kv.second.first);
+    } else {
+        std::unordered_map<uint32_t, uint32_t> byValue;
+        for (uint32_t row : rows) ++byValue[facetValue(row, facet)];
+        counts.assign(byValue.begin(), byValue.end());
+    }
+    // Most common first; ties by id keep the order stable.
+    std::sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return counts;
+}
+
+InstalledPackage PackageIndex::package(size_t row) const
+{
+    InstalledPackage p;
+    p.name = std::string(str(m_name[row]));
+    p.displayName = text(row, DisplayName);
+    p.version = text(row, Version);
+    p.description = text(row, Description);
+    p.type = std::string(str(m_type[row]));
+    p.category = std::string(str(m_category[row]));
+    p.author = std::string(str(m_author[row]));
+    p.license = std::string(str(m_license[row]));
+    p.icon = text(row, Icon);
+    p.view = text(row, View);
+    p.dependencies.reserve(m_depOffsets[row + 1] - m_depOffsets[row]);
+    for (uint32_t i = m_depOffsets[row]; i < m_depOffsets[row + 1]; ++i)
+        p.dependencies.emplace_back(str(m_deps[i]));
+    p.hashes.root = text(row, HashRoot);
+    p.installType = static_cast<InstallType>(m_installType[row]);
+    p.installDir = text(row, InstallDir);
+    p.mainFilePath = text(row, MainFilePath);
+    return p;
+}
+
+size_t PackageIndex::memoryBytes() const
+{
+    size_t bytes = memstats::heapBytes(m_blob) + m_strings.capacity() * sizeof(Slice)
+                 + m_installType.capacity() + m_kind.capacity()
+                 + (m_name.capacity() + m_type.capacity() + m_category.capacity()
+                    + m_author.capacity() + m_license.capacity()
+                    + m_depOffsets.capacity() + m_deps.capacity() + m_rowByName.capacity())
+                   * sizeof(uint32_t);
+    for (const auto& column : m_text) bytes += column.capacity() * sizeof(Slice);
+    bytes += m_versionKey.capacity() * sizeof(semver::Key);
+    for (const auto& postings : m_postings) {
+        bytes += postings.rows.capacity() * sizeof(uint32_t)
+               + postings.ranges.size() * (sizeof(uint32_t) + sizeof(std::pair<uint32_t, uint32_t>)
+                                           + 2 * sizeof(void*))
+               + postings.ranges.bucket_count() * sizeof(void*);
+    }
+    // Hash nodes (key, value, next pointer, cached hash) plus the bucket array.
+    bytes += m_ids.size() * (sizeof(std::string_view) + sizeof(uint32_t) + 2 * sizeof(void*))
+           + m_ids.bucket_count() * sizeof(void*);
+    return bytes;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "semver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct InstalledPackage;
+
+// ---------------------------------------------------------------------------
+// Column-wise snapshot of the installed package set
+// ---------------------------------------------------------------------------
+//
+// Built once from a scan and kept until something changes what is installed.
+// Instead of a vector of InstalledPackage (fourteen heap-backed strings per
+// row), each attribute is its own column:
+//
+//   - installType and kind (core / ui) are one byte per row, so filters over
+//     them are linear scans over small arrays that the compiler vectorises.
+//   - name, type, category, author and license are interned: the column
+//     holds a 32-bit id and equal values share one id, so comparing against
+//     a filter value is an integer compare.
+//   - every other string is an (offset, length) pair into one shared blob
+//     (32-bit offsets: up to 4 GiB of text).
+//   - dependencies are a CSR list of interned name ids.
+//   - version is also parsed once into a packed semver::Key, so version
+//     decisions against the installed set never re-parse the string.
+//   - installType, type, category, author and license also have posting
+//     lists (value -> ascending rows) for faceted queries: a query
+//     intersects the lists of its predicates, smallest first, and a facet
+//     is counted over the rows matching every other predicate.
+//
+// A row is turned back into an InstalledPackage only when it is returned.
+// The index is immutable after construction and not synchronised; the
+// module builds and reads it on the module thread.
+// ---------------------------------------------------------------------------
+
+class PackageIndex {
+public:
+    enum Kind : uint8_t { KindCore = 0, KindUi = 1 };
+    static constexpr uint32_t kNoId = UINT32_MAX;
+
+    // Conjunctive filter; a negative / kNoId member matches every row.
+    struct Filter {
+        int      installType = -1;  // static_cast<int>(InstallType)
+        int      kind = -1;         // Kind
+        uint32_t category = kNoId;  // interned id from find()
+    };
+
+    // Facets of query(): exact-value attributes with posting lists.
+    enum Facet : uint8_t { FacetInstallType, FacetType, FacetCategory, FacetAuthor, FacetLicense,
+                           FacetCount };
+    // Value ids per facet: static_cast<uint32_t>(InstallType) for
+    // FacetInstallType, interned ids from find() for the others. kAny
+    // matches every row; any id no row carries (kNoId included) matches
+    // none.
+    static constexpr uint32_t kAny = UINT32_MAX - 1;
+    struct Query {
+        uint32_t value[FacetCount] = { kAny, kAny, kAny, kAny, kAny };
+    };
+
+    explicit PackageIndex(const std::vector<InstalledPackage>& packages);
+
+    size_t size() const { return m_installType.size(); }
+
+    // Id of an interned value (name, type, category, author, license,
+    // dependency name), or kNoId when no row carries it.
+    uint32_t find(std::string_view value) const;
+    std::string_view str(uint32_t id) const;
+
+    uint8_t installType(size_t row) const { return m_installType[row]; }
+    uint8_t kind(size_t row) const { return m_kind[row]; }
+    uint32_t nameId(size_t row) const { return m_name[row]; }
+    uint32_t categoryId(size_t row) const { return m_category[row]; }
+    std::string_view name(size_t row) const { return str(m_name[row]); }
+    std::string_view displayName(size_t row) const { return slice(m_text[DisplayName][row]); }
+    std::string_view description(size_t row) const { return slice(m_text[Description][row]); }
+    std::string_view version(size_t row) const { return slice(m_text[Version][row]); }
+    const semver::Key& versionKey(size_t row) const { return m_versionKey[row]; }
+    std::string_view hashRoot(size_t row) const { return slice(m_text[HashRoot][row]); }
+    std::string_view installDir(size_t row) const { return slice(m_text[InstallDir][row]); }
+    std::string_view mainFilePath(size_t row) const { return slice(m_text[MainFilePath][row]); }
+    std::string_view type(size_t row) const { return str(m_type[row]); }
+    std::string_view category(size_t row) const { return str(m_category[row]); }
+    // Dependency names of a row, as interned ids.
+    size_t dependencyCount(size_t row) const { return m_depOffsets[row + 1] - m_depOffsets[row]; }
+    uint32_t dependencyId(size_t row, size_t i) const { return m_deps[m_depOffsets[row] + i]; }
+    // Row of the package called `name`, or kNoId.
+    uint32_t findRow(std::string_view name) const;
+
+    size_t count(const Filter& filter) const;
+    std::vector<uint32_t> rows(const Filter& filter) const;
+    // Ascending rows matching every predicate of `q`.
+    std::vector<uint32_t> query(const Query& q) const;
+    // (value id, rows) for every value of `facet` among the rows matching
+    // every predicate of `q` except the facet's own, so a selected value
+    // still shows its alternatives. Zero counts are left out.
+    std::vector<std::pair<uint32_t, uint32_t>> facetCounts(const Query& q, Facet facet) const;
+    InstalledPackage package(size_t row) const;
+
+    // Heap held by the columns, blob and intern table.
+    size_t memoryBytes() const;
+
+private:
+    struct Slice {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+    enum Text { DisplayName, Version, Description, Icon, View, HashRoot, InstallDir, MainFilePath,
+                TextCount };
+
+    std::string_view slice(Slice s) const { return std::string_view(m_blob.data() + s.offset, s.length); }
+    uint32_t intern(const std::string& value);
+    Slice append(const std::string& value);
+    std::string text(size_t row, Text field) const;
+    uint32_t facetValue(size_t row, Facet facet) const;
+    // Rows matching every predicate but `skip` (FacetCount: none); `all`
+    // is set instead when no predicate applies.
+    std::vector<uint32_t> match(const Query& q, int skip, bool& all) const;
+
+    struct Postings {
+        std::vector<uint32_t> rows;  // grouped by value, ascending within a value
+        std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t>> ranges;  // value -> [begin, end)
+    };
+
+    std::string m_blob;
+    std::vector<Slice> m_strings;  // interned id -> blob slice
+    std::unordered_map<std::string_view, uint32_t> m_ids;  // views into m_blob
+
+    std::vector<uint8_t>  m_installType;
+    std::vector<uint8_t>  m_kind;
+    std::vector<uint32_t> m_name;
+    std::vector<uint32_t> m_type;
+    std::vector<uint32_t> m_category;
+    std::vector<uint32_t> m_author;
+    std::vector<uint32_t> m_license;
+    std::vector<Slice>    m_text[TextCount];
+    std::vector<semver::Key> m_versionKey;
+    std::vector<uint32_t> m_depOffsets;  // size() + 1 entries
+    std::vector<uint32_t> m_deps;
+    std::vector<uint32_t> m_rowByName;   // interned id -> row, kNoId if not a package name
+    Postings              m_postings[FacetCount];
+};
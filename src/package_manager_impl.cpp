@@ -1,133 +1,705 @@
 #include "package_manager_impl.h"
+#include "conversions.h"
+#include "file_ops.h"
+#include "embedded_index.h"
+#include "installed_shm.h"
+#include "integrity.h"
+#include "manifest_reader.h"
+#include "memory_stats.h"
+#include "metrics.h"
+#include "package_index.h"
+#include "packed_encoding.h"
+#include "parallel_scan.h"
+#include "reverse_dependency_index.h"
+#include "semver.h"
+#include "trace.h"
+#include "trigram_index.h"
+#include "worker_pool.h"
 #include <package_manager_lib.h>
 #include <lgx.h>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <set>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+#include <unistd.h>
+
+namespace {
+
+using conversions::toFlatLogosList;
+using conversions::toLogosList;
+using conversions::toLogosTreeMap;
+
+// Package subdirectories a directory needs before a parallel scan reads its
+// manifests ahead across the pool; below it one job reads them in turn.
+constexpr size_t kScanFanOut = 32;
+
+// Applies an already-lowercased policy name; false for unknown names.
+bool applySignaturePolicy(PackageManagerLib& lib, const std::string& p)
+{
+    if (p == "none") lib.setSignaturePolicy(SignaturePolicy::NONE);
+    else if (p == "warn") lib.setSignaturePolicy(SignaturePolicy::WARN);
+    else if (p == "require") lib.setSignaturePolicy(SignaturePolicy::REQUIRE);
+    else return false;
+    return true;
+}
+
+// A package name is used as a single directory entry under a user dir; reject
+// anything that would resolve elsewhere once joined into a path.
+bool isPlainPackageName(const std::string& name)
+{
+    return !name.empty() && name.find('/') == std::string::npos && name != "." && name != "..";
+}
+
+// True when `path` is `dir` or lies beneath it. Both must already be
+// canonical; this compares components only.
+bool isWithin(const std::filesystem::path& path, const std::filesystem::path& dir)
+{
+    const std::filesystem::path rel = path.lexically_relative(dir);
+    return !rel.empty() && *rel.begin() != "..";
+}
+
+// Where a package's integrity baseline is kept beside its install.
+std::filesystem::path baselineFile(const std::filesystem::path& installDir, const std::string& name)
+{
+    return installDir.parent_path() / ".pm-integrity" / (name + ".json");
+}
+
+// Package name recorded in an archive header, or empty if it can't be read.
+std::string lgxPackageName(const std::string& lgxPath)
+{
+    lgx_package_t pkg = lgx_load(lgxPath.c_str());
+    if (!pkg) return {};
+    const char* rawName = lgx_get_name(pkg);
+    std::string name = rawName ? rawName : "";
+    lgx_free_package(pkg);
+    return name;
+}
+
+// How replacing `from` with `to` moves a package, in requestUpgrade's
+// terms: "upgrade", "downgrade", "sidegrade" (equal precedence, different
+// or unknown content) or "none" (same Merkle root).
+const char* versionChange(const semver::Key& fromKey, const std::string& from,
+                          const std::string& fromRoot, const semver::Key& toKey,
+                          const std::string& to, const std::string& toRoot)
+{
+    const int c = semver::compare(toKey, to, fromKey, from);
+    if (c > 0) return "upgrade";
+    if (c < 0) return "downgrade";
+    return !toRoot.empty() && toRoot == fromRoot ? "none" : "sidegrade";
+}
+
+// Heap owned by the library's result structs while the module holds them.
+size_t heapBytes(const InstalledPackage& p)
+{
+    using memstats::heapBytes;
+    return heapBytes(p.name) + heapBytes(p.displayName) + heapBytes(p.version)
+         + heapBytes(p.description) + heapBytes(p.type) + heapBytes(p.category)
+         + heapBytes(p.author) + heapBytes(p.license) + heapBytes(p.icon) + heapBytes(p.view)
+         + heapBytes(p.dependencies) + heapBytes(p.hashes.root)
+         + heapBytes(p.installDir) + heapBytes(p.mainFilePath);
+}
+
+size_t heapBytes(const std::vector<InstalledPackage>& packages)
+{
+    size_t bytes = packages.capacity() * sizeof(InstalledPackage);
+    for (const auto& p : packages) bytes += heapBytes(p);
+    return bytes;
+}
+
+size_t nodeFieldBytes(const DependencyTreeNode& n)
+{
+    return memstats::heapBytes(n.name) + memstats::heapBytes(n.version);
+}
+
+size_t nodeFieldBytes(const DependentTreeNode& n)
+{
+    return memstats::heapBytes(n.name) + memstats::heapBytes(n.version)
+         + memstats::heapBytes(n.type) + memstats::heapBytes(n.installDir);
+}
+
+template <typename Node>
+size_t treeBytes(const Node& n)
+{
+    size_t bytes = nodeFieldBytes(n) + n.children.capacity() * sizeof(Node);
+    for (const auto& c : n.children) bytes += treeBytes(c);
+    return bytes;
+}
+
+size_t keyringListBytes(const lgx_keyring_list_t& list)
+{
+    size_t bytes = list.count * sizeof(lgx_keyring_key_t);
+    auto str = [](const char* s) { return s ? std::strlen(s) + 1 : 0; };
+    for (size_t i = 0; i < list.count; ++i) {
+        const auto& k = list.keys[i];
+        bytes += str(k.name) + str(k.did) + str(k.display_name) + str(k.url) + str(k.added_at);
+    }
+    return bytes;
+}
+
+} // namespace
 
 // ---------------------------------------------------------------------------
-// Struct → LogosMap / LogosList conversion helpers
+// Metrics
 // ---------------------------------------------------------------------------
 //
-// Wire format is identical to what PackageManagerLib / the lgpm CLI emit via
-// package_manager_json.cpp's nlohmann ADL hooks. We re-hand-roll here (rather
-// than reuse those hooks) so the unit tests can compile against the stub
-// header in tests/stubs/package_manager_lib.h without pulling in the lib's
-// JSON module.
-//
-// Keep these in sync with package_manager_json.cpp's to_json definitions.
-// ---------------------------------------------------------------------------
+// Every series is registered here, up front, so recording never takes the
+// registry lock. Per-slot histograms are looked up by name in a map that is
+// only read after construction, keyed by views of the static names below so
+// a lookup from a slot's string literal allocates nothing.
 
 namespace {
 
-LogosMap toLogosMap(const Hashes& h)
+// Public slots timed by timeSlot(). Adding a slot means adding it here.
+const char* const kInstrumentedSlots[] = {
+    "installPlugin", "inspectPackage", "installFromDirectory", "upgradeFromFile",
+    "rollbackPackage", "purgeRollbackVersions",
+    "getInstalledPackages", "getInstalledModules", "getInstalledUiPlugins",
+    "findInstalledPackages", "countInstalledPackages", "searchInstalledPackages",
+    "queryInstalledPackages", "compareVersions", "checkOutdated", "verifyInstalled",
+    "startIntegrityScrubber", "stopIntegrityScrubber", "getIntegrityScrubberStatus",
+    "writeEmbeddedIndex", "loadEmbeddedIndex", "setSharedIndexPublishing", "setParallelScan",
+    "setScanManifestReader",
+    "uninstallPackage",
+    "resolveDependencies", "resolveDependents", "resolveFlatDependencies", "resolveFlatDependents",
+    "verifyPackage", "addTrustedKey", "removeTrustedKey", "listTrustedKeys",
+    "requestUninstall", "requestUpgrade", "requestInstall", "stagePendingPackage",
+    "ackPendingAction", "confirmUninstall", "cancelUninstall", "confirmUpgrade", "cancelUpgrade",
+    "confirmInstall", "cancelInstall", "resetPendingAction",
+    "requestMultiUninstall", "confirmMultiUninstall", "cancelMultiUninstall",
+};
+
+const char* const kGatedOps[] = { "none", "uninstall", "upgrade", "install", "multi_uninstall" };
+const char* const kGatedOutcomes[] = { "confirmed", "cancelled", "timeout" };
+// getMemoryStats / logos_package_manager_memory_bytes order, matching
+// MemoryAccounts::all.
+const char* const kMemorySubsystems[] = {
+    "scans", "indexes", "dependencyGraphs", "keyring", "trace", "metrics", "pendingAction",
+};
+
+} // namespace
+
+struct PackageManagerImpl::Instruments {
+    explicit Instruments(metrics::Registry& r)
+        : scanPackages(r.histogram("logos_package_manager_scan_duration_seconds",
+                                   "Time spent scanning installed packages.", {{"kind", "packages"}}))
+        , scanModules(r.histogram("logos_package_manager_scan_duration_seconds",
+                                  "Time spent scanning installed packages.", {{"kind", "modules"}}))
+        , scanUiPlugins(r.histogram("logos_package_manager_scan_duration_seconds",
+                                    "Time spent scanning installed packages.", {{"kind", "ui_plugins"}}))
+        , phaseVerify(phase(r, "verify"))
+        , phaseExtract(phase(r, "extract"))
+        , phaseDiff(phase(r, "diff"))
+        , phaseStage(phase(r, "stage"))
+        , phaseSwap(phase(r, "swap"))
+        , sigValid(signature(r, "valid"))
+        , sigInvalid(signature(r, "invalid"))
+        , sigUnsigned(signature(r, "unsigned"))
+        , sigError(signature(r, "error"))
+        , installSuccess(r.counter("logos_package_manager_installs_total",
+                                   "installPlugin calls by result.", {{"result", "success"}}))
+        , installFailure(r.counter("logos_package_manager_installs_total",
+                                   "installPlugin calls by result.", {{"result", "failure"}}))
+        , uninstallSuccess(r.counter("logos_package_manager_uninstalls_total",
+                                     "Package removals by result.", {{"result", "success"}}))
+        , uninstallFailure(r.counter("logos_package_manager_uninstalls_total",
+                                     "Package removals by result.", {{"result", "failure"}}))
+        , upgradeSwapped(r.counter("logos_package_manager_upgrades_total",
+                                   "Staged upgrades by result.", {{"result", "swapped"}}))
+        , upgradeUpToDate(r.counter("logos_package_manager_upgrades_total",
+                                    "Staged upgrades by result.", {{"result", "up_to_date"}}))
+        , upgradeFailure(r.counter("logos_package_manager_upgrades_total",
+                                   "Staged upgrades by result.", {{"result", "failure"}}))
+        , upgradeBytesWritten(r.counter("logos_package_manager_upgrade_bytes_written_total",
+                                        "Bytes of added or changed files written by staged upgrades."))
+        , stagingCommitted(staging(r, "committed"))
+        , stagingFallback(staging(r, "fallback"))
+        , stagingDiscarded(staging(r, "discarded"))
+        , ackTimerThreads(r.counter("logos_package_manager_ack_timer_threads_started_total",
+                                    "Ack-reception timer threads started by gated requests."))
+        , indexHits(r.counter("logos_package_manager_index_lookups_total",
+                              "Installed-index queries by whether the cached index was current.",
+                              {{"result", "hit"}}))
+        , indexMisses(r.counter("logos_package_manager_index_lookups_total",
+                                "Installed-index queries by whether the cached index was current.",
+                                {{"result", "miss"}}))
+        , indexInvalidations(r.counter("logos_package_manager_index_invalidations_total",
+                                       "Cached installed indexes dropped because the installed set changed."))
+        , searchUpserted(r.counter("logos_package_manager_search_index_updates_total",
+                                   "Search index documents re-tokenised or dropped on index rebuilds.",
+                                   {{"change", "upserted"}}))
+        , searchRemoved(r.counter("logos_package_manager_search_index_updates_total",
+                                  "Search index documents re-tokenised or dropped on index rebuilds.",
+                                  {{"change", "removed"}}))
+        , reverseUpserted(r.counter("logos_package_manager_reverse_index_updates_total",
+                                    "Packages whose reverse dependency edges were rewritten or dropped on index rebuilds.",
+                                    {{"change", "upserted"}}))
+        , reverseRemoved(r.counter("logos_package_manager_reverse_index_updates_total",
+                                   "Packages whose reverse dependency edges were rewritten or dropped on index rebuilds.",
+                                   {{"change", "removed"}}))
+        , indexBuild(r.histogram("logos_package_manager_index_build_duration_seconds",
+                                 "Time to rebuild the installed index, scan included."))
+        , integrityHashed(r.counter("logos_package_manager_integrity_files_total",
+                                    "Files examined by integrity audits, by whether their contents were hashed.",
+                                    {{"result", "hashed"}}))
+        , integritySkipped(r.counter("logos_package_manager_integrity_files_total",
+                                     "Files examined by integrity audits, by whether their contents were hashed.",
+                                     {{"result", "skipped"}}))
+        , integrityBytes(r.counter("logos_package_manager_integrity_bytes_hashed_total",
+                                   "Bytes read and hashed by integrity audits."))
+        , integrityModified(r.counter("logos_package_manager_integrity_violations_total",
+                                      "Packages an integrity audit found modified."))
+        , embeddedIndexLoaded(r.counter("logos_package_manager_embedded_index_loads_total",
+                                        "loadEmbeddedIndex calls by whether the file was accepted.",
+                                        {{"result", "loaded"}}))
+        , embeddedIndexRejected(r.counter("logos_package_manager_embedded_index_loads_total",
+                                          "loadEmbeddedIndex calls by whether the file was accepted.",
+                                          {{"result", "rejected"}}))
+        , sharedIndexPublished(r.counter("logos_package_manager_shared_index_publishes_total",
+                                         "Installed indexes published to the shared-memory segment."))
+        , sharedIndexBytes(r.gauge("logos_package_manager_shared_index_bytes",
+                                   "Size of the shared-memory segment, 0 when not publishing."))
+        , scanPrefetched(r.counter("logos_package_manager_scan_prefetched_manifests_total",
+                                   "Manifests read ahead across the pool by parallel scans."))
+    {
+        for (size_t i = 0; i <= std::size(kMemorySubsystems); ++i) {
+            const char* subsystem = i < std::size(kMemorySubsystems) ? kMemorySubsystems[i] : "total";
+            memoryBytes[i] = &r.gauge("logos_package_manager_memory_bytes",
+                                      "Estimated heap held by each subsystem.", {{"subsystem", subsystem}});
+            memoryPeakBytes[i] = &r.gauge("logos_package_manager_memory_peak_bytes",
+                                          "Most heap each subsystem has held at once.",
+                                          {{"subsystem", subsystem}});
+        }
+        for (const char* slot : kInstrumentedSlots) {
+            slotSeconds.emplace(slot, &r.histogram("logos_package_manager_slot_duration_seconds",
+                                                  "Wall time of each public slot call.",
+                                                  {{"slot", slot}}));
+        }
+        for (size_t op = 1; op < std::size(kGatedOps); ++op) {
+            pending[op] = &r.gauge("logos_package_manager_pending_action",
+                                   "1 while a gated action of this kind awaits a decision.",
+                                   {{"op", kGatedOps[op]}});
+            for (size_t o = 0; o < std::size(kGatedOutcomes); ++o) {
+                outcomes[op][o] = &r.counter("logos_package_manager_gated_outcomes_total",
+                                             "Gated actions by how they ended.",
+                                             {{"op", kGatedOps[op]}, {"outcome", kGatedOutcomes[o]}});
+            }
+        }
+    }
+
+    static metrics::Histogram& phase(metrics::Registry& r, const char* name)
+    {
+        return r.histogram("logos_package_manager_install_phase_duration_seconds",
+                           "Time spent in each phase of installs and upgrades.", {{"phase", name}});
+    }
+    static metrics::Counter& signature(metrics::Registry& r, const char* result)
+    {
+        return r.counter("logos_package_manager_signature_checks_total",
+                         "Package signature verifications by result.", {{"result", result}});
+    }
+    static metrics::Counter& staging(metrics::Registry& r, const char* result)
+    {
+        return r.counter("logos_package_manager_speculative_staging_total",
+                         "stagePendingPackage work by how it ended.", {{"result", result}});
+    }
+
+    void countSignature(const SignatureVerificationResult& sig)
+    {
+        if (sig.is_signed) (sig.signature_valid && sig.package_valid ? sigValid : sigInvalid).inc();
+        else if (!sig.error.empty()) sigError.inc();
+        else sigUnsigned.inc();
+    }
+
+    std::unordered_map<std::string_view, metrics::Histogram*> slotSeconds;
+    metrics::Histogram& scanPackages;
+    metrics::Histogram& scanModules;
+    metrics::Histogram& scanUiPlugins;
+    metrics::Histogram& phaseVerify;
+    metrics::Histogram& phaseExtract;
+    metrics::Histogram& phaseDiff;
+    metrics::Histogram& phaseStage;
+    metrics::Histogram& phaseSwap;
+    metrics::Counter& sigValid;
+    metrics::Counter& sigInvalid;
+    metrics::Counter& sigUnsigned;
+    metrics::Counter& sigError;
+    metrics::Counter& installSuccess;
+    metrics::Counter& installFailure;
+    metrics::Counter& uninstallSuccess;
+    metrics::Counter& uninstallFailure;
+    metrics::Counter& upgradeSwapped;
+    metrics::Counter& upgradeUpToDate;
+    metrics::Counter& upgradeFailure;
+    metrics::Counter& upgradeBytesWritten;
+    metrics::Counter& stagingCommitted;
+    metrics::Counter& stagingFallback;
+    metrics::Counter& stagingDiscarded;
+    metrics::Counter& ackTimerThreads;
+    metrics::Counter& indexHits;
+    metrics::Counter& indexMisses;
+    metrics::Counter& indexInvalidations;
+    metrics::Counter& searchUpserted;
+    metrics::Counter& searchRemoved;
+    metrics::Counter& reverseUpserted;
+    metrics::Counter& reverseRemoved;
+    metrics::Histogram& indexBuild;
+    metrics::Counter& integrityHashed;
+    metrics::Counter& integritySkipped;
+    metrics::Counter& integrityBytes;
+    metrics::Counter& integrityModified;
+    metrics::Counter& embeddedIndexLoaded;
+    metrics::Counter& embeddedIndexRejected;
+    metrics::Counter& sharedIndexPublished;
+    metrics::Gauge&   sharedIndexBytes;
+    metrics::Counter& scanPrefetched;
+    // Indexed by PendingOp (None unused) and kGatedOutcomes.
+    metrics::Gauge*   pending[std::size(kGatedOps)] = {};
+    metrics::Counter* outcomes[std::size(kGatedOps)][std::size(kGatedOutcomes)] = {};
+    // Indexed by kMemorySubsystems; the extra last entry is the total.
+    metrics::Gauge*   memoryBytes[std::size(kMemorySubsystems) + 1] = {};
+    metrics::Gauge*   memoryPeakBytes[std::size(kMemorySubsystems) + 1] = {};
+};
+
+// ---------------------------------------------------------------------------
+// Memory accounting
+// ---------------------------------------------------------------------------
+//
+// Transient structures (scan results, dependency trees, keyring listings)
+// are charged while a slot holds them, so their peaks show the largest
+// working set. Long-lived state is set on the module thread where it
+// changes: the indexes when the installed index is built or dropped, the
+// trace ring when tracing is enabled, the metrics registry once all series
+// are registered. Pending-action state is sampled under m_stateMutex when
+// the stats are read. The metrics textfile writer therefore reads only
+// these atomics and state under that mutex, never the indexes themselves.
+
+struct PackageManagerImpl::MemoryAccounts {
+    memstats::Account total;
+    memstats::Account scans{&total};
+    memstats::Account indexes{&total};
+    memstats::Account dependencyGraphs{&total};
+    memstats::Account keyring{&total};
+    memstats::Account trace{&total};
+    memstats::Account metrics{&total};
+    memstats::Account pendingAction{&total};
+
+    memstats::Account* const all[std::size(kMemorySubsystems)] = {
+        &scans, &indexes, &dependencyGraphs, &keyring, &trace, &metrics, &pendingAction,
+    };
+};
+
+PackageManagerImpl::PackageManagerImpl()
+    : m_lib(nullptr)
+    , m_metrics(std::make_unique<metrics::Registry>())
+    , m_mem(std::make_unique<MemoryAccounts>())
+    , m_search(std::make_unique<TrigramIndex>())
+    , m_reverse(std::make_unique<ReverseDependencyIndex>())
 {
-    LogosMap m = LogosMap::object();
-    m["root"] = h.root;
-    return m;
+    m_lib = new PackageManagerLib();
+    m_instr = std::make_unique<Instruments>(*m_metrics);
+    // Every series is registered by Instruments; the registry does not grow.
+    m_mem->metrics.set(m_metrics->memoryBytes());
 }
 
-LogosMap toLogosMap(const InstalledPackage& p)
+PackageManagerImpl::SlotGuard::SlotGuard(PackageManagerImpl* impl)
+    : m_impl(impl)
 {
-    LogosMap m = LogosMap::object();
-    m["name"]         = p.name;
-    m["displayName"]  = p.displayName;
-    m["version"]      = p.version;
-    m["description"]  = p.description;
-    m["type"]         = p.type;
-    m["category"]     = p.category;
-    m["author"]       = p.author;
-    m["license"]      = p.license;
-    m["icon"]         = p.icon;
-    m["view"]         = p.view;
+    ++m_impl->m_slotDepth;
+}
 
-    LogosList deps = LogosList::array();
-    for (const auto& d : p.dependencies) deps.push_back(d);
-    m["dependencies"] = deps;
+PackageManagerImpl::SlotGuard::~SlotGuard()
+{
+    if (!m_impl || --m_impl->m_slotDepth > 0) return;
+    try {
+        m_impl->flushSharedIndex();
+    } catch (const std::exception& e) {
+        std::cerr << "PackageManagerImpl: could not publish the shared index: " << e.what() << "\n";
+    }
+}
+
+PackageManagerImpl::TimedScope PackageManagerImpl::timeSlot(const char* slot)
+{
+    // A slot missing from kInstrumentedSlots is traced but not timed.
+    const auto it = m_instr->slotSeconds.find(slot);
+    return TimedScope{metrics::ScopedTimer(it != m_instr->slotSeconds.end() ? it->second : nullptr),
+                      trace::Span(m_trace, slot, "slot"), SlotGuard(this)};
+}
 
-    m["hashes"]       = toLogosMap(p.hashes);
-    m["installType"]  = std::string(installTypeToString(p.installType));
-    m["installDir"]   = p.installDir;
-    m["mainFilePath"] = p.mainFilePath;
-    return m;
+PackageManagerImpl::TimedScope PackageManagerImpl::timePhase(metrics::Histogram& histogram,
+                                                             const char* phase) const
+{
+    return TimedScope{metrics::ScopedTimer(histogram), trace::Span(m_trace, phase, "phase")};
 }
 
-LogosList toLogosList(const std::vector<InstalledPackage>& v)
+void PackageManagerImpl::emitInstalled(bool isCore, const std::string& path)
 {
-    LogosList out = LogosList::array();
-    for (const auto& p : v) out.push_back(toLogosMap(p));
-    return out;
+    // Every path that installs, upgrades or rolls back announces it here,
+    // which is also where the package's files legitimately change: the
+    // integrity baseline is taken now, from what the module just wrote.
+    invalidateInstalledIndex();
+    const std::filesystem::path installed(path);
+    for (const auto* dir : {&m_userModulesDir, &m_userUiPluginsDir}) {
+        if (dir->empty()) continue;
+        const std::filesystem::path rel = installed.lexically_relative(*dir);
+        if (rel.empty() || !isPlainPackageName(rel.begin()->string())) continue;
+        const std::string name = rel.begin()->string();
+        takeIntegrityBaseline(name, std::filesystem::path(*dir) / name);
+        break;
+    }
+    flushSharedIndex();
+    trace::Span span(m_trace, isCore ? "emit corePluginFileInstalled" : "emit uiPluginFileInstalled",
+                     "event");
+    if (isCore) {
+        corePluginFileInstalled(path);
+    } else {
+        uiPluginFileInstalled(path);
+    }
 }
 
-// Flat per-node projection — just the node's own fields, no `children`.
-// Shared between the flat list APIs (resolveFlatDependencies /
-// resolveFlatDependents) and the tree APIs (where each recursive step is
-// "this node's fields plus its children").
-LogosMap toFlatLogosMap(const DependencyTreeNode& n)
+LogosMap PackageManagerImpl::setTracingEnabled(bool enabled)
 {
-    LogosMap m = LogosMap::object();
-    m["name"]   = n.name;
-    m["status"] = std::string(dependencyStatusToString(n.status));
-    if (n.status == DependencyStatus::Installed) {
-        m["version"]     = n.version;
-        m["installType"] = std::string(installTypeToString(n.installType));
+    if (enabled) {
+        m_trace.enable();
     } else {
-        m["version"]     = "";
-        m["installType"] = "";
+        m_trace.disable();
     }
-    return m;
+    m_mem->trace.set(m_trace.memoryBytes());
+    LogosMap response;
+    response["success"] = true;
+    response["enabled"] = enabled;
+    return response;
 }
 
-LogosMap toFlatLogosMap(const DependentTreeNode& n)
+std::string PackageManagerImpl::getTraceJson()
 {
-    LogosMap m = LogosMap::object();
-    m["name"]        = n.name;
-    m["version"]     = n.version;
-    m["type"]        = n.type;
-    m["installType"] = std::string(installTypeToString(n.installType));
-    m["installDir"]  = n.installDir;
-    return m;
+    return m_trace.toChromeJson();
 }
 
-// Depth-clipped tree serialisation — root always emitted with its own
-// fields; `maxDepth` bounds how far we recurse into `children`. Used by
-// resolveDependencies/resolveDependents: maxDepth=1 for !recursive (root
-// + direct children with empty children arrays), maxDepth=INT_MAX for
-// the full tree.
-template <typename Node>
-LogosMap toLogosTreeMap(const Node& n, int maxDepth)
+void PackageManagerImpl::countGatedOutcome(PendingOp op, GatedOutcome outcome)
+{
+    const size_t i = static_cast<size_t>(op);
+    if (i > 0 && i < std::size(kGatedOps))
+        m_instr->outcomes[i][static_cast<size_t>(outcome)]->inc();
+}
+
+SignatureVerificationResult PackageManagerImpl::verifySignature(const std::string& lgxPath) const
+{
+    return verifySignature(*m_lib, lgxPath);
+}
+
+SignatureVerificationResult PackageManagerImpl::verifySignature(PackageManagerLib& lib,
+                                                                const std::string& lgxPath) const
+{
+    auto phase = timePhase(m_instr->phaseVerify, "verifyPackageSignature");
+    SignatureVerificationResult sig = lib.verifyPackageSignature(lgxPath);
+    m_instr->countSignature(sig);
+    return sig;
+}
+
+std::vector<InstalledPackage> PackageManagerImpl::scanInstalledPackages() const
 {
-    LogosMap m = toFlatLogosMap(n);
-    LogosList children = LogosList::array();
-    if (maxDepth > 0) {
-        for (const auto& c : n.children)
-            children.push_back(toLogosTreeMap(c, maxDepth - 1));
+    metrics::ScopedTimer timer(m_instr->scanPackages);
+    trace::Span span(m_trace, "scan getInstalledPackages", "scan");
+    if (m_embeddedIndexActive) return scanWithEmbeddedIndex(true, true, &PackageManagerLib::getInstalledPackages);
+    if (scansInParallel()) return scanInParallel(true, true, true);
+    return m_lib->getInstalledPackages();
+}
+
+std::vector<InstalledPackage> PackageManagerImpl::scanWithEmbeddedIndex(
+    bool modules, bool uiPlugins, std::vector<InstalledPackage> (PackageManagerLib::*scan)()) const
+{
+    std::vector<InstalledPackage> user =
+        scansInParallel() ? scanInParallel(modules, uiPlugins, false) : (m_userLib.get()->*scan)();
+    const embeddedindex::Index& index = *m_embeddedIndex;
+    std::vector<InstalledPackage> out;
+    out.reserve((modules ? index.modules.size() : 0) + (uiPlugins ? index.uiPlugins.size() : 0) + user.size());
+    if (modules) out.insert(out.end(), index.modules.begin(), index.modules.end());
+    if (uiPlugins) out.insert(out.end(), index.uiPlugins.begin(), index.uiPlugins.end());
+    // m_userLib is given no embedded directories, so it reports none.
+    for (auto& p : user) {
+        if (p.installType == InstallType::User) out.push_back(std::move(p));
     }
-    m["children"] = children;
-    return m;
+    return out;
 }
 
-template <typename Node>
-LogosList toFlatLogosList(const std::vector<Node>& v)
+std::vector<InstalledPackage> PackageManagerImpl::scanInParallel(bool modules, bool uiPlugins, bool embedded) const
 {
-    LogosList out = LogosList::array();
-    for (const auto& n : v) out.push_back(toFlatLogosMap(n));
+    trace::Span span(m_trace, "parallel scan", "scan");
+    std::vector<parallelscan::Directory> dirs;
+    std::vector<size_t> configured;  // indexes into m_scanDirs / m_scanLibs
+    for (size_t i = 0; i < m_scanDirs.size(); ++i) {
+        const parallelscan::Directory& d = m_scanDirs[i];
+        if ((d.uiPlugins ? uiPlugins : modules) && (embedded || d.installType == InstallType::User)) {
+            dirs.push_back(d);
+            configured.push_back(i);
+        }
+    }
+    const size_t fanOut = m_scanFanOut ? m_scanFanOut : kScanFanOut;
+    parallelscan::Stats stats;
+    std::vector<InstalledPackage> out;
+    if (m_onDemandManifests) {
+        // The module reads the manifests, fanned out per package.
+        const std::vector<std::string> variants = PackageManagerLib::platformVariantsToTry();
+        out = parallelscan::scan(
+            dirs,
+            [&](size_t i) {
+                return manifest::scanDirectory(dirs[i].path, dirs[i].installType, variants,
+                                               manifest::Reader::OnDemand, &pool(), fanOut);
+            },
+            pool(), 0, stats);
+    } else {
+        out = parallelscan::scan(
+            dirs,
+            [&](size_t i) {
+                PackageManagerLib& lib = *m_scanLibs[configured[i]];
+                return dirs[i].uiPlugins ? lib.getInstalledUiPlugins() : lib.getInstalledModules();
+            },
+            pool(), fanOut, stats);
+    }
+    m_instr->scanPrefetched.inc(stats.prefetched);
     return out;
 }
 
-} // namespace
+void PackageManagerImpl::rebuildScanLibs()
+{
+    m_scanDirs.clear();
+    m_scanLibs.clear();
+    if (!scansInParallel()) return;
+    auto add = [&](const std::string& dir, bool uiPlugins, InstallType type) {
+        if (dir.empty()) return;
+        m_scanDirs.push_back({dir, uiPlugins, type});
+        // The on-demand reader scans without a library.
+        if (m_onDemandManifests) return;
+        auto lib = std::make_unique<PackageManagerLib>();
+        if (type == InstallType::User) {
+            if (uiPlugins) lib->setUserUiPluginsDirectory(dir);
+            else lib->setUserModulesDirectory(dir);
+        } else {
+            if (uiPlugins) lib->setEmbeddedUiPluginsDirectory(dir);
+            else lib->setEmbeddedModulesDirectory(dir);
+        }
+        m_scanLibs.push_back(std::move(lib));
+    };
+    for (const auto& dir : m_embeddedModulesDirs) add(dir, false, InstallType::Embedded);
+    for (const auto& dir : m_embeddedUiPluginsDirs) add(dir, true, InstallType::Embedded);
+    add(m_userModulesDir, false, InstallType::User);
+    add(m_userUiPluginsDir, true, InstallType::User);
+}
 
-PackageManagerImpl::PackageManagerImpl()
-    : m_lib(nullptr)
+std::string PackageManagerImpl::getMetricsText()
 {
-    m_lib = new PackageManagerLib();
+    {
+        // Pending state is sampled at render time rather than tracked on
+        // every transition.
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        for (size_t op = 1; op < std::size(kGatedOps); ++op)
+            m_instr->pending[op]->set(static_cast<size_t>(m_pendingAction.op) == op ? 1 : 0);
+        m_mem->pendingAction.set(pendingActionBytesLocked());
+    }
+    for (size_t i = 0; i <= std::size(kMemorySubsystems); ++i) {
+        const memstats::Account& account =
+            i < std::size(kMemorySubsystems) ? *m_mem->all[i] : m_mem->total;
+        m_instr->memoryBytes[i]->set(account.current());
+        m_instr->memoryPeakBytes[i]->set(account.peak());
+    }
+    return m_metrics->render();
+}
+
+void PackageManagerImpl::accountIndexMemory()
+{
+    size_t embedded = 0;
+    if (m_embeddedIndex)
+        embedded = heapBytes(m_embeddedIndex->modules) + heapBytes(m_embeddedIndex->uiPlugins);
+    m_mem->indexes.set((m_index ? m_index->memoryBytes() : 0) + m_search->memoryBytes()
+                       + m_reverse->memoryBytes() + embedded);
+}
+
+size_t PackageManagerImpl::pendingActionBytesLocked() const
+{
+    using memstats::heapBytes;
+    const PendingAction& pa = m_pendingAction;
+    size_t bytes = heapBytes(pa.name) + heapBytes(pa.names) + heapBytes(pa.releaseTag)
+                 + heapBytes(pa.repositoryUrl);
+    if (const Speculation* spec = pa.speculation.get()) {
+        const UpgradePlan& up = spec->upgrade;
+        bytes += sizeof(Speculation) + heapBytes(spec->lgxPath) + heapBytes(spec->error)
+               + heapBytes(spec->config.signaturePolicy) + heapBytes(spec->config.keyringDir)
+               + heapBytes(spec->config.parentDir)
+               + heapBytes(up.name) + heapBytes(up.fromVersion) + heapBytes(up.toVersion)
+               + heapBytes(up.liveDir) + heapBytes(up.stagingParent) + heapBytes(up.stagedDir)
+               + heapBytes(up.mainFile)
+               + heapBytes(up.diff.added) + heapBytes(up.diff.changed)
+               + heapBytes(up.diff.removed) + heapBytes(up.diff.unchanged)
+               + heapBytes(spec->install.root) + heapBytes(spec->install.packageDir)
+               + heapBytes(spec->install.mainFile);
+    }
+    return bytes;
+}
+
+LogosMap PackageManagerImpl::getMemoryStats()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_mem->pendingAction.set(pendingActionBytesLocked());
+    }
+    LogosMap subsystems = LogosMap::object();
+    for (size_t i = 0; i < std::size(kMemorySubsystems); ++i) {
+        LogosMap entry;
+        entry["bytes"] = m_mem->all[i]->current();
+        entry["peakBytes"] = m_mem->all[i]->peak();
+        subsystems[kMemorySubsystems[i]] = entry;
+    }
+    const memstats::ProcessMemory process = memstats::processMemory();
+    LogosMap processMap;
+    processMap["residentBytes"] = process.residentBytes;
+    processMap["peakResidentBytes"] = process.peakResidentBytes;
+
+    LogosMap response;
+    response["success"] = true;
+    response["totalBytes"] = m_mem->total.current();
+    response["peakTotalBytes"] = m_mem->total.peak();
+    response["subsystems"] = subsystems;
+    response["process"] = processMap;
+    return response;
+}
+
+LogosMap PackageManagerImpl::setMetricsFile(const std::string& path, int64_t intervalMs)
+{
+    LogosMap response;
+    m_metricsWriter.stop();
+    if (path.empty()) {
+        response["success"] = true;
+        return response;
+    }
+    // Write once here so a bad path is reported to the caller rather than
+    // failing silently on the writer thread.
+    std::string error;
+    if (!metrics::TextfileWriter::writeOnce(path, getMetricsText(), error)) {
+        response["success"] = false;
+        response["error"] = error;
+        return response;
+    }
+    const auto interval = std::chrono::milliseconds(intervalMs > 0 ? intervalMs : 15000);
+    m_metricsWriter.start(path, interval, [this]() { return getMetricsText(); });
+    response["success"] = true;
+    return response;
 }
 
 PackageManagerImpl::~PackageManagerImpl()
 {
+    // The textfile writer renders through this object, and the scrubber
+    // audits through it; stop them first.
+    m_metricsWriter.stop();
+    m_scrubber.stop();
+
     // Signal any running worker thread to exit, then join it before tearing
     // down state it might still reference (m_pendingAction, read when the
     // worker emits its cancellation event via the typed event methods). The
@@ -142,32 +714,60 @@ PackageManagerImpl::~PackageManagerImpl()
     m_ackCv.notify_all();
     if (m_ackThread.joinable()) m_ackThread.join();
 
+    // A speculation still running is told to clean up after itself, then
+    // pool tasks (which may still be using m_lib) are drained and joined.
+    if (m_pendingAction.speculation) discardSpeculation(m_pendingAction.speculation);
+    m_pool.reset();
+
     delete m_lib;
     m_lib = nullptr;
 }
 
+WorkerPool& PackageManagerImpl::pool() const
+{
+    if (!m_pool) m_pool = std::make_unique<WorkerPool>();
+    return *m_pool;
+}
+
 LogosMap PackageManagerImpl::installPlugin(const std::string& pluginPath, bool skipIfNotNewerVersion)
 {
+    auto slotTimer = timeSlot("installPlugin");
+    // The response carries a signature report, which means decompressing and
+    // hashing the whole archive a second time (the library's own policy check
+    // during installPluginFile is the first). Run the report on the pool while
+    // extraction proceeds on this thread, through a private library instance
+    // with the same policy and keyring: m_lib stays on the module thread.
+    const ExtractionConfig config = extractionConfig({});
+    auto sigFuture = pool().submit([this, config, pluginPath]() {
+        PackageManagerLib verifyLib;
+        if (!config.signaturePolicy.empty()) applySignaturePolicy(verifyLib, config.signaturePolicy);
+        if (!config.keyringDir.empty()) verifyLib.setKeyringDirectory(config.keyringDir);
+        return verifySignature(verifyLib, pluginPath);
+    });
+
     std::string errorMsg;
     std::string installedPluginPath;
     bool isCoreModule = false;
-    std::string result = m_lib->installPluginFile(
-        pluginPath, errorMsg, skipIfNotNewerVersion,
-        &installedPluginPath, &isCoreModule
-    );
+    bool success = false;
+
+    std::string result;
+    {
+        auto phase = timePhase(m_instr->phaseExtract, "installPluginFile");
+        result = m_lib->installPluginFile(
+            pluginPath, errorMsg, skipIfNotNewerVersion,
+            &installedPluginPath, &isCoreModule
+        );
+    }
 
-    bool success = !result.empty();
+    success = !result.empty();
 
     if (success && !installedPluginPath.empty()) {
-        if (isCoreModule) {
-            corePluginFileInstalled(installedPluginPath);
-        } else {
-            uiPluginFileInstalled(installedPluginPath);
-        }
+        emitInstalled(isCoreModule, installedPluginPath);
     }
 
     // Get signature info for the response
-    auto sigResult = m_lib->verifyPackageSignature(pluginPath);
+    auto sigResult = sigFuture.get();
+    (success ? m_instr->installSuccess : m_instr->installFailure).inc();
 
     std::string stem = std::filesystem::path(pluginPath).stem().string();
 
@@ -202,9 +802,13 @@ LogosMap PackageManagerImpl::installPlugin(const std::string& pluginPath, bool s
 
 LogosMap PackageManagerImpl::inspectPackage(const std::string& lgxPath)
 {
+    auto slotTimer = timeSlot("inspectPackage");
     LogosMap result;
 
-    lgx_package_t pkg = lgx_load(lgxPath.c_str());
+    lgx_package_t pkg = [&] {
+        trace::Span span(m_trace, "lgx_load", "lgx");
+        return lgx_load(lgxPath.c_str());
+    }();
     if (!pkg) {
         result["error"] = std::string("Failed to load LGX package: ")
                         + (lgx_get_last_error() ? lgx_get_last_error() : "unknown");
@@ -230,6 +834,7 @@ LogosMap PackageManagerImpl::inspectPackage(const std::string& lgxPath)
     // confirmation dialog show a stable per-release fingerprint.
     if (rawManifest) {
         try {
+            trace::Span span(m_trace, "manifest parse", "json");
             auto doc = LogosMap::parse(rawManifest);
             result["type"]     = doc.value("type", "");
             result["category"] = doc.value("category", "");
@@ -245,87 +850,1526 @@ LogosMap PackageManagerImpl::inspectPackage(const std::string& lgxPath)
         }
     }
 
-    // Available platform variants.
-    const char** variants = lgx_get_variants(pkg);
-    LogosList variantList = LogosList::array();
-    if (variants) {
-        for (int i = 0; variants[i]; ++i)
-            variantList.push_back(std::string(variants[i]));
-        lgx_free_string_array(variants);
+    // Available platform variants.
+    const char** variants = lgx_get_variants(pkg);
+    LogosList variantList = LogosList::array();
+    if (variants) {
+        for (int i = 0; variants[i]; ++i)
+            variantList.push_back(std::string(variants[i]));
+        lgx_free_string_array(variants);
+    }
+    result["variants"] = variantList;
+
+    lgx_free_package(pkg);
+
+    // Signature verification — standalone, no install side effects.
+    auto sig = verifySignature(lgxPath);
+    if (sig.is_signed) {
+        bool valid = sig.signature_valid && sig.package_valid;
+        result["signatureStatus"] = valid ? std::string("signed")
+                                          : std::string("invalid");
+        result["signerDid"]  = sig.signer_did;
+        result["signerName"] = sig.signer_name;
+    } else if (!sig.error.empty()) {
+        result["signatureStatus"] = std::string("error");
+    } else {
+        result["signatureStatus"] = std::string("unsigned");
+    }
+
+    // Check if this package is already installed.
+    bool isAlreadyInstalled = false;
+    std::string installedVersion;
+    std::string installedHash;
+    std::vector<InstalledPackage> scan = scanInstalledPackages();
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(scan));
+    for (const auto& entry : scan) {
+        if (entry.name == pkgName) {
+            isAlreadyInstalled = true;
+            installedVersion = entry.version;
+            // Passthrough from the installed manifest.json; same field PMU
+            // reads in the online catalog (`manifest.hashes.root`).
+            installedHash = entry.hashes.root;
+            break;
+        }
+    }
+    result["isAlreadyInstalled"] = isAlreadyInstalled;
+    result["installedVersion"]   = installedVersion;
+    result["installedHash"]      = installedHash;
+    if (isAlreadyInstalled) {
+        result["versionChange"] = versionChange(semver::key(installedVersion), installedVersion,
+                                                installedHash, semver::key(pkgVersion), pkgVersion,
+                                                result.value("rootHash", ""));
+    }
+
+    // If already installed, compute reverse dependents so the dialog can
+    // show what would be affected by an upgrade.
+    if (isAlreadyInstalled) {
+        auto deps = installedDependentsNames(pkgName);
+        LogosList depList = LogosList::array();
+        for (const auto& d : deps) depList.push_back(d);
+        result["installedDependents"] = depList;
+    }
+
+    return result;
+}
+
+// Resolve a manifest's `main` entry to a file inside `installDir`. `main` is
+// either a plain file name or an object keyed by platform variant; in the
+// latter case the first variant this build accepts wins. Returns an empty
+// string when nothing resolves (the caller then reports the directory).
+static std::string resolveMainFile(const LogosMap& manifest, const std::filesystem::path& installDir)
+{
+    return manifest::mainFile(manifest, installDir, PackageManagerLib::platformVariantsToTry());
+}
+
+LogosMap PackageManagerImpl::compareVersions(const LogosList& pairs)
+{
+    auto slotTimer = timeSlot("compareVersions");
+    LogosMap response;
+    if (!pairs.is_array()) {
+        response["success"] = false;
+        response["error"] = "pairs must be a list of [a, b] version pairs";
+        return response;
+    }
+    LogosList results = LogosList::array();
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const auto& pair = pairs[i];
+        if (!pair.is_array() || pair.size() != 2 || !pair[0].is_string() || !pair[1].is_string()) {
+            response["success"] = false;
+            response["error"] = "Entry " + std::to_string(i) + " is not a pair of version strings";
+            return response;
+        }
+        results.push_back(semver::compare(pair[0].get<std::string>(), pair[1].get<std::string>()));
+    }
+    response["success"] = true;
+    response["results"] = results;
+    return response;
+}
+
+// Unique scratch directory name under `parent` — pid + monotonic clock keeps
+// concurrent hosts and back-to-back calls apart without a global counter.
+static std::filesystem::path uniqueChildPath(const std::filesystem::path& parent,
+                                             const std::string& prefix)
+{
+    return parent / (prefix + "-" + std::to_string(::getpid()) + "-"
+                     + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+}
+
+LogosMap PackageManagerImpl::installFromDirectory(const std::string& dirPath, const std::string& mode)
+{
+    auto slotTimer = timeSlot("installFromDirectory");
+    namespace fs = std::filesystem;
+    LogosMap response;
+    response["mode"] = mode;
+
+    auto fail = [&response](const std::string& msg) {
+        response["path"] = std::string();
+        response["error"] = msg;
+        return response;
+    };
+
+    if (mode != "symlink" && mode != "reflink" && mode != "copy" && mode != "copy_file_range")
+        return fail("Invalid mode '" + mode
+                    + "' - expected one of: symlink, reflink, copy, copy_file_range");
+
+    // Resolved, so a link to a previous install (or to the build tree) is
+    // read through to the directory it names.
+    std::error_code ec;
+    const fs::path srcDir = fs::weakly_canonical(fs::absolute(dirPath, ec), ec);
+    if (ec || !fs::is_directory(srcDir))
+        return fail("Not a directory: " + dirPath);
+
+    LogosMap manifest;
+    try {
+        std::ifstream in(srcDir / "manifest.json");
+        if (!in) return fail("No manifest.json in " + srcDir.string());
+        std::stringstream buf;
+        buf << in.rdbuf();
+        trace::Span span(m_trace, "manifest parse", "json");
+        manifest = LogosMap::parse(buf.str());
+    } catch (const std::exception& e) {
+        return fail(std::string("Failed to parse manifest.json: ") + e.what());
+    }
+
+    const std::string name = manifest.value("name", "");
+    const bool isCore = manifest.value("type", "") == "core";
+    response["name"] = name;
+    response["isCoreModule"] = isCore;
+    if (!isPlainPackageName(name))
+        return fail("manifest.json has no usable 'name'");
+
+    const std::string& userDir = isCore ? m_userModulesDir : m_userUiPluginsDir;
+    if (userDir.empty())
+        return fail(std::string("User ") + (isCore ? "modules" : "UI plugins")
+                    + " directory is not configured");
+    if (isEmbedded(name))
+        return fail("Cannot replace embedded module '" + name + "'");
+
+    fs::create_directories(userDir, ec);
+    const fs::path installDir = fs::path(userDir) / name;
+    // The install's own path, not where a symlinked install points: that
+    // link is replaced, never followed.
+    const fs::path installPath = fs::weakly_canonical(userDir, ec) / name;
+    if (isWithin(srcDir, installPath) || isWithin(installPath, srcDir))
+        return fail("Source '" + srcDir.string() + "' overlaps the install directory '"
+                    + installDir.string() + "'");
+
+    // Built beside the old install and exchanged in, as commitUpgrade does,
+    // so a failed copy leaves the previous install untouched.
+    const fs::path stagingParent = fs::path(userDir) / ".pm-staging";
+    fs::create_directories(stagingParent, ec);
+    const fs::path stagedDir = uniqueChildPath(stagingParent, name);
+    auto cleanupStaging = [&]() {
+        std::error_code ignored;
+        fs::remove_all(stagedDir, ignored);
+        fs::remove(stagingParent, ignored);  // only succeeds once empty
+    };
+    if (mode == "symlink") {
+        fs::create_directory_symlink(srcDir, stagedDir, ec);
+        if (ec) {
+            cleanupStaging();
+            return fail("Failed to link '" + installDir.string() + "': " + ec.message());
+        }
+    } else {
+        fileops::CopyStats stats;
+        std::string err;
+        const auto copyMode = mode == "reflink" ? fileops::CopyMode::Reflink
+                                                : fileops::CopyMode::Copy;
+        if (!fileops::copyTree(srcDir, stagedDir, copyMode, &pool(), stats, err)) {
+            cleanupStaging();
+            return fail(err);
+        }
+        response["files"] = static_cast<int64_t>(stats.files);
+        response["bytes"] = static_cast<int64_t>(stats.bytes);
+        if (copyMode == fileops::CopyMode::Reflink)
+            response["reflinkFallbacks"] = static_cast<int64_t>(stats.reflinkFallbacks);
+    }
+
+    // A symlinked previous install loses only the link.
+    std::string err;
+    if (fs::symlink_status(installDir, ec).type() == fs::file_type::not_found) {
+        fs::rename(stagedDir, installDir, ec);
+        if (ec) err = ec.message();
+    } else {
+        bool atomic = false;
+        if (!fileops::exchangePaths(stagedDir, installDir, atomic, err)) {
+            cleanupStaging();
+            return fail("Failed to replace previous install: " + err);
+        }
+    }
+    cleanupStaging();
+    if (!err.empty()) return fail("Failed to place '" + installDir.string() + "': " + err);
+
+    std::string mainFile = resolveMainFile(manifest, installDir);
+    const std::string eventPath = mainFile.empty() ? installDir.string() : mainFile;
+    response["path"] = eventPath;
+    response["installDir"] = installDir.string();
+
+    emitInstalled(isCore, eventPath);
+    return response;
+}
+
+PackageManagerImpl::ExtractionConfig
+PackageManagerImpl::extractionConfig(const std::filesystem::path& parentDir) const
+{
+    ExtractionConfig config;
+    config.signaturePolicy = m_signaturePolicy;
+    config.keyringDir = m_lib->keyringDirectory();
+    config.parentDir = parentDir;
+    return config;
+}
+
+bool PackageManagerImpl::extractToScratch(const std::string& lgxPath, const ExtractionConfig& config,
+                                          ScratchExtraction& out, std::string& error)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path parent = config.parentDir.empty() ? fs::temp_directory_path(ec) : config.parentDir;
+    out.root = uniqueChildPath(parent, "logos-pm-extract").string();
+    const fs::path root(out.root);
+    fs::create_directories(root / "modules", ec);
+    fs::create_directories(root / "ui", ec);
+    if (ec) {
+        error = "Failed to create scratch directory: " + ec.message();
+        return false;
+    }
+
+    // A private library instance whose only writable directories are the
+    // scratch tree: the archive is verified and unpacked exactly as
+    // installPlugin would, but nothing the host can see changes. Policy and
+    // keyring are mirrored so verification matches the real install.
+    PackageManagerLib scratchLib;
+    scratchLib.setUserModulesDirectory((root / "modules").string());
+    scratchLib.setUserUiPluginsDirectory((root / "ui").string());
+    if (!config.signaturePolicy.empty()) applySignaturePolicy(scratchLib, config.signaturePolicy);
+    if (!config.keyringDir.empty()) scratchLib.setKeyringDirectory(config.keyringDir);
+
+    std::string mainPath;
+    bool isCore = false;
+    std::string result = scratchLib.installPluginFile(lgxPath, error, false, &mainPath, &isCore);
+    if (result.empty()) {
+        if (error.empty()) error = "Extraction failed";
+        return false;
+    }
+
+    // The library installs into <userDir>/<name>; there is exactly one.
+    const fs::path userDir = root / (isCore ? "modules" : "ui");
+    for (const auto& entry : fs::directory_iterator(userDir, ec)) {
+        if (entry.is_directory()) {
+            out.packageDir = entry.path().string();
+            break;
+        }
+    }
+    if (out.packageDir.empty()) {
+        error = "Extraction produced no package directory";
+        return false;
+    }
+    out.isCore = isCore;
+    out.mainFile = mainPath;
+    return true;
+}
+
+bool PackageManagerImpl::resolveUpgrade(const std::string& lgxPath, UpgradePlan& plan,
+                                        std::string& error) const
+{
+    lgx_package_t pkg = [&] {
+        trace::Span span(m_trace, "lgx_load", "lgx");
+        return lgx_load(lgxPath.c_str());
+    }();
+    if (!pkg) {
+        error = std::string("Failed to load LGX package: ")
+              + (lgx_get_last_error() ? lgx_get_last_error() : "unknown");
+        return false;
+    }
+    const char* rawName     = lgx_get_name(pkg);
+    const char* rawVersion  = lgx_get_version(pkg);
+    const char* rawManifest = lgx_get_manifest_json(pkg);
+    plan.name      = rawName    ? rawName    : "";
+    plan.toVersion = rawVersion ? rawVersion : "";
+    std::string newRoot;
+    if (rawManifest) {
+        try {
+            trace::Span span(m_trace, "manifest parse", "json");
+            auto doc = LogosMap::parse(rawManifest);
+            if (doc.contains("hashes") && doc["hashes"].is_object())
+                newRoot = doc["hashes"].value("root", "");
+        } catch (...) {
+        }
+    }
+    lgx_free_package(pkg);
+
+    InstalledPackage installed;
+    bool found = false;
+    for (const auto& entry : scanInstalledPackages()) {
+        if (entry.name == plan.name) {
+            installed = entry;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        error = "Package '" + plan.name + "' is not installed - use installPlugin";
+        return false;
+    }
+    if (installed.installType == InstallType::Embedded) {
+        error = "Cannot upgrade embedded module '" + plan.name + "'";
+        return false;
+    }
+    plan.fromVersion = installed.version;
+    plan.liveDir = installed.installDir;
+    plan.stagingParent = (std::filesystem::path(installed.installDir).parent_path() / ".pm-staging").string();
+
+    // Equal Merkle roots mean equal content — nothing to extract or write.
+    if (!newRoot.empty() && newRoot == installed.hashes.root) {
+        plan.upToDate = true;
+        plan.mainFile = installed.mainFilePath;
+    }
+    plan.versionChange = versionChange(semver::key(plan.fromVersion), plan.fromVersion,
+                                       installed.hashes.root, semver::key(plan.toVersion),
+                                       plan.toVersion, newRoot);
+    return true;
+}
+
+bool PackageManagerImpl::stageUpgrade(const std::string& lgxPath, const ExtractionConfig& config,
+                                      UpgradePlan& plan, std::string& error)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    // Extract beside the install so stageFromDiff can move leaves instead
+    // of copying them across devices.
+    ScratchExtraction scratch;
+    auto cleanupScratch = [&scratch]() {
+        std::error_code ec;
+        if (!scratch.root.empty()) fs::remove_all(scratch.root, ec);
+    };
+    bool extracted;
+    {
+        auto phase = timePhase(m_instr->phaseExtract, "extract");
+        extracted = extractToScratch(lgxPath, config, scratch, error);
+    }
+    if (!extracted) {
+        cleanupScratch();
+        return false;
+    }
+
+    const fs::path liveDir(plan.liveDir);
+    const fs::path stagedDir = uniqueChildPath(plan.stagingParent, plan.name);
+
+    // The install-time baseline already holds the live files' digests: a
+    // same-size leaf whose live size and mtime still match its record is
+    // settled by hashing the extracted copy alone, so an unchanged install
+    // is not read back in full.
+    integrity::Baseline baseline;
+    {
+        std::lock_guard<std::mutex> lk(m_baselineMutex);
+        auto it = m_baselines.find(plan.name);
+        if (it != m_baselines.end()) baseline = it->second;
+    }
+    if (!baseline.installTime) integrity::loadBaseline(baselineFile(liveDir, plan.name), baseline);
+    fileops::KnownLeaf known;
+    if (baseline.installTime) {
+        known = [&](const fs::path& rel, bool& equal) {
+            const std::string key = rel.generic_string();
+            auto it = std::lower_bound(baseline.files.begin(), baseline.files.end(), key,
+                                       [](const integrity::FileRecord& f, const std::string& k) { return f.path < k; });
+            if (it == baseline.files.end() || it->path != key) return false;
+            uint64_t size = 0;
+            int64_t mtimeNs = 0;
+            std::string ignored;
+            if (!integrity::fingerprint(liveDir / rel, size, mtimeNs, ignored) || size != it->size
+                || mtimeNs != it->mtimeNs)
+                return false;
+            integrity::Digest digest;
+            if (!integrity::sha256File(fs::path(scratch.packageDir) / rel, digest, ignored)) return false;
+            equal = digest == it->digest;
+            return true;
+        };
+    }
+    bool staged;
+    {
+        auto phase = timePhase(m_instr->phaseDiff, "diff");
+        staged = fileops::diffTrees(liveDir, scratch.packageDir, &pool(), plan.diff, error, known);
+    }
+    if (staged) {
+        auto phase = timePhase(m_instr->phaseStage, "stage");
+        staged = fileops::stageFromDiff(liveDir, scratch.packageDir, plan.diff, stagedDir, &pool(),
+                                        plan.stats, error);
+    }
+    if (!staged) {
+        fs::remove_all(stagedDir, ec);
+        cleanupScratch();
+        return false;
+    }
+    cleanupScratch();
+
+    plan.stagedDir = stagedDir.string();
+    plan.isCore = scratch.isCore;
+    plan.mainFile = scratch.mainFile.empty()
+        ? liveDir.string()
+        : (liveDir / fs::path(scratch.mainFile).lexically_relative(scratch.packageDir)).string();
+    return true;
+}
+
+LogosMap PackageManagerImpl::commitUpgrade(const UpgradePlan& plan)
+{
+    namespace fs = std::filesystem;
+    LogosMap response;
+    response["success"] = false;
+    response["name"] = plan.name;
+    response["fromVersion"] = plan.fromVersion;
+    response["toVersion"] = plan.toVersion;
+    response["versionChange"] = plan.versionChange;
+
+    const fs::path liveDir(plan.liveDir);
+    std::error_code ec;
+
+    // Switch versions with a single atomic exchange: <name> is never absent,
+    // and afterwards the staged path holds the previous version, which is
+    // retained for rollbackPackage.
+    bool atomic = false;
+    std::string error;
+    bool swapped;
+    {
+        auto phase = timePhase(m_instr->phaseSwap, "swap");
+        swapped = fileops::exchangePaths(plan.stagedDir, liveDir, atomic, error);
+    }
+    if (!swapped) {
+        fs::remove_all(plan.stagedDir, ec);
+        m_instr->upgradeFailure.inc();
+        response["error"] = "Failed to swap in staged upgrade: " + error;
+        return response;
+    }
+    retainPreviousVersion(liveDir.parent_path(), plan.name, plan.stagedDir);
+    fs::remove(plan.stagingParent, ec);  // only succeeds once empty
+    m_instr->upgradeSwapped.inc();
+    m_instr->upgradeBytesWritten.inc(plan.diff.bytesToWrite);
+
+    auto toList = [](const std::vector<fs::path>& v) {
+        LogosList l = LogosList::array();
+        for (const auto& p : v) l.push_back(p.generic_string());
+        return l;
+    };
+    response["success"] = true;
+    response["isCoreModule"] = plan.isCore;
+    response["atomicSwap"] = atomic;
+    response["added"] = toList(plan.diff.added);
+    response["changed"] = toList(plan.diff.changed);
+    response["removed"] = toList(plan.diff.removed);
+    response["unchanged"] = static_cast<int64_t>(plan.diff.unchanged.size());
+    response["settledByBaseline"] = static_cast<int64_t>(plan.diff.settledByKnown);
+    response["bytesWritten"] = static_cast<int64_t>(plan.diff.bytesToWrite);
+    response["path"] = plan.mainFile;
+    emitInstalled(plan.isCore, plan.mainFile);
+    return response;
+}
+
+LogosMap PackageManagerImpl::upgradeFromFile(const std::string& lgxPath)
+{
+    auto slotTimer = timeSlot("upgradeFromFile");
+    LogosMap response;
+    response["success"] = false;
+
+    UpgradePlan plan;
+    std::string error;
+    const bool resolved = resolveUpgrade(lgxPath, plan, error);
+    if (!plan.name.empty()) {
+        response["name"] = plan.name;
+        response["toVersion"] = plan.toVersion;
+    }
+    if (!plan.fromVersion.empty()) response["fromVersion"] = plan.fromVersion;
+    if (!resolved) {
+        m_instr->upgradeFailure.inc();
+        response["error"] = error;
+        return response;
+    }
+    if (plan.upToDate) {
+        m_instr->upgradeUpToDate.inc();
+        response["versionChange"] = plan.versionChange;
+        response["success"] = true;
+        response["upToDate"] = true;
+        response["path"] = plan.mainFile;
+        return response;
+    }
+
+    if (!stageUpgrade(lgxPath, extractionConfig(plan.stagingParent), plan, error)) {
+        m_instr->upgradeFailure.inc();
+        std::error_code ec;
+        std::filesystem::remove(plan.stagingParent, ec);
+        response["error"] = error;
+        return response;
+    }
+    return commitUpgrade(plan);
+}
+
+// Retained previous versions live beside the installs they belong to, in a
+// dot-directory the library's scanner never descends into (it only reads
+// <userDir>/<entry>/manifest.json). An unusable name maps to an empty path,
+// which every filesystem call here treats as absent.
+static std::filesystem::path previousVersionDir(const std::filesystem::path& userDir,
+                                                const std::string& name)
+{
+    if (!isPlainPackageName(name)) return {};
+    return userDir / ".pm-previous" / name;
+}
+
+void PackageManagerImpl::retainPreviousVersion(const std::filesystem::path& userDir,
+                                               const std::string& name,
+                                               const std::filesystem::path& previous)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path keep = previousVersionDir(userDir, name);
+    if (keep.empty()) {
+        fs::remove_all(previous, ec);
+        return;
+    }
+    // Only one previous version is kept; an older one is collected here.
+    fs::remove_all(keep, ec);
+    fs::create_directories(keep.parent_path(), ec);
+    fs::rename(previous, keep, ec);
+    if (ec) {
+        std::cerr << "PackageManagerImpl: could not retain previous version of '"
+                  << name << "' for rollback: " << ec.message() << "\n";
+        fs::remove_all(previous, ec);
+    }
+}
+
+void PackageManagerImpl::dropPreviousVersion(const std::string& name)
+{
+    std::error_code ec;
+    if (!isPlainPackageName(name)) return;
+    for (const auto* dir : {&m_userModulesDir, &m_userUiPluginsDir}) {
+        if (!dir->empty()) std::filesystem::remove_all(previousVersionDir(*dir, name), ec);
+    }
+}
+
+LogosMap PackageManagerImpl::rollbackPackage(const std::string& packageName)
+{
+    auto slotTimer = timeSlot("rollbackPackage");
+    namespace fs = std::filesystem;
+    LogosMap response;
+    response["success"] = false;
+    response["name"] = packageName;
+    if (!isPlainPackageName(packageName)) {
+        response["error"] = "Invalid package name '" + packageName + "'";
+        return response;
+    }
+
+    fs::path userDir;
+    bool isCore = false;
+    std::error_code ec;
+    if (!m_userModulesDir.empty()
+        && fs::exists(fs::symlink_status(previousVersionDir(m_userModulesDir, packageName), ec))) {
+        userDir = m_userModulesDir;
+        isCore = true;
+    } else if (!m_userUiPluginsDir.empty()
+               && fs::exists(fs::symlink_status(previousVersionDir(m_userUiPluginsDir, packageName), ec))) {
+        userDir = m_userUiPluginsDir;
+    }
+    if (userDir.empty()) {
+        response["error"] = "No previous version of '" + packageName + "' is retained";
+        return response;
+    }
+
+    const fs::path previous = previousVersionDir(userDir, packageName);
+    const fs::path liveDir = userDir / packageName;
+
+    auto manifestOf = [this](const fs::path& dir) {
+        trace::Span span(m_trace, "manifest parse", "json");
+        LogosMap doc = LogosMap::object();
+        try {
+            std::ifstream in(dir / "manifest.json");
+            std::stringstream buf;
+            buf << in.rdbuf();
+            doc = LogosMap::parse(buf.str());
+        } catch (...) {
+        }
+        return doc;
+    };
+    const LogosMap restored = manifestOf(previous);
+    response["toVersion"] = restored.value("version", "");
+
+    bool atomic = true;
+    std::string error;
+    if (fs::exists(fs::symlink_status(liveDir, ec))) {
+        response["fromVersion"] = manifestOf(liveDir).value("version", "");
+        // Exchange rather than replace: the version being rolled back from
+        // becomes the retained one, so a mistaken rollback can be undone.
+        if (!fileops::exchangePaths(previous, liveDir, atomic, error)) {
+            response["error"] = error;
+            return response;
+        }
+    } else {
+        fs::rename(previous, liveDir, ec);
+        if (ec) {
+            response["error"] = "Failed to restore previous version: " + ec.message();
+            return response;
+        }
+    }
+
+    std::string mainFile = resolveMainFile(restored, liveDir);
+    if (mainFile.empty()) mainFile = liveDir.string();
+    response["success"] = true;
+    response["atomicSwap"] = atomic;
+    response["path"] = mainFile;
+    emitInstalled(isCore, mainFile);
+    return response;
+}
+
+LogosMap PackageManagerImpl::purgeRollbackVersions()
+{
+    auto slotTimer = timeSlot("purgeRollbackVersions");
+    namespace fs = std::filesystem;
+    LogosList removed = LogosList::array();
+    std::error_code ec;
+    for (const auto* dir : {&m_userModulesDir, &m_userUiPluginsDir}) {
+        if (dir->empty()) continue;
+        const fs::path root = fs::path(*dir) / ".pm-previous";
+        for (const auto& entry : fs::directory_iterator(root, ec)) {
+            std::error_code rmEc;
+            fs::remove_all(entry.path(), rmEc);
+            if (!rmEc) removed.push_back(entry.path().filename().string());
+        }
+        fs::remove(root, ec);
+    }
+    LogosMap response;
+    response["success"] = true;
+    response["removed"] = removed;
+    return response;
+}
+
+namespace {
+
+LogosMap unknownEncoding(const std::string& encoding)
+{
+    LogosMap response;
+    response["success"] = false;
+    response["error"] = "Unknown encoding '" + encoding + "' (expected msgpack or cbor)";
+    return response;
+}
+
+LogosMap packedResponse(packed::Format format, std::vector<uint8_t> bytes)
+{
+    LogosMap response;
+    response["success"] = true;
+    response["encoding"] = packed::formatName(format);
+    response["bytes"] = static_cast<int64_t>(bytes.size());
+    response["data"] = packed::toBase64(bytes);
+    return response;
+}
+
+// LogosList slots carry a packed response as their one element.
+LogosList asList(LogosMap response)
+{
+    LogosList list = LogosList::array();
+    list.push_back(std::move(response));
+    return list;
+}
+
+} // namespace
+
+LogosList PackageManagerImpl::getInstalledPackages(const std::string& encoding)
+{
+    auto slotTimer = timeSlot("getInstalledPackages");
+    packed::Format format;
+    if (!encoding.empty() && !packed::parseFormat(encoding, format)) return asList(unknownEncoding(encoding));
+    const std::vector<InstalledPackage> packages = scanInstalledPackages();
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(packages));
+    if (!encoding.empty()) {
+        trace::Span span(m_trace, "packed::encode", "convert");
+        return asList(packedResponse(format, packed::encode(packages, format)));
+    }
+    trace::Span span(m_trace, "toLogosList", "convert");
+    return toLogosList(packages);
+}
+
+LogosList PackageManagerImpl::getInstalledModules()
+{
+    auto slotTimer = timeSlot("getInstalledModules");
+    std::vector<InstalledPackage> modules;
+    {
+        metrics::ScopedTimer scanTimer(m_instr->scanModules);
+        trace::Span span(m_trace, "scan getInstalledModules", "scan");
+        modules = m_embeddedIndexActive ? scanWithEmbeddedIndex(true, false, &PackageManagerLib::getInstalledModules)
+                : scansInParallel()     ? scanInParallel(true, false, true)
+                                        : m_lib->getInstalledModules();
+    }
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(modules));
+    trace::Span span(m_trace, "toLogosList", "convert");
+    return toLogosList(modules);
+}
+
+LogosList PackageManagerImpl::getInstalledUiPlugins()
+{
+    auto slotTimer = timeSlot("getInstalledUiPlugins");
+    std::vector<InstalledPackage> plugins;
+    {
+        metrics::ScopedTimer scanTimer(m_instr->scanUiPlugins);
+        trace::Span span(m_trace, "scan getInstalledUiPlugins", "scan");
+        plugins = m_embeddedIndexActive ? scanWithEmbeddedIndex(false, true, &PackageManagerLib::getInstalledUiPlugins)
+                : scansInParallel()     ? scanInParallel(false, true, true)
+                                        : m_lib->getInstalledUiPlugins();
+    }
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(plugins));
+    trace::Span span(m_trace, "toLogosList", "convert");
+    return toLogosList(plugins);
+}
+
+namespace {
+
+// The integrity scrubber's work list.
+std::vector<IntegrityScrubber::Target> scrubTargets(const PackageIndex& index)
+{
+    std::vector<IntegrityScrubber::Target> targets(index.size());
+    for (uint32_t row = 0; row < index.size(); ++row) {
+        targets[row].name = std::string(index.name(row));
+        targets[row].installDir = std::string(index.installDir(row));
+        targets[row].manifestRoot = std::string(index.hashRoot(row));
+    }
+    return targets;
+}
+
+} // namespace
+
+std::vector<int64_t> PackageManagerImpl::moduleDirStamp() const
+{
+    std::vector<int64_t> stamp;
+    auto add = [&stamp](const std::string& dir) {
+        if (dir.empty()) return;
+        std::error_code ec;
+        const auto t = std::filesystem::last_write_time(dir, ec);
+        stamp.push_back(ec ? -1 : static_cast<int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count()));
+    };
+    add(m_userModulesDir);
+    add(m_userUiPluginsDir);
+    for (const auto& dir : m_embeddedModulesDirs) add(dir);
+    for (const auto& dir : m_embeddedUiPluginsDirs) add(dir);
+    return stamp;
+}
+
+const PackageIndex& PackageManagerImpl::installedIndex()
+{
+    // A package directory added or removed changes its parent's mtime; a
+    // few stats are far cheaper than serving a stale set.
+    if (m_index && moduleDirStamp() != m_indexStamp) invalidateInstalledIndex();
+    if (m_index) {
+        m_instr->indexHits.inc();
+        return *m_index;
+    }
+    m_instr->indexMisses.inc();
+    auto phase = timePhase(m_instr->indexBuild, "build installed index");
+    // Taken before the scan, so a change made during it is picked up next time.
+    m_indexStamp = moduleDirStamp();
+    const std::vector<InstalledPackage> packages = scanInstalledPackages();
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(packages));
+    m_index = std::make_unique<PackageIndex>(packages);
+
+    // Only packages whose searchable text changed are re-tokenised.
+    trace::Span span(m_trace, "sync search index", "index");
+    m_search->beginSync();
+    uint64_t upserted = 0;
+    for (size_t row = 0; row < m_index->size(); ++row) {
+        upserted += m_search->upsert(m_index->name(row), m_index->displayName(row),
+                                     m_index->description(row));
+    }
+    m_instr->searchUpserted.inc(upserted);
+    m_instr->searchRemoved.inc(m_search->endSync());
+
+    // Likewise only packages whose dependency lists changed rewrite their
+    // reverse edges. A name installed twice counts once, as findRow sees it.
+    trace::Span reverseSpan(m_trace, "sync reverse dependencies", "index");
+    m_reverse->beginSync();
+    uint64_t relinked = 0;
+    std::vector<std::string_view> deps;
+    for (size_t row = 0; row < m_index->size(); ++row) {
+        if (m_index->findRow(m_index->name(row)) != row) continue;
+        deps.clear();
+        for (size_t k = 0; k < m_index->dependencyCount(row); ++k)
+            deps.push_back(m_index->str(m_index->dependencyId(row, k)));
+        relinked += m_reverse->upsert(m_index->name(row), deps);
+    }
+    m_instr->reverseUpserted.inc(relinked);
+    m_instr->reverseRemoved.inc(m_reverse->endSync());
+    accountIndexMemory();
+    if (m_scrubber.running()) m_scrubber.setTargets(scrubTargets(*m_index));
+    if (m_shm.isOpen()) publishSharedIndex(*m_index);
+    return *m_index;
+}
+
+namespace {
+
+DependentTreeNode dependentNode(const PackageIndex& index, uint32_t row)
+{
+    DependentTreeNode n;
+    n.name = std::string(index.name(row));
+    n.version = std::string(index.version(row));
+    n.type = std::string(index.type(row));
+    n.installType = static_cast<InstallType>(index.installType(row));
+    n.installDir = std::string(index.installDir(row));
+    return n;
+}
+
+void buildDependents(const PackageIndex& index, const ReverseDependencyIndex& reverse, DependentTreeNode& node,
+                     uint32_t row, int depth, std::vector<uint32_t>& path)
+{
+    if (depth <= 0) return;
+    path.push_back(row);
+    for (const std::string& name : reverse.dependents(index.name(row))) {
+        const uint32_t child = index.findRow(name);
+        if (child == PackageIndex::kNoId || std::find(path.begin(), path.end(), child) != path.end()) continue;
+        node.children.push_back(dependentNode(index, child));
+        buildDependents(index, reverse, node.children.back(), child, depth - 1, path);
+    }
+    path.pop_back();
+}
+
+} // namespace
+
+std::optional<DependentTreeNode> PackageManagerImpl::dependentTree(const std::string& packageName, int maxDepth)
+{
+    trace::Span span(m_trace, "resolveDependents", "deps");
+    const PackageIndex& index = installedIndex();
+    const uint32_t root = index.findRow(packageName);
+    if (root == PackageIndex::kNoId) return std::nullopt;
+    DependentTreeNode tree = dependentNode(index, root);
+    std::vector<uint32_t> path;
+    buildDependents(index, *m_reverse, tree, root, maxDepth, path);
+    return tree;
+}
+
+std::vector<DependentTreeNode> PackageManagerImpl::flatDependents(const std::string& packageName, bool recursive)
+{
+    trace::Span span(m_trace, "resolveDependents", "deps");
+    std::vector<DependentTreeNode> out;
+    const PackageIndex& index = installedIndex();
+    const uint32_t root = index.findRow(packageName);
+    if (root == PackageIndex::kNoId) return out;
+    std::vector<bool> seen(index.size(), false);
+    seen[root] = true;
+    std::vector<uint32_t> queue{root};
+    for (size_t head = 0; head < queue.size(); ++head) {
+        for (const std::string& name : m_reverse->dependents(index.name(queue[head]))) {
+            const uint32_t row = index.findRow(name);
+            if (row == PackageIndex::kNoId || seen[row]) continue;
+            seen[row] = true;
+            out.push_back(dependentNode(index, row));
+            if (recursive) queue.push_back(row);
+        }
+    }
+    return out;
+}
+
+void PackageManagerImpl::invalidateInstalledIndex()
+{
+    // Also reached after the embedded index is replaced, with no installed
+    // index built yet.
+    if (!m_index) {
+        accountIndexMemory();
+        return;
+    }
+    m_index.reset();
+    accountIndexMemory();
+    m_instr->indexInvalidations.inc();
+}
+
+void PackageManagerImpl::flushSharedIndex()
+{
+    // Shared-index readers never call in, so they would otherwise see the
+    // old set until some query happened to rebuild.
+    if (m_shm.isOpen() && !m_index) installedIndex();
+}
+
+void PackageManagerImpl::publishSharedIndex(const PackageIndex& index)
+{
+    trace::Span span(m_trace, "publish shared index", "io");
+    std::string error;
+    if (!m_shm.publish(index, error)) {
+        std::cerr << "PackageManagerImpl: could not publish the shared index: " << error << "\n";
+        return;
+    }
+    m_instr->sharedIndexPublished.inc();
+    m_instr->sharedIndexBytes.set(static_cast<double>(m_shm.bytes()));
+}
+
+namespace {
+
+// Filter arguments of findInstalledPackages / countInstalledPackages; false
+// when a value can never match (unknown installType or type, or a category
+// no installed package has).
+bool parseIndexFilter(const PackageIndex& index, const std::string& installType,
+                      const std::string& type, const std::string& category,
+                      PackageIndex::Filter& filter)
+{
+    if (installType == "embedded") filter.installType = static_cast<int>(InstallType::Embedded);
+    else if (installType == "user") filter.installType = static_cast<int>(InstallType::User);
+    else if (!installType.empty()) return false;
+
+    if (type == "core") filter.kind = PackageIndex::KindCore;
+    else if (type == "ui") filter.kind = PackageIndex::KindUi;
+    else if (!type.empty()) return false;
+
+    if (!category.empty()) {
+        filter.category = index.find(category);
+        if (filter.category == PackageIndex::kNoId) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+LogosList PackageManagerImpl::findInstalledPackages(const std::string& installType,
+                                                    const std::string& type,
+                                                    const std::string& category)
+{
+    auto slotTimer = timeSlot("findInstalledPackages");
+    const PackageIndex& index = installedIndex();
+    PackageIndex::Filter filter;
+    LogosList result = LogosList::array();
+    if (!parseIndexFilter(index, installType, type, category, filter)) return result;
+    trace::Span span(m_trace, "toLogosList", "convert");
+    for (uint32_t row : index.rows(filter))
+        result.push_back(conversions::toLogosMap(index.package(row)));
+    return result;
+}
+
+LogosList PackageManagerImpl::searchInstalledPackages(const std::string& query, int64_t limit)
+{
+    auto slotTimer = timeSlot("searchInstalledPackages");
+    const PackageIndex& index = installedIndex();
+    std::vector<TrigramIndex::Match> matches;
+    {
+        trace::Span span(m_trace, "trigram search", "index");
+        matches = m_search->search(query, limit > 0 ? static_cast<size_t>(limit) : 0);
+    }
+    trace::Span span(m_trace, "toLogosList", "convert");
+    LogosList result = LogosList::array();
+    for (const auto& m : matches) {
+        const uint32_t row = index.findRow(m.key);
+        if (row == PackageIndex::kNoId) continue;
+        LogosMap entry = conversions::toLogosMap(index.package(row));
+        entry["score"] = m.score;
+        result.push_back(entry);
+    }
+    return result;
+}
+
+LogosMap PackageManagerImpl::countInstalledPackages(const std::string& installType,
+                                                    const std::string& type,
+                                                    const std::string& category)
+{
+    auto slotTimer = timeSlot("countInstalledPackages");
+    const PackageIndex& index = installedIndex();
+    PackageIndex::Filter filter;
+    LogosMap response;
+    response["success"] = true;
+    response["count"] = parseIndexFilter(index, installType, type, category, filter)
+        ? index.count(filter) : 0;
+    return response;
+}
+
+namespace {
+
+// queryInstalledPackages filter keys, in PackageIndex::Facet order.
+constexpr const char* kFacetKeys[PackageIndex::FacetCount] = {
+    "installType", "type", "category", "author", "license"
+};
+
+const char* installTypeName(uint32_t value)
+{
+    return value == static_cast<uint32_t>(InstallType::Embedded) ? "embedded" : "user";
+}
+
+} // namespace
+
+LogosMap PackageManagerImpl::queryInstalledPackages(const LogosMap& filter, bool includePackages)
+{
+    auto slotTimer = timeSlot("queryInstalledPackages");
+    LogosMap response;
+    auto fail = [&response](const std::string& msg) {
+        response["success"] = false;
+        response["error"] = msg;
+        return response;
+    };
+    if (!filter.is_null() && !filter.is_object()) return fail("filter must be an object");
+
+    const PackageIndex& index = installedIndex();
+    PackageIndex::Query query;
+    if (filter.is_object()) {
+        for (auto it = filter.begin(); it != filter.end(); ++it) {
+            const auto key = std::find_if(std::begin(kFacetKeys), std::end(kFacetKeys),
+                                          [&](const char* k) { return it.key() == k; });
+            if (key == std::end(kFacetKeys)) return fail("Unknown filter key '" + it.key() + "'");
+            if (!it.value().is_string()) return fail("Filter value for '" + it.key() + "' must be a string");
+            const std::string value = it.value().get<std::string>();
+            if (value.empty()) continue;
+            const auto facet = static_cast<PackageIndex::Facet>(key - std::begin(kFacetKeys));
+            if (facet == PackageIndex::FacetInstallType) {
+                if (value == "embedded") query.value[facet] = static_cast<uint32_t>(InstallType::Embedded);
+                else if (value == "user") query.value[facet] = static_cast<uint32_t>(InstallType::User);
+                else return fail("Invalid installType '" + value + "' - expected embedded or user");
+            } else {
+                // kNoId when no installed package has the value: matches nothing.
+                query.value[facet] = index.find(value);
+            }
+        }
+    }
+
+    std::vector<uint32_t> rows;
+    LogosMap facets = LogosMap::object();
+    {
+        trace::Span span(m_trace, "facet query", "index");
+        rows = index.query(query);
+        for (int f = 0; f < PackageIndex::FacetCount; ++f) {
+            const auto facet = static_cast<PackageIndex::Facet>(f);
+            LogosMap counts = LogosMap::object();
+            for (const auto& [value, count] : index.facetCounts(query, facet)) {
+                const std::string name = facet == PackageIndex::FacetInstallType
+                    ? installTypeName(value) : std::string(index.str(value));
+                counts[name] = count;
+            }
+            facets[kFacetKeys[f]] = counts;
+        }
+    }
+
+    response["success"] = true;
+    response["count"] = rows.size();
+    response["facets"] = facets;
+    if (includePackages) {
+        trace::Span span(m_trace, "toLogosList", "convert");
+        LogosList packages = LogosList::array();
+        for (uint32_t row : rows) packages.push_back(conversions::toLogosMap(index.package(row)));
+        response["packages"] = packages;
+    }
+    return response;
+}
+
+namespace {
+
+// One release in a catalog snapshot, version parsed once on load.
+struct CatalogEntry {
+    std::string version;
+    semver::Key key;
+    std::string rootHash;
+    std::string releaseTag;
+};
+
+// Reads a catalog snapshot: either { name: { version, rootHash,
+// releaseTag } } or a list of { name, version, rootHash, releaseTag }.
+// rootHash may also be given as hashes.root, as in manifests.
+bool loadCatalog(const std::string& path, std::unordered_map<std::string, CatalogEntry>& out,
+                 std::string& error)
+{
+    LogosMap doc;
+    try {
+        std::ifstream in(path);
+        if (!in) {
+            error = "Cannot read catalog " + path;
+            return false;
+        }
+        std::stringstream buf;
+        buf << in.rdbuf();
+        doc = LogosMap::parse(buf.str());
+    } catch (const std::exception& e) {
+        error = std::string("Failed to parse catalog: ") + e.what();
+        return false;
+    }
+
+    // Absent fields read as empty; present ones must be strings.
+    auto field = [&error](const LogosMap& e, const char* key, std::string& value) {
+        if (!e.contains(key) || e[key].is_null()) return true;
+        if (!e[key].is_string()) {
+            error = std::string("Catalog field '") + key + "' must be a string";
+            return false;
+        }
+        value = e[key].get<std::string>();
+        return true;
+    };
+    auto add = [&out, &field](const std::string& name, const LogosMap& e) {
+        if (name.empty() || !e.is_object()) return true;
+        CatalogEntry entry;
+        if (!field(e, "version", entry.version) || !field(e, "rootHash", entry.rootHash)
+            || !field(e, "releaseTag", entry.releaseTag))
+            return false;
+        entry.key = semver::key(entry.version);
+        if (entry.rootHash.empty() && e.contains("hashes") && e["hashes"].is_object()
+            && !field(e["hashes"], "root", entry.rootHash))
+            return false;
+        out[name] = std::move(entry);
+        return true;
+    };
+    if (doc.is_object()) {
+        out.reserve(doc.size());
+        for (auto it = doc.begin(); it != doc.end(); ++it) {
+            if (!add(it.key(), it.value())) return false;
+        }
+    } else if (doc.is_array()) {
+        out.reserve(doc.size());
+        for (const auto& e : doc) {
+            if (!e.is_object()) continue;
+            std::string name;
+            if (!field(e, "name", name) || !add(name, e)) return false;
+        }
+    } else {
+        error = "Catalog must be an object keyed by package name or a list of entries";
+        return false;
+    }
+    return true;
+}
+
+enum OutdatedStatus { Upgrade, Downgrade, Sidegrade, HashMismatch, UpToDate, NotInCatalog,
+                      OutdatedStatusCount };
+constexpr const char* kOutdatedStatuses[OutdatedStatusCount] = {
+    "upgrade", "downgrade", "sidegrade", "hashMismatch", "upToDate", "notInCatalog"
+};
+
+} // namespace
+
+LogosMap PackageManagerImpl::checkOutdated(const std::string& catalogJsonPath)
+{
+    auto slotTimer = timeSlot("checkOutdated");
+    LogosMap response;
+    std::unordered_map<std::string, CatalogEntry> catalog;
+    std::string error;
+    {
+        trace::Span span(m_trace, "catalog load", "json");
+        if (!loadCatalog(catalogJsonPath, catalog, error)) {
+            response["success"] = false;
+            response["error"] = error;
+            return response;
+        }
+    }
+
+    const PackageIndex& index = installedIndex();
+    trace::Span span(m_trace, "outdated join", "index");
+    int64_t counts[OutdatedStatusCount] = {};
+    LogosList packages = LogosList::array();
+    for (size_t row = 0; row < index.size(); ++row) {
+        const std::string name(index.name(row));
+        const std::string_view installedRoot = index.hashRoot(row);
+        LogosMap entry;
+        entry["name"] = name;
+        entry["installType"] = installTypeName(index.installType(row));
+        entry["installedVersion"] = std::string(index.version(row));
+        entry["installedHash"] = std::string(installedRoot);
+
+        OutdatedStatus status;
+        auto it = catalog.find(name);
+        if (it == catalog.end()) {
+            status = NotInCatalog;
+        } else {
+            const CatalogEntry& c = it->second;
+            entry["catalogVersion"] = c.version;
+            entry["catalogHash"] = c.rootHash;
+            entry["releaseTag"] = c.releaseTag;
+            const int cmp = semver::compare(c.key, c.version, index.versionKey(row), index.version(row));
+            if (cmp > 0) status = Upgrade;
+            else if (cmp < 0) status = Downgrade;
+            else if (c.version != index.version(row)) status = Sidegrade;  // e.g. 1.2 vs 1.2.0+build.3
+            else if (!c.rootHash.empty() && !installedRoot.empty() && c.rootHash != installedRoot)
+                status = HashMismatch;
+            else status = UpToDate;
+        }
+        entry["status"] = kOutdatedStatuses[status];
+        ++counts[status];
+        packages.push_back(entry);
+    }
+
+    LogosMap summary = LogosMap::object();
+    for (int i = 0; i < OutdatedStatusCount; ++i) summary[kOutdatedStatuses[i]] = counts[i];
+    response["success"] = true;
+    response["packages"] = packages;
+    response["counts"] = summary;
+    return response;
+}
+
+namespace {
+
+LogosList toStringList(const std::vector<std::string>& v)
+{
+    LogosList l = LogosList::array();
+    for (const auto& s : v) l.push_back(s);
+    return l;
+}
+
+constexpr const char* kAuditStatuses[] = { "ok", "modified", "unverified", "notInstalled", "error" };
+
+} // namespace
+
+LogosMap PackageManagerImpl::auditPackage(const std::string& name, const std::string& installDirPath,
+                                          const std::string& manifestRoot, bool rehash,
+                                          const integrity::Pacer& pace)
+{
+    namespace fs = std::filesystem;
+    const fs::path installDir(installDirPath);
+    LogosMap entry;
+    entry["name"] = name;
+    entry["installDir"] = installDir.string();
+    auto fail = [&entry](const std::string& error) {
+        entry["status"] = "error";
+        entry["error"] = error;
+        return entry;
+    };
+
+    uint64_t manifestSize = 0;
+    int64_t manifestMtime = 0;
+    std::string error;
+    if (!integrity::fingerprint(installDir / "manifest.json", manifestSize, manifestMtime, error))
+        return fail(error);
+
+    // Work on a copy so the scrubber and a verifyInstalled call never hold
+    // the lock while hashing; whichever finishes last stores its copy.
+    const fs::path sidecar = baselineFile(installDir, name);
+    integrity::Baseline baseline;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lk(m_baselineMutex);
+        auto it = m_baselines.find(name);
+        if (it != m_baselines.end()) {
+            baseline = it->second;
+            found = true;
+        }
+    }
+    bool cached = found;
+    if (!found) found = integrity::loadBaseline(sidecar, baseline);
+    auto store = [&](const integrity::Baseline& b, bool persist) {
+        std::lock_guard<std::mutex> lk(m_baselineMutex);
+        // Best effort: embedded directories are usually read-only, and the
+        // in-memory copy still serves this process.
+        std::string ignored;
+        if (persist) integrity::saveBaseline(sidecar, b, ignored);
+        m_baselines[name] = b;
+    };
+    WorkerPool* workers = pace ? nullptr : &pool();
+
+    // Only a baseline the module took when it wrote the files can tell a
+    // damaged install from a good one. Without one, or once hashes.root has
+    // moved on (content replaced from outside), nothing vouches for what is
+    // on disk, so it is not reported clean.
+    if (!found || !baseline.installTime || baseline.manifestRoot != manifestRoot) {
+        entry["status"] = "unverified";
+        entry["reason"] = found && baseline.installTime
+            ? "manifest root changed since the install-time baseline"
+            : "no install-time baseline";
+        return entry;
+    }
+
+    integrity::Report report;
+    bool refreshed = false;
+    {
+        trace::Span span(m_trace, "integrity verify", "io");
+        if (!integrity::verify(installDir, baseline, rehash, workers, report, refreshed, error, pace))
+            return fail(error);
+    }
+    if (refreshed || !cached) store(baseline, refreshed);
+    m_instr->integrityHashed.inc(report.filesHashed);
+    m_instr->integritySkipped.inc(report.filesSkipped);
+    m_instr->integrityBytes.inc(report.bytesHashed);
+    if (!report.clean()) m_instr->integrityModified.inc();
+
+    entry["status"] = report.clean() ? "ok" : "modified";
+    entry["root"] = integrity::toHex(report.root);
+    entry["baselineRoot"] = integrity::toHex(integrity::merkleRoot(baseline.files));
+    entry["mismatched"] = toStringList(report.mismatched);
+    entry["missing"] = toStringList(report.missing);
+    entry["extra"] = toStringList(report.extra);
+    entry["filesHashed"] = report.filesHashed;
+    entry["filesSkipped"] = report.filesSkipped;
+    entry["bytesHashed"] = report.bytesHashed;
+    return entry;
+}
+
+void PackageManagerImpl::dropIntegrityBaseline(const std::string& name)
+{
+    std::lock_guard<std::mutex> lk(m_baselineMutex);
+    m_baselines.erase(name);
+    std::error_code ec;
+    for (const auto* dir : {&m_userModulesDir, &m_userUiPluginsDir}) {
+        if (!dir->empty())
+            std::filesystem::remove(std::filesystem::path(*dir) / ".pm-integrity" / (name + ".json"), ec);
+    }
+}
+
+void PackageManagerImpl::takeIntegrityBaseline(const std::string& name,
+                                               const std::filesystem::path& installDir)
+{
+    namespace fs = std::filesystem;
+    dropIntegrityBaseline(name);
+    std::error_code ec;
+    if (fs::is_symlink(installDir, ec)) return;
+
+    auto warn = [&name](const std::string& error) {
+        std::cerr << "PackageManagerImpl: no integrity baseline for '" << name << "': " << error << "\n";
+    };
+    integrity::Baseline fresh;
+    fresh.installTime = true;
+    std::string error;
+    {
+        std::ifstream in(installDir / "manifest.json");
+        std::stringstream buf;
+        buf << in.rdbuf();
+        InstalledPackage package;
+        if (!in || !manifest::read(buf.str(), installDir.string(), InstallType::User, {}, package, error))
+            return warn(error.empty() ? "manifest.json is unreadable" : error);
+        fresh.manifestRoot = package.hashes.root;
+    }
+    if (!integrity::fingerprint(installDir / "manifest.json", fresh.manifestSize, fresh.manifestMtimeNs,
+                                error))
+        return warn(error);
+    {
+        trace::Span span(m_trace, "integrity snapshot", "io");
+        if (!integrity::snapshot(installDir, &pool(), fresh, error)) return warn(error);
+    }
+    uint64_t bytes = 0;
+    for (const auto& f : fresh.files) bytes += f.size;
+    m_instr->integrityHashed.inc(fresh.files.size());
+    m_instr->integrityBytes.inc(bytes);
+
+    std::lock_guard<std::mutex> lk(m_baselineMutex);
+    // Best effort, as in auditPackage: the in-memory copy still serves this
+    // process when the sidecar cannot be written.
+    std::string ignored;
+    integrity::saveBaseline(baselineFile(installDir, name), fresh, ignored);
+    m_baselines[name] = std::move(fresh);
+}
+
+LogosMap PackageManagerImpl::verifyInstalled(const LogosList& names, bool rehash)
+{
+    auto slotTimer = timeSlot("verifyInstalled");
+    LogosMap response;
+    if (!names.is_null() && !names.is_array()) {
+        response["success"] = false;
+        response["error"] = "names must be a list of package names";
+        return response;
     }
-    result["variants"] = variantList;
 
-    lgx_free_package(pkg);
+    const PackageIndex& index = installedIndex();
+    int64_t counts[std::size(kAuditStatuses)] = {};
+    LogosList packages = LogosList::array();
+    auto add = [&](LogosMap entry) {
+        const std::string status = entry["status"].get<std::string>();
+        for (size_t i = 0; i < std::size(kAuditStatuses); ++i) {
+            if (status == kAuditStatuses[i]) ++counts[i];
+        }
+        packages.push_back(std::move(entry));
+    };
 
-    // Signature verification — standalone, no install side effects.
-    auto sig = m_lib->verifyPackageSignature(lgxPath);
-    if (sig.is_signed) {
-        bool valid = sig.signature_valid && sig.package_valid;
-        result["signatureStatus"] = valid ? std::string("signed")
-                                          : std::string("invalid");
-        result["signerDid"]  = sig.signer_did;
-        result["signerName"] = sig.signer_name;
-    } else if (!sig.error.empty()) {
-        result["signatureStatus"] = std::string("error");
+    if (names.empty()) {
+        for (uint32_t row = 0; row < index.size(); ++row) {
+            add(auditPackage(std::string(index.name(row)), std::string(index.installDir(row)),
+                             std::string(index.hashRoot(row)), rehash));
+        }
     } else {
-        result["signatureStatus"] = std::string("unsigned");
-    }
-
-    // Check if this package is already installed.
-    bool isAlreadyInstalled = false;
-    std::string installedVersion;
-    std::string installedHash;
-    std::vector<InstalledPackage> scan = m_lib->getInstalledPackages();
-    for (const auto& entry : scan) {
-        if (entry.name == pkgName) {
-            isAlreadyInstalled = true;
-            installedVersion = entry.version;
-            // Passthrough from the installed manifest.json; same field PMU
-            // reads in the online catalog (`manifest.hashes.root`).
-            installedHash = entry.hashes.root;
-            break;
+        for (const auto& n : names) {
+            const std::string name = n.is_string() ? n.get<std::string>() : std::string();
+            const uint32_t row = index.findRow(name);
+            if (row == PackageIndex::kNoId) {
+                LogosMap entry;
+                entry["name"] = name;
+                entry["status"] = "notInstalled";
+                add(std::move(entry));
+            } else {
+                add(auditPackage(name, std::string(index.installDir(row)), std::string(index.hashRoot(row)),
+                                 rehash));
+            }
         }
     }
-    result["isAlreadyInstalled"] = isAlreadyInstalled;
-    result["installedVersion"]   = installedVersion;
-    result["installedHash"]      = installedHash;
 
-    // If already installed, compute reverse dependents so the dialog can
-    // show what would be affected by an upgrade.
-    if (isAlreadyInstalled) {
-        auto deps = installedDependentsNames(pkgName);
-        LogosList depList = LogosList::array();
-        for (const auto& d : deps) depList.push_back(d);
-        result["installedDependents"] = depList;
-    }
+    LogosMap summary = LogosMap::object();
+    for (size_t i = 0; i < std::size(kAuditStatuses); ++i) summary[kAuditStatuses[i]] = counts[i];
+    response["success"] = true;
+    response["packages"] = packages;
+    response["counts"] = summary;
+    return response;
+}
 
-    return result;
+namespace {
+
+LogosMap scrubberStatus(const IntegrityScrubber::Status& status)
+{
+    LogosMap response;
+    response["success"] = true;
+    response["running"] = status.running;
+    response["bytesPerSecond"] = status.options.bytesPerSecond;
+    response["stateFile"] = status.options.stateFile;
+    response["nice"] = status.options.niceness;
+    response["idleIo"] = status.options.idleIo;
+    response["cycleIntervalMs"] = static_cast<int64_t>(status.options.cycleInterval.count());
+    response["cycle"] = status.cycle;
+    response["resumeAfter"] = status.resumeAfter;
+    response["packagesScrubbed"] = status.packagesScrubbed;
+    response["violations"] = status.violations;
+    response["failures"] = status.failures;
+    response["bytesHashed"] = status.bytesHashed;
+    response["niceApplied"] = status.niceApplied;
+    response["idleIoApplied"] = status.idleIoApplied;
+    return response;
 }
 
-LogosList PackageManagerImpl::getInstalledPackages()
+} // namespace
+
+IntegrityScrubber::Result PackageManagerImpl::scrubPackage(const IntegrityScrubber::Target& target,
+                                                           const integrity::Pacer& pace)
 {
-    return toLogosList(m_lib->getInstalledPackages());
+    LogosMap entry = auditPackage(target.name, target.installDir, target.manifestRoot, true, pace);
+    const std::string status = entry["status"].get<std::string>();
+    if (status == "error") {
+        return entry["error"] == "cancelled" ? IntegrityScrubber::Result::Cancelled
+                                             : IntegrityScrubber::Result::Failed;
+    }
+    if (status != "modified") {
+        m_scrubFlagged.erase(target.name);
+        return IntegrityScrubber::Result::Clean;
+    }
+    if (m_scrubFlagged.insert(target.name).second) {
+        LogosMap payload;
+        for (const char* key : {"name", "installDir", "root", "baselineRoot", "mismatched", "missing", "extra"})
+            payload[key] = entry[key];
+        integrityViolation(payload.dump());
+    }
+    return IntegrityScrubber::Result::Violation;
 }
 
-LogosList PackageManagerImpl::getInstalledModules()
+LogosMap PackageManagerImpl::startIntegrityScrubber(const LogosMap& options)
+{
+    auto slotTimer = timeSlot("startIntegrityScrubber");
+    LogosMap response;
+    auto fail = [&response](const std::string& msg) {
+        response["success"] = false;
+        response["error"] = msg;
+        return response;
+    };
+    if (!options.is_null() && !options.is_object()) return fail("options must be an object");
+
+    IntegrityScrubber::Options config;
+    if (!m_userModulesDir.empty())
+        config.stateFile = (std::filesystem::path(m_userModulesDir) / ".pm-integrity" / "scrubber.json").string();
+    if (options.is_object()) {
+        for (auto it = options.begin(); it != options.end(); ++it) {
+            const std::string& key = it.key();
+            const LogosMap& value = it.value();
+            if (key == "bytesPerSecond") {
+                if (!value.is_number_integer() || value.get<int64_t>() <= 0)
+                    return fail("bytesPerSecond must be a positive integer");
+                config.bytesPerSecond = value.get<uint64_t>();
+            } else if (key == "stateFile") {
+                if (!value.is_string()) return fail("stateFile must be a string");
+                config.stateFile = value.get<std::string>();
+            } else if (key == "nice") {
+                if (!value.is_number_integer() || value.get<int64_t>() < 0 || value.get<int64_t>() > 19)
+                    return fail("nice must be an integer from 0 to 19");
+                config.niceness = value.get<int>();
+            } else if (key == "idleIo") {
+                if (!value.is_boolean()) return fail("idleIo must be a boolean");
+                config.idleIo = value.get<bool>();
+            } else if (key == "cycleIntervalMs") {
+                // Zero would turn an empty target list into a busy loop.
+                if (!value.is_number_integer() || value.get<int64_t>() <= 0)
+                    return fail("cycleIntervalMs must be a positive integer");
+                config.cycleInterval = std::chrono::milliseconds(value.get<int64_t>());
+            } else {
+                return fail("Unknown option '" + key + "'");
+            }
+        }
+    }
+
+    // Stop first: m_scrubFlagged belongs to the scrubber thread.
+    m_scrubber.stop();
+    m_scrubFlagged.clear();
+    m_scrubber.setTargets(scrubTargets(installedIndex()));
+    m_scrubber.start(config, [this](const IntegrityScrubber::Target& target, const integrity::Pacer& pace) {
+        return scrubPackage(target, pace);
+    });
+    return scrubberStatus(m_scrubber.status());
+}
+
+LogosMap PackageManagerImpl::stopIntegrityScrubber()
 {
-    return toLogosList(m_lib->getInstalledModules());
+    auto slotTimer = timeSlot("stopIntegrityScrubber");
+    LogosMap response;
+    response["success"] = true;
+    response["stopped"] = m_scrubber.stop();
+    return response;
 }
 
-LogosList PackageManagerImpl::getInstalledUiPlugins()
+LogosMap PackageManagerImpl::getIntegrityScrubberStatus()
 {
-    return toLogosList(m_lib->getInstalledUiPlugins());
+    auto slotTimer = timeSlot("getIntegrityScrubberStatus");
+    return scrubberStatus(m_scrubber.status());
 }
 
 LogosMap PackageManagerImpl::uninstallPackage(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("uninstallPackage");
     return doUninstall(packageName);
 }
 
 LogosMap PackageManagerImpl::doUninstall(const std::string& packageName)
 {
     // Inspect the package before removal so we know whether to emit a core or UI event.
-    std::vector<InstalledPackage> scan = m_lib->getInstalledPackages();
+    std::vector<InstalledPackage> scan = scanInstalledPackages();
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(scan));
     std::string moduleType;
     for (const auto& entry : scan) {
         if (entry.name == packageName) {
@@ -335,6 +2379,7 @@ LogosMap PackageManagerImpl::doUninstall(const std::string& packageName)
     }
 
     UninstallResult r = m_lib->uninstallPackage(packageName);
+    (r.success ? m_instr->uninstallSuccess : m_instr->uninstallFailure).inc();
 
     LogosMap response;
     response["success"] = r.success;
@@ -345,6 +2390,13 @@ LogosMap PackageManagerImpl::doUninstall(const std::string& packageName)
         for (const auto& f : r.removedFiles) removed.push_back(f);
         response["removedFiles"] = removed;
 
+        // A retained pre-upgrade copy must not outlive the package itself.
+        dropPreviousVersion(packageName);
+        dropIntegrityBaseline(packageName);
+        invalidateInstalledIndex();
+        flushSharedIndex();
+
+        trace::Span span(m_trace, "emit pluginUninstalled", "event");
         if (moduleType == "core") {
             corePluginUninstalled(packageName);
         } else {
@@ -354,43 +2406,89 @@ LogosMap PackageManagerImpl::doUninstall(const std::string& packageName)
     return response;
 }
 
-LogosMap PackageManagerImpl::resolveDependencies(const std::string& packageName, bool recursive)
+LogosMap PackageManagerImpl::resolveDependencies(const std::string& packageName, bool recursive,
+                                                 const std::string& encoding)
 {
+    auto slotTimer = timeSlot("resolveDependencies");
+    packed::Format format;
+    if (!encoding.empty() && !packed::parseFormat(encoding, format)) return unknownEncoding(encoding);
+    // maxDepth=1 clips to root + direct children (children with empty
+    // `children` arrays); INT_MAX walks the full tree.
+    const int depth = recursive ? std::numeric_limits<int>::max() : 1;
+    auto tree = [&] {
+        trace::Span span(m_trace, "resolveDependencies", "deps");
+        return m_lib->resolveDependencies(packageName);
+    }();
+    memstats::Charge graphBytes(m_mem->dependencyGraphs, tree ? treeBytes(*tree) : 0);
+    if (!encoding.empty()) {
+        trace::Span span(m_trace, "packed::encodeTree", "convert");
+        return packedResponse(format, packed::encodeTree(tree ? &*tree : nullptr, depth, format));
+    }
     // Unknown roots surface as nullopt from the library; keep an empty
     // object on the wire so callers can `.contains(...)` without branching.
-    auto tree = m_lib->resolveDependencies(packageName);
     if (!tree) return LogosMap::object();
-    // maxDepth=1 clips to root + direct children (children with empty
-    // `children` arrays); INT_MAX walks the full tree.
-    return toLogosTreeMap(*tree, recursive ? std::numeric_limits<int>::max() : 1);
+    trace::Span span(m_trace, "toLogosTreeMap", "convert");
+    return toLogosTreeMap(*tree, depth);
 }
 
-LogosMap PackageManagerImpl::resolveDependents(const std::string& packageName, bool recursive)
+LogosMap PackageManagerImpl::resolveDependents(const std::string& packageName, bool recursive,
+                                               const std::string& encoding)
 {
-    // Same shape treatment as resolveDependencies — the library returns a
-    // tree, we either clip it at depth 1 or walk the full reverse subtree.
-    auto tree = m_lib->resolveDependents(packageName);
+    auto slotTimer = timeSlot("resolveDependents");
+    packed::Format format;
+    if (!encoding.empty() && !packed::parseFormat(encoding, format)) return unknownEncoding(encoding);
+    // Same shape treatment as resolveDependencies, but walked over the
+    // reverse index: depth 1, or the full reverse subtree.
+    const int depth = recursive ? std::numeric_limits<int>::max() : 1;
+    auto tree = dependentTree(packageName, depth);
+    memstats::Charge graphBytes(m_mem->dependencyGraphs, tree ? treeBytes(*tree) : 0);
+    if (!encoding.empty()) {
+        trace::Span span(m_trace, "packed::encodeTree", "convert");
+        return packedResponse(format, packed::encodeTree(tree ? &*tree : nullptr, depth, format));
+    }
     if (!tree) return LogosMap::object();
-    return toLogosTreeMap(*tree, recursive ? std::numeric_limits<int>::max() : 1);
+    trace::Span span(m_trace, "toLogosTreeMap", "convert");
+    return toLogosTreeMap(*tree, depth);
 }
 
-LogosList PackageManagerImpl::resolveFlatDependencies(const std::string& packageName, bool recursive)
+LogosList PackageManagerImpl::resolveFlatDependencies(const std::string& packageName, bool recursive,
+                                                      const std::string& encoding)
 {
+    auto slotTimer = timeSlot("resolveFlatDependencies");
+    packed::Format format;
+    if (!encoding.empty() && !packed::parseFormat(encoding, format)) return asList(unknownEncoding(encoding));
     // Flat list of per-node maps (no `children`). recursive=false emits
     // only the root's direct children; recursive=true emits every
     // descendant, BFS-ordered and deduped by name (via DependencyTreeNode::flatten()).
-    auto tree = m_lib->resolveDependencies(packageName);
-    if (!tree) return LogosList::array();
-    return recursive ? toFlatLogosList(tree->flatten())
-                     : toFlatLogosList(tree->children);
+    auto tree = [&] {
+        trace::Span span(m_trace, "resolveDependencies", "deps");
+        return m_lib->resolveDependencies(packageName);
+    }();
+    memstats::Charge graphBytes(m_mem->dependencyGraphs, tree ? treeBytes(*tree) : 0);
+    std::vector<DependencyTreeNode> flattened;
+    if (tree && recursive) flattened = tree->flatten();
+    const std::vector<DependencyTreeNode>& flat = tree && !recursive ? tree->children : flattened;
+    if (!encoding.empty()) {
+        trace::Span span(m_trace, "packed::encodeList", "convert");
+        return asList(packedResponse(format, packed::encodeList(flat, format)));
+    }
+    trace::Span span(m_trace, "toFlatLogosList", "convert");
+    return toFlatLogosList(flat);
 }
 
-LogosList PackageManagerImpl::resolveFlatDependents(const std::string& packageName, bool recursive)
+LogosList PackageManagerImpl::resolveFlatDependents(const std::string& packageName, bool recursive,
+                                                    const std::string& encoding)
 {
-    auto tree = m_lib->resolveDependents(packageName);
-    if (!tree) return LogosList::array();
-    return recursive ? toFlatLogosList(tree->flatten())
-                     : toFlatLogosList(tree->children);
+    auto slotTimer = timeSlot("resolveFlatDependents");
+    packed::Format format;
+    if (!encoding.empty() && !packed::parseFormat(encoding, format)) return asList(unknownEncoding(encoding));
+    const std::vector<DependentTreeNode> flat = flatDependents(packageName, recursive);
+    if (!encoding.empty()) {
+        trace::Span span(m_trace, "packed::encodeList", "convert");
+        return asList(packedResponse(format, packed::encodeList(flat, format)));
+    }
+    trace::Span span(m_trace, "toFlatLogosList", "convert");
+    return toFlatLogosList(flat);
 }
 
 std::vector<std::string> PackageManagerImpl::getValidVariants()
@@ -400,42 +2498,223 @@ std::vector<std::string> PackageManagerImpl::getValidVariants()
 
 void PackageManagerImpl::setEmbeddedModulesDirectory(const std::string& dir)
 {
+    m_embeddedModulesDirs = {dir};
     m_lib->setEmbeddedModulesDirectory(dir);
+    refreshEmbeddedIndex();
+    rebuildScanLibs();
+    invalidateInstalledIndex();
 }
 
 void PackageManagerImpl::addEmbeddedModulesDirectory(const std::string& dir)
 {
+    m_embeddedModulesDirs.push_back(dir);
     m_lib->addEmbeddedModulesDirectory(dir);
+    refreshEmbeddedIndex();
+    rebuildScanLibs();
+    invalidateInstalledIndex();
 }
 
 void PackageManagerImpl::setEmbeddedUiPluginsDirectory(const std::string& dir)
 {
+    m_embeddedUiPluginsDirs = {dir};
     m_lib->setEmbeddedUiPluginsDirectory(dir);
+    refreshEmbeddedIndex();
+    rebuildScanLibs();
+    invalidateInstalledIndex();
 }
 
 void PackageManagerImpl::addEmbeddedUiPluginsDirectory(const std::string& dir)
 {
+    m_embeddedUiPluginsDirs.push_back(dir);
     m_lib->addEmbeddedUiPluginsDirectory(dir);
+    refreshEmbeddedIndex();
+    rebuildScanLibs();
+    invalidateInstalledIndex();
+}
+
+void PackageManagerImpl::refreshEmbeddedIndex()
+{
+    m_embeddedIndexActive = m_embeddedIndex
+                         && embeddedindex::covers(*m_embeddedIndex, m_embeddedModulesDirs, m_embeddedUiPluginsDirs);
+}
+
+LogosMap PackageManagerImpl::writeEmbeddedIndex(const std::string& outputPath)
+{
+    auto slotTimer = timeSlot("writeEmbeddedIndex");
+    LogosMap response;
+    auto fail = [&response](const std::string& msg) {
+        response["success"] = false;
+        response["error"] = msg;
+        return response;
+    };
+    if (outputPath.empty()) return fail("outputPath is required");
+    if (m_embeddedModulesDirs.empty() && m_embeddedUiPluginsDirs.empty())
+        return fail("No embedded directories are configured");
+
+    // A library instance that sees only the embedded directories, so the
+    // index holds exactly what they contain, parsed the way scans parse it.
+    PackageManagerLib embeddedLib;
+    for (const auto& dir : m_embeddedModulesDirs) embeddedLib.addEmbeddedModulesDirectory(dir);
+    for (const auto& dir : m_embeddedUiPluginsDirs) embeddedLib.addEmbeddedUiPluginsDirectory(dir);
+    embeddedindex::Index index;
+    index.moduleDirs = m_embeddedModulesDirs;
+    index.uiPluginDirs = m_embeddedUiPluginsDirs;
+    {
+        trace::Span span(m_trace, "scan embedded directories", "scan");
+        auto embeddedOnly = [](std::vector<InstalledPackage> v) {
+            v.erase(std::remove_if(v.begin(), v.end(),
+                                   [](const InstalledPackage& p) { return p.installType != InstallType::Embedded; }),
+                    v.end());
+            return v;
+        };
+        index.modules = embeddedOnly(embeddedLib.getInstalledModules());
+        index.uiPlugins = embeddedOnly(embeddedLib.getInstalledUiPlugins());
+    }
+
+    std::string checksum;
+    std::string error;
+    size_t bytes = 0;
+    {
+        trace::Span span(m_trace, "write embedded index", "io");
+        if (!embeddedindex::write(outputPath, index, checksum, bytes, error)) return fail(error);
+    }
+    response["success"] = true;
+    response["path"] = outputPath;
+    response["packages"] = static_cast<int64_t>(index.modules.size() + index.uiPlugins.size());
+    response["bytes"] = static_cast<int64_t>(bytes);
+    response["checksum"] = checksum;
+    return response;
+}
+
+LogosMap PackageManagerImpl::loadEmbeddedIndex(const std::string& path)
+{
+    auto slotTimer = timeSlot("loadEmbeddedIndex");
+    LogosMap response;
+    // Whatever happens, the old index no longer applies.
+    m_embeddedIndex.reset();
+    m_embeddedIndexChecksum.clear();
+    m_embeddedIndexActive = false;
+    if (path.empty()) {
+        invalidateInstalledIndex();
+        response["success"] = true;
+        response["active"] = false;
+        return response;
+    }
+
+    auto index = std::make_unique<embeddedindex::Index>();
+    std::string error;
+    {
+        trace::Span span(m_trace, "load embedded index", "io");
+        if (!embeddedindex::load(path, *index, m_embeddedIndexChecksum, error)) {
+            m_instr->embeddedIndexRejected.inc();
+            invalidateInstalledIndex();
+            response["success"] = false;
+            response["error"] = error;
+            response["active"] = false;
+            return response;
+        }
+    }
+    m_instr->embeddedIndexLoaded.inc();
+    if (!m_userLib) {
+        m_userLib = std::make_unique<PackageManagerLib>();
+        if (!m_userModulesDir.empty()) m_userLib->setUserModulesDirectory(m_userModulesDir);
+        if (!m_userUiPluginsDir.empty()) m_userLib->setUserUiPluginsDirectory(m_userUiPluginsDir);
+    }
+    const size_t packages = index->modules.size() + index->uiPlugins.size();
+    m_embeddedIndex = std::move(index);
+    refreshEmbeddedIndex();
+    invalidateInstalledIndex();
+    response["success"] = true;
+    response["active"] = m_embeddedIndexActive;
+    response["packages"] = static_cast<int64_t>(packages);
+    response["checksum"] = m_embeddedIndexChecksum;
+    return response;
+}
+
+LogosMap PackageManagerImpl::setSharedIndexPublishing(bool enabled, const std::string& name)
+{
+    auto slotTimer = timeSlot("setSharedIndexPublishing");
+    LogosMap response;
+    m_shm.close();
+    m_instr->sharedIndexBytes.set(0);
+    if (enabled) {
+        std::string error;
+        if (!m_shm.open(name.empty() ? installed_shm::kDefaultName : name, error)) {
+            response["success"] = false;
+            response["enabled"] = false;
+            response["error"] = error;
+            return response;
+        }
+        // A stale index publishes as it rebuilds.
+        if (m_index) publishSharedIndex(*m_index);
+        else installedIndex();
+    }
+    response["success"] = true;
+    response["enabled"] = m_shm.isOpen();
+    response["name"] = m_shm.name();
+    response["generation"] = static_cast<int64_t>(m_shm.generation());
+    response["bytes"] = static_cast<int64_t>(m_shm.bytes());
+    return response;
+}
+
+LogosMap PackageManagerImpl::setParallelScan(bool enabled, int fanOut)
+{
+    auto slotTimer = timeSlot("setParallelScan");
+    m_parallelScan = enabled;
+    m_scanFanOut = fanOut > 0 ? static_cast<size_t>(fanOut) : 0;
+    rebuildScanLibs();
+    invalidateInstalledIndex();
+    LogosMap response;
+    response["success"] = true;
+    response["enabled"] = m_parallelScan;
+    response["directories"] = static_cast<int64_t>(m_scanDirs.size());
+    response["fanOut"] = static_cast<int64_t>(m_scanFanOut ? m_scanFanOut : kScanFanOut);
+    return response;
+}
+
+LogosMap PackageManagerImpl::setScanManifestReader(const std::string& reader)
+{
+    auto slotTimer = timeSlot("setScanManifestReader");
+    LogosMap response;
+    if (reader != "library" && reader != "ondemand") {
+        response["success"] = false;
+        response["error"] = "Unknown manifest reader '" + reader + "' - expected library or ondemand";
+        return response;
+    }
+    m_onDemandManifests = reader == "ondemand";
+    rebuildScanLibs();
+    invalidateInstalledIndex();
+    response["success"] = true;
+    response["reader"] = reader;
+    response["directories"] = static_cast<int64_t>(m_scanDirs.size());
+    return response;
 }
 
 void PackageManagerImpl::setUserModulesDirectory(const std::string& dir)
 {
+    m_userModulesDir = dir;
     m_lib->setUserModulesDirectory(dir);
+    if (m_userLib) m_userLib->setUserModulesDirectory(dir);
+    rebuildScanLibs();
+    invalidateInstalledIndex();
 }
 
 void PackageManagerImpl::setUserUiPluginsDirectory(const std::string& dir)
 {
+    m_userUiPluginsDir = dir;
     m_lib->setUserUiPluginsDirectory(dir);
+    if (m_userLib) m_userLib->setUserUiPluginsDirectory(dir);
+    rebuildScanLibs();
+    invalidateInstalledIndex();
 }
 
 void PackageManagerImpl::setSignaturePolicy(const std::string& policy)
 {
     std::string p = policy;
     std::transform(p.begin(), p.end(), p.begin(), ::tolower);
-    if (p == "none") m_lib->setSignaturePolicy(SignaturePolicy::NONE);
-    else if (p == "warn") m_lib->setSignaturePolicy(SignaturePolicy::WARN);
-    else if (p == "require") m_lib->setSignaturePolicy(SignaturePolicy::REQUIRE);
-    else {
+    if (applySignaturePolicy(*m_lib, p)) {
+        m_signaturePolicy = p;
+    } else {
         std::cerr << "PackageManagerImpl::setSignaturePolicy: invalid policy '"
                   << policy << "' - expected one of: none, warn, require\n";
     }
@@ -448,7 +2727,8 @@ void PackageManagerImpl::setKeyringDirectory(const std::string& dir)
 
 LogosMap PackageManagerImpl::verifyPackage(const std::string& lgxPath)
 {
-    auto result = m_lib->verifyPackageSignature(lgxPath);
+    auto slotTimer = timeSlot("verifyPackage");
+    auto result = verifySignature(lgxPath);
 
     LogosMap response;
     response["isSigned"] = result.is_signed;
@@ -466,6 +2746,7 @@ LogosMap PackageManagerImpl::verifyPackage(const std::string& lgxPath)
 LogosMap PackageManagerImpl::addTrustedKey(const std::string& name, const std::string& did,
                                             const std::string& displayName, const std::string& url)
 {
+    auto slotTimer = timeSlot("addTrustedKey");
     std::string keyringDir = m_lib->keyringDirectory();
     const char* keyringDirPtr = keyringDir.empty() ? nullptr : keyringDir.c_str();
 
@@ -486,6 +2767,7 @@ LogosMap PackageManagerImpl::addTrustedKey(const std::string& name, const std::s
 
 LogosMap PackageManagerImpl::removeTrustedKey(const std::string& name)
 {
+    auto slotTimer = timeSlot("removeTrustedKey");
     std::string keyringDir = m_lib->keyringDirectory();
     const char* keyringDirPtr = keyringDir.empty() ? nullptr : keyringDir.c_str();
 
@@ -503,10 +2785,12 @@ LogosMap PackageManagerImpl::removeTrustedKey(const std::string& name)
 
 LogosList PackageManagerImpl::listTrustedKeys()
 {
+    auto slotTimer = timeSlot("listTrustedKeys");
     std::string keyringDir = m_lib->keyringDirectory();
     const char* keyringDirPtr = keyringDir.empty() ? nullptr : keyringDir.c_str();
 
     lgx_keyring_list_t list = lgx_keyring_list(keyringDirPtr);
+    memstats::Charge listBytes(m_mem->keyring, keyringListBytes(list));
 
     LogosList result = LogosList::array();
     for (size_t i = 0; i < list.count; ++i) {
@@ -557,7 +2841,8 @@ std::string PackageManagerImpl::pendingDescriptionLocked() const
 
 bool PackageManagerImpl::isEmbedded(const std::string& packageName) const
 {
-    std::vector<InstalledPackage> scan = m_lib->getInstalledPackages();
+    std::vector<InstalledPackage> scan = scanInstalledPackages();
+    memstats::Charge scanBytes(m_mem->scans, heapBytes(scan));
     for (const auto& entry : scan) {
         if (entry.name == packageName)
             return entry.installType == InstallType::Embedded;
@@ -565,16 +2850,11 @@ bool PackageManagerImpl::isEmbedded(const std::string& packageName) const
     return false;
 }
 
-std::vector<std::string> PackageManagerImpl::installedDependentsNames(const std::string& packageName) const
+std::vector<std::string> PackageManagerImpl::installedDependentsNames(const std::string& packageName)
 {
     std::vector<std::string> names;
-    auto tree = m_lib->resolveDependents(packageName);
-    if (!tree) return names;
-    auto flat = tree->flatten();
-    names.reserve(flat.size());
-    for (const auto& d : flat) {
-        if (!d.name.empty()) names.push_back(d.name);
-    }
+    trace::Span span(m_trace, "installedDependentsNames", "deps");
+    for (auto& d : flatDependents(packageName, true)) names.push_back(std::move(d.name));
     return names;
 }
 
@@ -586,6 +2866,7 @@ std::vector<std::string> PackageManagerImpl::installedDependentsNames(const std:
 void PackageManagerImpl::startAckTimerLocked(std::unique_lock<std::mutex>& lock)
 {
     // Precondition: caller holds m_stateMutex via `lock`.
+    trace::Span span(m_trace, "ackTimer start", "ack");
 
     // Bump the generation and wake any previously-running worker. If one is
     // still waiting on the CV, it'll re-acquire the mutex, see its captured
@@ -605,6 +2886,7 @@ void PackageManagerImpl::startAckTimerLocked(std::unique_lock<std::mutex>& lock)
 
     const uint64_t gen = m_ackGeneration;
     m_ackThread = std::thread([this, gen]() { ackTimerWorker(gen); });
+    m_instr->ackTimerThreads.inc();
 }
 
 void PackageManagerImpl::stopAckTimerLocked()
@@ -627,13 +2909,19 @@ void PackageManagerImpl::ackTimerWorker(uint64_t myGeneration)
     // timeout. Predicate: "stop waiting" — either the process is shutting
     // down or our generation is stale (a newer request / ack / cancel
     // has superseded us).
-    bool cancelled = m_ackCv.wait_for(
-        lock,
-        std::chrono::milliseconds(m_ackTimeoutMs),
-        [this, myGeneration]() {
-            return m_ackShutdown || m_ackGeneration != myGeneration;
-        }
-    );
+    bool cancelled;
+    {
+        // The span covers the whole wait, so the timeline shows how long
+        // each dialog went unacknowledged.
+        trace::Span span(m_trace, "ackTimer wait", "ack");
+        cancelled = m_ackCv.wait_for(
+            lock,
+            std::chrono::milliseconds(m_ackTimeoutMs),
+            [this, myGeneration]() {
+                return m_ackShutdown || m_ackGeneration != myGeneration;
+            }
+        );
+    }
     if (cancelled) return;
 
     // Full timeout with no cancellation — but recheck state now that we
@@ -656,11 +2944,20 @@ void PackageManagerImpl::ackTimerWorker(uint64_t myGeneration)
     // (e.g. a headless runtime that calls uninstallPackage on cancel
     // notification) would otherwise re-enter the mutex and deadlock.
     lock.unlock();
+    countGatedOutcome(pa.op, GatedOutcome::Timeout);
     emitCancellation(pa, reason);
 }
 
 void PackageManagerImpl::emitCancellation(const PendingAction& pa, const std::string& reason)
 {
+    trace::Span span(m_trace, "emit cancellation", "event");
+
+    // Every path that abandons a pending action ends here.
+    if (pa.speculation) {
+        discardSpeculation(pa.speculation);
+        m_instr->stagingDiscarded.inc();
+    }
+
     LogosMap payload;
     payload["reason"] = reason;
     if (pa.op == PendingOp::Upgrade) {
@@ -685,6 +2982,7 @@ void PackageManagerImpl::emitCancellation(const PendingAction& pa, const std::st
 
 LogosMap PackageManagerImpl::requestUninstall(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("requestUninstall");
     LogosMap response;
     // Empty packageName would be persisted into m_pendingAction.name and then
     // broadcast via beforeUninstall(payload{name:""}), causing listeners to
@@ -731,7 +3029,10 @@ LogosMap PackageManagerImpl::requestUninstall(const std::string& packageName)
     startAckTimerLocked(lock);
 
     lock.unlock();
-    beforeUninstall(payload.dump());
+    {
+        trace::Span span(m_trace, "emit beforeUninstall", "event");
+        beforeUninstall(payload.dump());
+    }
 
     response["success"] = true;
     return response;
@@ -762,6 +3063,7 @@ LogosMap PackageManagerImpl::requestUpgrade(const std::string& packageName,
                                              int64_t mode,
                                              const std::string& depChanges)
 {
+    auto slotTimer = timeSlot("requestUpgrade");
     LogosMap response;
     // Same rationale as requestUninstall: empty name has to be rejected
     // before we set pending state, otherwise beforeUpgrade(name="") leads
@@ -806,7 +3108,10 @@ LogosMap PackageManagerImpl::requestUpgrade(const std::string& packageName,
     startAckTimerLocked(lock);
 
     lock.unlock();
-    beforeUpgrade(payload.dump());
+    {
+        trace::Span span(m_trace, "emit beforeUpgrade", "event");
+        beforeUpgrade(payload.dump());
+    }
 
     response["success"] = true;
     return response;
@@ -817,6 +3122,7 @@ LogosMap PackageManagerImpl::requestInstall(const std::string& packageName,
                                              const std::string& repositoryUrl,
                                              const std::string& depChanges)
 {
+    auto slotTimer = timeSlot("requestInstall");
     LogosMap response;
     if (packageName.empty()) {
         response["success"] = false;
@@ -848,14 +3154,218 @@ LogosMap PackageManagerImpl::requestInstall(const std::string& packageName,
     startAckTimerLocked(lock);
 
     lock.unlock();
-    beforeInstall(payload.dump());
+    {
+        trace::Span span(m_trace, "emit beforeInstall", "event");
+        beforeInstall(payload.dump());
+    }
+
+    response["success"] = true;
+    return response;
+}
+
+LogosMap PackageManagerImpl::stagePendingPackage(const std::string& packageName,
+                                                 const std::string& lgxPath)
+{
+    auto slotTimer = timeSlot("stagePendingPackage");
+    namespace fs = std::filesystem;
+    LogosMap response;
+    response["success"] = false;
+
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(lgxPath, ec);
+    const fs::file_time_type mtime = ec ? fs::file_time_type() : fs::last_write_time(lgxPath, ec);
+    if (ec) {
+        response["error"] = "LGX file not found: " + lgxPath;
+        return response;
+    }
+
+    // The archive is read and the installed set scanned without holding
+    // m_stateMutex: the ack timer needs it to cancel on time. The pending
+    // action is looked up here and checked again before attaching.
+    const std::string noPending = "No pending install or upgrade for '" + packageName + "'";
+    PendingOp op = PendingOp::None;
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        if ((m_pendingAction.op == PendingOp::Install || m_pendingAction.op == PendingOp::Upgrade)
+            && m_pendingAction.name == packageName)
+            op = m_pendingAction.op;
+    }
+    if (op == PendingOp::None) {
+        response["error"] = noPending;
+        return response;
+    }
+
+    auto spec = std::make_shared<Speculation>();
+    spec->op = op;
+    spec->lgxPath = lgxPath;
+    spec->lgxSize = size;
+    spec->lgxMtime = mtime;
+
+    std::string error;
+    if (spec->op == PendingOp::Upgrade) {
+        // Cheap and on this thread: read the header, find the install, and
+        // compare Merkle roots. Only a real change is worth staging.
+        if (!resolveUpgrade(lgxPath, spec->upgrade, error)) {
+            response["error"] = error;
+            return response;
+        }
+        if (spec->upgrade.name != packageName) {
+            response["error"] = "'" + lgxPath + "' contains '" + spec->upgrade.name
+                              + "', not '" + packageName + "'";
+            return response;
+        }
+        spec->config = extractionConfig(spec->upgrade.stagingParent);
+    } else {
+        const std::string name = [&] {
+            trace::Span span(m_trace, "lgx_load", "lgx");
+            return lgxPackageName(lgxPath);
+        }();
+        if (name != packageName) {
+            response["error"] = name.empty()
+                ? "Failed to load LGX package: " + lgxPath
+                : "'" + lgxPath + "' contains '" + name + "', not '" + packageName + "'";
+            return response;
+        }
+        // Stage inside a user directory so committing is a rename rather
+        // than a copy out of the system temp directory.
+        const std::string& userDir = !m_userModulesDir.empty() ? m_userModulesDir : m_userUiPluginsDir;
+        if (userDir.empty()) {
+            response["error"] = "User modules directory is not configured";
+            return response;
+        }
+        spec->config = extractionConfig(fs::path(userDir) / ".pm-staging");
+    }
+
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (m_pendingAction.op != op || m_pendingAction.name != packageName) {
+        // Cancelled, timed out or replaced while the archive was read.
+        response["error"] = noPending;
+        return response;
+    }
+    // A second call replaces the first (e.g. the initiator re-downloaded).
+    if (m_pendingAction.speculation) discardSpeculation(m_pendingAction.speculation);
+    m_pendingAction.speculation = spec;
+
+    response["success"] = true;
+    if (spec->upgrade.upToDate) {
+        spec->finished = true;
+        response["upToDate"] = true;
+        return response;
+    }
+    pool().submit([this, spec]() { runSpeculation(spec); });
+    response["staging"] = true;
+    return response;
+}
+
+void PackageManagerImpl::runSpeculation(const std::shared_ptr<Speculation>& spec)
+{
+    std::string error;
+    bool ok = false;
+    {
+        std::lock_guard<std::mutex> lk(spec->mutex);
+        if (spec->discarded) {
+            // Cancelled before the pool got to it — nothing to undo.
+            spec->finished = true;
+            spec->finishedCv.notify_all();
+            return;
+        }
+    }
+    if (spec->op == PendingOp::Upgrade) {
+        ok = stageUpgrade(spec->lgxPath, spec->config, spec->upgrade, error);
+    } else {
+        auto phase = timePhase(m_instr->phaseExtract, "extract");
+        ok = extractToScratch(spec->lgxPath, spec->config, spec->install, error);
+    }
+
+    std::lock_guard<std::mutex> lk(spec->mutex);
+    if (!ok) spec->error = error.empty() ? "Staging failed" : error;
+    spec->finished = true;
+    if (spec->discarded) removeSpeculationFiles(*spec);
+    spec->finishedCv.notify_all();
+}
+
+bool PackageManagerImpl::awaitSpeculation(Speculation& spec)
+{
+    std::unique_lock<std::mutex> lk(spec.mutex);
+    spec.finishedCv.wait(lk, [&spec]() { return spec.finished; });
+    if (!spec.error.empty()) return false;
+
+    // The archive was verified as it was when staged; refuse to commit it if
+    // it has been replaced since.
+    std::error_code ec;
+    if (std::filesystem::file_size(spec.lgxPath, ec) != spec.lgxSize || ec
+        || std::filesystem::last_write_time(spec.lgxPath, ec) != spec.lgxMtime || ec) {
+        spec.error = "'" + spec.lgxPath + "' changed after it was staged";
+        return false;
+    }
+    return true;
+}
+
+void PackageManagerImpl::discardSpeculation(const std::shared_ptr<Speculation>& spec)
+{
+    std::lock_guard<std::mutex> lk(spec->mutex);
+    spec->discarded = true;
+    if (spec->finished) removeSpeculationFiles(*spec);
+}
 
+void PackageManagerImpl::removeSpeculationFiles(Speculation& spec)
+{
+    std::error_code ec;
+    if (!spec.upgrade.stagedDir.empty()) std::filesystem::remove_all(spec.upgrade.stagedDir, ec);
+    if (!spec.install.root.empty()) std::filesystem::remove_all(spec.install.root, ec);
+    spec.upgrade.stagedDir.clear();
+    spec.install.root.clear();
+    if (!spec.config.parentDir.empty()) std::filesystem::remove(spec.config.parentDir, ec);  // once empty
+}
+
+LogosMap PackageManagerImpl::commitInstall(const Speculation& spec)
+{
+    namespace fs = std::filesystem;
+    LogosMap response;
+    response["success"] = false;
+
+    const fs::path packageDir(spec.install.packageDir);
+    const std::string& userDir = spec.install.isCore ? m_userModulesDir : m_userUiPluginsDir;
+    if (userDir.empty()) {
+        response["error"] = std::string(spec.install.isCore ? "User modules" : "User UI plugins")
+                          + " directory is not configured";
+        return response;
+    }
+    const fs::path target = fs::path(userDir) / packageDir.filename();
+    std::error_code ec;
+    if (fs::exists(fs::symlink_status(target, ec))) {
+        response["error"] = "'" + target.string() + "' appeared while the install was pending";
+        return response;
+    }
+
+    fs::create_directories(target.parent_path(), ec);
+    fs::rename(packageDir, target, ec);
+    if (ec) {
+        // Staged under the modules directory but placed in the UI one, on
+        // another device.
+        fileops::CopyStats stats;
+        std::string error;
+        if (!fileops::copyTree(packageDir, target, fileops::CopyMode::Copy, &pool(), stats, error)) {
+            fs::remove_all(target, ec);
+            response["error"] = error;
+            return response;
+        }
+    }
+
+    const std::string mainFile = spec.install.mainFile.empty()
+        ? target.string()
+        : (target / fs::path(spec.install.mainFile).lexically_relative(packageDir)).string();
     response["success"] = true;
+    response["committed"] = true;
+    response["isCoreModule"] = spec.install.isCore;
+    response["path"] = mainFile;
+    emitInstalled(spec.install.isCore, mainFile);
     return response;
 }
 
 LogosMap PackageManagerImpl::ackPendingAction(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("ackPendingAction");
     std::lock_guard<std::mutex> lock(m_stateMutex);
     LogosMap response;
 
@@ -882,6 +3392,7 @@ LogosMap PackageManagerImpl::ackPendingAction(const std::string& packageName)
 
 LogosMap PackageManagerImpl::confirmUninstall(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("confirmUninstall");
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
         if (m_pendingAction.op != PendingOp::Uninstall || m_pendingAction.name != packageName) {
@@ -896,6 +3407,7 @@ LogosMap PackageManagerImpl::confirmUninstall(const std::string& packageName)
             response["error"] = "Pending uninstall for '" + packageName + "' has not been acknowledged";
             return response;
         }
+        countGatedOutcome(m_pendingAction.op, GatedOutcome::Confirmed);
         m_pendingAction = {};
         stopAckTimerLocked();
     }
@@ -907,6 +3419,7 @@ LogosMap PackageManagerImpl::confirmUninstall(const std::string& packageName)
 
 LogosMap PackageManagerImpl::cancelUninstall(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("cancelUninstall");
     PendingAction pa;
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
@@ -934,6 +3447,7 @@ LogosMap PackageManagerImpl::cancelUninstall(const std::string& packageName)
     }
     // Uniform cancellation notification — same event the ack-timeout path emits.
     // Initiators (PMU) subscribe once and handle every cancellation consistently.
+    countGatedOutcome(pa.op, GatedOutcome::Cancelled);
     emitCancellation(pa, "user cancelled");
     LogosMap response;
     response["success"] = true;
@@ -943,7 +3457,9 @@ LogosMap PackageManagerImpl::cancelUninstall(const std::string& packageName)
 LogosMap PackageManagerImpl::confirmUpgrade(const std::string& packageName,
                                              const std::string& releaseTag)
 {
+    auto slotTimer = timeSlot("confirmUpgrade");
     int64_t mode = 0;
+    std::shared_ptr<Speculation> speculation;
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
         if (m_pendingAction.op != PendingOp::Upgrade
@@ -961,10 +3477,39 @@ LogosMap PackageManagerImpl::confirmUpgrade(const std::string& packageName,
             return response;
         }
         mode = m_pendingAction.mode;
+        speculation = std::move(m_pendingAction.speculation);
+        countGatedOutcome(m_pendingAction.op, GatedOutcome::Confirmed);
         m_pendingAction = {};
         stopAckTimerLocked();
     }
 
+    std::string stagingError;
+    if (speculation) {
+        if (awaitSpeculation(*speculation)) {
+            if (speculation->upgrade.upToDate) {
+                m_instr->stagingCommitted.inc();
+                LogosMap response;
+                response["success"] = true;
+                response["committed"] = true;
+                response["upToDate"] = true;
+                response["path"] = speculation->upgrade.mainFile;
+                return response;
+            }
+            LogosMap response = commitUpgrade(speculation->upgrade);
+            if (response.value("success", false)) {
+                m_instr->stagingCommitted.inc();
+                response["committed"] = true;
+                return response;
+            }
+            stagingError = response.value("error", "");
+        } else {
+            stagingError = speculation->error;
+            discardSpeculation(speculation);
+        }
+    }
+
+    if (speculation) m_instr->stagingFallback.inc();
+
     LogosMap uninstallResult = doUninstall(packageName);
 
     // On successful uninstall, tell PMU to drive the download+install step
@@ -975,21 +3520,26 @@ LogosMap PackageManagerImpl::confirmUpgrade(const std::string& packageName,
     // its existing download+install chain (downloadPackageAsync →
     // installOnePackage). The user sees the row flip to "Installing" while
     // the download runs, then to "Installed" (or "Failed") when it finishes.
+    // Hosts wanting the old version kept live until the new one is in use
+    // upgradeFromFile instead.
     bool ok = uninstallResult.value("success", false);
     if (ok) {
         LogosMap payload;
         payload["name"] = packageName;
         payload["releaseTag"] = releaseTag;
         payload["mode"] = mode;
+        trace::Span span(m_trace, "emit upgradeUninstallDone", "event");
         upgradeUninstallDone(payload.dump());
     }
 
+    if (!stagingError.empty()) uninstallResult["stagingError"] = stagingError;
     return uninstallResult;
 }
 
 LogosMap PackageManagerImpl::cancelUpgrade(const std::string& packageName,
                                             const std::string& releaseTag)
 {
+    auto slotTimer = timeSlot("cancelUpgrade");
     PendingAction pa;
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
@@ -1012,6 +3562,7 @@ LogosMap PackageManagerImpl::cancelUpgrade(const std::string& packageName,
         m_pendingAction = {};
         stopAckTimerLocked();
     }
+    countGatedOutcome(pa.op, GatedOutcome::Cancelled);
     emitCancellation(pa, "user cancelled");
     LogosMap response;
     response["success"] = true;
@@ -1020,7 +3571,12 @@ LogosMap PackageManagerImpl::cancelUpgrade(const std::string& packageName,
 
 LogosMap PackageManagerImpl::resetPendingAction()
 {
+    auto slotTimer = timeSlot("resetPendingAction");
     std::lock_guard<std::mutex> lock(m_stateMutex);
+    if (m_pendingAction.speculation) {
+        discardSpeculation(m_pendingAction.speculation);
+        m_instr->stagingDiscarded.inc();
+    }
     m_pendingAction = {};
     stopAckTimerLocked();
     LogosMap response;
@@ -1058,6 +3614,7 @@ static std::vector<std::string> dedupeNamesPreserveOrder(
 
 LogosMap PackageManagerImpl::confirmInstall(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("confirmInstall");
     // A fresh install removes nothing first — unlike confirmUpgrade there is no
     // doUninstall step. Validate, capture the echo fields, and clear the gate in
     // ONE critical section so a concurrent cancel / reset / ack-timeout can't swap
@@ -1065,6 +3622,7 @@ LogosMap PackageManagerImpl::confirmInstall(const std::string& packageName)
     // installApproved carry an empty/wrong payload). Emit outside the lock —
     // listeners may call back in synchronously.
     LogosMap payload;
+    std::shared_ptr<Speculation> speculation;
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
         if (m_pendingAction.op != PendingOp::Install || m_pendingAction.name != packageName) {
@@ -1082,18 +3640,46 @@ LogosMap PackageManagerImpl::confirmInstall(const std::string& packageName)
         payload["name"] = m_pendingAction.name;
         payload["releaseTag"] = m_pendingAction.releaseTag;
         payload["repositoryUrl"] = m_pendingAction.repositoryUrl;
+        speculation = std::move(m_pendingAction.speculation);
+        countGatedOutcome(m_pendingAction.op, GatedOutcome::Confirmed);
         m_pendingAction = {};
         stopAckTimerLocked();
     }
-    installApproved(payload.dump());
+
+    // A package staged by stagePendingPackage is already verified and
+    // unpacked; placing it is a rename, and there is nothing left for the
+    // initiator to download.
+    std::string stagingError;
+    if (speculation) {
+        LogosMap committed = LogosMap::object();
+        if (awaitSpeculation(*speculation)) {
+            committed = commitInstall(*speculation);
+            stagingError = committed.value("error", "");
+        } else {
+            stagingError = speculation->error;
+        }
+        // Clears the scratch root (and the package too if it wasn't placed).
+        discardSpeculation(speculation);
+        if (committed.value("success", false)) {
+            m_instr->stagingCommitted.inc();
+            return committed;
+        }
+        m_instr->stagingFallback.inc();
+    }
+    {
+        trace::Span span(m_trace, "emit installApproved", "event");
+        installApproved(payload.dump());
+    }
 
     LogosMap response;
     response["success"] = true;
+    if (!stagingError.empty()) response["stagingError"] = stagingError;
     return response;
 }
 
 LogosMap PackageManagerImpl::cancelInstall(const std::string& packageName)
 {
+    auto slotTimer = timeSlot("cancelInstall");
     PendingAction pa;
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
@@ -1114,6 +3700,7 @@ LogosMap PackageManagerImpl::cancelInstall(const std::string& packageName)
         m_pendingAction = {};
         stopAckTimerLocked();
     }
+    countGatedOutcome(pa.op, GatedOutcome::Cancelled);
     emitCancellation(pa, "user cancelled");
     LogosMap response;
     response["success"] = true;
@@ -1122,6 +3709,7 @@ LogosMap PackageManagerImpl::cancelInstall(const std::string& packageName)
 
 LogosMap PackageManagerImpl::requestMultiUninstall(const std::vector<std::string>& packageNamesIn)
 {
+    auto slotTimer = timeSlot("requestMultiUninstall");
     LogosMap response;
 
     if (packageNamesIn.empty()) {
@@ -1193,7 +3781,10 @@ LogosMap PackageManagerImpl::requestMultiUninstall(const std::vector<std::string
     startAckTimerLocked(lock);
 
     lock.unlock();
-    beforeMultiUninstall(payload.dump());
+    {
+        trace::Span span(m_trace, "emit beforeMultiUninstall", "event");
+        beforeMultiUninstall(payload.dump());
+    }
 
     response["success"] = true;
     return response;
@@ -1201,6 +3792,7 @@ LogosMap PackageManagerImpl::requestMultiUninstall(const std::vector<std::string
 
 LogosMap PackageManagerImpl::confirmMultiUninstall(const std::vector<std::string>& packageNamesIn)
 {
+    auto slotTimer = timeSlot("confirmMultiUninstall");
     // Dedupe so callers can pass either the original or deduped form — the
     // pending state always holds the deduped list (see requestMultiUninstall).
     const std::vector<std::string> packageNames =
@@ -1219,6 +3811,7 @@ LogosMap PackageManagerImpl::confirmMultiUninstall(const std::vector<std::string
             response["error"] = "Pending multi-uninstall has not been acknowledged";
             return response;
         }
+        countGatedOutcome(m_pendingAction.op, GatedOutcome::Confirmed);
         m_pendingAction = {};
         stopAckTimerLocked();
     }
@@ -1245,6 +3838,7 @@ LogosMap PackageManagerImpl::confirmMultiUninstall(const std::vector<std::string
 
 LogosMap PackageManagerImpl::cancelMultiUninstall(const std::vector<std::string>& packageNamesIn)
 {
+    auto slotTimer = timeSlot("cancelMultiUninstall");
     // Dedupe so callers can pass either the original or deduped form — see
     // confirmMultiUninstall for rationale.
     const std::vector<std::string> packageNames =
@@ -1269,6 +3863,7 @@ LogosMap PackageManagerImpl::cancelMultiUninstall(const std::vector<std::string>
         m_pendingAction = {};
         stopAckTimerLocked();
     }
+    countGatedOutcome(pa.op, GatedOutcome::Cancelled);
     emitCancellation(pa, "user cancelled");
     LogosMap response;
     response["success"] = true;
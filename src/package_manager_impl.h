@@ -1,15 +1,35 @@
 #pragma once
 
+#include <filesystem>
+#include <set>
 #include <string>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
 #include <logos_json.h>
 #include <logos_module_context.h>  // LogosModuleContext base; provides `logos_events`
-
+#include "file_ops.h"
+#include "integrity.h"
+#include "integrity_scrubber.h"
+#include "installed_shm_publisher.h"
+#include "metrics.h"
+#include "trace.h"
+
+namespace embeddedindex { struct Index; }
+namespace parallelscan { struct Directory; }
+class PackageIndex;
 class PackageManagerLib;
+class ReverseDependencyIndex;
+class TrigramIndex;
+class WorkerPool;
+struct DependentTreeNode;
+struct InstalledPackage;
+struct SignatureVerificationResult;
 
 class PackageManagerImpl : public LogosModuleContext {
 public:
@@ -20,6 +40,9 @@ public:
     PackageManagerImpl& operator=(const PackageManagerImpl&) = delete;
 
     // Install from local LGX file — returns LogosMap {name, path, error, isCoreModule, ...}
+    // The signature report in the response is computed on the worker pool
+    // while the library extracts, so the archive's second hashing pass no
+    // longer adds to install latency.
     LogosMap installPlugin(const std::string& pluginPath, bool skipIfNotNewerVersion);
 
     // Inspect an LGX file without installing. Returns package metadata plus
@@ -29,25 +52,221 @@ public:
     //     signatureStatus ("signed"|"unsigned"|"invalid"|"error"),
     //     signerDid?, signerName?,
     //     isAlreadyInstalled, installedVersion?,
+    //     versionChange? ("upgrade"|"downgrade"|"sidegrade"|"none", by
+    //                     semver precedence then Merkle root),
     //     installedDependents? }
     LogosMap inspectPackage(const std::string& lgxPath);
 
+    // Batch semver comparison (see semver.h for the ordering), so hosts do
+    // not need their own. `pairs` is a list of [a, b] version string pairs.
+    // Returns { success, results: [-1 | 0 | 1] } (a lower / equal / higher
+    // than b), or { success: false, error } naming the first malformed pair.
+    LogosMap compareVersions(const LogosList& pairs);
+
+    // Developer install from an unpacked build directory (one containing a
+    // manifest.json), bypassing .lgx packing and hashing entirely. The package
+    // is registered under the user modules / UI plugins directory (chosen by
+    // the manifest's `type`), replacing any previous user install of the same
+    // name, and the usual corePluginFileInstalled / uiPluginFileInstalled
+    // event is emitted. `mode`:
+    //   "symlink" — <userDir>/<name> becomes a symlink to `dirPath`; edits in
+    //               the build tree are live without reinstalling.
+    //   "reflink" — per-file copy-on-write clones (FICLONE / clonefile),
+    //               falling back to a copy on filesystems without support.
+    //   "copy"    — per-file kernel-side copy (copy_file_range on Linux).
+    //               "copy_file_range" is accepted as an alias.
+    // The new install is built under <userDir>/.pm-staging and exchanged in,
+    // so a failure leaves the previous install as it was. `dirPath` is
+    // resolved through symlinks first; a source that is, contains or lies
+    // inside <userDir>/<name> is refused.
+    // Returns { name, path, installDir, isCoreModule, mode, error? } where
+    // `path` is the resolved main file (same field installPlugin returns).
+    // Embedded packages cannot be shadowed this way.
+    LogosMap installFromDirectory(const std::string& dirPath, const std::string& mode);
+
+    // Upgrade an installed user package in place from a local .lgx, writing
+    // only what changed. If the archive's Merkle root (manifest.hashes.root)
+    // equals the installed one this is a no-op. Otherwise the archive is
+    // verified and unpacked into a private scratch tree, compared leaf by
+    // leaf against the installed files (a same-size leaf still matching
+    // the install-time integrity baseline costs one read of the new copy,
+    // not a byte compare), and a staged copy is assembled next
+    // to the install from hard links (unchanged leaves) plus the added and
+    // changed leaves. The staged copy and the live directory are then
+    // exchanged atomically (the package is never absent on disk) and the
+    // previous version is retained for rollbackPackage.
+    // Returns { success, name, fromVersion, toVersion, versionChange, path,
+    //           isCoreModule, upToDate?, atomicSwap, added: [relPath], changed: [relPath],
+    //           removed: [relPath], unchanged, settledByBaseline, bytesWritten, error? }
+    // and emits corePluginFileInstalled / uiPluginFileInstalled on change.
+    LogosMap upgradeFromFile(const std::string& lgxPath);
+
+    // Swap the version retained by the last upgrade back in, atomically.
+    // The version being replaced becomes the retained one, so calling it
+    // twice rolls forward again. Emits corePluginFileInstalled /
+    // uiPluginFileInstalled for the restored version.
+    // Returns { success, name, fromVersion, toVersion, path, atomicSwap, error? }.
+    LogosMap rollbackPackage(const std::string& packageName);
+
+    // Garbage-collect every retained previous version (one per package is
+    // kept; a newer upgrade or an uninstall also drops it).
+    // Returns { success, removed: [name] }.
+    LogosMap purgeRollbackVersions();
+
     // Directory configuration — embedded (multiple, read-only)
     void setEmbeddedModulesDirectory(const std::string& dir);
     void addEmbeddedModulesDirectory(const std::string& dir);
     void setEmbeddedUiPluginsDirectory(const std::string& dir);
     void addEmbeddedUiPluginsDirectory(const std::string& dir);
 
+    // Prebuilt embedded index (see embedded_index.h). writeEmbeddedIndex is
+    // the bundle-time step: it scans the configured embedded directories
+    // (and only those) and writes the result, dependency edges included,
+    // to `outputPath`. Returns { success, path, packages, bytes, checksum,
+    // error? }.
+    LogosMap writeEmbeddedIndex(const std::string& outputPath);
+    // Maps an index written by writeEmbeddedIndex. While the configured
+    // embedded directories are the ones it was built from, scans take the
+    // embedded packages from it and read only the user directories. A file
+    // that fails its checksum or format checks is rejected — { success:
+    // false, error } — and scans stay real. Returns { success, active,
+    // packages, checksum }; `active` is false until the directories match.
+    // An empty path drops the index.
+    LogosMap loadEmbeddedIndex(const std::string& path);
+
+    // Shared-memory index (layout and header-only reader in installed_shm.h).
+    // When enabled, every rebuild of the installed index — and every change
+    // to the installed set, which now rebuilds eagerly — is published into
+    // the POSIX shared-memory object `name` (empty = "/logos-package-manager")
+    // for co-located processes to read without calling in. Disabling, or
+    // re-enabling under another name, retires the old segment. Returns
+    // { success, enabled, name, generation, bytes, error? }.
+    LogosMap setSharedIndexPublishing(bool enabled, const std::string& name);
+
+    // Parallel scanning (see parallel_scan.h). When enabled, scans run one
+    // job per configured directory on the worker pool, each through a
+    // library instance given that directory alone, and read ahead the
+    // manifests of directories holding at least `fanOut` packages (0 =
+    // default) across the pool. Results merge in the library's directory
+    // order. Returns { success, enabled, directories, fanOut }.
+    LogosMap setParallelScan(bool enabled, int fanOut);
+
+    // How scans read manifest.json (see manifest_reader.h): "library"
+    // (default) leaves it to the library; "ondemand" scans the configured
+    // directories module-side, in parallel, decoding only the fields the
+    // index keeps. Returns { success, reader, directories, error? }.
+    LogosMap setScanManifestReader(const std::string& reader);
+
     // Directory configuration — user (single, writable)
     void setUserModulesDirectory(const std::string& dir);
     void setUserUiPluginsDirectory(const std::string& dir);
 
     // Scanning — each returns LogosList (JSON array with all manifest fields
     // + installDir + mainFilePath + installType ("embedded"|"user"))
-    LogosList getInstalledPackages();
+    // getInstalledPackages and the four dependency walks below also take an
+    // `encoding` ("msgpack" or "cbor"; empty = plain result) for callers on
+    // large installations (see packed_encoding.h). The same data then comes
+    // back as one document with a string table: { success, encoding, bytes,
+    // data } with `data` base64, or { success: false, error } for an
+    // unknown encoding. A LogosList slot returns that map as its one element.
+    LogosList getInstalledPackages(const std::string& encoding = "");
     LogosList getInstalledModules();
     LogosList getInstalledUiPlugins();
 
+    // Filtered views of getInstalledPackages served from a cached,
+    // column-wise index of the installed set (see package_index.h). The
+    // index is built by the first query and dropped whenever this module
+    // installs, upgrades, rolls back or uninstalls a package or a directory
+    // setting changes; getInstalledPackages always rescans. Each argument
+    // is a conjunctive filter, empty = any:
+    //   installType — "embedded" | "user"
+    //   type        — "core" | "ui" (anything not "core", as for events)
+    //   category    — exact manifest category
+    // An unknown installType / type matches nothing.
+    LogosList findInstalledPackages(const std::string& installType, const std::string& type,
+                                    const std::string& category);
+    // Same filter, without transferring the packages. Returns { success, count }.
+    LogosMap countInstalledPackages(const std::string& installType, const std::string& type,
+                                    const std::string& category);
+
+    // Fuzzy search over name, displayName and description through a trigram
+    // index kept next to the installed index (see trigram_index.h). When
+    // the installed index is rebuilt, only packages whose text changed are
+    // re-indexed. Returns at most `limit` (<= 0: all) getInstalledPackages-
+    // shaped entries, best first, each with a `score`: the weighted share
+    // of query trigrams found (name counts most), plus a bonus when the
+    // query is the whole name (+1), a name prefix (+0.5) or inside the name
+    // (+0.25).
+    LogosList searchInstalledPackages(const std::string& query, int64_t limit);
+
+    // Faceted query over the installed index. `filter` maps any of
+    // installType ("embedded" | "user"), type, category, author and license
+    // to an exact value; keys are conjunctive and an empty value means any
+    // (type is the manifest type as-is, unlike findInstalledPackages).
+    // Returns { success, count, facets, packages? } where facets maps each
+    // of the five keys to { value: count } over the packages matching every
+    // *other* filter key, so a sidebar can show the alternatives to a
+    // selected value. packages (getInstalledPackages-shaped) is only
+    // included when includePackages is true. An unknown key, a non-string
+    // value or an unknown installType gives { success: false, error }.
+    LogosMap queryInstalledPackages(const LogosMap& filter, bool includePackages);
+
+    // Joins the installed index against a local catalog snapshot in one
+    // pass. The file is JSON, either { name: { version, rootHash,
+    // releaseTag } } or [ { name, version, rootHash, releaseTag } ]
+    // (rootHash may be hashes.root). Returns { success, packages, counts }
+    // with one entry per installed package —
+    //   { name, installType, installedVersion, installedHash, status,
+    //     catalogVersion?, catalogHash?, releaseTag? }
+    // — where status compares the catalog release to the installed one:
+    //   upgrade / downgrade — higher / lower semver precedence
+    //   sidegrade           — equal precedence, different version string
+    //   hashMismatch        — same version, different Merkle root
+    //   upToDate            — same version, same (or unknown) root
+    //   notInCatalog
+    // and counts maps each status to its number of packages. An unreadable
+    // or malformed file gives { success: false, error }.
+    LogosMap checkOutdated(const std::string& catalogJsonPath);
+
+    // Audit installed files (see integrity.h). `names` lists packages to
+    // check; empty = every installed package. Each package's files are
+    // compared with the baseline recorded when this module installed,
+    // upgraded or rolled it back; files whose size and mtime are unchanged
+    // are trusted unless `rehash`, the rest are SHA-256 hashed on the
+    // worker pool. Returns { success, packages, counts } with entries
+    //   { name, status, installDir?, root?, baselineRoot?, mismatched?,
+    //     missing?, extra?, filesHashed?, filesSkipped?, bytesHashed?,
+    //     reason?, error? }
+    // where status is "ok", "modified", "unverified" (no install-time
+    // baseline, or hashes.root changed since; `reason` says which),
+    // "notInstalled" or "error"; counts tallies statuses.
+    LogosMap verifyInstalled(const LogosList& names, bool rehash);
+
+    // Background scrubbing (see integrity_scrubber.h): the verifyInstalled
+    // audit, with rehash, over every installed package in turn on a
+    // low-priority thread that reads at most a fixed number of bytes per
+    // second. `options` (all optional):
+    //   { bytesPerSecond  (default 4 MiB),
+    //     stateFile       (default <user modules dir>/.pm-integrity/scrubber.json),
+    //     nice            (0-19, default 10; 0 = unchanged),
+    //     idleIo          (idle I/O class, default true),
+    //     cycleIntervalMs (pause between passes, default one hour) }
+    // Progress is saved to stateFile after each package, so a scrubber
+    // started again later continues where the last one stopped. The work
+    // list follows the installed index as it is rebuilt. A package found
+    // modified emits "integrityViolation" with payload
+    //   { name, installDir, root, baselineRoot, mismatched, missing, extra }
+    // once, and again only after it has audited clean in between. Starting
+    // replaces a running scrubber. Returns { success, error? } plus the
+    // status fields below.
+    LogosMap startIntegrityScrubber(const LogosMap& options);
+    // Returns { success, stopped } — false when none was running.
+    LogosMap stopIntegrityScrubber();
+    // { success, running, bytesPerSecond, stateFile, nice, idleIo,
+    //   cycleIntervalMs, cycle, resumeAfter, packagesScrubbed, violations,
+    //   failures, bytesHashed, niceApplied, idleIoApplied }
+    LogosMap getIntegrityScrubberStatus();
+
     // Uninstall a user-installed package. Refuses embedded packages.
     // Returns { success: bool, error?: string, removedFiles?: [string] }.
     // On success also emits "corePluginUninstalled" or "uiPluginUninstalled".
@@ -63,7 +282,8 @@ public:
     // queried package. Stops at NotInstalled/Cycle nodes. `recursive=false`
     // walks only one level deep (children have empty `children` arrays);
     // `recursive=true` walks the full tree.
-    LogosMap resolveDependencies(const std::string& packageName, bool recursive);
+    LogosMap resolveDependencies(const std::string& packageName, bool recursive,
+                                 const std::string& encoding = "");
 
     // Reverse dependency walk — same tree shape as resolveDependencies but
     // for the inverse edge. Returns a tree of { name, version, type,
@@ -71,14 +291,17 @@ public:
     // package. `recursive=false` walks only depth-1 (direct reverse
     // neighbours, with empty `children`); `recursive=true` walks the full
     // reverse subtree.
-    LogosMap resolveDependents(const std::string& packageName, bool recursive);
+    LogosMap resolveDependents(const std::string& packageName, bool recursive,
+                               const std::string& encoding = "");
 
     // Flat projections of the two walks above. Each returns a LogosList of
     // per-node maps (same fields as the tree version minus `children`).
     // `recursive=false` emits only direct neighbours; `recursive=true`
     // emits every descendant, BFS-ordered and deduplicated by name.
-    LogosList resolveFlatDependencies(const std::string& packageName, bool recursive);
-    LogosList resolveFlatDependents(const std::string& packageName, bool recursive);
+    LogosList resolveFlatDependencies(const std::string& packageName, bool recursive,
+                                      const std::string& encoding = "");
+    LogosList resolveFlatDependents(const std::string& packageName, bool recursive,
+                                    const std::string& encoding = "");
 
     // Platform variants this build accepts (e.g. ["darwin-arm64-dev"] or ["darwin-arm64"])
     std::vector<std::string> getValidVariants();
@@ -148,6 +371,22 @@ public:
     LogosMap confirmInstall(const std::string& packageName);
     LogosMap cancelInstall(const std::string& packageName);
 
+    // Speculative preparation while the dialog is open. When the initiator
+    // already has the new version as a local .lgx, it may hand the path over
+    // once requestInstall / requestUpgrade has succeeded. The archive's
+    // Merkle root is checked against the installed package synchronously;
+    // signature verification, extraction and (for upgrades) diff staging
+    // then run on the worker pool while the human decides.
+    //   - cancel, ack timeout or resetPendingAction discards the staged tree.
+    //   - confirmInstall / confirmUpgrade commit it in place (a rename or
+    //     atomic exchange) and emit corePluginFileInstalled /
+    //     uiPluginFileInstalled instead of installApproved /
+    //     upgradeUninstallDone, returning { success, committed: true, path, ... }.
+    //   - If staging failed, or the .lgx changed on disk since, confirm falls
+    //     back to the normal event and reports { stagingError }.
+    // Returns { success, staging?, upToDate?, error? }.
+    LogosMap stagePendingPackage(const std::string& packageName, const std::string& lgxPath);
+
     LogosMap ackPendingAction(const std::string& packageName);
 
     LogosMap confirmUninstall(const std::string& packageName);
@@ -163,6 +402,63 @@ public:
     // so a crash mid-dialog in a previous session doesn't block new requests.
     LogosMap resetPendingAction();
 
+    // ----------------------------------------------------------------
+    // Metrics
+    // ----------------------------------------------------------------
+    //
+    // Counters, gauges and histograms for every slot (wall time), package
+    // scans, signature checks, install/upgrade phases (verify, extract,
+    // diff, stage, swap), install/uninstall/upgrade results, gated-action
+    // outcomes (confirmed / cancelled / ack timeout), pending-action state
+    // and speculative staging. Recording is lock-free.
+
+    // Prometheus text exposition format (0.0.4).
+    std::string getMetricsText();
+    // Also write that text to `path` every `intervalMs` (default 15s when
+    // <= 0), atomically via rename, for node_exporter's textfile collector.
+    // An empty path stops writing. Returns { success, error? } — the first
+    // write happens synchronously so a bad path is reported here.
+    LogosMap setMetricsFile(const std::string& path, int64_t intervalMs);
+
+    // ----------------------------------------------------------------
+    // Tracing
+    // ----------------------------------------------------------------
+    //
+    // Opt-in span recording for "where did the time go" reports: every slot,
+    // and within them lgx_load, manifest parse, verifyPackageSignature,
+    // scans, dependency walks, LogosMap conversion, event emission, install
+    // phases and the ack timer (start and the full unacknowledged wait).
+    // Spans go to a lock-free ring of the most recent 65536 events.
+
+    // Enabling starts a fresh recording. Returns { success, enabled }.
+    LogosMap setTracingEnabled(bool enabled);
+    // The recording as Chrome trace-event JSON ({"traceEvents":[...]}),
+    // ready to open in Perfetto or chrome://tracing. Does not clear it.
+    std::string getTraceJson();
+
+    // ----------------------------------------------------------------
+    // Memory accounting
+    // ----------------------------------------------------------------
+    //
+    // Estimated heap held by the module, per subsystem: scan results,
+    // dependency trees and keyring listings while a slot holds them, the
+    // cached installed index, the trace ring, the metrics registry, and
+    // pending-action state (including a speculative staging plan). Every
+    // figure is a relaxed atomic, so accounting stays on in production.
+    //
+    // `keyring` covers the trusted-key listings the module copies out of
+    // lgx. The keys lgx and PackageManagerLib keep between calls are held
+    // inside those libraries, which report no sizes, so they are not
+    // counted.
+    //
+    // Returns { success, totalBytes, peakTotalBytes,
+    //           subsystems: { <name>: { bytes, peakBytes } },
+    //           process: { residentBytes, peakResidentBytes } }.
+    // `process` is the whole host, for scale; residentBytes is 0 where the
+    // platform has no cheap way to read it. The same figures are exported
+    // as logos_package_manager_memory_bytes / _memory_peak_bytes.
+    LogosMap getMemoryStats();
+
     // Test-only hook — override the ack-reception timeout so timeout-path
     // tests complete in milliseconds instead of the production 3-second
     // default. Must be called before any request*() on this instance (i.e.
@@ -197,10 +493,16 @@ logos_events:
     // initiator (PMU) runs its download + install chain for the approved
     // package. Payload: { name, releaseTag, repositoryUrl }.
     void installApproved(const std::string& payload);
+    // The integrity scrubber found a package's files no longer match its
+    // baseline. Emitted from the scrubber thread; payload as documented on
+    // startIntegrityScrubber.
+    void integrityViolation(const std::string& payload);
 
 private:
     enum class PendingOp { None, Uninstall, Upgrade, Install, MultiUninstall };
 
+    struct Speculation;
+
     struct PendingAction {
         PendingOp   op = PendingOp::None;
         std::string name;             // Uninstall / Upgrade / Install; empty for MultiUninstall (which uses `names`).
@@ -209,6 +511,7 @@ private:
         std::string repositoryUrl;     // install only — echoed back in installApproved
         int64_t     mode = 0;          // upgrade only (UpgradeMode enum as int)
         bool        acked = false;
+        std::shared_ptr<Speculation> speculation;  // install / upgrade only (stagePendingPackage)
     };
 
     // Production ack-reception timeout. Overridable per-instance via
@@ -217,6 +520,7 @@ private:
     int m_ackTimeoutMs = 3000;
     static const char* opName(PendingOp op);
     std::string pendingDescriptionLocked() const;
+    size_t pendingActionBytesLocked() const;
 
     // ----------------------------------------------------------------
     // Pure-C++ ack timer.
@@ -253,11 +557,232 @@ private:
 
     // Helpers used by the gated-flow slots.
     bool isEmbedded(const std::string& packageName) const;
-    std::vector<std::string> installedDependentsNames(const std::string& packageName) const;
+    std::vector<std::string> installedDependentsNames(const std::string& packageName);
     LogosMap doUninstall(const std::string& packageName);
     void emitCancellation(const PendingAction& pa, const std::string& reason);
 
+    // Result of unpacking an .lgx outside the user directories (see
+    // extractToScratch). `root` is the scratch tree to delete afterwards.
+    struct ScratchExtraction {
+        std::string root;
+        std::string packageDir;
+        std::string mainFile;
+        bool        isCore = false;
+    };
+    // What a scratch extraction needs from the live configuration, captured
+    // on the module thread so the extraction itself can run on the pool.
+    struct ExtractionConfig {
+        std::string           signaturePolicy;
+        std::string           keyringDir;
+        std::filesystem::path parentDir;  // empty = system temp directory
+    };
+    ExtractionConfig extractionConfig(const std::filesystem::path& parentDir) const;
+    static bool extractToScratch(const std::string& lgxPath, const ExtractionConfig& config,
+                                 ScratchExtraction& out, std::string& error);
+
+    // upgradeFromFile in three steps: resolve the archive against the
+    // installed package (module thread), stage the new tree beside it (any
+    // thread), then swap it in and emit (module thread).
+    struct UpgradePlan {
+        std::string name;
+        std::string fromVersion;
+        std::string toVersion;
+        std::string versionChange;  // "upgrade" | "downgrade" | "sidegrade" | "none"
+        std::string liveDir;
+        std::string stagingParent;
+        std::string stagedDir;
+        std::string mainFile;  // installed path after the swap
+        bool        isCore = false;
+        bool        upToDate = false;
+        fileops::TreeDiff diff;
+        fileops::CopyStats stats;
+    };
+    bool resolveUpgrade(const std::string& lgxPath, UpgradePlan& plan, std::string& error) const;
+    bool stageUpgrade(const std::string& lgxPath, const ExtractionConfig& config,
+                      UpgradePlan& plan, std::string& error);
+    LogosMap commitUpgrade(const UpgradePlan& plan);
+
+    // Background preparation attached to a pending install / upgrade. The
+    // pool task owns the work until `finished`; whoever observes both
+    // `finished` and `discarded` (the task or discardSpeculation) deletes
+    // the staged files, so discarding never waits for the task.
+    struct Speculation {
+        PendingOp         op = PendingOp::None;
+        std::string       lgxPath;
+        uintmax_t         lgxSize = 0;
+        std::filesystem::file_time_type lgxMtime;
+        ExtractionConfig  config;
+        UpgradePlan       upgrade;  // Upgrade
+        ScratchExtraction install;  // Install
+        std::string       error;    // staging failed
+
+        std::mutex              mutex;
+        std::condition_variable finishedCv;
+        bool                    finished = false;
+        bool                    discarded = false;
+    };
+    void runSpeculation(const std::shared_ptr<Speculation>& spec);
+    // Blocks until the task is done; false (with spec->error set) when the
+    // staged result cannot be committed.
+    static bool awaitSpeculation(Speculation& spec);
+    static void discardSpeculation(const std::shared_ptr<Speculation>& spec);
+    static void removeSpeculationFiles(Speculation& spec);
+    LogosMap commitInstall(const Speculation& spec);
+
+    void retainPreviousVersion(const std::filesystem::path& userDir, const std::string& name,
+                               const std::filesystem::path& previous);
+    void dropPreviousVersion(const std::string& name);
+
+    // verifyInstalled for one package: audits the install directory
+    // against its install-time integrity baseline and returns the
+    // per-package report entry. Callable from the scrubber thread; a paced
+    // audit hashes on the calling thread instead of the pool.
+    LogosMap auditPackage(const std::string& name, const std::string& installDir,
+                          const std::string& manifestRoot, bool rehash,
+                          const integrity::Pacer& pace = {});
+    void dropIntegrityBaseline(const std::string& name);
+    // Replaces `name`'s baseline with a snapshot of installDir, which the
+    // module has just written. A symlinked install (a live build tree) is
+    // left without one.
+    void takeIntegrityBaseline(const std::string& name, const std::filesystem::path& installDir);
+    // The scrubber's audit function; runs on the scrubber thread.
+    IntegrityScrubber::Result scrubPackage(const IntegrityScrubber::Target& target,
+                                           const integrity::Pacer& pace);
+
+    struct Instruments;
+    struct MemoryAccounts;
+    enum class GatedOutcome { Confirmed, Cancelled, Timeout };
+    // Marks a slot in progress. When the outermost one ends, a shared index
+    // dropped meanwhile is rebuilt and published once (flushSharedIndex).
+    class SlotGuard {
+    public:
+        SlotGuard() = default;
+        explicit SlotGuard(PackageManagerImpl* impl);
+        SlotGuard(const SlotGuard&) = delete;
+        SlotGuard& operator=(const SlotGuard&) = delete;
+        ~SlotGuard();
+
+    private:
+        PackageManagerImpl* m_impl = nullptr;
+    };
+    // A metrics timer and a trace span over the same scope; for a slot,
+    // also its SlotGuard, which ends first so the publish is timed with it.
+    struct TimedScope {
+        metrics::ScopedTimer timer;
+        trace::Span          span;
+        SlotGuard            slot;
+    };
+    TimedScope timeSlot(const char* slot);
+    TimedScope timePhase(metrics::Histogram& histogram, const char* phase) const;
+    void emitInstalled(bool isCore, const std::string& path);
+    void countGatedOutcome(PendingOp op, GatedOutcome outcome);
+    // Sets the `indexes` memory account from the installed, search, reverse
+    // dependency and embedded indexes. Module thread only, after any of
+    // them is built or dropped.
+    void accountIndexMemory();
+    // m_lib calls that are timed / counted at every call site.
+    SignatureVerificationResult verifySignature(const std::string& lgxPath) const;
+    SignatureVerificationResult verifySignature(PackageManagerLib& lib, const std::string& lgxPath) const;
+    std::vector<InstalledPackage> scanInstalledPackages() const;
+    // The index's embedded modules and / or UI plugins plus `scan` of the
+    // user directories.
+    std::vector<InstalledPackage> scanWithEmbeddedIndex(
+        bool modules, bool uiPlugins, std::vector<InstalledPackage> (PackageManagerLib::*scan)()) const;
+    // Modules and / or UI plugins of the configured directories, scanned
+    // in parallel; the embedded directories only when `embedded`.
+    std::vector<InstalledPackage> scanInParallel(bool modules, bool uiPlugins, bool embedded) const;
+    // Rebuilds m_scanDirs / m_scanLibs from the configured directories;
+    // empties them when scans go through the library.
+    void rebuildScanLibs();
+    // The on-demand reader scans module-side, so it implies parallel scans.
+    bool scansInParallel() const { return m_parallelScan || m_onDemandManifests; }
+    // Re-checks whether the embedded index covers the configured embedded
+    // directories.
+    void refreshEmbeddedIndex();
+    void publishSharedIndex(const PackageIndex& index);
+    // The cached installed index, rebuilt from a scan when missing or when
+    // a configured module directory's mtime moved since it was built (a
+    // package installed or removed outside the module: lgpm, a manual copy).
+    const PackageIndex& installedIndex();
+    // Drops the installed index. While shared publishing is open, the
+    // rebuild and publish wait for flushSharedIndex.
+    void invalidateInstalledIndex();
+    // Rebuilds and publishes a dropped index while shared publishing is
+    // open. Run as the outermost slot ends, and before an install or
+    // uninstall event, so listeners read the new set.
+    void flushSharedIndex();
+    // Mtimes (ns) of the configured module and UI plugin directories, -1
+    // for one that cannot be read.
+    std::vector<int64_t> moduleDirStamp() const;
+    // Reverse walks over m_reverse, answered from the installed index
+    // rather than a library scan. dependentTree is empty for a package that
+    // is not installed; a package already on the path is not expanded
+    // again, so cycles end. flatDependents is BFS-ordered and deduplicated
+    // by name, root excluded, like DependentTreeNode::flatten().
+    std::optional<DependentTreeNode> dependentTree(const std::string& packageName, int maxDepth);
+    std::vector<DependentTreeNode> flatDependents(const std::string& packageName, bool recursive);
+
+    // Lazily-constructed shared worker pool (sized to the core count). Not
+    // created until a slot first needs it so short-lived instances (tests,
+    // one-shot CLI hosts) never spawn idle threads.
+    // Const so the const scan helpers can fan out too.
+    WorkerPool& pool() const;
+
     PackageManagerLib* m_lib;
+    mutable std::unique_ptr<WorkerPool> m_pool;
+    std::unique_ptr<metrics::Registry> m_metrics;
+    std::unique_ptr<Instruments> m_instr;  // references into m_metrics
+    std::unique_ptr<MemoryAccounts> m_mem;
+    std::unique_ptr<PackageIndex> m_index;  // null = stale
+    std::vector<int64_t> m_indexStamp;      // moduleDirStamp() when m_index was built
+    std::unique_ptr<TrigramIndex> m_search;  // synced from m_index on each rebuild
+    std::unique_ptr<ReverseDependencyIndex> m_reverse;  // likewise
+    // Republished from m_index on each rebuild while open. Readers have no
+    // way to ask for a rebuild, so a dropped index is rebuilt when the slot
+    // that dropped it ends: one scan however many times it was dropped. The
+    // directory setters are not slots (hosts call them in a batch while
+    // configuring); the next slot publishes for them.
+    InstalledShmPublisher m_shm;
+    int m_slotDepth = 0;  // timed slots in progress, for SlotGuard
+    // Integrity baselines by package name, loaded from / saved to
+    // <modules dir>/.pm-integrity/<name>.json when that is writable.
+    // Shared with the scrubber thread: guarded by m_baselineMutex, which is
+    // never held while hashing.
+    std::mutex m_baselineMutex;
+    std::unordered_map<std::string, integrity::Baseline> m_baselines;
+    IntegrityScrubber m_scrubber;
+    // Packages the scrubber has reported and not since seen clean. Scrubber
+    // thread only (cleared before it starts).
+    std::set<std::string> m_scrubFlagged;
+    metrics::TextfileWriter m_metricsWriter;
+    // Mutable: const helpers (scans, verification) record spans too.
+    mutable trace::Recorder m_trace;
+
+    // Mirrors of the writable directories handed to m_lib, for the slots
+    // that place files themselves (installFromDirectory).
+    std::string m_userModulesDir;
+    std::string m_userUiPluginsDir;
+    // Mirrors of the embedded directories, matched against the embedded
+    // index's.
+    std::vector<std::string> m_embeddedModulesDirs;
+    std::vector<std::string> m_embeddedUiPluginsDirs;
+    // Loaded by loadEmbeddedIndex; used while m_embeddedIndexActive. Scans
+    // then go through m_userLib, which is given the user directories only.
+    std::unique_ptr<embeddedindex::Index> m_embeddedIndex;
+    std::string m_embeddedIndexChecksum;
+    bool m_embeddedIndexActive = false;
+    std::unique_ptr<PackageManagerLib> m_userLib;
+    // Last valid policy passed to setSignaturePolicy (lowercase), mirrored
+    // into the scratch library instances; empty = library default.
+    std::string m_signaturePolicy;
+    // While parallel scanning is on: every configured directory, in merge
+    // order, and a library instance given that directory alone (none with
+    // the on-demand reader).
+    bool m_parallelScan = false;
+    bool m_onDemandManifests = false;
+    size_t m_scanFanOut = 0;
+    std::vector<parallelscan::Directory> m_scanDirs;
+    std::vector<std::unique_ptr<PackageManagerLib>> m_scanLibs;
 
     // Guards m_pendingAction and the ack-timer generation/shutdown flags.
     mutable std::mutex      m_stateMutex;
@@ -0,0 +1,491 @@
+#include "packed_encoding.h"
+
+#include <package_manager_lib.h>
+
+#include <string_view>
+#include <unordered_map>
+
+namespace packed {
+
+namespace {
+
+constexpr const char* kMagic = "lpmpack";
+constexpr uint64_t    kVersion = 1;
+
+const char* const kPackageKeys[] = {"name", "displayName", "version", "description", "type",
+                                    "category", "author", "license", "icon", "view", "dependencies",
+                                    "hashes", "installType", "installDir", "mainFilePath"};
+const char* const kDependencyKeys[] = {"name", "status", "version", "installType"};
+const char* const kDependentKeys[] = {"name", "version", "type", "installType", "installDir"};
+
+// MessagePack or CBOR primitives, big-endian as both formats require.
+class Out {
+public:
+    Out(Format f, std::vector<uint8_t>& buf) : m_f(f), m_buf(buf) {}
+
+    void array(uint64_t n) { m_f == Format::Cbor ? cborHead(4, n) : packHead(n, 0x90, 16, 0xdc, 0xdd); }
+    void str(std::string_view s)
+    {
+        if (m_f == Format::Cbor) cborHead(3, s.size());
+        else if (s.size() < 32) m_buf.push_back(static_cast<uint8_t>(0xa0 | s.size()));
+        else if (s.size() < 256) {
+            m_buf.push_back(0xd9);
+            m_buf.push_back(static_cast<uint8_t>(s.size()));
+        } else packHead(s.size(), 0, 0, 0xda, 0xdb);
+        m_buf.insert(m_buf.end(), s.begin(), s.end());
+    }
+    void number(uint64_t v)
+    {
+        if (m_f == Format::Cbor) return cborHead(0, v);
+        if (v < 128) return m_buf.push_back(static_cast<uint8_t>(v));
+        if (v < 256) {
+            m_buf.push_back(0xcc);
+            return m_buf.push_back(static_cast<uint8_t>(v));
+        }
+        packHead(v, 0, 0, 0xcd, 0xce);
+    }
+    void nil() { m_buf.push_back(m_f == Format::Cbor ? 0xf6 : 0xc0); }
+
+private:
+    void be(uint64_t v, int bytes)
+    {
+        for (int i = bytes - 1; i >= 0; --i) m_buf.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+    // Fix-size form below `fixLimit`, else 16- or 32-bit length.
+    void packHead(uint64_t n, uint8_t fix, uint64_t fixLimit, uint8_t b16, uint8_t b32)
+    {
+        if (n < fixLimit) return m_buf.push_back(static_cast<uint8_t>(fix | n));
+        if (n < 65536) {
+            m_buf.push_back(b16);
+            return be(n, 2);
+        }
+        m_buf.push_back(b32);
+        be(n, 4);
+    }
+    void cborHead(uint8_t major, uint64_t v)
+    {
+        const uint8_t m = static_cast<uint8_t>(major << 5);
+        if (v < 24) return m_buf.push_back(static_cast<uint8_t>(m | v));
+        if (v < 256) {
+            m_buf.push_back(m | 24);
+            return be(v, 1);
+        }
+        if (v < 65536) {
+            m_buf.push_back(m | 25);
+            return be(v, 2);
+        }
+        if (v <= UINT32_MAX) {
+            m_buf.push_back(m | 26);
+            return be(v, 4);
+        }
+        m_buf.push_back(m | 27);
+        be(v, 8);
+    }
+
+    Format                m_f;
+    std::vector<uint8_t>& m_buf;
+};
+
+// Writes the body while interning strings, then the document around it.
+// Views point into the caller's structs, which outlive the encoder.
+class Encoder {
+public:
+    explicit Encoder(Format f) : m_f(f), m_body(f, m_bodyBytes) {}
+
+    Out& body() { return m_body; }
+    void s(std::string_view v)
+    {
+        auto [it, inserted] = m_ids.try_emplace(v, static_cast<uint32_t>(m_strings.size()));
+        if (inserted) m_strings.push_back(v);
+        m_body.number(it->second);
+    }
+
+    template <size_t N>
+    std::vector<uint8_t> finish(const char* shape, const char* const (&keys)[N])
+    {
+        std::vector<uint8_t> doc;
+        size_t strings = 0;
+        for (std::string_view v : m_strings) strings += v.size() + 5;
+        doc.reserve(64 + N * 16 + strings + m_bodyBytes.size());
+        Out out(m_f, doc);
+        out.array(6);
+        out.str(kMagic);
+        out.number(kVersion);
+        out.str(shape);
+        out.array(N);
+        for (const char* k : keys) out.str(k);
+        out.array(m_strings.size());
+        for (std::string_view v : m_strings) out.str(v);
+        doc.insert(doc.end(), m_bodyBytes.begin(), m_bodyBytes.end());
+        return doc;
+    }
+
+private:
+    Format                                         m_f;
+    std::vector<uint8_t>                           m_bodyBytes;
+    Out                                            m_body;
+    std::unordered_map<std::string_view, uint32_t> m_ids;
+    std::vector<std::string_view>                  m_strings;
+};
+
+void record(Encoder& e, const InstalledPackage& p)
+{
+    e.body().array(std::size(kPackageKeys));
+    for (const std::string* v : {&p.name, &p.displayName, &p.version, &p.description, &p.type,
+                                 &p.category, &p.author, &p.license, &p.icon, &p.view})
+        e.s(*v);
+    e.body().array(p.dependencies.size());
+    for (const auto& d : p.dependencies) e.s(d);
+    e.s(p.hashes.root);
+    e.s(installTypeToString(p.installType));
+    e.s(p.installDir);
+    e.s(p.mainFilePath);
+}
+
+// Mirrors conversions::toFlatLogosMap; `children` < 0 writes no children
+// column (the flat lists), otherwise that many children follow.
+void record(Encoder& e, const DependencyTreeNode& n, int64_t children)
+{
+    e.body().array(std::size(kDependencyKeys) + (children >= 0));
+    e.s(n.name);
+    e.s(dependencyStatusToString(n.status));
+    const bool installed = n.status == DependencyStatus::Installed;
+    e.s(installed ? std::string_view(n.version) : std::string_view());
+    e.s(installed ? installTypeToString(n.installType) : "");
+    if (children >= 0) e.body().array(static_cast<uint64_t>(children));
+}
+
+void record(Encoder& e, const DependentTreeNode& n, int64_t children)
+{
+    e.body().array(std::size(kDependentKeys) + (children >= 0));
+    e.s(n.name);
+    e.s(n.version);
+    e.s(n.type);
+    e.s(installTypeToString(n.installType));
+    e.s(n.installDir);
+    if (children >= 0) e.body().array(static_cast<uint64_t>(children));
+}
+
+template <typename Node>
+void tree(Encoder& e, const Node& n, int maxDepth)
+{
+    const bool descend = maxDepth > 0;
+    record(e, n, descend ? static_cast<int64_t>(n.children.size()) : 0);
+    if (!descend) return;
+    for (const auto& c : n.children) tree(e, c, maxDepth - 1);
+}
+
+template <typename Node, size_t N>
+std::vector<uint8_t> encodeTreeOf(const Node* root, int maxDepth, Format f, const char* shape,
+                                  const char* const (&keys)[N])
+{
+    Encoder e(f);
+    if (root) tree(e, *root, maxDepth);
+    else e.body().nil();
+    return e.finish(shape, keys);
+}
+
+template <typename Node, size_t N>
+std::vector<uint8_t> encodeListOf(const std::vector<Node>& nodes, Format f, const char* shape,
+                                  const char* const (&keys)[N])
+{
+    Encoder e(f);
+    e.body().array(nodes.size());
+    for (const auto& n : nodes) record(e, n, -1);
+    return e.finish(shape, keys);
+}
+
+// Reads the four kinds of item the encoder writes, straight from the
+// bytes; every read is bounds-checked and a failed one sticks.
+class In {
+public:
+    In(const std::vector<uint8_t>& data, Format f) : m_p(data.data()), m_end(data.data() + data.size()), m_f(f) {}
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_p == m_end; }
+
+    uint64_t array() { return head(4, 0x90, 16, 0xdc, 0xdd); }
+    uint64_t number()
+    {
+        if (m_f == Format::Cbor) return head(0, 0, 0, 0, 0);
+        const uint8_t b = byte();
+        if (b < 0x80) return b;
+        switch (b) {
+        case 0xcc: return be(1);
+        case 0xcd: return be(2);
+        case 0xce: return be(4);
+        case 0xcf: return be(8);
+        default: return fail();
+        }
+    }
+    std::string_view str()
+    {
+        uint64_t n = 0;
+        if (m_f == Format::Cbor) {
+            n = head(3, 0, 0, 0, 0);
+        } else {
+            const uint8_t b = byte();
+            if ((b & 0xe0) == 0xa0) n = b & 0x1f;
+            else if (b == 0xd9) n = be(1);
+            else if (b == 0xda) n = be(2);
+            else if (b == 0xdb) n = be(4);
+            else fail();
+        }
+        if (!need(n)) return std::string_view();
+        const std::string_view s(reinterpret_cast<const char*>(m_p), n);
+        m_p += n;
+        return s;
+    }
+    bool nil()
+    {
+        if (!need(1) || *m_p != (m_f == Format::Cbor ? 0xf6 : 0xc0)) return false;
+        ++m_p;
+        return true;
+    }
+
+private:
+    bool need(uint64_t n)
+    {
+        if (!m_ok || static_cast<uint64_t>(m_end - m_p) < n) m_ok = false;
+        return m_ok;
+    }
+    uint64_t fail()
+    {
+        m_ok = false;
+        return 0;
+    }
+    uint8_t byte() { return need(1) ? *m_p++ : 0; }
+    uint64_t be(int bytes)
+    {
+        if (!need(bytes)) return 0;
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) v = (v << 8) | *m_p++;
+        return v;
+    }
+    // A CBOR head of `major`, or a MessagePack length with a fix form
+    // below `fixLimit` (fixLimit 0: none) and 16- / 32-bit forms.
+    uint64_t head(uint8_t major, uint8_t fix, uint64_t fixLimit, uint8_t b16, uint8_t b32)
+    {
+        const uint8_t b = byte();
+        if (!m_ok) return 0;
+        if (m_f == Format::Cbor) {
+            if (b >> 5 != major) return fail();
+            const uint8_t info = b & 0x1f;
+            if (info < 24) return info;
+            if (info > 27) return fail();  // indefinite lengths are never written
+            return be(1 << (info - 24));
+        }
+        if (fixLimit && b >= fix && b < fix + fixLimit) return b - fix;
+        if (b == b16) return be(2);
+        if (b == b32) return be(4);
+        return fail();
+    }
+
+    const uint8_t* m_p;
+    const uint8_t* m_end;
+    Format         m_f;
+    bool           m_ok = true;
+};
+
+// Rebuilds the LogosMap / LogosList the plain slots return.
+class Decoder {
+public:
+    // Deeper trees than this are rejected rather than recursed into.
+    static constexpr int kMaxDepth = 10000;
+
+    explicit Decoder(In& in) : m_in(in) {}
+
+    bool header(std::string& shape)
+    {
+        if (m_in.array() != 6 || m_in.str() != kMagic || m_in.number() != kVersion) return false;
+        shape = std::string(m_in.str());
+        const uint64_t keys = m_in.array();
+        for (uint64_t i = 0; i < keys && m_in.ok(); ++i) {
+            const std::string_view k = m_in.str();
+            m_keys.emplace_back(k);
+            m_kinds.push_back(k == "children" ? Children : k == "dependencies" ? Dependencies
+                              : k == "hashes" ? HashRoot : Plain);
+        }
+        const uint64_t strings = m_in.array();
+        for (uint64_t i = 0; i < strings && m_in.ok(); ++i) m_strings.push_back(m_in.str());
+        return m_in.ok();
+    }
+
+    bool record(LogosMap& out, int depth = 0)
+    {
+        if (m_in.array() != m_keys.size() || depth > kMaxDepth) return false;
+        out = LogosMap::object();
+        for (size_t i = 0; i < m_keys.size() && m_in.ok(); ++i) {
+            LogosMap& v = out[m_keys[i]];
+            switch (m_kinds[i]) {
+            case Plain:
+                if (!string(v)) return false;
+                break;
+            case HashRoot:
+                v = LogosMap::object();
+                if (!string(v["root"])) return false;
+                break;
+            case Dependencies:
+            case Children: {
+                v = LogosList::array();
+                const uint64_t n = m_in.array();
+                for (uint64_t k = 0; k < n && m_in.ok(); ++k) {
+                    LogosMap item;
+                    if (!(m_kinds[i] == Children ? record(item, depth + 1) : string(item))) return false;
+                    v.push_back(std::move(item));
+                }
+                break;
+            }
+            }
+        }
+        return m_in.ok();
+    }
+
+private:
+    enum Kind { Plain, Dependencies, HashRoot, Children };
+
+    bool string(LogosMap& out)
+    {
+        const uint64_t id = m_in.number();
+        if (!m_in.ok() || id >= m_strings.size()) return false;
+        out = std::string(m_strings[id]);
+        return true;
+    }
+
+    In&                           m_in;
+    std::vector<std::string>      m_keys;
+    std::vector<Kind>             m_kinds;
+    std::vector<std::string_view> m_strings;
+};
+
+} // namespace
+
+bool parseFormat(const std::string& name, Format& out)
+{
+    if (name == "msgpack") out = Format::MessagePack;
+    else if (name == "cbor") out = Format::Cbor;
+    else return false;
+    return true;
+}
+
+const char* formatName(Format f)
+{
+    return f == Format::Cbor ? "cbor" : "msgpack";
+}
+
+std::vector<uint8_t> encode(const std::vector<InstalledPackage>& packages, Format f)
+{
+    Encoder e(f);
+    e.body().array(packages.size());
+    for (const auto& p : packages) record(e, p);
+    return e.finish("packages", kPackageKeys);
+}
+
+std::vector<uint8_t> encodeTree(const DependencyTreeNode* root, int maxDepth, Format f)
+{
+    const char* const keys[] = {"name", "status", "version", "installType", "children"};
+    return encodeTreeOf(root, maxDepth, f, "dependencyTree", keys);
+}
+
+std::vector<uint8_t> encodeTree(const DependentTreeNode* root, int maxDepth, Format f)
+{
+    const char* const keys[] = {"name", "version", "type", "installType", "installDir", "children"};
+    return encodeTreeOf(root, maxDepth, f, "dependentTree", keys);
+}
+
+std::vector<uint8_t> encodeList(const std::vector<DependencyTreeNode>& nodes, Format f)
+{
+    return encodeListOf(nodes, f, "dependencyList", kDependencyKeys);
+}
+
+std::vector<uint8_t> encodeList(const std::vector<DependentTreeNode>& nodes, Format f)
+{
+    return encodeListOf(nodes, f, "dependentList", kDependentKeys);
+}
+
+bool decode(const std::vector<uint8_t>& data, Format f, LogosMap& out, std::string& error)
+{
+    In in(data, f);
+    Decoder decoder(in);
+    std::string shape;
+    if (!decoder.header(shape)) {
+        error = std::string("Not a packed query result of this version in ") + formatName(f);
+        return false;
+    }
+    LogosMap result;
+    bool ok = true;
+    if (shape == "dependencyTree" || shape == "dependentTree") {
+        if (in.nil()) result = LogosMap::object();
+        else ok = decoder.record(result);
+    } else {
+        result = LogosList::array();
+        const uint64_t n = in.array();
+        for (uint64_t i = 0; i < n && ok; ++i) {
+            LogosMap m;
+            ok = decoder.record(m);
+            result.push_back(std::move(m));
+        }
+    }
+    if (!ok || !in.ok() || !in.atEnd()) {
+        error = "Malformed " + shape + " document";
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
+
+std::string toBase64(const std::vector<uint8_t>& data)
+{
+    static constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 3 <= data.size(); i += 3) {
+        const uint32_t v = uint32_t(data[i]) << 16 | uint32_t(data[i + 1]) << 8 | data[i + 2];
+        out += kAlphabet[v >> 18];
+        out += kAlphabet[(v >> 12) & 63];
+        out += kAlphabet[(v >> 6) & 63];
+        out += kAlphabet[v & 63];
+    }
+    if (i < data.size()) {
+        const bool two = i + 1 < data.size();
+        const uint32_t v = uint32_t(data[i]) << 16 | (two ? uint32_t(data[i + 1]) << 8 : 0);
+        out += kAlphabet[v >> 18];
+        out += kAlphabet[(v >> 12) & 63];
+        out += two ? kAlphabet[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+bool fromBase64(std::string_view text, std::vector<uint8_t>& out)
+{
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+    if (text.size() % 4) return false;
+    out.clear();
+    out.reserve(text.size() / 4 * 3);
+    for (size_t i = 0; i < text.size(); i += 4) {
+        const bool last = i + 4 == text.size();
+        const int pad = last ? (text[i + 3] == '=') + (text[i + 2] == '=') : 0;
+        if (pad == 1 && text[i + 2] == '=') return false;
+        uint32_t v = 0;
+        for (size_t k = 0; k < 4; ++k) {
+            const int d = k < 4u - pad ? value(text[i + k]) : 0;
+            if (d < 0) return false;
+            v = v << 6 | static_cast<uint32_t>(d);
+        }
+        out.push_back(static_cast<uint8_t>(v >> 16));
+        if (pad < 2) out.push_back(static_cast<uint8_t>(v >> 8));
+        if (pad < 1) out.push_back(static_cast<uint8_t>(v));
+    }
+    return true;
+}
+
+} // namespace packed
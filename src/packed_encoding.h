@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <logos_json.h>
+
+struct InstalledPackage;
+struct DependencyTreeNode;
+struct DependentTreeNode;
+
+// ---------------------------------------------------------------------------
+// Compact binary encoding of the large query results
+// ---------------------------------------------------------------------------
+//
+// Given an `encoding`, the query slots return their result as one
+// MessagePack or CBOR blob instead of a LogosList / LogosMap tree, encoded
+// straight from the library's structs. Field names are not repeated per
+// record, and every string is written once into a table and referenced by
+// index, so installType, type, versions and dependency names shared by many
+// records cost a byte or two each.
+//
+// Document (one array, in either format):
+//   [ "lpmpack", 1, shape, keys, strings, body ]
+//   shape    "packages" | "dependencyTree" | "dependentTree"
+//            | "dependencyList" | "dependentList"
+//   keys     field names, in the order each record lists its values
+//   strings  the string table
+//   body     an array of records (packages, *List), one record (*Tree),
+//            or nil when the tree's root is unknown
+// A record is an array of values in `keys` order. Every string value is an
+// unsigned index into `strings` (the results carry no numbers), a
+// "dependencies" value is an array of such indexes, "hashes" is the index
+// of hashes.root, and "children" is an array of records.
+//
+// decode() rebuilds exactly what the plain slot returns, for callers that
+// want the familiar shape; any MessagePack / CBOR library reads the
+// document directly.
+//
+// The slots return the document base64-encoded: a LogosMap binary value
+// has no JSON form, and serialised as JSON it becomes an array of numbers
+// several times the size of the plain result.
+// ---------------------------------------------------------------------------
+
+namespace packed {
+
+enum class Format { MessagePack, Cbor };
+
+// "msgpack" or "cbor".
+bool parseFormat(const std::string& name, Format& out);
+const char* formatName(Format f);
+
+std::vector<uint8_t> encode(const std::vector<InstalledPackage>& packages, Format f);
+// Depth-clipped like conversions::toLogosTreeMap; null encodes an unknown root.
+std::vector<uint8_t> encodeTree(const DependencyTreeNode* root, int maxDepth, Format f);
+std::vector<uint8_t> encodeTree(const DependentTreeNode* root, int maxDepth, Format f);
+std::vector<uint8_t> encodeList(const std::vector<DependencyTreeNode>& nodes, Format f);
+std::vector<uint8_t> encodeList(const std::vector<DependentTreeNode>& nodes, Format f);
+
+bool decode(const std::vector<uint8_t>& data, Format f, LogosMap& out, std::string& error);
+
+// Standard alphabet, padded. fromBase64 rejects anything else.
+std::string toBase64(const std::vector<uint8_t>& data);
+bool fromBase64(std::string_view text, std::vector<uint8_t>& out);
+
+} // namespace packed
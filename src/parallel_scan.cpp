@@ -0,0 +1,97 @@
+#include "parallel_scan.h"
+#include "worker_pool.h"
+#include <package_manager_lib.h>
+
+#include <filesystem>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace parallelscan {
+
+namespace {
+
+// Lexically normal, without a trailing separator.
+fs::path normal(const std::string& path)
+{
+    fs::path p = fs::path(path).lexically_normal();
+    if (!p.has_filename() && p.has_parent_path() && p != p.root_path()) p = p.parent_path();
+    return p;
+}
+
+bool readAhead(const fs::path& manifest)
+{
+    const int fd = ::open(manifest.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = ::fstat(fd, &st) == 0;
+    if (ok) {
+#if defined(__linux__)
+        // Blocks until the pages are queued, so the library's read that
+        // follows finds them cached or in flight.
+        ok = ::readahead(fd, 0, static_cast<size_t>(st.st_size)) == 0;
+#elif defined(POSIX_FADV_WILLNEED)
+        ok = ::posix_fadvise(fd, 0, st.st_size, POSIX_FADV_WILLNEED) == 0;
+#endif
+    }
+    ::close(fd);
+    return ok;
+}
+
+} // namespace
+
+uint64_t prefetchManifests(const std::string& dir, WorkerPool* pool, size_t fanOut)
+{
+    std::vector<fs::path> manifests;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code typeEc;
+        if (it->is_directory(typeEc)) manifests.push_back(it->path() / "manifest.json");
+    }
+    std::vector<char> done(manifests.size(), 0);
+    auto one = [&](size_t i) { done[i] = readAhead(manifests[i]); };
+    if (pool && manifests.size() >= fanOut) {
+        pool->parallelFor(manifests.size(), one);
+    } else {
+        for (size_t i = 0; i < manifests.size(); ++i) one(i);
+    }
+    uint64_t count = 0;
+    for (char d : done) count += d;
+    return count;
+}
+
+bool belongsTo(const InstalledPackage& package, const Directory& directory)
+{
+    return package.installType == directory.installType
+        && normal(package.installDir).parent_path() == normal(directory.path);
+}
+
+std::vector<InstalledPackage> scan(const std::vector<Directory>& directories, const ScanFn& scanOne,
+                                   WorkerPool& pool, size_t fanOut, Stats& stats)
+{
+    std::vector<std::vector<InstalledPackage>> found(directories.size());
+    std::vector<uint64_t> prefetched(directories.size(), 0);
+    pool.parallelFor(directories.size(), [&](size_t i) {
+        if (fanOut) prefetched[i] = prefetchManifests(directories[i].path, &pool, fanOut);
+        for (auto& p : scanOne(i)) {
+            if (belongsTo(p, directories[i])) found[i].push_back(std::move(p));
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& f : found) total += f.size();
+    std::vector<InstalledPackage> out;
+    out.reserve(total);
+    for (size_t i = 0; i < directories.size(); ++i) {
+        for (auto& p : found[i]) out.push_back(std::move(p));
+        stats.prefetched += prefetched[i];
+    }
+    stats.directories += directories.size();
+    return out;
+}
+
+} // namespace parallelscan
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+struct InstalledPackage;
+enum class InstallType;
+
+// ---------------------------------------------------------------------------
+// Scanning the package directories in parallel
+// ---------------------------------------------------------------------------
+//
+// A library scan visits every configured directory in turn, and each visit
+// is a readdir, a stat and a small manifest.json read per package. On cold
+// or network-backed storage those are round trips, not bandwidth, so the
+// module scans the directories side by side instead: one job per directory,
+// run on the shared WorkerPool, each handing its directory to a scan
+// function (PackageManagerImpl passes a library instance configured with
+// that directory alone).
+//
+// The library reads a directory's manifests itself, one after another, so
+// per-package parallelism comes from readahead: before a directory with at
+// least `fanOut` package subdirectories is scanned, its manifests are
+// opened and read ahead across the pool, and the library's reads then hit
+// the page cache. readahead(2) on Linux; posix_fadvise(WILLNEED) elsewhere.
+//
+// Results are merged in directory order — embedded modules, embedded UI
+// plugins, user modules, user UI plugins, each in configuration order, the
+// order the library reports them in — whatever order the jobs finish in.
+// A job keeps only the packages installed directly under its directory
+// with the directory's install type, so whatever else a fresh library
+// instance reports (built-in defaults) is not counted twice.
+// ---------------------------------------------------------------------------
+
+namespace parallelscan {
+
+struct Directory {
+    std::string path;
+    bool        uiPlugins = false;
+    InstallType installType;
+};
+
+struct Stats {
+    size_t   directories = 0;
+    uint64_t prefetched = 0;  // manifests read ahead
+};
+
+using ScanFn = std::function<std::vector<InstalledPackage>(size_t directory)>;
+
+// Scans `directories` through `scan` on `pool` and merges the results in
+// directory order. fanOut 0 skips the readahead, for scan functions that
+// read the manifests across the pool themselves.
+std::vector<InstalledPackage> scan(const std::vector<Directory>& directories, const ScanFn& scan,
+                                   WorkerPool& pool, size_t fanOut, Stats& stats);
+
+// Reads ahead <dir>/<package>/manifest.json for every package subdirectory
+// of `dir`, across `pool` when there are at least `fanOut` of them. Returns
+// how many manifests were read ahead; a missing directory reads none.
+uint64_t prefetchManifests(const std::string& dir, WorkerPool* pool, size_t fanOut);
+
+// Whether `package` was installed directly under `directory`.
+bool belongsTo(const InstalledPackage& package, const Directory& directory);
+
+} // namespace parallelscan
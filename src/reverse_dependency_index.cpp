@@ -0,0 +1,97 @@
+#include "reverse_dependency_index.h"
+#include "memory_stats.h"
+
+#include <algorithm>
+
+bool ReverseDependencyIndex::upsert(std::string_view package, const std::vector<std::string_view>& dependencies)
+{
+    std::vector<std::string> next(dependencies.begin(), dependencies.end());
+    std::sort(next.begin(), next.end());
+    next.erase(std::unique(next.begin(), next.end()), next.end());
+
+    auto [it, inserted] = m_packages.try_emplace(std::string(package));
+    Package& p = it->second;
+    p.seen = true;
+    if (!inserted && p.dependencies == next) return false;
+
+    // Both lists are sorted: walk them together and touch only the edges
+    // that differ.
+    const std::string& name = it->first;
+    auto before = p.dependencies.begin();
+    auto after = next.begin();
+    while (before != p.dependencies.end() || after != next.end()) {
+        if (after == next.end() || (before != p.dependencies.end() && *before < *after)) {
+            unlink(*before++, name);
+        } else if (before == p.dependencies.end() || *after < *before) {
+            link(*after++, name);
+        } else {
+            ++before;
+            ++after;
+        }
+    }
+    p.dependencies = std::move(next);
+    return true;
+}
+
+bool ReverseDependencyIndex::remove(std::string_view package)
+{
+    auto it = m_packages.find(std::string(package));
+    if (it == m_packages.end()) return false;
+    for (const auto& d : it->second.dependencies) unlink(d, it->first);
+    m_packages.erase(it);
+    return true;
+}
+
+void ReverseDependencyIndex::beginSync()
+{
+    for (auto& kv : m_packages) kv.second.seen = false;
+}
+
+size_t ReverseDependencyIndex::endSync()
+{
+    std::vector<std::string> gone;
+    for (const auto& kv : m_packages) {
+        if (!kv.second.seen) gone.push_back(kv.first);
+    }
+    for (const auto& name : gone) remove(name);
+    return gone.size();
+}
+
+const std::vector<std::string>& ReverseDependencyIndex::dependents(std::string_view dependency) const
+{
+    static const std::vector<std::string> kNone;
+    auto it = m_dependents.find(std::string(dependency));
+    return it == m_dependents.end() ? kNone : it->second;
+}
+
+void ReverseDependencyIndex::link(const std::string& dependency, const std::string& package)
+{
+    auto& list = m_dependents[dependency];
+    list.insert(std::lower_bound(list.begin(), list.end(), package), package);
+    ++m_edges;
+}
+
+void ReverseDependencyIndex::unlink(const std::string& dependency, const std::string& package)
+{
+    auto it = m_dependents.find(dependency);
+    if (it == m_dependents.end()) return;
+    auto& list = it->second;
+    auto pos = std::lower_bound(list.begin(), list.end(), package);
+    if (pos == list.end() || *pos != package) return;
+    list.erase(pos);
+    --m_edges;
+    if (list.empty()) m_dependents.erase(it);
+}
+
+size_t ReverseDependencyIndex::memoryBytes() const
+{
+    // Hash nodes: value plus next pointer and cached hash; and bucket arrays.
+    size_t bytes = (m_packages.bucket_count() + m_dependents.bucket_count()) * sizeof(void*);
+    for (const auto& kv : m_packages) {
+        bytes += sizeof(kv) + 2 * sizeof(void*) + memstats::heapBytes(kv.first)
+               + memstats::heapBytes(kv.second.dependencies);
+    }
+    for (const auto& kv : m_dependents)
+        bytes += sizeof(kv) + 2 * sizeof(void*) + memstats::heapBytes(kv.first) + memstats::heapBytes(kv.second);
+    return bytes;
+}
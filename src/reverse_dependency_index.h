@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Reverse dependency adjacency of the installed set
+// ---------------------------------------------------------------------------
+//
+// Maps each dependency name to the installed packages that list it, so
+// "who depends on X" is one lookup instead of a pass over every manifest.
+//
+// Packages are keyed by name and updated incrementally, like TrigramIndex:
+// upsert() compares a package's dependency list with the one it last saw
+// and only touches the edges that appeared or disappeared, and remove()
+// drops a package's own edges. The module syncs it from each rebuild of
+// the installed index (beginSync / upsert / endSync), so an install or
+// uninstall rewrites only the affected package's edges.
+//
+// Dependents lists are kept sorted by name, so lookups are deterministic
+// whatever order the updates arrived in.
+//
+// Not synchronised; the module updates and queries it on the module thread.
+// ---------------------------------------------------------------------------
+
+class ReverseDependencyIndex {
+public:
+    // Sets `package`'s dependencies (duplicates ignored). Returns false when
+    // they were already exactly these.
+    bool upsert(std::string_view package, const std::vector<std::string_view>& dependencies);
+    bool remove(std::string_view package);
+    // Mark-and-sweep refresh from a full listing: beginSync(), upsert()
+    // every current package, then endSync() removes the rest and returns
+    // how many it removed.
+    void beginSync();
+    size_t endSync();
+
+    // Packages that list `dependency`, sorted by name (empty when none).
+    const std::vector<std::string>& dependents(std::string_view dependency) const;
+
+    size_t packages() const { return m_packages.size(); }
+    size_t edges() const { return m_edges; }
+    size_t memoryBytes() const;
+
+private:
+    struct Package {
+        std::vector<std::string> dependencies;  // sorted, unique
+        bool                     seen = false;  // upserted since beginSync()
+    };
+
+    void link(const std::string& dependency, const std::string& package);
+    void unlink(const std::string& dependency, const std::string& package);
+
+    std::unordered_map<std::string, Package> m_packages;
+    std::unordered_map<std::string, std::vector<std::string>> m_dependents;
+    size_t m_edges = 0;
+};
@@ -0,0 +1,191 @@
+#include "semver.h"
+
+namespace semver {
+
+namespace {
+
+struct Parsed {
+    bool             valid = false;
+    uint64_t         part[3] = {};
+    std::string_view pre;  // empty for a release
+};
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool allDigits(std::string_view s)
+{
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!isDigit(c)) return false;
+    }
+    return true;
+}
+
+bool isIdentifierChar(char c)
+{
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-';
+}
+
+std::string_view stripZeros(std::string_view s)
+{
+    while (s.size() > 1 && s.front() == '0') s.remove_prefix(1);
+    return s;
+}
+
+// Splits off the next '.'-separated field of `rest`.
+std::string_view nextField(std::string_view& rest)
+{
+    const size_t dot = rest.find('.');
+    const std::string_view field = rest.substr(0, dot);
+    rest = dot == std::string_view::npos ? std::string_view() : rest.substr(dot + 1);
+    return field;
+}
+
+Parsed parse(std::string_view v)
+{
+    Parsed p;
+    const size_t plus = v.find('+');
+    if (plus != std::string_view::npos) v = v.substr(0, plus);
+    if (!v.empty() && (v.front() == 'v' || v.front() == 'V')) v.remove_prefix(1);
+
+    const size_t dash = v.find('-');
+    std::string_view core = v.substr(0, dash);
+    if (dash != std::string_view::npos) {
+        p.pre = v.substr(dash + 1);
+        if (p.pre.empty()) return p;
+        for (std::string_view rest = p.pre; !rest.empty();) {
+            const std::string_view id = nextField(rest);
+            if (id.empty()) return p;
+            for (char c : id) {
+                if (!isIdentifierChar(c)) return p;
+            }
+        }
+        if (p.pre.back() == '.') return p;
+    }
+
+    if (core.empty() || core.back() == '.') return p;
+    int count = 0;
+    while (!core.empty()) {
+        const std::string_view field = nextField(core);
+        // 18 digits always fits in 64 bits.
+        if (count == 3 || !allDigits(field) || stripZeros(field).size() > 18) return p;
+        uint64_t n = 0;
+        for (char c : field) n = n * 10 + static_cast<uint64_t>(c - '0');
+        p.part[count++] = n;
+    }
+    p.valid = true;
+    return p;
+}
+
+int compareIdentifiers(std::string_view a, std::string_view b)
+{
+    const bool numA = allDigits(a);
+    const bool numB = allDigits(b);
+    if (numA && numB) {
+        a = stripZeros(a);
+        b = stripZeros(b);
+        if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+        return a.compare(b);
+    }
+    if (numA != numB) return numA ? -1 : 1;
+    return a.compare(b);
+}
+
+int comparePrereleases(std::string_view a, std::string_view b)
+{
+    if (a.empty() || b.empty()) return a.empty() - b.empty();  // release > prerelease
+    while (!a.empty() && !b.empty()) {
+        const int c = compareIdentifiers(nextField(a), nextField(b));
+        if (c != 0) return c;
+    }
+    return !a.empty() - !b.empty();
+}
+
+int sign(int c) { return (c > 0) - (c < 0); }
+
+} // namespace
+
+bool valid(std::string_view version)
+{
+    return parse(version).valid;
+}
+
+int compare(std::string_view a, std::string_view b)
+{
+    const Parsed pa = parse(a);
+    const Parsed pb = parse(b);
+    if (!pa.valid || !pb.valid) {
+        if (pa.valid != pb.valid) return pa.valid ? 1 : -1;
+        return sign(a.compare(b));
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (pa.part[i] != pb.part[i]) return pa.part[i] < pb.part[i] ? -1 : 1;
+    }
+    return sign(comparePrereleases(pa.pre, pb.pre));
+}
+
+Key key(std::string_view version)
+{
+    Key k;
+    const Parsed p = parse(version);
+    if (!p.valid) return k;
+    constexpr uint64_t kPartMax = (uint64_t(1) << 21) - 1;
+    if (p.part[0] > kPartMax || p.part[1] > kPartMax || p.part[2] > kPartMax) return k;
+    k.core = p.part[0] << 42 | p.part[1] << 21 | p.part[2];
+
+    if (p.pre.empty()) {
+        k.pre[0] = k.pre[1] = UINT64_MAX;
+        k.exact = true;
+        return k;
+    }
+
+    // Identifiers as bytes whose memcmp order is their precedence order:
+    //   end of list       0x00 (trailing padding; shorter lists sort first)
+    //   numeric < 256     0x02 n
+    //   numeric < 65536   0x03 hi lo
+    //   alphanumeric      its characters (all >= '-'), then 0x01
+    unsigned char bytes[16] = {};
+    size_t n = 0;
+    auto put = [&](unsigned char b) {
+        if (n == sizeof(bytes)) return false;
+        bytes[n++] = b;
+        return true;
+    };
+    for (std::string_view rest = p.pre; !rest.empty();) {
+        const std::string_view id = nextField(rest);
+        if (allDigits(id)) {
+            const std::string_view digits = stripZeros(id);
+            if (digits.size() > 5) return k;
+            uint32_t v = 0;
+            for (char c : digits) v = v * 10 + static_cast<uint32_t>(c - '0');
+            if (v > 0xffff) return k;
+            const bool ok = v < 256 ? put(0x02) && put(static_cast<unsigned char>(v))
+                                    : put(0x03) && put(static_cast<unsigned char>(v >> 8))
+                                          && put(static_cast<unsigned char>(v & 0xff));
+            if (!ok) return k;
+        } else {
+            for (char c : id) {
+                if (!put(static_cast<unsigned char>(c))) return k;
+            }
+            if (!put(0x01)) return k;
+        }
+    }
+    for (int w = 0; w < 2; ++w) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; ++i) word = word << 8 | bytes[w * 8 + i];
+        k.pre[w] = word;
+    }
+    k.exact = true;
+    return k;
+}
+
+int compare(const Key& ka, std::string_view a, const Key& kb, std::string_view b)
+{
+    if (!ka.exact || !kb.exact) return compare(a, b);
+    if (ka.core != kb.core) return ka.core < kb.core ? -1 : 1;
+    if (ka.pre[0] != kb.pre[0]) return ka.pre[0] < kb.pre[0] ? -1 : 1;
+    if (ka.pre[1] != kb.pre[1]) return ka.pre[1] < kb.pre[1] ? -1 : 1;
+    return 0;
+}
+
+} // namespace semver
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// ---------------------------------------------------------------------------
+// Semantic version ordering
+// ---------------------------------------------------------------------------
+//
+// Versions follow semver 2.0 precedence: major.minor.patch compared
+// numerically, a prerelease ("-rc.1") sorts below its release, prerelease
+// identifiers compare numerically when all digits and as ASCII otherwise,
+// numeric identifiers sort below alphanumeric ones, and a shorter list of
+// identifiers sorts below a longer one it prefixes. Build metadata ("+...")
+// is ignored. Manifests in the wild are accepted leniently: a leading "v"
+// and missing minor / patch components ("1.2" == "1.2.0") are allowed.
+// Anything else is invalid; invalid versions sort below every valid one and
+// among themselves as plain strings.
+//
+// key() packs a version into three integers whose lexicographic order is
+// the precedence order, so comparing two parsed versions is at most three
+// integer compares. Components above 2^21 - 1, numeric prerelease
+// identifiers above 65535, and prereleases longer than 16 encoded bytes do
+// not fit; their key is marked inexact and compare() falls back to parsing
+// the strings.
+// ---------------------------------------------------------------------------
+
+namespace semver {
+
+struct Key {
+    uint64_t core = 0;    // major << 42 | minor << 21 | patch
+    uint64_t pre[2] = {}; // order-preserving prerelease bytes; all ones for a release
+    bool     exact = false;
+};
+
+Key key(std::string_view version);
+
+bool valid(std::string_view version);
+
+// <0, 0 or >0 as a has lower, equal or higher precedence than b.
+int compare(std::string_view a, std::string_view b);
+
+// Same, from keys made by key(a) and key(b); parses the strings only when
+// either key is inexact.
+int compare(const Key& ka, std::string_view a, const Key& kb, std::string_view b);
+
+} // namespace semver
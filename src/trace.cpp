@@ -0,0 +1,132 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <unistd.h>
+
+namespace trace {
+
+namespace {
+
+// Small, stable per-thread ids read better in the timeline than hashed
+// std::thread::id values.
+uint32_t currentTid()
+{
+    static std::atomic<uint32_t> nextTid{0};
+    thread_local const uint32_t tid = ++nextTid;
+    return tid;
+}
+
+void appendJsonString(std::string& out, const char* s)
+{
+    out += '"';
+    for (const char* p = s ? s : ""; *p; ++p) {
+        const char c = *p;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+Recorder::Recorder()
+    : m_epoch(std::chrono::steady_clock::now())
+{
+}
+
+Recorder::~Recorder() = default;
+
+void Recorder::enable(size_t capacity)
+{
+    if (!m_slots) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_slots.reset(new Slot[cap]);
+        m_capacity = cap;
+    }
+    m_start.store(m_next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // Release: a writer that observes enabled also observes m_slots.
+    m_enabled.store(true, std::memory_order_release);
+}
+
+void Recorder::disable()
+{
+    m_enabled.store(false, std::memory_order_release);
+}
+
+uint64_t Recorder::nowNs() const
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_epoch).count());
+}
+
+void Recorder::record(const char* name, const char* category, uint64_t startNs, uint64_t endNs)
+{
+    // A span that began while enabled may end after disable(); the ring is
+    // never freed before the recorder, so recording it is still safe.
+    if (!m_slots) return;
+    const uint64_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = m_slots[index & (m_capacity - 1)];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.durNs.store(endNs >= startNs ? endNs - startNs : 0, std::memory_order_relaxed);
+    slot.tid.store(currentTid(), std::memory_order_relaxed);
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+}
+
+uint64_t Recorder::recordedCount() const
+{
+    return m_next.load(std::memory_order_relaxed) - m_start.load(std::memory_order_relaxed);
+}
+
+std::string Recorder::toChromeJson() const
+{
+    std::string out = "{\"traceEvents\":[";
+    if (m_slots) {
+        const uint64_t end = m_next.load(std::memory_order_acquire);
+        uint64_t begin = m_start.load(std::memory_order_relaxed);
+        if (end - begin > m_capacity) begin = end - m_capacity;
+
+        const long pid = static_cast<long>(::getpid());
+        bool first = true;
+        for (uint64_t index = begin; index < end; ++index) {
+            const Slot& slot = m_slots[index & (m_capacity - 1)];
+            const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != 2 * index + 2) continue;  // still being written, or already overwritten
+            const char* name = slot.name.load(std::memory_order_relaxed);
+            const char* category = slot.category.load(std::memory_order_relaxed);
+            const uint64_t startNs = slot.startNs.load(std::memory_order_relaxed);
+            const uint64_t durNs = slot.durNs.load(std::memory_order_relaxed);
+            const uint32_t tid = slot.tid.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq) continue;  // torn
+
+            if (!first) out += ',';
+            first = false;
+            char buf[160];
+            out += "{\"name\":";
+            appendJsonString(out, name);
+            out += ",\"cat\":";
+            appendJsonString(out, category);
+            // Chrome trace timestamps are microseconds.
+            std::snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%u}",
+                          startNs / 1000.0, durNs / 1000.0, pid, tid);
+            out += buf;
+        }
+    }
+    out += "],\"displayTimeUnit\":\"ms\"}";
+    return out;
+}
+
+} // namespace trace
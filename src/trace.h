@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// ---------------------------------------------------------------------------
+// Opt-in span recording, dumpable as Chrome trace-event JSON
+// ---------------------------------------------------------------------------
+//
+// A Recorder owns a fixed-size ring of complete ("ph":"X") events. While
+// disabled, a Span costs one relaxed atomic load. While enabled, finishing a
+// Span claims a slot with fetch_add and publishes it through a per-slot
+// sequence number (seqlock style), so writers on any thread never lock and
+// never allocate; when the ring wraps, the oldest events are overwritten.
+//
+// Span names and categories must be string literals (or otherwise outlive
+// the recorder) — only the pointers are stored.
+//
+// toChromeJson() produces {"traceEvents":[...]} that chrome://tracing and
+// Perfetto open directly. Slots still being written while it runs are
+// skipped rather than waited for.
+// ---------------------------------------------------------------------------
+
+namespace trace {
+
+class Recorder {
+public:
+    static constexpr size_t kDefaultCapacity = 1u << 16;
+
+    Recorder();
+    ~Recorder();
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    bool enabled() const { return m_enabled.load(std::memory_order_acquire); }
+
+    // Enabling starts a fresh recording (earlier events are no longer
+    // dumped). The ring is allocated on first enable with `capacity` slots
+    // (rounded up to a power of two) and kept for the recorder's lifetime.
+    void enable(size_t capacity = kDefaultCapacity);
+    void disable();
+
+    uint64_t nowNs() const;
+    void record(const char* name, const char* category, uint64_t startNs, uint64_t endNs);
+
+    std::string toChromeJson() const;
+    // Events recorded since enable(), including those already overwritten.
+    uint64_t recordedCount() const;
+    size_t capacity() const { return m_capacity; }
+    // Heap held by the ring (zero until first enabled).
+    size_t memoryBytes() const { return m_capacity * sizeof(Slot); }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t>    seq{0};  // 2*index+1 while writing, 2*index+2 once published
+        std::atomic<const char*> name{nullptr};
+        std::atomic<const char*> category{nullptr};
+        std::atomic<uint64_t>    startNs{0};
+        std::atomic<uint64_t>    durNs{0};
+        std::atomic<uint32_t>    tid{0};
+    };
+
+    std::atomic<bool>        m_enabled{false};
+    std::atomic<uint64_t>    m_next{0};   // next global event index, never reset
+    std::atomic<uint64_t>    m_start{0};  // first index of the current recording
+    std::unique_ptr<Slot[]>  m_slots;
+    size_t                   m_capacity = 0;
+    std::chrono::steady_clock::time_point m_epoch;
+};
+
+// Records [construction, destruction) as one event when the recorder is
+// enabled at construction time.
+class Span {
+public:
+    Span(Recorder& recorder, const char* name, const char* category)
+        : m_recorder(recorder.enabled() ? &recorder : nullptr)
+        , m_name(name)
+        , m_category(category)
+        , m_startNs(m_recorder ? m_recorder->nowNs() : 0) {}
+    ~Span()
+    {
+        if (m_recorder) m_recorder->record(m_name, m_category, m_startNs, m_recorder->nowNs());
+    }
+    Span(Span&& other) noexcept
+        : m_recorder(other.m_recorder), m_name(other.m_name)
+        , m_category(other.m_category), m_startNs(other.m_startNs) { other.m_recorder = nullptr; }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+    Span& operator=(Span&&) = delete;
+
+private:
+    Recorder*   m_recorder;
+    const char* m_name;
+    const char* m_category;
+    uint64_t    m_startNs;
+};
+
+} // namespace trace
@@ -0,0 +1,291 @@
+#include "trigram_index.h"
+#include "memory_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+enum : uint8_t { FieldName = 1, FieldDisplayName = 2, FieldDescription = 4 };
+
+// Best-field weight for each combination of field bits.
+const uint16_t kFieldWeight[8] = { 0, 3, 2, 3, 1, 3, 2, 3 };
+
+char lowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool isWordByte(char c)
+{
+    // Letters, digits and every non-ASCII byte (so UTF-8 words stay whole).
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || static_cast<unsigned char>(c) >= 0x80;
+}
+
+uint32_t pack(char a, char b, char c)
+{
+    return (static_cast<uint32_t>(static_cast<unsigned char>(a)) << 16)
+         | (static_cast<uint32_t>(static_cast<unsigned char>(b)) << 8)
+         | static_cast<uint32_t>(static_cast<unsigned char>(c));
+}
+
+// Calls fn(trigram) for every trigram of every padded, lower-cased word.
+template <typename Fn>
+void forEachTrigram(std::string_view text, Fn&& fn)
+{
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !isWordByte(text[i])) ++i;
+        const size_t start = i;
+        while (i < text.size() && isWordByte(text[i])) ++i;
+        if (i == start) break;
+        // "  w o r d ": two spaces before, one after.
+        char prev2 = ' ', prev1 = ' ';
+        for (size_t j = start; j < i; ++j) {
+            const char c = lowerAscii(text[j]);
+            fn(pack(prev2, prev1, c));
+            prev2 = prev1;
+            prev1 = c;
+        }
+        fn(pack(prev2, prev1, ' '));
+    }
+}
+
+std::string lowered(std::string_view s)
+{
+    std::string out(s);
+    for (char& c : out) c = lowerAscii(c);
+    return out;
+}
+
+uint64_t fingerprint(std::string_view a, std::string_view b, std::string_view c)
+{
+    // FNV-1a over the three fields with a separator between them.
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](std::string_view s) {
+        for (char ch : s) {
+            h ^= static_cast<unsigned char>(ch);
+            h *= 1099511628211ull;
+        }
+        h ^= 0x1f;
+        h *= 1099511628211ull;
+    };
+    mix(a);
+    mix(b);
+    mix(c);
+    return h;
+}
+
+} // namespace
+
+bool TrigramIndex::upsert(std::string_view key, std::string_view displayName,
+                          std::string_view description)
+{
+    const uint64_t fp = fingerprint(key, displayName, description);
+    auto it = m_byKey.find(std::string(key));
+    if (it != m_byKey.end()) {
+        Doc& doc = m_docs[it->second];
+        doc.seen = true;
+        if (doc.fingerprint == fp) return false;
+        tombstone(it->second);
+        m_byKey.erase(it);
+    }
+
+    const uint32_t id = static_cast<uint32_t>(m_docs.size());
+    Doc doc;
+    doc.key = std::string(key);
+    doc.lowerName = lowered(key);
+    doc.fingerprint = fp;
+    doc.live = true;
+    doc.seen = true;
+    m_docs.push_back(std::move(doc));
+    m_byKey.emplace(std::string(key), id);
+    ++m_live;
+    addPostings(id, key, displayName, description);
+    if (m_dead > m_live / 4 + 64) compact();
+    return true;
+}
+
+bool TrigramIndex::remove(std::string_view key)
+{
+    auto it = m_byKey.find(std::string(key));
+    if (it == m_byKey.end()) return false;
+    tombstone(it->second);
+    m_byKey.erase(it);
+    if (m_dead > m_live / 4 + 64) compact();
+    return true;
+}
+
+void TrigramIndex::beginSync()
+{
+    for (auto& doc : m_docs) doc.seen = false;
+}
+
+size_t TrigramIndex::endSync()
+{
+    std::vector<std::string> gone;
+    for (const auto& doc : m_docs) {
+        if (doc.live && !doc.seen) gone.push_back(doc.key);
+    }
+    for (const auto& key : gone) remove(key);
+    return gone.size();
+}
+
+void TrigramIndex::tombstone(uint32_t doc)
+{
+    m_docs[doc].live = false;
+    --m_live;
+    ++m_dead;
+}
+
+void TrigramIndex::addPostings(uint32_t doc, std::string_view name, std::string_view displayName,
+                               std::string_view description)
+{
+    // Collect (trigram, field) pairs, then merge duplicates so each trigram
+    // gets one posting carrying every field it occurs in.
+    std::vector<std::pair<uint32_t, uint8_t>> grams;
+    grams.reserve(name.size() + displayName.size() + description.size() + 8);
+    forEachTrigram(name, [&](uint32_t g) { grams.emplace_back(g, FieldName); });
+    forEachTrigram(displayName, [&](uint32_t g) { grams.emplace_back(g, FieldDisplayName); });
+    forEachTrigram(description, [&](uint32_t g) { grams.emplace_back(g, FieldDescription); });
+    std::sort(grams.begin(), grams.end());
+    for (size_t i = 0; i < grams.size();) {
+        const uint32_t g = grams[i].first;
+        uint8_t fields = 0;
+        for (; i < grams.size() && grams[i].first == g; ++i) fields |= grams[i].second;
+        m_postings[g].push_back(Posting{doc, fields});
+    }
+}
+
+void TrigramIndex::compact()
+{
+    std::vector<uint32_t> remap(m_docs.size(), UINT32_MAX);
+    std::vector<Doc> docs;
+    docs.reserve(m_live);
+    for (uint32_t i = 0; i < m_docs.size(); ++i) {
+        if (!m_docs[i].live) continue;
+        remap[i] = static_cast<uint32_t>(docs.size());
+        docs.push_back(std::move(m_docs[i]));
+    }
+    m_docs = std::move(docs);
+    for (auto& kv : m_byKey) kv.second = remap[kv.second];
+
+    for (auto it = m_postings.begin(); it != m_postings.end();) {
+        auto& list = it->second;
+        size_t out = 0;
+        for (const Posting& p : list) {
+            if (remap[p.doc] != UINT32_MAX) list[out++] = Posting{remap[p.doc], p.fields};
+        }
+        list.resize(out);
+        if (list.empty()) {
+            it = m_postings.erase(it);
+        } else {
+            list.shrink_to_fit();
+            ++it;
+        }
+    }
+    m_dead = 0;
+}
+
+std::vector<TrigramIndex::Match> TrigramIndex::search(std::string_view query, size_t limit) const
+{
+    if (query.size() > kMaxQueryBytes) query = query.substr(0, kMaxQueryBytes);
+    std::vector<uint32_t> grams;
+    forEachTrigram(query, [&](uint32_t g) { grams.push_back(g); });
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    if (grams.empty()) return {};
+
+    // A document with at least `need` of the g query trigrams must contain
+    // one of any g - need + 1 of them. So the rarest g - need + 1 posting
+    // lists seed the candidates, and the longer, common lists are only
+    // probed for documents already seeded — by binary search (lists are in
+    // document order) when there are few candidates, else by one pass.
+    const uint16_t need = static_cast<uint16_t>(std::ceil(grams.size() * kMinTrigramShare));
+    static const std::vector<Posting> kEmpty;
+    std::vector<const std::vector<Posting>*> lists;
+    lists.reserve(grams.size());
+    for (uint32_t g : grams) {
+        auto it = m_postings.find(g);
+        lists.push_back(it == m_postings.end() ? &kEmpty : &it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+    std::vector<uint16_t> hits(m_docs.size(), 0);
+    std::vector<uint16_t> weight(m_docs.size(), 0);
+    std::vector<uint32_t> candidates;
+    const size_t seedLists = grams.size() - need + 1;
+    for (size_t i = 0; i < seedLists; ++i) {
+        for (const Posting& p : *lists[i]) {
+            if (hits[p.doc] == 0) candidates.push_back(p.doc);
+            ++hits[p.doc];
+            weight[p.doc] = static_cast<uint16_t>(weight[p.doc] + kFieldWeight[p.fields]);
+        }
+    }
+    for (size_t i = seedLists; i < lists.size() && !candidates.empty(); ++i) {
+        const auto& list = *lists[i];
+        const size_t probeCost = candidates.size() * static_cast<size_t>(std::log2(list.size() + 1) + 1);
+        if (probeCost < list.size()) {
+            for (uint32_t d : candidates) {
+                auto it = std::lower_bound(list.begin(), list.end(), d,
+                                           [](const Posting& p, uint32_t doc) { return p.doc < doc; });
+                if (it == list.end() || it->doc != d) continue;
+                ++hits[d];
+                weight[d] = static_cast<uint16_t>(weight[d] + kFieldWeight[it->fields]);
+            }
+        } else {
+            for (const Posting& p : list) {
+                if (hits[p.doc] == 0) continue;
+                ++hits[p.doc];
+                weight[p.doc] = static_cast<uint16_t>(weight[p.doc] + kFieldWeight[p.fields]);
+            }
+        }
+    }
+
+    // Name bonuses compare against the query as typed, minus surrounding
+    // separators.
+    size_t b = 0, e = query.size();
+    while (b < e && !isWordByte(query[b])) ++b;
+    while (e > b && !isWordByte(query[e - 1])) --e;
+    const std::string needle = lowered(query.substr(b, e - b));
+
+    const double maxWeight = 3.0 * grams.size();
+    std::vector<Match> matches;
+    for (uint32_t d : candidates) {
+        if (hits[d] < need || !m_docs[d].live) continue;
+        const Doc& doc = m_docs[d];
+        double score = weight[d] / maxWeight;
+        if (!needle.empty()) {
+            if (doc.lowerName == needle) score += 1.0;
+            else if (doc.lowerName.compare(0, needle.size(), needle) == 0) score += 0.5;
+            else if (doc.lowerName.find(needle) != std::string::npos) score += 0.25;
+        }
+        matches.push_back(Match{doc.key, score});
+    }
+
+    auto better = [](const Match& a, const Match& b) {
+        return a.score != b.score ? a.score > b.score : a.key < b.key;
+    };
+    if (limit > 0 && limit < matches.size()) {
+        std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+        matches.resize(limit);
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
+
+size_t TrigramIndex::memoryBytes() const
+{
+    size_t bytes = m_docs.capacity() * sizeof(Doc);
+    for (const auto& doc : m_docs) bytes += memstats::heapBytes(doc.key) + memstats::heapBytes(doc.lowerName);
+    // Hash nodes: value plus next pointer and cached hash; and bucket arrays.
+    for (const auto& kv : m_byKey)
+        bytes += sizeof(kv) + 2 * sizeof(void*) + memstats::heapBytes(kv.first);
+    for (const auto& kv : m_postings)
+        bytes += sizeof(kv) + 2 * sizeof(void*) + kv.second.capacity() * sizeof(Posting);
+    bytes += (m_byKey.bucket_count() + m_postings.bucket_count()) * sizeof(void*);
+    return bytes;
+}
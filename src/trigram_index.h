@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Trigram full-text index over package name, displayName and description
+// ---------------------------------------------------------------------------
+//
+// Text is lower-cased (ASCII), split into words on anything that is not a
+// letter or digit, and each word is padded ("  word ") before taking its
+// byte trigrams, so short queries and word prefixes still produce trigrams
+// and misspellings share most of them with the intended word.
+//
+// Each trigram maps to a posting list of (document, fields) entries. A
+// query scores every document by the query trigrams it contains, weighted
+// by the best field each one occurs in (name 3, displayName 2,
+// description 1), and keeps documents that contain at least
+// kMinTrigramShare of them. Whole-name matches, name prefixes and name
+// substrings get a bonus on top so that "wallet" ranks the package named
+// wallet ahead of packages that mention wallets.
+//
+// Documents are keyed by package name and updated incrementally: upsert()
+// skips a document whose text is unchanged, and a removed or replaced
+// document is tombstoned and its postings compacted away in bulk once a
+// quarter of the index is dead.
+//
+// Not synchronised; the module updates and queries it on the module thread.
+// ---------------------------------------------------------------------------
+
+class TrigramIndex {
+public:
+    static constexpr double kMinTrigramShare = 0.5;
+    // Longer queries are truncated; keeps the per-document counters small.
+    static constexpr size_t kMaxQueryBytes = 256;
+
+    struct Match {
+        std::string_view key;  // valid until the next update
+        double score = 0;
+    };
+
+    // Adds or refreshes the document for `key`. Returns false when it was
+    // already indexed with identical text.
+    bool upsert(std::string_view key, std::string_view displayName, std::string_view description);
+    bool remove(std::string_view key);
+    // Mark-and-sweep refresh from a full listing: beginSync(), upsert()
+    // every current document, then endSync() removes the rest and returns
+    // how many it removed.
+    void beginSync();
+    size_t endSync();
+
+    size_t size() const { return m_live; }
+
+    // Best matches first, at most `limit` of them (0 = all).
+    std::vector<Match> search(std::string_view query, size_t limit) const;
+
+    size_t memoryBytes() const;
+
+private:
+    struct Posting {
+        uint32_t doc;
+        uint8_t  fields;  // bit 0 name, bit 1 displayName, bit 2 description
+    };
+    struct Doc {
+        std::string key;
+        std::string lowerName;
+        uint64_t    fingerprint = 0;
+        bool        live = false;
+        bool        seen = false;  // upserted since beginSync()
+    };
+
+    void addPostings(uint32_t doc, std::string_view name, std::string_view displayName,
+                     std::string_view description);
+    void tombstone(uint32_t doc);
+    void compact();
+
+    std::vector<Doc> m_docs;
+    std::unordered_map<std::string, uint32_t> m_byKey;  // live documents only
+    std::unordered_map<uint32_t, std::vector<Posting>> m_postings;
+    size_t m_live = 0;
+    size_t m_dead = 0;
+};
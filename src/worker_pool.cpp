@@ -0,0 +1,98 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+WorkerPool::WorkerPool(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    m_threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        m_threads.emplace_back([this]() { workerLoop(); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_threads) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void WorkerPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_queue.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void WorkerPool::workerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lk(m_mutex);
+            m_cv.wait(lk, [this]() { return m_stopping || !m_queue.empty(); });
+            // Drain whatever is queued before honouring m_stopping so no
+            // submitted future is left without a value.
+            if (m_queue.empty()) return;
+            task = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0) return;
+
+    // Shared between the caller and every helper task. Indices are claimed
+    // with fetch_add so each runs exactly once; `remaining` tracks completion
+    // so the caller can wait without joining specific tasks (a helper that
+    // is still queued when all indices are claimed finds nothing to do and
+    // returns immediately).
+    struct State {
+        std::atomic<size_t>     next{0};
+        size_t                  remaining;
+        std::exception_ptr      error;
+        std::mutex              mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    state->remaining = count;
+
+    auto drain = [state, count, &fn]() {
+        for (;;) {
+            const size_t i = state->next.fetch_add(1);
+            if (i >= count) return;
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(state->mutex);
+                if (!state->error) state->error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lk(state->mutex);
+            if (--state->remaining == 0) state->done.notify_all();
+        }
+    };
+
+    // `fn` is captured by reference: helpers only touch it while claiming an
+    // index below `count`, and the caller does not return until every such
+    // index has completed.
+    const size_t helpers = std::min(m_threads.size(), count - 1);
+    for (size_t h = 0; h < helpers; ++h) enqueue(drain);
+    drain();
+
+    std::unique_lock<std::mutex> lk(state->mutex);
+    state->done.wait(lk, [&state]() { return state->remaining == 0; });
+    if (state->error) std::rethrow_exception(state->error);
+}
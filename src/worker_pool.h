@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Bounded worker pool
+// ---------------------------------------------------------------------------
+//
+// A fixed set of std::threads draining a FIFO of tasks. Used wherever a slot
+// fans independent, I/O-heavy work out across cores (install-time signature
+// verification, integrity audits, directory scans).
+//
+// The pool never grows past the size it was constructed with, so a burst of
+// submissions queues rather than spawning threads. Results are handed back
+// through std::future (submit) or written by index (parallelFor), which keeps
+// the merge order deterministic regardless of completion order.
+//
+// Threading rules:
+//   - submit / parallelFor may be called from any thread, including from a
+//     task running on the pool (parallelFor runs the caller's share of the
+//     work inline, so a nested call cannot deadlock waiting on itself).
+//   - The destructor drains the queue and joins every worker.
+// ---------------------------------------------------------------------------
+
+class WorkerPool {
+public:
+    // threadCount == 0 picks std::thread::hardware_concurrency() (min 1).
+    explicit WorkerPool(size_t threadCount = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return m_threads.size(); }
+
+    template <typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<std::decay_t<Fn>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<Fn>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+        std::future<Result> fut = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return fut;
+    }
+
+    // Runs fn(i) for every i in [0, count). Blocks until all indices are done.
+    // The calling thread claims indices alongside the workers, so a pool of N
+    // threads gives N+1-way parallelism and parallelFor is safe to call from
+    // inside a pool task. The first exception thrown by fn is rethrown here
+    // after every index has finished.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread>          m_threads;
+    std::deque<std::function<void()>> m_queue;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_cv;
+    bool                              m_stopping = false;
+};
@@ -0,0 +1,691 @@
+// Microbenchmarks for the struct → LogosMap / LogosList conversion helpers
+// (src/conversions.h), plus the query slots that wrap them, checkOutdated
+// against a catalog file, and filtering the installed set through
+// PackageIndex (src/package_index.h) against the equivalent loop over
+// InstalledPackage structs, faceted PackageIndex queries, semver
+// comparisons and TrigramIndex searches. The wire/ and packed/ cases set
+// the text a LogosList serialises to against the packed encoding
+// (src/packed_encoding.h): encode time, decode time, and size; the
+// */response/ cases time and size each slot's whole serialised response,
+// the packed one with its base64 payload, as it crosses the boundary.
+// The manifest/ cases parse manifest.json text through the document path
+// and the on-demand reader (src/manifest_reader.h); scan/cold/ scans a
+// directory of 5000 packages with its manifests evicted from the page
+// cache before every pass (scan/cold/evict is the eviction alone, to
+// subtract).
+//
+// Each case reports wall time and heap allocations per call, and the same
+// divided by the number of packages / nodes the call converts, so a change
+// to the conversion layer can be judged on numbers rather than intuition.
+// The slot cases feed identical fixtures through the mocked
+// PackageManagerLib (setMockInstalledPackages / setMockDependencyTree); the
+// gap between a helper and its slot is the lib call, the copy it returns
+// and the metrics/trace bookkeeping. slot/resolveDependents installs the
+// tree's packages instead, since dependents come from the module's
+// reverse index.
+//
+// Usage:
+//   package_manager_conversion_bench [--filter <substring>]
+//                                    [--min-time-ms <ms>] [--json <path>]
+//
+// Built only with -DPACKAGE_MANAGER_BUILD_BENCHMARKS=ON; compare numbers
+// from Release builds on an otherwise idle machine.
+
+#include <logos_test.h>
+#include "conversions.h"
+#include "manifest_reader.h"
+#include "packed_encoding.h"
+#include "package_index.h"
+#include "package_manager_impl.h"
+#include "semver.h"
+#include "trigram_index.h"
+#include "worker_pool.h"
+#include "mocks/mock_package_manager_lib.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------
+// Allocation counting
+// ---------------------------------------------------------------------------
+//
+// Global operator new is replaced for the whole binary, but only counts on
+// the measuring thread while a case is running — the module's worker pool
+// and ack-timer threads never skew the numbers.
+
+namespace {
+
+std::atomic<uint64_t> g_allocs{0};
+std::atomic<uint64_t> g_allocBytes{0};
+thread_local bool t_counting = false;
+
+void* countedAlloc(std::size_t size)
+{
+    if (t_counting) {
+        g_allocs.fetch_add(1, std::memory_order_relaxed);
+        g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Harness
+// ---------------------------------------------------------------------------
+
+struct Options {
+    std::string filter;
+    double minTimeMs = 200;
+    std::string jsonPath;
+};
+
+struct Result {
+    std::string name;
+    size_t elements = 0;  // packages or nodes converted per call
+    uint64_t iterations = 0;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double bytesPerOp = 0;
+};
+
+// Results are consumed here so the optimiser cannot drop the conversion.
+volatile size_t g_sink = 0;
+
+class Bench {
+public:
+    explicit Bench(Options opts) : m_opts(std::move(opts)) {}
+
+    bool wants(const std::string& name) const
+    {
+        return m_opts.filter.empty() || name.find(m_opts.filter) != std::string::npos;
+    }
+
+    // `fn` performs one conversion and returns the size of its result.
+    void run(const std::string& name, size_t elements, const std::function<size_t()>& fn)
+    {
+        if (!wants(name)) return;
+        g_sink = g_sink + fn();  // warm-up: first-touch allocations, lazy statics
+
+        // Grow the batch until one batch alone takes at least the minimum
+        // time, then report that batch.
+        uint64_t iterations = 1;
+        for (;;) {
+            g_allocs.store(0, std::memory_order_relaxed);
+            g_allocBytes.store(0, std::memory_order_relaxed);
+            t_counting = true;
+            const auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) g_sink = g_sink + fn();
+            const auto end = std::chrono::steady_clock::now();
+            t_counting = false;
+
+            const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            if (ns >= m_opts.minTimeMs * 1e6 || iterations >= (uint64_t{1} << 40)) {
+                Result r;
+                r.name = name;
+                r.elements = elements;
+                r.iterations = iterations;
+                r.nsPerOp = ns / iterations;
+                r.allocsPerOp = double(g_allocs.load()) / iterations;
+                r.bytesPerOp = double(g_allocBytes.load()) / iterations;
+                print(r);
+                m_results.push_back(r);
+                return;
+            }
+            // Aim for ~1.5x the target on the next round; at least double.
+            const double perOp = ns / iterations;
+            const double want = perOp > 0 ? m_opts.minTimeMs * 1e6 * 1.5 / perOp : iterations * 10.0;
+            iterations = std::max<uint64_t>(iterations * 2, static_cast<uint64_t>(want));
+        }
+    }
+
+    static void printHeader()
+    {
+        std::printf("%-52s %8s %14s %12s %12s %12s %14s\n", "case", "elems", "ns/op", "ns/elem",
+                    "allocs/op", "allocs/elem", "bytes/op");
+    }
+
+    bool writeJson() const
+    {
+        if (m_opts.jsonPath.empty()) return true;
+        std::ofstream f(m_opts.jsonPath, std::ios::trunc);
+        if (!f) {
+            std::fprintf(stderr, "cannot write %s\n", m_opts.jsonPath.c_str());
+            return false;
+        }
+        f << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < m_results.size(); ++i) {
+            const Result& r = m_results[i];
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          "    {\"name\": \"%s\", \"elements\": %zu, \"iterations\": %llu, "
+                          "\"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+                          r.name.c_str(), r.elements, static_cast<unsigned long long>(r.iterations),
+                          r.nsPerOp, r.allocsPerOp, r.bytesPerOp,
+                          i + 1 < m_results.size() ? "," : "");
+            f << line;
+        }
+        f << "  ]\n}\n";
+        return bool(f);
+    }
+
+private:
+    static void print(const Result& r)
+    {
+        const double n = r.elements ? double(r.elements) : 1.0;
+        std::printf("%-52s %8zu %14.1f %12.1f %12.2f %12.2f %14.1f\n", r.name.c_str(), r.elements,
+                    r.nsPerOp, r.nsPerOp / n, r.allocsPerOp, r.allocsPerOp / n, r.bytesPerOp);
+        std::fflush(stdout);
+    }
+
+    Options m_opts;
+    std::vector<Result> m_results;
+};
+
+// ---------------------------------------------------------------------------
+// Fixtures
+// ---------------------------------------------------------------------------
+
+// Field lengths roughly match packages in the wild: short names, a sentence
+// of description, absolute install paths, three dependencies.
+InstalledPackage makePackage(size_t i)
+{
+    const std::string id = std::to_string(i);
+    InstalledPackage p;
+    p.name = "package_" + id;
+    p.displayName = "Package " + id;
+    p.version = "1.2." + id;
+    p.description = "Benchmark fixture package number " + id + " with a typical one-line description";
+    p.type = "core";
+    p.category = "network";
+    p.author = "Logos Benchmarks";
+    p.license = "MIT";
+    p.icon = "icons/package_" + id + ".png";
+    p.view = "";
+    p.dependencies = {"dep_a_" + id, "dep_b_" + id, "dep_c_" + id};
+    p.hashes.root = "b3a1c9f0d2e47a6580c1d3e5f7091b2d4f6a8c0e2f4a6b8d0f1e3c5a7b9d1f3e";
+    p.installType = i % 2 ? InstallType::User : InstallType::Embedded;
+    p.installDir = "/home/user/.local/share/logos/modules/package_" + id;
+    p.mainFilePath = p.installDir + "/package_" + id + "_plugin.so";
+    return p;
+}
+
+std::vector<InstalledPackage> makePackages(size_t n)
+{
+    std::vector<InstalledPackage> v;
+    v.reserve(n);
+    for (size_t i = 0; i < n; ++i) v.push_back(makePackage(i));
+    return v;
+}
+
+template <typename Node>
+Node makeNode(size_t i);
+
+template <>
+DependencyTreeNode makeNode<DependencyTreeNode>(size_t i)
+{
+    DependencyTreeNode n;
+    n.name = "node_" + std::to_string(i);
+    n.status = i % 5 ? DependencyStatus::Installed : DependencyStatus::NotInstalled;
+    n.version = "0.9." + std::to_string(i);
+    n.installType = InstallType::User;
+    return n;
+}
+
+template <>
+DependentTreeNode makeNode<DependentTreeNode>(size_t i)
+{
+    DependentTreeNode n;
+    n.name = "node_" + std::to_string(i);
+    n.version = "0.9." + std::to_string(i);
+    n.type = "core";
+    n.installType = InstallType::User;
+    n.installDir = "/home/user/.local/share/logos/modules/node_" + std::to_string(i);
+    return n;
+}
+
+enum class Shape { Chain, Wide, Balanced };
+
+const char* shapeName(Shape s)
+{
+    switch (s) {
+    case Shape::Chain:    return "chain";
+    case Shape::Wide:     return "wide";
+    case Shape::Balanced: return "balanced";
+    }
+    return "?";
+}
+
+// A tree of exactly `nodes` nodes (root included) with unique names:
+//   chain    — each node has one child (depth = nodes)
+//   wide     — root with nodes-1 direct children
+//   balanced — breadth-first fill with fan-out 4
+template <typename Node>
+Node makeTree(Shape shape, size_t nodes)
+{
+    size_t next = 0;
+    Node root = makeNode<Node>(next++);
+    if (nodes <= 1) return root;
+
+    if (shape == Shape::Chain) {
+        Node* cur = &root;
+        while (next < nodes) {
+            cur->children.push_back(makeNode<Node>(next++));
+            cur = &cur->children.back();
+        }
+    } else if (shape == Shape::Wide) {
+        root.children.reserve(nodes - 1);
+        while (next < nodes) root.children.push_back(makeNode<Node>(next++));
+    } else {
+        // Reserve each level up front so the parent pointers stay valid.
+        std::vector<Node*> level{&root};
+        while (next < nodes) {
+            std::vector<Node*> nextLevel;
+            for (Node* parent : level) {
+                parent->children.reserve(4);
+                for (int c = 0; c < 4 && next < nodes; ++c)
+                    parent->children.push_back(makeNode<Node>(next++));
+            }
+            for (Node* parent : level)
+                for (auto& child : parent->children) nextLevel.push_back(&child);
+            level.swap(nextLevel);
+        }
+    }
+    return root;
+}
+
+// The installed set whose reverse tree is `root`: each node's package lists
+// its parent as a dependency (dependents come from the reverse index).
+void collectDependents(const DependentTreeNode& node, const std::string& parent,
+                       std::vector<InstalledPackage>& out)
+{
+    InstalledPackage p;
+    p.name = node.name;
+    p.version = node.version;
+    p.type = node.type;
+    p.installType = node.installType;
+    p.installDir = node.installDir;
+    if (!parent.empty()) p.dependencies = {parent};
+    out.push_back(std::move(p));
+    for (const auto& child : node.children) collectDependents(child, node.name, out);
+}
+
+std::vector<InstalledPackage> dependentsOf(const DependentTreeNode& root)
+{
+    std::vector<InstalledPackage> out;
+    collectDependents(root, "", out);
+    return out;
+}
+
+const size_t kPackageCounts[] = {1, 10, 100, 1000};
+const size_t kNodeCounts[] = {10, 100, 1000};
+const Shape kShapes[] = {Shape::Chain, Shape::Wide, Shape::Balanced};
+constexpr int kFullDepth = std::numeric_limits<int>::max();
+
+// ---------------------------------------------------------------------------
+// Cases
+// ---------------------------------------------------------------------------
+
+void benchPackages(Bench& bench)
+{
+    const InstalledPackage one = makePackage(0);
+    bench.run("toLogosMap/package", 1, [&]() { return conversions::toLogosMap(one).size(); });
+
+    for (size_t n : kPackageCounts) {
+        const auto packages = makePackages(n);
+        bench.run("toLogosList/packages/" + std::to_string(n), n,
+                  [&]() { return conversions::toLogosList(packages).size(); });
+    }
+}
+
+// Each case returns bytes, so the sizes print alongside the times.
+void benchWire(Bench& bench)
+{
+    using packed::Format;
+    for (size_t n : {size_t(100), size_t(1000), size_t(10000)}) {
+        const std::string suffix = "packages/" + std::to_string(n);
+        bool wanted = false;
+        for (const char* c : {"wire/json/encode/", "packed/msgpack/encode/", "packed/cbor/encode/",
+                              "wire/json/parse/", "packed/msgpack/parse/", "packed/msgpack/decode/"})
+            wanted = wanted || bench.wants(c + suffix);
+        if (!wanted) continue;
+        const auto packages = makePackages(n);
+        const std::string text = conversions::toLogosList(packages).dump();
+        const std::vector<uint8_t> msgpack = packed::encode(packages, Format::MessagePack);
+        std::printf("# %s: json %zu bytes, msgpack %zu bytes, cbor %zu bytes\n", suffix.c_str(), text.size(),
+                    msgpack.size(), packed::encode(packages, Format::Cbor).size());
+
+        bench.run("wire/json/encode/" + suffix, n,
+                  [&]() { return conversions::toLogosList(packages).dump().size(); });
+        bench.run("packed/msgpack/encode/" + suffix, n,
+                  [&]() { return packed::encode(packages, Format::MessagePack).size(); });
+        bench.run("packed/cbor/encode/" + suffix, n,
+                  [&]() { return packed::encode(packages, Format::Cbor).size(); });
+        bench.run("wire/json/parse/" + suffix, n, [&]() { return LogosMap::parse(text).size(); });
+        // A generic MessagePack parse, then the rebuild into plain maps.
+        bench.run("packed/msgpack/parse/" + suffix, n, [&]() { return LogosMap::from_msgpack(msgpack).size(); });
+        bench.run("packed/msgpack/decode/" + suffix, n, [&]() {
+            LogosMap out;
+            std::string error;
+            packed::decode(msgpack, Format::MessagePack, out, error);
+            return out.size();
+        });
+    }
+
+    // What actually crosses the boundary: each slot's whole response as it
+    // serialises, the packed one with its base64 payload.
+    for (size_t n : {size_t(100), size_t(1000), size_t(10000)}) {
+        const std::string suffix = "packages/" + std::to_string(n);
+        const std::string plainName = "wire/json/response/" + suffix;
+        const std::string packedName = "packed/msgpack/response/" + suffix;
+        if (!bench.wants(plainName) && !bench.wants(packedName)) continue;
+        auto t = LogosTestContext("package_manager");
+        setMockInstalledPackages(makePackages(n));
+        PackageManagerImpl impl;
+        std::printf("# response %s: json %zu bytes, msgpack %zu bytes\n", suffix.c_str(),
+                    impl.getInstalledPackages().dump().size(),
+                    impl.getInstalledPackages("msgpack").dump().size());
+        bench.run(plainName, n, [&]() { return impl.getInstalledPackages().dump().size(); });
+        bench.run(packedName, n, [&]() { return impl.getInstalledPackages("msgpack").dump().size(); });
+    }
+
+    const auto tree = makeTree<DependencyTreeNode>(Shape::Balanced, 1000);
+    bench.run("wire/json/encode/dependency/balanced/1000", 1000,
+              [&]() { return conversions::toLogosTreeMap(tree, kFullDepth).dump().size(); });
+    bench.run("packed/msgpack/encode/dependency/balanced/1000", 1000,
+              [&]() { return packed::encodeTree(&tree, kFullDepth, Format::MessagePack).size(); });
+}
+
+template <typename Node>
+void benchTrees(Bench& bench, const char* kind)
+{
+    const Node single = makeNode<Node>(0);
+    bench.run(std::string("toFlatLogosMap/") + kind, 1,
+              [&]() { return conversions::toFlatLogosMap(single).size(); });
+
+    for (Shape shape : kShapes) {
+        for (size_t n : kNodeCounts) {
+            const std::string suffix = std::string(kind) + "/" + shapeName(shape) + "/" + std::to_string(n);
+            const Node tree = makeTree<Node>(shape, n);
+            bench.run("toLogosTreeMap/" + suffix, n,
+                      [&]() { return conversions::toLogosTreeMap(tree, kFullDepth).size(); });
+
+            const size_t direct = tree.children.size();
+            bench.run("toLogosTreeMap/depth1/" + suffix, 1 + direct,
+                      [&]() { return conversions::toLogosTreeMap(tree, 1).size(); });
+
+            const auto flat = tree.flatten();
+            bench.run("toFlatLogosList/" + suffix, flat.size(),
+                      [&]() { return conversions::toFlatLogosList(flat).size(); });
+        }
+    }
+}
+
+void benchSlots(Bench& bench)
+{
+    for (size_t n : kPackageCounts) {
+        const std::string name = "slot/getInstalledPackages/" + std::to_string(n);
+        if (!bench.wants(name)) continue;
+        auto t = LogosTestContext("package_manager");
+        setMockInstalledPackages(makePackages(n));
+        PackageManagerImpl impl;
+        bench.run(name, n, [&]() { return impl.getInstalledPackages().size(); });
+    }
+
+    // The catalog lists every installed package, a quarter of them newer.
+    for (size_t n : {size_t(1000), size_t(10000)}) {
+        const std::string name = "slot/checkOutdated/" + std::to_string(n);
+        if (!bench.wants(name)) continue;
+        const auto packages = makePackages(n);
+        const auto catalog = std::filesystem::temp_directory_path()
+            / ("pm_bench_catalog_" + std::to_string(n) + ".json");
+        {
+            LogosMap doc = LogosMap::object();
+            for (size_t i = 0; i < n; ++i) {
+                LogosMap entry;
+                entry["version"] = i % 4 ? packages[i].version : "1.3.0";
+                entry["rootHash"] = packages[i].hashes.root;
+                entry["releaseTag"] = "v" + entry["version"].get<std::string>();
+                doc[packages[i].name] = entry;
+            }
+            std::ofstream(catalog) << doc.dump();
+        }
+        auto t = LogosTestContext("package_manager");
+        setMockInstalledPackages(packages);
+        PackageManagerImpl impl;
+        bench.run(name, n, [&]() { return impl.checkOutdated(catalog.string())["packages"].size(); });
+        std::error_code ec;
+        std::filesystem::remove(catalog, ec);
+    }
+
+    for (Shape shape : kShapes) {
+        for (size_t n : kNodeCounts) {
+            const std::string suffix = std::string(shapeName(shape)) + "/" + std::to_string(n);
+            const std::string deps = "slot/resolveDependencies/" + suffix;
+            const std::string flatDeps = "slot/resolveFlatDependencies/" + suffix;
+            const std::string dependents = "slot/resolveDependents/" + suffix;
+            if (!bench.wants(deps) && !bench.wants(flatDeps) && !bench.wants(dependents)) continue;
+
+            auto t = LogosTestContext("package_manager");
+            setMockDependencyTree(makeTree<DependencyTreeNode>(shape, n));
+            setMockInstalledPackages(dependentsOf(makeTree<DependentTreeNode>(shape, n)));
+            PackageManagerImpl impl;
+            bench.run(deps, n, [&]() { return impl.resolveDependencies("node_0", true).size(); });
+            bench.run(flatDeps, n - 1,
+                      [&]() { return impl.resolveFlatDependencies("node_0", true).size(); });
+            bench.run(dependents, n, [&]() { return impl.resolveDependents("node_0", true).size(); });
+        }
+    }
+}
+
+void benchIndex(Bench& bench)
+{
+    for (size_t n : {size_t(1000), size_t(10000), size_t(50000)}) {
+        const std::string suffix = std::to_string(n);
+        if (!bench.wants("index/build/" + suffix) && !bench.wants("filter/structs/" + suffix)
+            && !bench.wants("filter/index/" + suffix) && !bench.wants("search/name/" + suffix)
+            && !bench.wants("search/common/" + suffix) && !bench.wants("facets/" + suffix)
+            && !bench.wants("versions/strings/" + suffix) && !bench.wants("versions/keys/" + suffix))
+            continue;
+        const auto packages = makePackages(n);
+        bench.run("index/build/" + suffix, n, [&]() { return PackageIndex(packages).size(); });
+
+        // User-installed core modules in one category, the struct way...
+        bench.run("filter/structs/" + suffix, n, [&]() {
+            size_t count = 0;
+            for (const auto& p : packages) {
+                count += p.installType == InstallType::User && p.type == "core"
+                         && p.category == "network";
+            }
+            return count;
+        });
+        // ...and over the index columns.
+        const PackageIndex index(packages);
+        PackageIndex::Filter filter;
+        filter.installType = static_cast<int>(InstallType::User);
+        filter.kind = PackageIndex::KindCore;
+        filter.category = index.find("network");
+        bench.run("filter/index/" + suffix, n, [&]() { return index.count(filter); });
+
+        TrigramIndex search;
+        for (size_t row = 0; row < index.size(); ++row)
+            search.upsert(index.name(row), index.displayName(row), index.description(row));
+        // A name lookup with a typo, and a worst case whose trigrams occur
+        // in every description.
+        bench.run("search/name/" + suffix, n, [&]() { return search.search("pakage_4242", 20).size(); });
+        bench.run("search/common/" + suffix, n,
+                  [&]() { return search.search("typical description", 20).size(); });
+
+        // Every installed version against one candidate: parsing both
+        // strings each time, versus the keys the index parsed once.
+        const std::string candidate = "1.2.25000-rc.1";
+        bench.run("versions/strings/" + suffix, n, [&]() {
+            size_t newer = 0;
+            for (size_t row = 0; row < index.size(); ++row)
+                newer += semver::compare(candidate, index.version(row)) > 0;
+            return newer;
+        });
+        const semver::Key candidateKey = semver::key(candidate);
+        bench.run("versions/keys/" + suffix, n, [&]() {
+            size_t newer = 0;
+            for (size_t row = 0; row < index.size(); ++row)
+                newer += semver::compare(candidateKey, candidate, index.versionKey(row), index.version(row)) > 0;
+            return newer;
+        });
+
+        // A faceted query over varied attributes: user packages in one of
+        // eight categories by one of 200 authors, plus all five facet counts.
+        auto varied = packages;
+        for (size_t i = 0; i < varied.size(); ++i) {
+            varied[i].category = "category_" + std::to_string(i % 8);
+            varied[i].author = "author_" + std::to_string(i % 200);
+            varied[i].license = i % 3 ? "MIT" : "Apache-2.0";
+        }
+        const PackageIndex facetIndex(varied);
+        PackageIndex::Query query;
+        query.value[PackageIndex::FacetInstallType] = static_cast<uint32_t>(InstallType::User);
+        query.value[PackageIndex::FacetCategory] = facetIndex.find("category_3");
+        query.value[PackageIndex::FacetAuthor] = facetIndex.find("author_11");
+        bench.run("facets/" + suffix, n, [&]() {
+            size_t total = facetIndex.query(query).size();
+            for (int f = 0; f < PackageIndex::FacetCount; ++f)
+                total += facetIndex.facetCounts(query, static_cast<PackageIndex::Facet>(f)).size();
+            return total;
+        });
+    }
+}
+
+bool parseArgs(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) {
+            opts.filter = argv[++i];
+        } else if (arg == "--min-time-ms" && hasValue) {
+            opts.minTimeMs = std::atof(argv[++i]);
+        } else if (arg == "--json" && hasValue) {
+            opts.jsonPath = argv[++i];
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--filter <substring>] [--min-time-ms <ms>] [--json <path>]\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return opts.minTimeMs > 0;
+}
+
+// manifest.json as installFromDirectory leaves it, for makePackage(i).
+std::string manifestText(size_t i)
+{
+    const InstalledPackage p = makePackage(i);
+    LogosMap doc = conversions::toLogosMap(p);
+    doc.erase("installType");
+    doc.erase("installDir");
+    doc.erase("mainFilePath");
+    doc["hashes"] = LogosMap{{"root", p.hashes.root}};
+    doc["main"] = LogosMap{{"darwin-arm64", "plugin.dylib"}, {"mock-variant", "plugin.so"}};
+    doc["capabilities"] = LogosList{"network", "storage"};
+    return doc.dump(2);
+}
+
+// Drops `dir`'s manifests from the page cache. Best effort: only clean,
+// unmapped pages go.
+size_t evictManifests(const std::filesystem::path& dir)
+{
+    size_t evicted = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        const int fd = ::open((entry.path() / "manifest.json").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        ::fdatasync(fd);
+        evicted += ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        ::close(fd);
+    }
+    return evicted;
+}
+
+void benchManifests(Bench& bench)
+{
+    using manifest::Reader;
+    const std::vector<std::string> variants = {"mock-variant"};
+    const std::string text = manifestText(7);
+    const std::string installDir = "/home/user/.local/share/logos/modules/package_7";
+    auto parse = [&](Reader reader) {
+        InstalledPackage p;
+        std::string error;
+        const bool ok = reader == Reader::OnDemand
+            ? manifest::read(text, installDir, InstallType::User, variants, p, error)
+            : manifest::readDom(text, installDir, InstallType::User, variants, p, error);
+        return ok ? p.dependencies.size() : 0;
+    };
+    bench.run("manifest/dom", 1, [&]() { return parse(Reader::Dom); });
+    bench.run("manifest/ondemand", 1, [&]() { return parse(Reader::OnDemand); });
+
+    const size_t n = 5000;
+    const std::string suffix = "/" + std::to_string(n);
+    if (!bench.wants("scan/cold/evict" + suffix) && !bench.wants("scan/cold/dom" + suffix)
+        && !bench.wants("scan/cold/ondemand" + suffix))
+        return;
+    const auto dir = std::filesystem::temp_directory_path() / ("pm_bench_scan_" + std::to_string(::getpid()));
+    for (size_t i = 0; i < n; ++i) {
+        const auto pkg = dir / ("package_" + std::to_string(i));
+        std::filesystem::create_directories(pkg);
+        std::ofstream(pkg / "manifest.json", std::ios::binary) << manifestText(i);
+    }
+    WorkerPool pool(std::max(2u, std::thread::hardware_concurrency()));
+    auto scan = [&](Reader reader) {
+        evictManifests(dir);
+        return manifest::scanDirectory(dir.string(), InstallType::User, variants, reader, &pool, 64).size();
+    };
+    bench.run("scan/cold/evict" + suffix, n, [&]() { return evictManifests(dir); });
+    bench.run("scan/cold/dom" + suffix, n, [&]() { return scan(Reader::Dom); });
+    bench.run("scan/cold/ondemand" + suffix, n, [&]() { return scan(Reader::OnDemand); });
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) return 2;
+
+    Bench bench(opts);
+    Bench::printHeader();
+    benchPackages(bench);
+    benchWire(bench);
+    benchManifests(bench);
+    benchTrees<DependencyTreeNode>(bench, "dependency");
+    benchTrees<DependentTreeNode>(bench, "dependent");
+    benchSlots(bench);
+    benchIndex(bench);
+    return bench.writeJson() ? 0 : 1;
+}
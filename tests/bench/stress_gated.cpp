@@ -0,0 +1,637 @@
+// Stress and latency harness for the gated request / ack / confirm protocol.
+//
+// Several caller threads drive requestUninstall / requestUpgrade /
+// requestInstall / requestMultiUninstall, ackPendingAction, confirm* /
+// cancel* and resetPendingAction against one PackageManagerImpl backed by
+// the mocked PackageManagerLib. As in production, slot calls are serialised
+// (the glue layer's queued connection is modelled by one "module thread"
+// mutex) while the ack-reception timer runs on its own thread, so the races
+// exercised are the real ones: timer expiry against ack, confirm, cancel,
+// reset and the next request.
+//
+// Each successful request takes one of four paths, chosen at random:
+// ack then confirm, ack then cancel, no ack (the timer must cancel it), or
+// resetPendingAction. Callers whose request is refused because another
+// flow is pending poke at that flow instead (ack / confirm / cancel by a
+// random name), the way a second host UI would, then back off.
+//
+// Reported:
+//   - latency from entering a request* slot to its before* emission
+//   - lateness of timeout cancellations: *Cancelled emission minus
+//     (request start + ack timeout), an upper bound on the timer's delay
+//   - time spent waiting for the module thread
+//   - ack-timer threads started (logos_package_manager_ack_timer_threads_
+//     started_total) per successful request
+//   - stuck pending states: an un-acked flow that outlives the timeout by
+//     --stuck-slack-ms, an acked flow left unresolved for as long, flows
+//     still open once everything has quiesced, and a final probe request
+//     that must be accepted
+//
+// Usage:
+//   package_manager_gated_stress [--threads N] [--duration-ms MS]
+//                                [--ack-timeout-ms MS] [--think-us US]
+//                                [--stuck-slack-ms MS] [--race-ack-pct P]
+//                                [--seed N]
+//
+// Exits 1 when a stuck state or an accounting violation was detected.
+// Built only with -DPACKAGE_MANAGER_BUILD_BENCHMARKS=ON.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "mocks/mock_package_manager_lib.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+struct Options {
+    int threads = 4;
+    int durationMs = 5000;
+    int ackTimeoutMs = 20;
+    int thinkUs = 200;
+    int stuckSlackMs = 500;
+    int raceAckPct = 10;
+    unsigned seed = 1;
+};
+
+// Latency samples in nanoseconds; summarised once at the end.
+class Samples {
+public:
+    void add(int64_t ns)
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_values.push_back(ns);
+    }
+    void print(const char* label)
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (m_values.empty()) {
+            std::printf("  %-34s       (no samples)\n", label);
+            return;
+        }
+        std::sort(m_values.begin(), m_values.end());
+        auto pct = [this](double p) {
+            const size_t i = std::min(m_values.size() - 1, static_cast<size_t>(p * m_values.size()));
+            return m_values[i] / 1000.0;
+        };
+        std::printf("  %-34s n=%-7zu p50=%9.1fus p90=%9.1fus p99=%9.1fus max=%9.1fus\n", label,
+                    m_values.size(), pct(0.50), pct(0.90), pct(0.99), m_values.back() / 1000.0);
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<int64_t> m_values;
+};
+
+enum class Path { AckConfirm, AckCancel, NoAck, Reset };
+enum Op { Uninstall, Upgrade, Install, Multi, kOpCount };
+const char* const kOpNames[kOpCount] = {"uninstall", "upgrade", "install", "multiUninstall"};
+const char* const kPathNames[] = {"ack+confirm", "ack+cancel", "no ack (timeout)", "reset"};
+
+// A flow opened by a before* event and not yet resolved.
+struct Flow {
+    Op       op = Uninstall;
+    std::string name;                // empty for multiUninstall
+    std::string releaseTag;          // upgrade / install
+    std::vector<std::string> names;  // multiUninstall
+    uint64_t requestStartNs = 0;
+    uint64_t openedNs = 0;
+    bool     acked = false;
+    bool     reset = false;  // resetPendingAction ran while this was newest
+    bool     reportedStuck = false;
+
+    std::string key() const
+    {
+        std::string k = name;
+        for (const auto& n : names) k += (k.empty() ? "" : ",") + n;
+        return k;
+    }
+};
+
+class Harness {
+public:
+    explicit Harness(const Options& opts)
+        : m_opts(opts)
+        , m_sink([this](const std::string& name, const std::string& payload) { onEvent(name, payload); })
+    {
+        std::vector<InstalledPackage> installed;
+        for (int i = 0; i < 8; ++i) {
+            InstalledPackage p;
+            p.name = "pkg" + std::to_string(i);
+            p.version = "1.0.0";
+            p.type = i % 2 ? "ui" : "core";
+            p.installType = InstallType::User;
+            installed.push_back(p);
+        }
+        setMockInstalledPackages(installed);
+        m_context.mockCFunction("uninstallPackage_success").returns(true);
+        m_impl.setAckTimeoutMsForTest(opts.ackTimeoutMs);
+    }
+
+    int run()
+    {
+        std::printf("gated-flow stress: %d caller threads, %d ms, ack timeout %d ms, seed %u\n",
+                    m_opts.threads, m_opts.durationMs, m_opts.ackTimeoutMs, m_opts.seed);
+        const auto deadline = Clock::now() + std::chrono::milliseconds(m_opts.durationMs);
+
+        std::thread watchdog([this, deadline]() { watch(deadline); });
+        std::vector<std::thread> callers;
+        for (int t = 0; t < m_opts.threads; ++t)
+            callers.emplace_back([this, t, deadline]() { caller(m_opts.seed * 7919u + t, deadline); });
+        for (auto& c : callers) c.join();
+        m_stopWatch = true;
+        watchdog.join();
+
+        // Let every outstanding ack timer fire, then everything must be
+        // resolved and a fresh request must be accepted.
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_opts.ackTimeoutMs + m_opts.stuckSlackMs));
+        checkQuiescent();
+        probe();
+        return report();
+    }
+
+private:
+    // --- callers -----------------------------------------------------------
+
+    template <typename F>
+    LogosMap call(F&& f)
+    {
+        const uint64_t queued = nowNs();
+        std::lock_guard<std::mutex> lk(m_moduleThread);
+        m_queueWait.add(static_cast<int64_t>(nowNs() - queued));
+        return f();
+    }
+
+    static bool ok(const LogosMap& r) { return r.value("success", false); }
+
+    void caller(unsigned seed, Clock::time_point deadline)
+    {
+        std::mt19937 rng(seed);
+        auto pick = [&rng](int n) { return static_cast<int>(rng() % static_cast<unsigned>(n)); };
+
+        while (Clock::now() < deadline) {
+            const Op op = static_cast<Op>(pick(kOpCount));
+            const std::string name = "pkg" + std::to_string(pick(8));
+            const std::string other = "pkg" + std::to_string((std::stoi(name.substr(3)) + 1 + pick(7)) % 8);
+            const std::vector<std::string> batch = {name, other};
+            const std::string tag = "v" + std::to_string(pick(3));
+
+            LogosMap r = call([&]() {
+                t_requestStartNs = nowNs();
+                switch (op) {
+                case Uninstall: return m_impl.requestUninstall(name);
+                case Upgrade:   return m_impl.requestUpgrade(name, tag, 0, "");
+                case Install:   return m_impl.requestInstall(name, tag, "https://example.invalid/repo", "");
+                default:        return m_impl.requestMultiUninstall(batch);
+                }
+            });
+            m_requests[op].fetch_add(1, std::memory_order_relaxed);
+
+            if (!ok(r)) {
+                m_refused.fetch_add(1, std::memory_order_relaxed);
+                interfere(pick);
+                // Back off like a UI would rather than spinning on refusals.
+                std::this_thread::sleep_for(std::chrono::microseconds(
+                    pick(m_opts.ackTimeoutMs * 500) + 1));
+                continue;
+            }
+            m_accepted[op].fetch_add(1, std::memory_order_relaxed);
+
+            const int roll = pick(100);
+            const Path path = roll < 40 ? Path::AckConfirm
+                            : roll < 70 ? Path::AckCancel
+                            : roll < 92 ? Path::NoAck
+                                        : Path::Reset;
+            m_paths[static_cast<int>(path)].fetch_add(1, std::memory_order_relaxed);
+            think(rng);
+
+            if (path == Path::NoAck) {
+                // Leave it to the timer; poll so this caller doesn't spin on refusals.
+                std::this_thread::sleep_for(std::chrono::milliseconds(m_opts.ackTimeoutMs));
+                continue;
+            }
+            if (path == Path::Reset) {
+                call([&]() {
+                    LogosMap res = m_impl.resetPendingAction();
+                    // Only the newest flow can still have been pending; it
+                    // stays listed in case the timer claimed it first and
+                    // its cancellation is still on the way.
+                    std::lock_guard<std::mutex> lk(m_flowMutex);
+                    if (!m_open.empty() && !m_open.back().reset) {
+                        m_open.back().reset = true;
+                        ++m_resetFlows;
+                    }
+                    return res;
+                });
+                continue;
+            }
+
+            // The timer may already have cancelled the flow if this caller
+            // was descheduled past the ack timeout; that is a legitimate race.
+            const std::string ackName = name;
+            const bool acked = ok(call([&]() {
+                LogosMap res = m_impl.ackPendingAction(ackName);
+                if (ok(res)) markAcked();
+                return res;
+            }));
+            if (!acked) {
+                m_lostAckRace.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            think(rng);
+
+            const bool confirm = path == Path::AckConfirm;
+            call([&]() {
+                LogosMap res;
+                switch (op) {
+                case Uninstall: res = confirm ? m_impl.confirmUninstall(name) : m_impl.cancelUninstall(name); break;
+                case Upgrade:   res = confirm ? m_impl.confirmUpgrade(name, tag) : m_impl.cancelUpgrade(name, tag); break;
+                case Install:   res = confirm ? m_impl.confirmInstall(name) : m_impl.cancelInstall(name); break;
+                default:        res = confirm ? m_impl.confirmMultiUninstall(batch)
+                                              : m_impl.cancelMultiUninstall(batch); break;
+                }
+                // A successful cancel resolves through its *Cancelled event;
+                // a confirm has no single completion event, so resolve here
+                // while the module thread is still held.
+                if (confirm && ok(res)) {
+                    Flow resolved;
+                    resolved.name = op == Multi ? std::string() : name;
+                    if (op == Multi) resolved.names = batch;
+                    closeFlow(op, resolved.key(), false, 0);
+                }
+                if (!ok(res)) m_resolveFailed.fetch_add(1, std::memory_order_relaxed);
+                return res;
+            });
+        }
+    }
+
+    // A second UI acting on whatever is pending. Sometimes (--race-ack-pct)
+    // it races the owner to the ack — and a UI that wins the ack owns the
+    // dialog, so it must resolve it (it cancels). Otherwise it pokes with a random name,
+    // exercising the refusal paths.
+    template <typename Pick>
+    void interfere(Pick& pick)
+    {
+        m_interference.fetch_add(1, std::memory_order_relaxed);
+        if (pick(100) < m_opts.raceAckPct) {
+            call([&]() {
+                Flow pending;
+                {
+                    std::lock_guard<std::mutex> lk(m_flowMutex);
+                    if (m_open.empty() || m_open.back().reset) return LogosMap::object();
+                    pending = m_open.back();
+                }
+                const std::string& key = pending.op == Multi ? pending.names.front() : pending.name;
+                LogosMap res = m_impl.ackPendingAction(key);
+                if (!ok(res)) return res;
+                markAcked();
+                switch (pending.op) {
+                case Uninstall: return m_impl.cancelUninstall(pending.name);
+                case Upgrade:   return m_impl.cancelUpgrade(pending.name, pending.releaseTag);
+                case Install:   return m_impl.cancelInstall(pending.name);
+                default:        return m_impl.cancelMultiUninstall(pending.names);
+                }
+            });
+            return;
+        }
+        const std::string name = "pkg" + std::to_string(pick(8));
+        call([&]() {
+            // Confirms can land on the owner's acked flow; cancels resolve
+            // through their event.
+            switch (pick(3)) {
+            case 0: {
+                LogosMap res = m_impl.confirmUninstall(name);
+                if (ok(res)) closeFlow(Uninstall, name, false, 0);
+                return res;
+            }
+            case 1:
+                return m_impl.cancelUpgrade(name, "v0");
+            default: {
+                LogosMap res = m_impl.confirmInstall(name);
+                if (ok(res)) closeFlow(Install, name, false, 0);
+                return res;
+            }
+            }
+        });
+    }
+
+    void think(std::mt19937& rng)
+    {
+        if (m_opts.thinkUs > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(rng() % static_cast<unsigned>(m_opts.thinkUs)));
+    }
+
+    // --- event accounting ----------------------------------------------------
+
+    static bool startsWith(const std::string& s, const char* prefix)
+    {
+        return s.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+    }
+
+    void onEvent(const std::string& name, const std::string& payload)
+    {
+        const uint64_t now = nowNs();
+        if (startsWith(name, "before")) {
+            // Emitted synchronously from the request slot, on the caller's thread.
+            m_requestToBefore.add(static_cast<int64_t>(now - t_requestStartNs));
+            std::lock_guard<std::mutex> lk(m_flowMutex);
+            // A previous flow's timeout cancellation not yet delivered.
+            if (std::any_of(m_open.begin(), m_open.end(), [](const Flow& f) { return !f.reset; }))
+                ++m_overlapping;
+            Op op = name == "beforeUninstall" ? Uninstall
+                  : name == "beforeUpgrade"   ? Upgrade
+                  : name == "beforeInstall"   ? Install
+                                              : Multi;
+            Flow flow;
+            flow.op = op;
+            flow.requestStartNs = t_requestStartNs;
+            flow.openedNs = now;
+            const LogosMap p = LogosMap::parse(payload);
+            flow.name = p.value("name", std::string());
+            flow.releaseTag = p.value("releaseTag", std::string());
+            if (p.contains("names"))
+                for (const auto& n : p["names"]) flow.names.push_back(n.get<std::string>());
+            m_open.push_back(flow);
+            ++m_opened;
+            return;
+        }
+        if (name.size() > 9 && name.compare(name.size() - 9, 9, "Cancelled") == 0) {
+            const LogosMap p = LogosMap::parse(payload);
+            Flow cancelled;
+            cancelled.name = p.value("name", std::string());
+            if (p.contains("names"))
+                for (const auto& n : p["names"]) cancelled.names.push_back(n.get<std::string>());
+            const Op op = name == "uninstallCancelled" ? Uninstall
+                        : name == "upgradeCancelled"   ? Upgrade
+                        : name == "installCancelled"   ? Install
+                                                       : Multi;
+            const bool timeout = p.value("reason", std::string()).rfind("no listener acknowledged", 0) == 0;
+            closeFlow(op, cancelled.key(), timeout, now);
+        }
+    }
+
+    // Only one flow is pending in the module at a time, and it is always
+    // the newest open one here: older entries are flows whose timeout
+    // cancellation was claimed by the timer but has not been delivered yet.
+    void markAcked()
+    {
+        std::lock_guard<std::mutex> lk(m_flowMutex);
+        if (!m_open.empty()) m_open.back().acked = true;
+    }
+
+    // A timeout cancellation resolves the oldest matching open flow
+    // (timer-claimed flows deliver in order); a confirm or user cancel
+    // resolves the pending one, the newest.
+    void closeFlow(Op op, const std::string& key, bool timeout, uint64_t now)
+    {
+        std::lock_guard<std::mutex> lk(m_flowMutex);
+        auto matches = [&](const Flow& f) { return f.op == op && f.key() == key && !f.reset; };
+        auto it = m_open.end();
+        if (timeout) {
+            it = std::find_if(m_open.begin(), m_open.end(), matches);
+            // The timer can claim a flow just before a reset lands.
+            if (it == m_open.end())
+                it = std::find_if(m_open.begin(), m_open.end(),
+                                  [&](const Flow& f) { return f.op == op && f.key() == key; });
+        } else {
+            auto rit = std::find_if(m_open.rbegin(), m_open.rend(), matches);
+            if (rit != m_open.rend()) it = std::next(rit).base();
+        }
+        if (it == m_open.end()) {
+            ++m_orphanResolutions;
+            return;
+        }
+        const Flow flow = *it;
+        m_open.erase(it);
+        if (timeout) {
+            ++m_timeoutCancels;
+            if (flow.acked) ++m_timeoutAfterAck;
+            const int64_t deadline = static_cast<int64_t>(flow.requestStartNs)
+                                   + int64_t(m_opts.ackTimeoutMs) * 1000000;
+            m_timeoutLateness.add(static_cast<int64_t>(now) - deadline);
+        } else {
+            ++m_resolved;
+        }
+    }
+
+    // --- stuck detection -------------------------------------------------------
+
+    void watch(Clock::time_point deadline)
+    {
+        const uint64_t unackedLimit = uint64_t(m_opts.ackTimeoutMs + m_opts.stuckSlackMs) * 1000000;
+        const uint64_t ackedLimit = uint64_t(m_opts.stuckSlackMs) * 1000000;
+        while (!m_stopWatch && Clock::now() < deadline + std::chrono::seconds(1)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            const uint64_t now = nowNs();
+            std::lock_guard<std::mutex> lk(m_flowMutex);
+            for (auto& f : m_open) {
+                const uint64_t age = now - f.openedNs;
+                if (!f.reset && !f.reportedStuck && age > (f.acked ? ackedLimit : unackedLimit)) {
+                    f.reportedStuck = true;
+                    ++m_stuck;
+                    std::printf("STUCK: %s flow %s, open for %.1f ms\n", kOpNames[f.op],
+                                f.acked ? "acked but unresolved" : "unacked and not timed out",
+                                age / 1e6);
+                }
+            }
+        }
+    }
+
+    void checkQuiescent()
+    {
+        std::lock_guard<std::mutex> lk(m_flowMutex);
+        for (const auto& f : m_open) {
+            if (f.reset) continue;  // reset, and the timer never claimed it
+            ++m_stuck;
+            std::printf("STUCK: %s flow still open after quiescence (%s)\n", kOpNames[f.op],
+                        f.acked ? "acked" : "unacked");
+        }
+    }
+
+    void probe()
+    {
+        const LogosMap r = call([this]() {
+            t_requestStartNs = nowNs();
+            return m_impl.requestUninstall("pkg0");
+        });
+        if (!ok(r)) {
+            ++m_stuck;
+            std::printf("STUCK: probe request refused after quiescence: %s\n",
+                        r.value("error", std::string()).c_str());
+            return;
+        }
+        ++m_probeAccepted;
+        call([this]() {
+            m_impl.ackPendingAction("pkg0");
+            return m_impl.cancelUninstall("pkg0");
+        });
+    }
+
+    uint64_t ackThreadsStarted()
+    {
+        std::istringstream in(call([this]() {
+            LogosMap m;
+            m["text"] = m_impl.getMetricsText();
+            return m;
+        })["text"].get<std::string>());
+        std::string line;
+        const std::string key = "logos_package_manager_ack_timer_threads_started_total ";
+        while (std::getline(in, line)) {
+            if (line.compare(0, key.size(), key) == 0) return std::stoull(line.substr(key.size()));
+        }
+        return 0;
+    }
+
+    // --- report ----------------------------------------------------------------
+
+    int report()
+    {
+        uint64_t requests = 0, accepted = 0;
+        std::printf("\nrequests (accepted / issued):\n");
+        for (int op = 0; op < kOpCount; ++op) {
+            requests += m_requests[op];
+            accepted += m_accepted[op];
+            std::printf("  %-16s %8llu / %llu\n", kOpNames[op],
+                        static_cast<unsigned long long>(m_accepted[op].load()),
+                        static_cast<unsigned long long>(m_requests[op].load()));
+        }
+        accepted += m_probeAccepted;
+        std::printf("paths taken:\n");
+        for (int p = 0; p < 4; ++p)
+            std::printf("  %-16s %8llu\n", kPathNames[p], static_cast<unsigned long long>(m_paths[p].load()));
+        std::printf("other: refused=%llu interference=%llu lost-ack-race=%llu resolve-failed=%llu\n",
+                    static_cast<unsigned long long>(m_refused.load()),
+                    static_cast<unsigned long long>(m_interference.load()),
+                    static_cast<unsigned long long>(m_lostAckRace.load()),
+                    static_cast<unsigned long long>(m_resolveFailed.load()));
+
+        std::printf("\nflows: opened=%llu resolved=%llu timeout-cancelled=%llu reset=%llu "
+                    "orphan-resolutions=%llu overlapping=%llu\n",
+                    static_cast<unsigned long long>(m_opened),
+                    static_cast<unsigned long long>(m_resolved),
+                    static_cast<unsigned long long>(m_timeoutCancels),
+                    static_cast<unsigned long long>(m_resetFlows),
+                    static_cast<unsigned long long>(m_orphanResolutions),
+                    static_cast<unsigned long long>(m_overlapping));
+
+        std::printf("\nlatency:\n");
+        m_requestToBefore.print("request -> before* emitted");
+        m_timeoutLateness.print("ack timeout -> *Cancelled (late by)");
+        m_queueWait.print("wait for module thread");
+
+        const uint64_t threads = ackThreadsStarted();
+        std::printf("\nack-timer threads started: %llu (%.2f per accepted request)\n",
+                    static_cast<unsigned long long>(threads), accepted ? double(threads) / accepted : 0.0);
+
+        int violations = 0;
+        if (m_opened != accepted) {
+            ++violations;
+            std::printf("VIOLATION: %llu accepted requests but %llu before* events\n",
+                        static_cast<unsigned long long>(accepted), static_cast<unsigned long long>(m_opened));
+        }
+        if (m_orphanResolutions) {
+            ++violations;
+            std::printf("VIOLATION: %llu confirmations / cancellations for flows that were never opened\n",
+                        static_cast<unsigned long long>(m_orphanResolutions));
+        }
+        if (m_timeoutAfterAck) {
+            ++violations;
+            std::printf("VIOLATION: %llu flows timed out after being acknowledged\n",
+                        static_cast<unsigned long long>(m_timeoutAfterAck));
+        }
+        std::printf("\n%s: %llu stuck state(s), %d violation(s)\n",
+                    m_stuck || violations ? "FAIL" : "OK",
+                    static_cast<unsigned long long>(m_stuck), violations);
+        return m_stuck || violations ? 1 : 0;
+    }
+
+    static thread_local uint64_t t_requestStartNs;
+
+    Options m_opts;
+    LogosTestContext m_context{"package_manager"};
+    PackageManagerImpl m_impl;
+    logos_test::ScopedEventSink m_sink;
+    std::mutex m_moduleThread;
+
+    std::atomic<uint64_t> m_requests[kOpCount]{};
+    std::atomic<uint64_t> m_accepted[kOpCount]{};
+    std::atomic<uint64_t> m_paths[4]{};
+    std::atomic<uint64_t> m_refused{0};
+    std::atomic<uint64_t> m_interference{0};
+    std::atomic<uint64_t> m_lostAckRace{0};
+    std::atomic<uint64_t> m_resolveFailed{0};
+    std::atomic<bool>     m_stopWatch{false};
+
+    // Guarded by m_flowMutex.
+    std::mutex m_flowMutex;
+    std::vector<Flow> m_open;
+    uint64_t m_opened = 0;
+    uint64_t m_resolved = 0;
+    uint64_t m_timeoutCancels = 0;
+    uint64_t m_timeoutAfterAck = 0;
+    uint64_t m_resetFlows = 0;
+    uint64_t m_orphanResolutions = 0;
+    uint64_t m_overlapping = 0;
+    uint64_t m_stuck = 0;
+    uint64_t m_probeAccepted = 0;
+
+    Samples m_requestToBefore;
+    Samples m_timeoutLateness;
+    Samples m_queueWait;
+};
+
+thread_local uint64_t Harness::t_requestStartNs = 0;
+
+bool parseArgs(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        const long v = std::strtol(argv[++i], nullptr, 10);
+        if (arg == "--threads") opts.threads = static_cast<int>(v);
+        else if (arg == "--duration-ms") opts.durationMs = static_cast<int>(v);
+        else if (arg == "--ack-timeout-ms") opts.ackTimeoutMs = static_cast<int>(v);
+        else if (arg == "--think-us") opts.thinkUs = static_cast<int>(v);
+        else if (arg == "--stuck-slack-ms") opts.stuckSlackMs = static_cast<int>(v);
+        else if (arg == "--race-ack-pct") opts.raceAckPct = static_cast<int>(v);
+        else if (arg == "--seed") opts.seed = static_cast<unsigned>(v);
+        else return false;
+    }
+    return opts.threads > 0 && opts.durationMs > 0 && opts.ackTimeoutMs > 0 && opts.stuckSlackMs > 0
+        && opts.raceAckPct >= 0 && opts.raceAckPct <= 100;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        std::fprintf(stderr,
+                     "usage: %s [--threads N] [--duration-ms MS] [--ack-timeout-ms MS] "
+                     "[--think-us US] [--stuck-slack-ms MS] [--race-ack-pct P] [--seed N]\n",
+                     argv[0]);
+        return 2;
+    }
+    Harness harness(opts);
+    return harness.run();
+}
@@ -47,14 +47,19 @@ void lgx_free_keyring_list(lgx_keyring_list_t list) {
 }
 
 // ---------------------------------------------------------------------------
-// Package loading / inspection — unit tests never invoke inspectPackage, but
-// the symbols must exist at link time because package_manager_impl.cpp
-// references them unconditionally. Stubs return benign zeroes/nulls.
+// Package loading / inspection — stubs return benign zeroes/nulls by default.
+// Tests that need an archive header to "load" mock `lgx_load_ok` to true and
+// the getters they care about (e.g. `lgx_get_name`); the returned handle is a
+// sentinel that is never dereferenced.
 // ---------------------------------------------------------------------------
 
+static int s_mockPackage;
+
 lgx_package_t lgx_load(const char* path) {
     LOGOS_CMOCK_RECORD("lgx_load");
     (void)path;
+    if (LOGOS_CMOCK_RETURN(bool, "lgx_load_ok"))
+        return reinterpret_cast<lgx_package_t>(&s_mockPackage);
     return nullptr;
 }
 
@@ -71,13 +76,13 @@ const char* lgx_get_last_error(void) {
 const char* lgx_get_name(lgx_package_t pkg) {
     LOGOS_CMOCK_RECORD("lgx_get_name");
     (void)pkg;
-    return nullptr;
+    return LOGOS_CMOCK_RETURN_STRING("lgx_get_name");
 }
 
 const char* lgx_get_version(lgx_package_t pkg) {
     LOGOS_CMOCK_RECORD("lgx_get_version");
     (void)pkg;
-    return nullptr;
+    return LOGOS_CMOCK_RETURN_STRING("lgx_get_version");
 }
 
 const char* lgx_get_description(lgx_package_t pkg) {
@@ -25,3 +25,4 @@ void PackageManagerImpl::installCancelled(const std::string& payload)        { r
 void PackageManagerImpl::multiUninstallCancelled(const std::string& payload) { recordEvent("multiUninstallCancelled", payload); }
 void PackageManagerImpl::upgradeUninstallDone(const std::string& payload)    { recordEvent("upgradeUninstallDone", payload); }
 void PackageManagerImpl::installApproved(const std::string& payload)         { recordEvent("installApproved", payload); }
+void PackageManagerImpl::integrityViolation(const std::string& payload)      { recordEvent("integrityViolation", payload); }
@@ -0,0 +1,38 @@
+#pragma once
+
+// Filesystem fixtures shared by the unit tests that exercise module-side
+// file placement (installFromDirectory, staged upgrades, fileops helpers).
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Self-deleting scratch directory under the system temp dir.
+struct ScratchDir {
+    std::filesystem::path path;
+    ScratchDir() {
+        static int counter = 0;
+        path = std::filesystem::temp_directory_path() / ("pm_unit_"
+            + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+            + "_" + std::to_string(++counter));
+        std::filesystem::create_directories(path);
+    }
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+};
+
+inline void writeFile(const std::filesystem::path& p, const std::string& content) {
+    std::filesystem::create_directories(p.parent_path());
+    std::ofstream(p, std::ios::binary | std::ios::trunc) << content;
+}
+
+inline std::string readFile(const std::filesystem::path& p) {
+    std::ifstream in(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
@@ -0,0 +1,92 @@
+// Unit tests for checkOutdated: joining the installed index against a
+// local catalog snapshot.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+#include "test_packages.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::map<std::string, LogosMap> byName(const LogosMap& result) {
+    std::map<std::string, LogosMap> out;
+    for (const auto& entry : result["packages"]) out[entry["name"].get<std::string>()] = entry;
+    return out;
+}
+
+} // namespace
+
+LOGOS_TEST(checkOutdated_classifies_every_installed_package) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages({
+        TestPackage("wallet").version("1.2.0").root("aa"),
+        TestPackage("chat").version("2.0.0").root("bb"),
+        TestPackage("net").version("1.0.0").root("cc"),
+        TestPackage("storage").version("0.9.0").root("dd"),
+        TestPackage("shell").version("3.1.0").root("ee"),
+        TestPackage("local").version("0.1.0").root("ff"),
+    });
+    ScratchDir dir;
+    const auto catalog = dir.path / "catalog.json";
+    writeFile(catalog, R"({
+        "wallet":  {"version": "1.3.0-rc.1", "rootHash": "a2", "releaseTag": "v1.3.0-rc.1"},
+        "chat":    {"version": "1.9.9", "rootHash": "b2"},
+        "net":     {"version": "1.0.0+build.2", "rootHash": "c2"},
+        "storage": {"version": "0.9.0", "hashes": {"root": "d2"}},
+        "shell":   {"version": "3.1.0", "rootHash": "ee"},
+        "remote":  {"version": "1.0.0"}
+    })");
+    PackageManagerImpl impl;
+
+    LogosMap result = impl.checkOutdated(catalog.string());
+    LOGOS_ASSERT_TRUE(result["success"].get<bool>());
+    auto packages = byName(result);
+    LOGOS_ASSERT_EQ(packages.size(), static_cast<size_t>(6));
+    LOGOS_ASSERT_EQ(packages["wallet"]["status"].get<std::string>(), std::string("upgrade"));
+    LOGOS_ASSERT_EQ(packages["wallet"]["releaseTag"].get<std::string>(), std::string("v1.3.0-rc.1"));
+    LOGOS_ASSERT_EQ(packages["chat"]["status"].get<std::string>(), std::string("downgrade"));
+    LOGOS_ASSERT_EQ(packages["net"]["status"].get<std::string>(), std::string("sidegrade"));
+    LOGOS_ASSERT_EQ(packages["storage"]["status"].get<std::string>(), std::string("hashMismatch"));
+    LOGOS_ASSERT_EQ(packages["storage"]["catalogHash"].get<std::string>(), std::string("d2"));
+    LOGOS_ASSERT_EQ(packages["shell"]["status"].get<std::string>(), std::string("upToDate"));
+    LOGOS_ASSERT_EQ(packages["local"]["status"].get<std::string>(), std::string("notInCatalog"));
+    LOGOS_ASSERT_FALSE(packages["local"].contains("catalogVersion"));
+    LOGOS_ASSERT_EQ(result["counts"]["upgrade"].get<int64_t>(), static_cast<int64_t>(1));
+    LOGOS_ASSERT_EQ(result["counts"]["notInCatalog"].get<int64_t>(), static_cast<int64_t>(1));
+
+    // The list form gives the same answer.
+    writeFile(catalog, R"([{"name": "wallet", "version": "1.2.0", "rootHash": "aa"}])");
+    packages = byName(impl.checkOutdated(catalog.string()));
+    LOGOS_ASSERT_EQ(packages["wallet"]["status"].get<std::string>(), std::string("upToDate"));
+    LOGOS_ASSERT_EQ(packages["chat"]["status"].get<std::string>(), std::string("notInCatalog"));
+}
+
+LOGOS_TEST(checkOutdated_reports_unreadable_and_malformed_catalogs) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir dir;
+    PackageManagerImpl impl;
+
+    LogosMap result = impl.checkOutdated((dir.path / "missing.json").string());
+    LOGOS_ASSERT_FALSE(result["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(result["error"].get<std::string>().find("Cannot read") != std::string::npos);
+
+    writeFile(dir.path / "bad.json", "{ not json");
+    result = impl.checkOutdated((dir.path / "bad.json").string());
+    LOGOS_ASSERT_FALSE(result["success"].get<bool>());
+
+    writeFile(dir.path / "scalar.json", "42");
+    LOGOS_ASSERT_FALSE(impl.checkOutdated((dir.path / "scalar.json").string())["success"].get<bool>());
+
+    // Valid JSON with a non-string field is an error, not an exception.
+    writeFile(dir.path / "typed.json", R"({"foo": {"version": 2}})");
+    result = impl.checkOutdated((dir.path / "typed.json").string());
+    LOGOS_ASSERT_FALSE(result["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(result["error"].get<std::string>().find("'version'") != std::string::npos);
+    writeFile(dir.path / "typed-list.json", R"([{"name": 7, "version": "1.0.0"}])");
+    LOGOS_ASSERT_FALSE(impl.checkOutdated((dir.path / "typed-list.json").string())["success"].get<bool>());
+}
@@ -0,0 +1,102 @@
+// Unit tests for the prebuilt embedded index (src/embedded_index.h) and the
+// writeEmbeddedIndex / loadEmbeddedIndex slots.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "embedded_index.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+#include "test_packages.h"
+
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+LOGOS_TEST(embeddedIndex_round_trips_relative_to_a_relocated_bundle) {
+    ScratchDir scratch;
+    const fs::path bundle = scratch.path / "bundle";
+    embeddedindex::Index index;
+    index.moduleDirs = {(bundle / "modules").string()};
+    const InstalledPackage net = TestPackage("net").embedded().installedUnder((bundle / "modules").string())
+                                     .dependencies({"crypto", "log"}).description("Networking");
+    index.modules = {net};
+    index.uiPlugins = {TestPackage("wallet_ui").embedded().installedUnder("/opt/elsewhere")};
+
+    std::string checksum, error;
+    size_t bytes = 0;
+    LOGOS_ASSERT_TRUE(embeddedindex::write(bundle / "embedded.idx", index, checksum, bytes, error));
+    LOGOS_ASSERT_EQ(checksum.size(), static_cast<size_t>(64));
+
+    // Paths under the bundle follow it; others stay absolute.
+    fs::rename(bundle, scratch.path / "moved");
+    const fs::path moved = scratch.path / "moved";
+    embeddedindex::Index loaded;
+    std::string loadedChecksum;
+    LOGOS_ASSERT_TRUE(embeddedindex::load(moved / "embedded.idx", loaded, loadedChecksum, error));
+    LOGOS_ASSERT_EQ(loadedChecksum, checksum);
+    LOGOS_ASSERT_EQ(loaded.modules.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(loaded.modules[0].installDir, (moved / "modules" / "net").string());
+    LOGOS_ASSERT_TRUE(loaded.modules[0].dependencies == net.dependencies);
+    LOGOS_ASSERT_EQ(loaded.modules[0].description, std::string("Networking"));
+    LOGOS_ASSERT_TRUE(loaded.modules[0].installType == InstallType::Embedded);
+    LOGOS_ASSERT_EQ(loaded.uiPlugins[0].installDir, std::string("/opt/elsewhere/wallet_ui"));
+    LOGOS_ASSERT_TRUE(embeddedindex::covers(loaded, {(moved / "modules/").string()}, {}));
+    LOGOS_ASSERT_FALSE(embeddedindex::covers(loaded, {(bundle / "modules").string()}, {}));
+
+    // One flipped byte fails the checksum; a cut-off file fails the size check.
+    std::string raw = readFile(moved / "embedded.idx");
+    raw[raw.size() - 3] ^= 0x20;
+    writeFile(moved / "flipped.idx", raw);
+    LOGOS_ASSERT_FALSE(embeddedindex::load(moved / "flipped.idx", loaded, loadedChecksum, error));
+    LOGOS_ASSERT_EQ(error, std::string("Embedded index checksum mismatch"));
+    writeFile(moved / "short.idx", raw.substr(0, raw.size() - 10));
+    LOGOS_ASSERT_FALSE(embeddedindex::load(moved / "short.idx", loaded, loadedChecksum, error));
+}
+
+LOGOS_TEST(loadEmbeddedIndex_replaces_embedded_scan_until_rejected) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path embedded = scratch.path / "app" / "modules";
+    const fs::path user = scratch.path / "user";
+    fs::create_directories(embedded);
+    setMockInstalledModules({TestPackage("core_ext").embedded().installedUnder(embedded.string()),
+                             TestPackage("user_mod").installedUnder(user.string())});
+    setMockInstalledUiPlugins({});
+
+    PackageManagerImpl impl;
+    impl.setEmbeddedModulesDirectory(embedded.string());
+    const fs::path indexFile = scratch.path / "app" / "embedded.idx";
+    LogosMap written = impl.writeEmbeddedIndex(indexFile.string());
+    LOGOS_ASSERT_TRUE(written["success"].get<bool>());
+    LOGOS_ASSERT_EQ(written["packages"].get<int64_t>(), static_cast<int64_t>(1));
+
+    // The live scan now disagrees with the index: the index must win for
+    // embedded packages, and the scan for user ones.
+    setMockInstalledPackages({TestPackage("stale_scan").embedded().installedUnder(embedded.string()),
+                              TestPackage("user_mod").installedUnder(user.string())});
+    LogosMap loaded = impl.loadEmbeddedIndex(indexFile.string());
+    LOGOS_ASSERT_TRUE(loaded["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(loaded["active"].get<bool>());
+    LOGOS_ASSERT_EQ(loaded["checksum"], written["checksum"]);
+    LOGOS_ASSERT_TRUE(names(impl.getInstalledPackages()) == (std::vector<std::string>{"core_ext", "user_mod"}));
+    LOGOS_ASSERT_EQ(impl.countInstalledPackages("embedded", "", "")["count"].get<int64_t>(), static_cast<int64_t>(1));
+
+    // A directory the index was not built from switches back to scanning.
+    impl.addEmbeddedModulesDirectory((scratch.path / "extra").string());
+    LOGOS_ASSERT_TRUE(names(impl.getInstalledPackages()) == (std::vector<std::string>{"stale_scan", "user_mod"}));
+    impl.setEmbeddedModulesDirectory(embedded.string());
+    LOGOS_ASSERT_EQ(names(impl.getInstalledPackages())[0], std::string("core_ext"));
+
+    // A corrupted file is rejected and scans stay real.
+    std::string raw = readFile(indexFile);
+    raw.back() ^= 0x01;
+    writeFile(indexFile, raw);
+    loaded = impl.loadEmbeddedIndex(indexFile.string());
+    LOGOS_ASSERT_FALSE(loaded["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(loaded["active"].get<bool>());
+    LOGOS_ASSERT_EQ(names(impl.getInstalledPackages())[0], std::string("stale_scan"));
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(text.find("logos_package_manager_embedded_index_loads_total{result=\"rejected\"} 1")
+                      != std::string::npos);
+}
@@ -0,0 +1,168 @@
+// Unit tests for the fileops helpers (src/file_ops.h) behind the module-side
+// install paths: tree copies, leaf diffs and diff-only staging.
+
+#include <logos_test.h>
+#include "file_ops.h"
+#include "worker_pool.h"
+#include "scratch_dir.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// old: keep.txt, edit.txt, drop.txt, sub/deep.txt
+// new: keep.txt (same), edit.txt (same size, different bytes),
+//      sub/deep.txt (same), sub/new.txt (added)
+void makeVersionPair(const fs::path& root) {
+    writeFile(root / "old" / "keep.txt", "unchanged");
+    writeFile(root / "old" / "edit.txt", "version-1");
+    writeFile(root / "old" / "drop.txt", "gone soon");
+    writeFile(root / "old" / "sub" / "deep.txt", "deep");
+    writeFile(root / "new" / "keep.txt", "unchanged");
+    writeFile(root / "new" / "edit.txt", "version-2");
+    writeFile(root / "new" / "sub" / "deep.txt", "deep");
+    writeFile(root / "new" / "sub" / "new.txt", "fresh");
+}
+
+} // namespace
+
+LOGOS_TEST(fileops_copyTree_copies_nested_files_and_mode_bits) {
+    ScratchDir scratch;
+    writeFile(scratch.path / "src" / "a.so", "lib");
+    writeFile(scratch.path / "src" / "qml" / "x" / "Main.qml", "Item {}");
+    ::chmod((scratch.path / "src" / "a.so").c_str(), 0755);
+
+    WorkerPool pool(2);
+    fileops::CopyStats stats;
+    std::string err;
+    LOGOS_ASSERT_TRUE(fileops::copyTree(scratch.path / "src", scratch.path / "dst",
+                                        fileops::CopyMode::Copy, &pool, stats, err));
+    LOGOS_ASSERT_EQ(stats.files, static_cast<uint64_t>(2));
+    LOGOS_ASSERT_EQ(stats.directories, static_cast<uint64_t>(2));
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "dst" / "qml" / "x" / "Main.qml"), std::string("Item {}"));
+    auto perms = fs::status(scratch.path / "dst" / "a.so").permissions();
+    LOGOS_ASSERT_TRUE((perms & fs::perms::owner_exec) != fs::perms::none);
+}
+
+LOGOS_TEST(fileops_diffTrees_classifies_every_leaf) {
+    ScratchDir scratch;
+    makeVersionPair(scratch.path);
+
+    fileops::TreeDiff diff;
+    std::string err;
+    LOGOS_ASSERT_TRUE(fileops::diffTrees(scratch.path / "old", scratch.path / "new",
+                                         nullptr, diff, err));
+    LOGOS_ASSERT_EQ(diff.added.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(diff.added[0].generic_string(), std::string("sub/new.txt"));
+    LOGOS_ASSERT_EQ(diff.changed.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(diff.changed[0].generic_string(), std::string("edit.txt"));
+    LOGOS_ASSERT_EQ(diff.removed.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(diff.removed[0].generic_string(), std::string("drop.txt"));
+    LOGOS_ASSERT_EQ(diff.unchanged.size(), static_cast<size_t>(2));
+    // "fresh" + "version-2"
+    LOGOS_ASSERT_EQ(diff.bytesToWrite, static_cast<uint64_t>(14));
+}
+
+LOGOS_TEST(fileops_diffTrees_lets_known_digests_settle_same_size_leaves) {
+    ScratchDir scratch;
+    makeVersionPair(scratch.path);
+
+    // Knows keep.txt only, and claims it changed: the verdict is taken
+    // as given, and everything else falls back to the byte compare.
+    std::vector<std::string> asked;
+    fileops::KnownLeaf known = [&asked](const fs::path& rel, bool& equal) {
+        asked.push_back(rel.generic_string());
+        if (rel.generic_string() != "keep.txt") return false;
+        equal = false;
+        return true;
+    };
+    fileops::TreeDiff diff;
+    std::string err;
+    LOGOS_ASSERT_TRUE(fileops::diffTrees(scratch.path / "old", scratch.path / "new",
+                                         nullptr, diff, err, known));
+    LOGOS_ASSERT_EQ(diff.settledByKnown, static_cast<uint64_t>(1));
+    LOGOS_ASSERT_EQ(diff.changed.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(diff.unchanged.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(diff.unchanged[0].generic_string(), std::string("sub/deep.txt"));
+    // Only leaves in both trees with equal sizes are asked about.
+    std::sort(asked.begin(), asked.end());
+    LOGOS_ASSERT_TRUE(asked == (std::vector<std::string>{"edit.txt", "keep.txt", "sub/deep.txt"}));
+}
+
+LOGOS_TEST(fileops_stageFromDiff_links_unchanged_and_moves_changed) {
+    ScratchDir scratch;
+    makeVersionPair(scratch.path);
+    const fs::path oldDir = scratch.path / "old";
+    const fs::path newDir = scratch.path / "new";
+    const fs::path staged = scratch.path / "staged";
+
+    WorkerPool pool(2);
+    fileops::TreeDiff diff;
+    fileops::CopyStats stats;
+    std::string err;
+    LOGOS_ASSERT_TRUE(fileops::diffTrees(oldDir, newDir, &pool, diff, err));
+    LOGOS_ASSERT_TRUE(fileops::stageFromDiff(oldDir, newDir, diff, staged, &pool, stats, err));
+
+    LOGOS_ASSERT_EQ(readFile(staged / "edit.txt"), std::string("version-2"));
+    LOGOS_ASSERT_EQ(readFile(staged / "sub" / "new.txt"), std::string("fresh"));
+    LOGOS_ASSERT_FALSE(fs::exists(staged / "drop.txt"));
+    // Unchanged leaves share the old inode rather than being rewritten.
+    LOGOS_ASSERT_TRUE(fs::equivalent(staged / "keep.txt", oldDir / "keep.txt"));
+    LOGOS_ASSERT_TRUE(fs::equivalent(staged / "sub" / "deep.txt", oldDir / "sub" / "deep.txt"));
+    LOGOS_ASSERT_EQ(stats.files, static_cast<uint64_t>(2));
+    // The old tree itself is untouched.
+    LOGOS_ASSERT_EQ(readFile(oldDir / "edit.txt"), std::string("version-1"));
+}
+
+LOGOS_TEST(fileops_exchangePaths_swaps_directories) {
+    ScratchDir scratch;
+    writeFile(scratch.path / "a" / "v.txt", "A");
+    writeFile(scratch.path / "b" / "v.txt", "B");
+
+    bool atomic = false;
+    std::string err;
+    LOGOS_ASSERT_TRUE(fileops::exchangePaths(scratch.path / "a", scratch.path / "b", atomic, err));
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "a" / "v.txt"), std::string("B"));
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "b" / "v.txt"), std::string("A"));
+    // The non-atomic fallback must not leave its temporary name behind.
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "b.pm-swap"));
+}
+
+LOGOS_TEST(fileops_exchangeByRenames_undoes_a_failed_last_step) {
+    ScratchDir scratch;
+    writeFile(scratch.path / "a" / "v.txt", "A");
+    writeFile(scratch.path / "b" / "v.txt", "B");
+
+    // The third rename ("<b>.pm-swap" -> a) fails; the first two must be
+    // reversed rather than leave `a` live at `b` and the old `b` stranded.
+    static int calls;
+    calls = 0;
+    std::string err;
+    LOGOS_ASSERT_FALSE(fileops::exchangeByRenames(
+        scratch.path / "a", scratch.path / "b", err,
+        [](const fs::path& from, const fs::path& to, std::error_code& ec) {
+            if (++calls == 3) ec = std::make_error_code(std::errc::io_error);
+            else fs::rename(from, to, ec);
+        }));
+    LOGOS_ASSERT_FALSE(err.empty());
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "a" / "v.txt"), std::string("A"));
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "b" / "v.txt"), std::string("B"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "b.pm-swap"));
+}
+
+LOGOS_TEST(fileops_exchangePaths_requires_both_paths) {
+    ScratchDir scratch;
+    writeFile(scratch.path / "a" / "v.txt", "A");
+
+    bool atomic = false;
+    std::string err;
+    LOGOS_ASSERT_FALSE(fileops::exchangePaths(scratch.path / "a", scratch.path / "missing", atomic, err));
+    LOGOS_ASSERT_FALSE(err.empty());
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "a" / "v.txt"), std::string("A"));
+}
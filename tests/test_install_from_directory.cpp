@@ -0,0 +1,206 @@
+// Unit tests for PackageManagerImpl::installFromDirectory — the developer
+// install path that places an unpacked build directory into the user
+// modules / UI plugins directory without going through an .lgx.
+//
+// These run against real temporary directories; PackageManagerLib is still
+// the mock (only isEmbedded's scan touches it).
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+
+#include <filesystem>
+#include <string>
+
+using logos_test::EventCapture;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A build directory for `name` with a manifest, a main library and a nested
+// QML file so tree copies have a subdirectory to recreate.
+fs::path makeBuildDir(const fs::path& root, const std::string& name, const std::string& type) {
+    fs::path dir = root / "build" / name;
+    writeFile(dir / "manifest.json",
+              "{\"name\":\"" + name + "\",\"type\":\"" + type
+              + "\",\"version\":\"0.0.1-dev\",\"main\":\"" + name + "_plugin.so\"}");
+    writeFile(dir / (name + "_plugin.so"), "binary");
+    writeFile(dir / "qml" / "Main.qml", "Item {}");
+    return dir;
+}
+
+} // namespace
+
+LOGOS_TEST(installFromDirectory_symlink_links_dir_and_emits_core_event) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    fs::path build = makeBuildDir(scratch.path, "devmod", "core");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+
+    LogosMap r = impl.installFromDirectory(build.string(), "symlink");
+    LOGOS_ASSERT_FALSE(r.contains("error"));
+    LOGOS_ASSERT_TRUE(r["isCoreModule"].get<bool>());
+
+    fs::path installDir = scratch.path / "modules" / "devmod";
+    LOGOS_ASSERT_TRUE(fs::is_symlink(installDir));
+    LOGOS_ASSERT_EQ(r["path"].get<std::string>(), (installDir / "devmod_plugin.so").string());
+
+    // Edits in the build tree are visible through the install immediately.
+    writeFile(build / "qml" / "Main.qml", "Item { id: edited }");
+    LOGOS_ASSERT_EQ(readFile(installDir / "qml" / "Main.qml"), std::string("Item { id: edited }"));
+
+    auto installed = events.all("corePluginFileInstalled");
+    LOGOS_ASSERT_EQ(installed.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(installed[0].data, (installDir / "devmod_plugin.so").string());
+}
+
+LOGOS_TEST(installFromDirectory_copy_recreates_tree_and_emits_ui_event) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    fs::path build = makeBuildDir(scratch.path, "devui", "ui");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserUiPluginsDirectory((scratch.path / "ui").string());
+
+    LogosMap r = impl.installFromDirectory(build.string(), "copy");
+    LOGOS_ASSERT_FALSE(r.contains("error"));
+    LOGOS_ASSERT_FALSE(r["isCoreModule"].get<bool>());
+    LOGOS_ASSERT_EQ(r["files"].get<int64_t>(), static_cast<int64_t>(3));
+
+    fs::path installDir = scratch.path / "ui" / "devui";
+    LOGOS_ASSERT_FALSE(fs::is_symlink(installDir));
+    LOGOS_ASSERT_EQ(readFile(installDir / "qml" / "Main.qml"), std::string("Item {}"));
+
+    // A copy is detached from the build tree.
+    writeFile(build / "qml" / "Main.qml", "changed");
+    LOGOS_ASSERT_EQ(readFile(installDir / "qml" / "Main.qml"), std::string("Item {}"));
+    LOGOS_ASSERT_TRUE(events.has("uiPluginFileInstalled"));
+}
+
+LOGOS_TEST(installFromDirectory_reflink_falls_back_to_copy) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    fs::path build = makeBuildDir(scratch.path, "devref", "core");
+
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+
+    // Whether or not the temp filesystem supports clones, every file must end
+    // up with the right contents.
+    LogosMap r = impl.installFromDirectory(build.string(), "reflink");
+    LOGOS_ASSERT_FALSE(r.contains("error"));
+    LOGOS_ASSERT_TRUE(r.contains("reflinkFallbacks"));
+    LOGOS_ASSERT_EQ(readFile(scratch.path / "modules" / "devref" / "devref_plugin.so"),
+                    std::string("binary"));
+}
+
+LOGOS_TEST(installFromDirectory_replaces_previous_install) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    fs::path build = makeBuildDir(scratch.path, "devmod", "core");
+
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    writeFile(scratch.path / "modules" / "devmod" / "stale.txt", "old");
+
+    LogosMap r = impl.installFromDirectory(build.string(), "copy");
+    LOGOS_ASSERT_FALSE(r.contains("error"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / "devmod" / "stale.txt"));
+}
+
+LOGOS_TEST(installFromDirectory_refuses_a_source_inside_the_install) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path modules = scratch.path / "modules";
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory(modules.string());
+    LOGOS_ASSERT_FALSE(impl.installFromDirectory(makeBuildDir(scratch.path, "devmod", "core").string(),
+                                                 "copy").contains("error"));
+
+    // Pointed at the copy-mode install itself: nothing is removed.
+    LogosMap r = impl.installFromDirectory((modules / "devmod").string(), "copy");
+    LOGOS_ASSERT_TRUE(r["error"].get<std::string>().find("overlaps the install directory")
+                      != std::string::npos);
+    LOGOS_ASSERT_EQ(readFile(modules / "devmod" / "devmod_plugin.so"), std::string("binary"));
+
+    writeFile(modules / "devmod" / "nested" / "manifest.json", R"({"name":"devmod","type":"core"})");
+    r = impl.installFromDirectory((modules / "devmod" / "nested").string(), "symlink");
+    LOGOS_ASSERT_TRUE(r.contains("error"));
+    LOGOS_ASSERT_FALSE(fs::is_symlink(modules / "devmod"));
+    LOGOS_ASSERT_FALSE(fs::exists(modules / ".pm-staging"));
+}
+
+LOGOS_TEST(installFromDirectory_reinstalls_through_a_symlinked_install) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path build = makeBuildDir(scratch.path, "devmod", "core");
+    const fs::path modules = scratch.path / "modules";
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory(modules.string());
+    LOGOS_ASSERT_FALSE(impl.installFromDirectory(build.string(), "symlink").contains("error"));
+
+    // The link path reads through to the build tree, which is copied.
+    LogosMap r = impl.installFromDirectory((modules / "devmod").string(), "copy");
+    LOGOS_ASSERT_FALSE(r.contains("error"));
+    LOGOS_ASSERT_FALSE(fs::is_symlink(modules / "devmod"));
+    LOGOS_ASSERT_EQ(readFile(modules / "devmod" / "qml" / "Main.qml"), std::string("Item {}"));
+    LOGOS_ASSERT_TRUE(fs::exists(build / "devmod_plugin.so"));
+}
+
+LOGOS_TEST(installFromDirectory_rejects_invalid_mode) {
+    auto t = LogosTestContext("package_manager");
+    EventCapture events;
+    PackageManagerImpl impl;
+    LogosMap r = impl.installFromDirectory("/anywhere", "hardlink");
+    LOGOS_ASSERT_EQ(r["error"].get<std::string>(),
+                    std::string("Invalid mode 'hardlink' - expected one of: symlink, reflink, copy, "
+                                "copy_file_range"));
+    LOGOS_ASSERT_EQ(events.size(), static_cast<size_t>(0));
+}
+
+LOGOS_TEST(installFromDirectory_requires_manifest) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+
+    LogosMap r = impl.installFromDirectory(scratch.path.string(), "symlink");
+    LOGOS_ASSERT_TRUE(r["error"].get<std::string>().find("No manifest.json") != std::string::npos);
+}
+
+LOGOS_TEST(installFromDirectory_requires_user_directory) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    fs::path build = makeBuildDir(scratch.path, "devmod", "core");
+
+    PackageManagerImpl impl;
+    LogosMap r = impl.installFromDirectory(build.string(), "symlink");
+    LOGOS_ASSERT_EQ(r["error"].get<std::string>(),
+                    std::string("User modules directory is not configured"));
+}
+
+LOGOS_TEST(installFromDirectory_refuses_to_shadow_embedded) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    fs::path build = makeBuildDir(scratch.path, "core_embed", "core");
+    InstalledPackage pkg;
+    pkg.name = "core_embed";
+    pkg.installType = InstallType::Embedded;
+    setMockInstalledPackages({pkg});
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+
+    LogosMap r = impl.installFromDirectory(build.string(), "symlink");
+    LOGOS_ASSERT_EQ(r["error"].get<std::string>(),
+                    std::string("Cannot replace embedded module 'core_embed'"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / "core_embed"));
+    LOGOS_ASSERT_FALSE(events.has("corePluginFileInstalled"));
+}
@@ -0,0 +1,221 @@
+// Unit tests for the shared-memory installed index: the publisher
+// (src/installed_shm_publisher.h), the header-only reader
+// (src/installed_shm.h) and the setSharedIndexPublishing slot.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "installed_shm.h"
+#include "installed_shm_publisher.h"
+#include "package_index.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "test_packages.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using logos_test::EventCapture;
+
+namespace {
+
+// Unique per process, so parallel test runs do not share a segment.
+std::string segmentName(const std::string& test) {
+    return "/logos-pm-test-" + test + "-" + std::to_string(::getpid());
+}
+
+} // namespace
+
+LOGOS_TEST(installedShm_publishes_packages_and_both_edge_directions) {
+    const std::string name = segmentName("roundtrip");
+    InstalledShmPublisher publisher;
+    std::string error;
+    LOGOS_ASSERT_TRUE(publisher.open(name, error));
+
+    installed_shm::Reader reader;
+    LOGOS_ASSERT_TRUE(reader.open(name, &error));
+    LOGOS_ASSERT_EQ(reader.generation(), static_cast<uint64_t>(0));
+    LOGOS_ASSERT_TRUE(reader.names().empty());
+    LOGOS_ASSERT_TRUE(reader.publisherAlive());
+
+    const InstalledPackage crypto =
+        TestPackage("crypto").version("1.2.0").root("abc").embedded().installedUnder("/user/modules");
+    const InstalledPackage wallet = TestPackage("wallet").version("2.0.0").installedUnder("/user/modules")
+                                        .dependencies({"net", "crypto", "absent"});
+    const InstalledPackage net =
+        TestPackage("net").version("1.0.0").installedUnder("/user/modules").dependencies({"crypto"});
+    LOGOS_ASSERT_TRUE(publisher.publish(PackageIndex({wallet, net, crypto}), error));
+    LOGOS_ASSERT_EQ(publisher.generation(), static_cast<uint64_t>(1));
+    LOGOS_ASSERT_EQ(reader.generation(), static_cast<uint64_t>(1));
+    LOGOS_ASSERT_TRUE(reader.names() == (std::vector<std::string>{"crypto", "net", "wallet"}));
+
+    auto wallet = reader.find("wallet");
+    LOGOS_ASSERT_TRUE(wallet.has_value());
+    LOGOS_ASSERT_EQ(wallet->version, std::string("2.0.0"));
+    LOGOS_ASSERT_EQ(wallet->mainFilePath, std::string("/user/modules/wallet/libwallet.so"));
+    LOGOS_ASSERT_FALSE(wallet->embedded);
+    LOGOS_ASSERT_TRUE(wallet->dependencies == (std::vector<std::string>{"net", "crypto", "absent"}));
+    LOGOS_ASSERT_TRUE(reader.find("crypto")->embedded);
+    LOGOS_ASSERT_EQ(reader.find("crypto")->hashRoot, std::string("abc"));
+    LOGOS_ASSERT_FALSE(reader.find("absent").has_value());
+
+    std::vector<std::string> dependents = reader.dependents("crypto");
+    std::sort(dependents.begin(), dependents.end());
+    LOGOS_ASSERT_TRUE(dependents == (std::vector<std::string>{"net", "wallet"}));
+    uint32_t netRecord = 0, netTarget = 0, absentTarget = 0;
+    LOGOS_ASSERT_TRUE(reader.read([&](const installed_shm::View& v) {
+        const uint32_t w = v.find("wallet");
+        netRecord = v.find("net");
+        netTarget = v.dependencyTarget(w, 0);
+        absentTarget = v.dependencyTarget(w, 2);
+    }));
+    LOGOS_ASSERT_EQ(netTarget, netRecord);
+    LOGOS_ASSERT_EQ(absentTarget, installed_shm::kNone);
+
+    // A payload past the initial capacity grows the segment; the open
+    // reader remaps.
+    std::vector<InstalledPackage> many;
+    for (int i = 0; i < 2000; ++i)
+        many.push_back(TestPackage("pkg" + std::to_string(i)).version("1.0.0").installedUnder("/user/modules")
+                           .dependencies(i ? std::vector<std::string>{"pkg0"} : std::vector<std::string>{}));
+    LOGOS_ASSERT_TRUE(publisher.publish(PackageIndex(many), error));
+    LOGOS_ASSERT_EQ(reader.names().size(), static_cast<size_t>(2000));
+    LOGOS_ASSERT_EQ(reader.dependents("pkg0").size(), static_cast<size_t>(1999));
+
+    // Closing retires the segment under the reader and unlinks the name.
+    publisher.close();
+    LOGOS_ASSERT_FALSE(reader.find("pkg1").has_value());
+    installed_shm::Reader late;
+    LOGOS_ASSERT_FALSE(late.open(name, &error));
+}
+
+LOGOS_TEST(installedShm_reader_never_sees_a_torn_snapshot) {
+    const std::string name = segmentName("torn");
+    InstalledShmPublisher publisher;
+    std::string error;
+    LOGOS_ASSERT_TRUE(publisher.open(name, error));
+
+    // Two sets that differ in every version, and in size.
+    std::vector<InstalledPackage> a, b;
+    for (int i = 0; i < 50; ++i)
+        a.push_back(TestPackage("pkg" + std::to_string(i)).version("1.0.0").installedUnder("/user/modules"));
+    for (int i = 0; i < 80; ++i)
+        b.push_back(TestPackage("pkg" + std::to_string(i)).version("22.0.0").installedUnder("/user/modules"));
+    const PackageIndex indexA(a), indexB(b);
+    LOGOS_ASSERT_TRUE(publisher.publish(indexA, error));
+
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        std::string e;
+        for (int i = 0; !done.load(); ++i) publisher.publish(i % 2 ? indexA : indexB, e);
+    });
+
+    installed_shm::Reader reader;
+    LOGOS_ASSERT_TRUE(reader.open(name, &error));
+    int torn = 0, reads = 0;
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (std::chrono::steady_clock::now() < until) {
+        bool consistent = false;
+        if (!reader.read([&](const installed_shm::View& v) {
+                const std::string_view version = v.version(0);
+                const size_t expected = version == "1.0.0" ? 50 : 80;
+                consistent = v.size() == expected;
+                for (uint32_t i = 0; consistent && i < v.size(); ++i) consistent = v.version(i) == version;
+            }))
+            continue;
+        ++reads;
+        if (!consistent) ++torn;
+    }
+    done = true;
+    writer.join();
+    LOGOS_ASSERT_TRUE(reads > 0);
+    LOGOS_ASSERT_EQ(torn, 0);
+}
+
+LOGOS_TEST(installedShm_open_takes_over_only_a_dead_publishers_segment) {
+    const std::string name = segmentName("takeover");
+    InstalledShmPublisher first;
+    std::string error;
+    LOGOS_ASSERT_TRUE(first.open(name, error));
+    const InstalledPackage net = TestPackage("net").version("1.0.0").installedUnder("/user/modules");
+    LOGOS_ASSERT_TRUE(first.publish(PackageIndex({net}), error));
+    installed_shm::Reader reader;
+    LOGOS_ASSERT_TRUE(reader.open(name, &error));
+
+    // A live publisher keeps its segment, and its readers keep reading.
+    InstalledShmPublisher second;
+    LOGOS_ASSERT_FALSE(second.open(name, error));
+    LOGOS_ASSERT_TRUE(error.find("already published") != std::string::npos);
+    LOGOS_ASSERT_EQ(reader.find("net")->version, std::string("1.0.0"));
+    first.close();
+
+    // A segment left by a publisher that died without retiring it is taken
+    // over. No process can have a pid above the kernel's 2^22 limit.
+    const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    LOGOS_ASSERT_TRUE(fd >= 0);
+    LOGOS_ASSERT_EQ(::ftruncate(fd, sizeof(installed_shm::Header)), 0);
+    void* map = ::mmap(nullptr, sizeof(installed_shm::Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    LOGOS_ASSERT_TRUE(map != MAP_FAILED);
+    auto* stale = new (map) installed_shm::Header{};
+    std::memcpy(stale->magic, installed_shm::kMagic, sizeof(installed_shm::kMagic));
+    stale->publisherPid = 0x7ffffff0;
+    LOGOS_ASSERT_TRUE(second.open(name, error));
+    LOGOS_ASSERT_TRUE(stale->flags & installed_shm::FlagRetired);
+    ::munmap(map, sizeof(installed_shm::Header));
+    ::close(fd);
+}
+
+LOGOS_TEST(setSharedIndexPublishing_republishes_when_the_installed_set_changes) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages({TestPackage("net").version("1.0.0").installedUnder("/user/modules")});
+
+    PackageManagerImpl impl;
+    const std::string name = segmentName("slot");
+    LogosMap enabled = impl.setSharedIndexPublishing(true, name);
+    LOGOS_ASSERT_TRUE(enabled["success"].get<bool>());
+    LOGOS_ASSERT_EQ(enabled["name"].get<std::string>(), name);
+    LOGOS_ASSERT_EQ(enabled["generation"].get<int64_t>(), static_cast<int64_t>(1));
+
+    installed_shm::Reader reader;
+    std::string error;
+    LOGOS_ASSERT_TRUE(reader.open(name, &error));
+    LOGOS_ASSERT_EQ(reader.find("net")->version, std::string("1.0.0"));
+
+    // Configuring directories only drops the index; nothing is scanned yet.
+    setMockInstalledPackages({TestPackage("net").version("1.1.0").installedUnder("/user/modules"),
+                              TestPackage("wallet").version("2.0.0").installedUnder("/user/modules")
+                                  .dependencies({"net"})});
+    impl.setUserModulesDirectory("/user/modules");
+    impl.setUserUiPluginsDirectory("/user/ui");
+    impl.setEmbeddedModulesDirectory("/embedded/modules");
+    impl.setEmbeddedUiPluginsDirectory("/embedded/ui");
+    LOGOS_ASSERT_EQ(reader.find("net")->version, std::string("1.0.0"));
+
+    // Readers never call in: an install is published without any query,
+    // once, before its event goes out.
+    EventCapture events;
+    t.mockCFunction("installPluginFile_result").returns("/user/modules/wallet/libwallet.so");
+    t.mockCFunction("installPluginFile_installedPath").returns("/user/modules/wallet/libwallet.so");
+    t.mockCFunction("installPluginFile_isCore").returns(true);
+    LOGOS_ASSERT_EQ(impl.installPlugin("/tmp/wallet.lgx", false)["path"].get<std::string>(),
+                    std::string("/user/modules/wallet/libwallet.so"));
+    LOGOS_ASSERT_EQ(events.all("corePluginFileInstalled").size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(reader.find("net")->version, std::string("1.1.0"));
+    LOGOS_ASSERT_TRUE(reader.dependents("net") == (std::vector<std::string>{"wallet"}));
+    LOGOS_ASSERT_TRUE(impl.getMetricsText().find("logos_package_manager_shared_index_publishes_total 2")
+                      != std::string::npos);
+
+    LOGOS_ASSERT_FALSE(impl.setSharedIndexPublishing(true, "no-slash")["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(reader.find("net").has_value());
+    LogosMap disabled = impl.setSharedIndexPublishing(false, "");
+    LOGOS_ASSERT_TRUE(disabled["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(disabled["enabled"].get<bool>());
+}
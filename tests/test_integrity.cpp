@@ -0,0 +1,285 @@
+// Unit tests for integrity baselines (src/integrity.h), the verifyInstalled
+// slot and the background scrubber.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "integrity.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+#include "test_packages.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using logos_test::EventCapture;
+
+namespace {
+
+std::string hexOf(const std::string& data) {
+    return integrity::toHex(integrity::sha256(data.data(), data.size()));
+}
+
+bool contains(const LogosMap& list, const std::string& value) {
+    return std::find(list.begin(), list.end(), LogosMap(value)) != list.end();
+}
+
+bool hasLine(const std::string& text, const std::string& line) {
+    return text.find("\n" + line + "\n") != std::string::npos;
+}
+
+void writePackage(const fs::path& dir, const std::string& root = "root-net") {
+    writeFile(dir / "manifest.json", R"({"name": "net", "version": "1.0.0", "hashes": {"root": ")" + root + R"("}})");
+    writeFile(dir / "libnet.so", std::string(200000, 'x'));
+    writeFile(dir / "qml/Main.qml", "Item {}");
+}
+
+// Reports `mainFile` as installed through installPlugin, so the module
+// takes the package's install-time baseline.
+template <typename Context>
+void installThroughModule(Context& t, PackageManagerImpl& impl, const fs::path& mainFile) {
+    const std::string path = mainFile.string();
+    t.mockCFunction("installPluginFile_result").returns(path.c_str());
+    t.mockCFunction("installPluginFile_installedPath").returns(path.c_str());
+    t.mockCFunction("installPluginFile_isCore").returns(true);
+    impl.installPlugin("/tmp/" + mainFile.parent_path().filename().string() + ".lgx", false);
+}
+
+// Polls the scrubber until `done` holds or `ms` pass.
+template <typename Pred>
+LogosMap waitForStatus(PackageManagerImpl& impl, Pred done, int ms = 5000) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    LogosMap status = impl.getIntegrityScrubberStatus();
+    while (!done(status) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        status = impl.getIntegrityScrubberStatus();
+    }
+    return status;
+}
+
+} // namespace
+
+LOGOS_TEST(integrity_sha256_matches_known_vectors) {
+    LOGOS_ASSERT_EQ(hexOf(""), std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    LOGOS_ASSERT_EQ(hexOf("abc"), std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    LOGOS_ASSERT_EQ(hexOf("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                    std::string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+    integrity::Digest d{};
+    LOGOS_ASSERT_TRUE(integrity::fromHex(hexOf("abc"), d));
+    LOGOS_ASSERT_EQ(integrity::toHex(d), hexOf("abc"));
+    LOGOS_ASSERT_FALSE(integrity::fromHex("zz", d));
+}
+
+LOGOS_TEST(integrity_verify_reports_changes_and_trusts_unchanged_fingerprints) {
+    ScratchDir scratch;
+    const fs::path dir = scratch.path / "net";
+    writePackage(dir);
+
+    integrity::Baseline baseline;
+    std::string error;
+    LOGOS_ASSERT_TRUE(integrity::snapshot(dir, nullptr, baseline, error));
+    LOGOS_ASSERT_EQ(baseline.files.size(), static_cast<size_t>(3));
+
+    integrity::Report clean;
+    bool refreshed = false;
+    LOGOS_ASSERT_TRUE(integrity::verify(dir, baseline, false, nullptr, clean, refreshed, error));
+    LOGOS_ASSERT_TRUE(clean.clean());
+    LOGOS_ASSERT_EQ(clean.filesHashed, static_cast<uint64_t>(0));
+    LOGOS_ASSERT_EQ(clean.filesSkipped, static_cast<uint64_t>(3));
+    LOGOS_ASSERT_TRUE(clean.root == integrity::merkleRoot(baseline.files));
+
+    // Same size, mtime restored: only a rehash notices the flipped byte.
+    const auto mtime = fs::last_write_time(dir / "libnet.so");
+    writeFile(dir / "libnet.so", std::string(199999, 'x') + "y");
+    fs::last_write_time(dir / "libnet.so", mtime);
+    integrity::Report trusted;
+    LOGOS_ASSERT_TRUE(integrity::verify(dir, baseline, false, nullptr, trusted, refreshed, error));
+    LOGOS_ASSERT_TRUE(trusted.clean());
+    integrity::Report rehashed;
+    LOGOS_ASSERT_TRUE(integrity::verify(dir, baseline, true, nullptr, rehashed, refreshed, error));
+    LOGOS_ASSERT_TRUE(rehashed.mismatched == std::vector<std::string>{"libnet.so"});
+    LOGOS_ASSERT_TRUE(rehashed.root != integrity::merkleRoot(baseline.files));
+
+    fs::remove(dir / "qml/Main.qml");
+    writeFile(dir / "stray.txt", "?");
+    integrity::Report changed;
+    LOGOS_ASSERT_TRUE(integrity::verify(dir, baseline, false, nullptr, changed, refreshed, error));
+    LOGOS_ASSERT_TRUE(changed.missing == std::vector<std::string>{"qml/Main.qml"});
+    LOGOS_ASSERT_TRUE(changed.extra == std::vector<std::string>{"stray.txt"});
+
+    // Baselines survive a save / load round trip.
+    integrity::Baseline loaded;
+    LOGOS_ASSERT_TRUE(integrity::saveBaseline(scratch.path / "b.json", baseline, error));
+    LOGOS_ASSERT_TRUE(integrity::loadBaseline(scratch.path / "b.json", loaded));
+    LOGOS_ASSERT_TRUE(integrity::merkleRoot(loaded.files) == integrity::merkleRoot(baseline.files));
+}
+
+LOGOS_TEST(verifyInstalled_checks_install_time_baseline_and_detects_modified_files) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path dir = scratch.path / "modules" / "net";
+    writePackage(dir, "root-1");
+    InstalledPackage p = TestPackage("net").installDir(dir.string()).root("root-1");
+    setMockInstalledPackages({p});
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+
+    // Placed by someone else: nothing vouches for it, and nothing is recorded.
+    LogosMap result = impl.verifyInstalled(LogosList::array(), false);
+    LOGOS_ASSERT_TRUE(result["success"].get<bool>());
+    LOGOS_ASSERT_EQ(result["packages"][0]["status"].get<std::string>(), std::string("unverified"));
+    LOGOS_ASSERT_EQ(result["packages"][0]["reason"].get<std::string>(), std::string("no install-time baseline"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / ".pm-integrity" / "net.json"));
+    LOGOS_ASSERT_EQ(result["counts"]["unverified"].get<int64_t>(), static_cast<int64_t>(1));
+
+    installThroughModule(t, impl, dir / "libnet.so");
+    LOGOS_ASSERT_TRUE(fs::exists(scratch.path / "modules" / ".pm-integrity" / "net.json"));
+
+    result = impl.verifyInstalled(LogosList::array({"net", "ghost"}), false);
+    LOGOS_ASSERT_EQ(result["packages"][0]["status"].get<std::string>(), std::string("ok"));
+    LOGOS_ASSERT_EQ(result["packages"][0]["filesSkipped"].get<int64_t>(), static_cast<int64_t>(3));
+    LOGOS_ASSERT_EQ(result["packages"][1]["status"].get<std::string>(), std::string("notInstalled"));
+    LOGOS_ASSERT_EQ(result["counts"]["notInstalled"].get<int64_t>(), static_cast<int64_t>(1));
+
+    writeFile(dir / "libnet.so", "truncated");
+    result = impl.verifyInstalled(LogosList::array(), false);
+    const LogosMap& entry = result["packages"][0];
+    LOGOS_ASSERT_EQ(entry["status"].get<std::string>(), std::string("modified"));
+    LOGOS_ASSERT_TRUE(contains(entry["mismatched"], "libnet.so"));
+    LOGOS_ASSERT_EQ(entry["filesHashed"].get<int64_t>(), static_cast<int64_t>(1));
+    LOGOS_ASSERT_TRUE(entry["root"] != entry["baselineRoot"]);
+
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_integrity_violations_total 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_integrity_files_total{result=\"skipped\"} 5"));
+
+    // A manifest.json rewritten under the same root (a partial external
+    // copy) is reported, not taken as a new baseline.
+    writeFile(dir / "manifest.json", R"({"name": "net", "version": "1.10.0", "hashes": {"root": "root-1"}})");
+    result = impl.verifyInstalled(LogosList::array(), false);
+    LOGOS_ASSERT_EQ(result["packages"][0]["status"].get<std::string>(), std::string("modified"));
+    LOGOS_ASSERT_TRUE(contains(result["packages"][0]["mismatched"], "manifest.json"));
+
+    // A different root is content replaced from outside: not vouched for.
+    p.hashes.root = "root-2";
+    setMockInstalledPackages({p});
+    impl.setUserModulesDirectory((scratch.path / "modules").string());  // drops the cached index
+    result = impl.verifyInstalled(LogosList::array(), false);
+    LOGOS_ASSERT_EQ(result["packages"][0]["status"].get<std::string>(), std::string("unverified"));
+    LOGOS_ASSERT_EQ(result["packages"][0]["reason"].get<std::string>(),
+                    std::string("manifest root changed since the install-time baseline"));
+}
+
+LOGOS_TEST(installPlugin_takes_a_new_integrity_baseline) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path dir = scratch.path / "modules" / "net";
+    writePackage(dir);
+    setMockInstalledPackages({TestPackage("net").installDir(dir.string()).root("root-net")});
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    installThroughModule(t, impl, dir / "libnet.so");
+    LOGOS_ASSERT_EQ(impl.verifyInstalled(LogosList::array(), false)["packages"][0]["status"].get<std::string>(),
+                    std::string("ok"));
+
+    // Reinstalling rewrites the tree; the module knows, so nothing is flagged.
+    writeFile(dir / "libnet.so", "rebuilt");
+    const std::string mainFile = (dir / "libnet.so").string();
+    LOGOS_ASSERT_EQ(impl.installPlugin("/tmp/net.lgx", false)["path"].get<std::string>(), mainFile);
+    LOGOS_ASSERT_TRUE(fs::exists(scratch.path / "modules" / ".pm-integrity" / "net.json"));
+    LogosMap result = impl.verifyInstalled(LogosList::array(), true);
+    LOGOS_ASSERT_EQ(result["packages"][0]["status"].get<std::string>(), std::string("ok"));
+
+    // The same rewrite behind the module's back is caught.
+    writeFile(dir / "libnet.so", "rebuilt again");
+    result = impl.verifyInstalled(LogosList::array(), false);
+    LOGOS_ASSERT_EQ(result["packages"][0]["status"].get<std::string>(), std::string("modified"));
+}
+
+LOGOS_TEST(integrityScrubber_emits_violation_once_per_modification) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path dir = scratch.path / "modules" / "net";
+    writePackage(dir);
+    setMockInstalledPackages({TestPackage("net").installDir(dir.string()).root("root-net")});
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    installThroughModule(t, impl, dir / "libnet.so");
+
+    // Same size and mtime: only the scrubber's rehash can see it.
+    const auto mtime = fs::last_write_time(dir / "libnet.so");
+    writeFile(dir / "libnet.so", std::string(199999, 'x') + "y");
+    fs::last_write_time(dir / "libnet.so", mtime);
+
+    EventCapture events;
+    LogosMap options;
+    options["cycleIntervalMs"] = 1;
+    options["bytesPerSecond"] = int64_t(1) << 30;
+    LogosMap started = impl.startIntegrityScrubber(options);
+    LOGOS_ASSERT_TRUE(started["success"].get<bool>());
+    LOGOS_ASSERT_EQ(started["stateFile"].get<std::string>(),
+                    (scratch.path / "modules" / ".pm-integrity" / "scrubber.json").string());
+
+    auto e = events.waitFor("integrityViolation", 5000);
+    LOGOS_ASSERT_EQ(e.name, std::string("integrityViolation"));
+    const LogosMap payload = LogosMap::parse(e.data);
+    LOGOS_ASSERT_EQ(payload["name"].get<std::string>(), std::string("net"));
+    LOGOS_ASSERT_TRUE(contains(payload["mismatched"], "libnet.so"));
+
+    // Later passes keep finding it but do not report it again.
+    waitForStatus(impl, [](const LogosMap& s) { return s["cycle"].get<int64_t>() >= 3; });
+    LOGOS_ASSERT_EQ(events.all("integrityViolation").size(), static_cast<size_t>(1));
+    LogosMap stopped = impl.stopIntegrityScrubber();
+    LOGOS_ASSERT_TRUE(stopped["stopped"].get<bool>());
+    LogosMap status = impl.getIntegrityScrubberStatus();
+    LOGOS_ASSERT_FALSE(status["running"].get<bool>());
+    LOGOS_ASSERT_TRUE(status["violations"].get<int64_t>() >= 2);
+    LOGOS_ASSERT_FALSE(impl.stopIntegrityScrubber()["stopped"].get<bool>());
+
+    LogosMap bad;
+    bad["nice"] = 40;
+    LOGOS_ASSERT_FALSE(impl.startIntegrityScrubber(bad)["success"].get<bool>());
+    LogosMap noPause;
+    noPause["cycleIntervalMs"] = 0;
+    LOGOS_ASSERT_FALSE(impl.startIntegrityScrubber(noPause)["success"].get<bool>());
+}
+
+LOGOS_TEST(integrityScrubber_resumes_from_state_file_within_budget) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path a = scratch.path / "modules" / "a";
+    const fs::path b = scratch.path / "modules" / "b";
+    writeFile(a / "manifest.json", R"({"name": "a", "hashes": {"root": "root-a"}})");
+    writeFile(a / "liba.so", std::string(200000, 'a'));
+    writeFile(b / "manifest.json", R"({"name": "b", "hashes": {"root": "root-b"}})");
+    writeFile(b / "libb.so", std::string(200000, 'b'));
+    setMockInstalledPackages({TestPackage("b").installDir(b.string()).root("root-b"),
+                              TestPackage("a").installDir(a.string()).root("root-a")});
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    installThroughModule(t, impl, a / "liba.so");
+    installThroughModule(t, impl, b / "libb.so");
+
+    // A previous run finished "a" in its fourth pass: only "b" is left.
+    const fs::path state = scratch.path / "scrubber.json";
+    writeFile(state, R"({"cycle": 3, "resumeAfter": "a"})");
+    LogosMap options;
+    options["stateFile"] = state.string();
+    options["bytesPerSecond"] = 1000000;
+    const auto begin = std::chrono::steady_clock::now();
+    LOGOS_ASSERT_TRUE(impl.startIntegrityScrubber(options)["success"].get<bool>());
+    LogosMap status = waitForStatus(impl, [](const LogosMap& s) { return s["cycle"].get<int64_t>() == 4; });
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    LOGOS_ASSERT_EQ(status["cycle"].get<int64_t>(), static_cast<int64_t>(4));
+    LOGOS_ASSERT_EQ(status["packagesScrubbed"].get<int64_t>(), static_cast<int64_t>(1));
+    // ~200 KB of b's files at 1 MB/s.
+    LOGOS_ASSERT_TRUE(elapsed >= std::chrono::milliseconds(150));
+    LOGOS_ASSERT_TRUE(status["bytesHashed"].get<int64_t>() >= 200000);
+    impl.stopIntegrityScrubber();
+
+    LOGOS_ASSERT_TRUE(readFile(state).find("\"cycle\":4") != std::string::npos);
+}
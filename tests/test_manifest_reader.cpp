@@ -0,0 +1,166 @@
+// Unit tests for the on-demand manifest reader (src/manifest_reader.h) and
+// the setScanManifestReader slot.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "manifest_reader.h"
+#include "worker_pool.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+#include "test_packages.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<std::string> kVariants = {"linux-x86_64", "linux"};
+
+bool samePackage(const InstalledPackage& a, const InstalledPackage& b) {
+    return a.name == b.name && a.displayName == b.displayName && a.version == b.version
+        && a.description == b.description && a.type == b.type && a.category == b.category
+        && a.author == b.author && a.license == b.license && a.icon == b.icon && a.view == b.view
+        && a.dependencies == b.dependencies && a.hashes.root == b.hashes.root
+        && a.installType == b.installType && a.installDir == b.installDir && a.mainFilePath == b.mainFilePath;
+}
+
+} // namespace
+
+LOGOS_TEST(manifest_read_matches_the_document_path_field_for_field) {
+    const std::vector<std::string> manifests = {
+        R"({"name":"plain","version":"1.0.0","type":"core","main":"libplain.so",
+            "dependencies":["a","b"],"hashes":{"root":"abc"}})",
+        // Every kept field, escapes, surrogate pairs and raw UTF-8.
+        "\xEF\xBB\xBF" R"( { "name" : "esc\"aped\\\/é😀", "displayName":"Caf)" "\xC3\xA9"
+        R"(", "description":"tab\tnew\nline \u00e9\ud83d\ude00", "category":"c", "author":"au", "license":"MIT",
+            "icon":"i.png", "view":"v.qml", "type":"ui" } )",
+        // Non-string values for string fields, mixed arrays, nested values
+        // the reader steps over.
+        R"({"name":7,"version":null,"dependencies":["x",1,{"y":[true,false]},"z",[]],
+            "hashes":{"other":[1.5e3,-0,{"deep":[[[]]]}],"root":true},
+            "extra":{"a":[1,2,{"b":"c\u0000"}],"n":-12.75E-2}})",
+        // The last of a key given twice counts.
+        R"({"name":"first","name":"second","dependencies":["a"],"dependencies":"none",
+            "hashes":{"root":"r1","root":"r2"}})",
+        // main by platform variant: the first variant with a string wins,
+        // and a later duplicate replaces an earlier entry.
+        R"({"name":"v","main":{"darwin":"d.dylib","linux":"l.so","linux-x86_64":5}})",
+        R"({"name":"v","main":{"linux-x86_64":"a.so","linux-x86_64":"b.so","linux":"l.so"}})",
+        R"({"name":"v","main":{"linux-x86_64":"a.so","linux-x86_64":null,"linux":"l.so"}})",
+        R"({"name":"v","main":"m.so","main":{"windows":"w.dll"}})",
+        R"({"name":"v","main":""})",
+        R"({"name":"v","main":[1]})",
+        R"({})",
+    };
+    for (const auto& json : manifests) {
+        InstalledPackage onDemand, dom;
+        std::string onDemandError, domError;
+        LOGOS_ASSERT_TRUE(manifest::read(json, "/pkgs/v", InstallType::Embedded, kVariants, onDemand, onDemandError));
+        LOGOS_ASSERT_TRUE(manifest::readDom(json, "/pkgs/v", InstallType::Embedded, kVariants, dom, domError));
+        LOGOS_ASSERT_TRUE(samePackage(onDemand, dom));
+    }
+
+    InstalledPackage p;
+    std::string error;
+    LOGOS_ASSERT_TRUE(manifest::read(manifests[1], "/pkgs/v", InstallType::User, kVariants, p, error));
+    LOGOS_ASSERT_EQ(p.name, std::string("esc\"aped\\/\xC3\xA9\xF0\x9F\x98\x80"));
+    LOGOS_ASSERT_EQ(p.displayName, std::string("Caf\xC3\xA9"));
+    LOGOS_ASSERT_EQ(p.description, std::string("tab\tnew\nline \xC3\xA9\xF0\x9F\x98\x80"));
+    LOGOS_ASSERT_TRUE(p.installType == InstallType::User);
+    LOGOS_ASSERT_TRUE(manifest::read(manifests[4], "/pkgs/v", InstallType::User, kVariants, p, error));
+    LOGOS_ASSERT_EQ(p.mainFilePath, std::string("/pkgs/v/l.so"));
+    LOGOS_ASSERT_TRUE(manifest::read(manifests[2], "/pkgs/v", InstallType::User, kVariants, p, error));
+    LOGOS_ASSERT_EQ(p.dependencies, (std::vector<std::string>{"x", "z"}));
+}
+
+LOGOS_TEST(manifest_read_rejects_what_the_document_path_rejects) {
+    const std::vector<std::string> malformed = {
+        "",
+        "   ",
+        "[]",
+        "\"name\"",
+        R"({"name":"a",})",
+        R"({"name":"a"} trailing)",
+        R"({"name":"a" "version":"1"})",
+        R"({"name":"unterminated})",
+        R"({"name":"bad \x escape"})",
+        R"({"name":"lone \ud83d surrogate"})",
+        "{\"name\":\"raw\tcontrol\"}",
+        "{\"name\":\"bad \xC3\x28 utf8\"}",
+        R"({"extra":[1,2,]})",
+        R"({"extra":01})",
+        R"({"extra":1.})",
+        R"({"extra":1e400})",
+        R"({"extra":tru})",
+        R"({"extra":{"a" 1}})",
+        R"({"name":"a")",
+    };
+    for (const auto& json : malformed) {
+        InstalledPackage p;
+        std::string onDemandError, domError;
+        LOGOS_ASSERT_FALSE(manifest::read(json, "/pkgs/x", InstallType::User, kVariants, p, onDemandError));
+        LOGOS_ASSERT_FALSE(manifest::readDom(json, "/pkgs/x", InstallType::User, kVariants, p, domError));
+        LOGOS_ASSERT_FALSE(onDemandError.empty());
+    }
+}
+
+LOGOS_TEST(manifest_scanDirectory_reads_entries_in_name_order) {
+    ScratchDir dir;
+    for (int i = 0; i < 30; ++i) {
+        const std::string name = "pkg" + std::to_string(100 + i);
+        writeFile(dir.path / name / "manifest.json",
+                  R"({"name":")" + name + R"(","type":"core","main":{"linux":"lib.so"}})");
+    }
+    writeFile(dir.path / "broken" / "manifest.json", "{\"name\":");
+    writeFile(dir.path / ".hidden" / "manifest.json", R"({"name":"hidden"})");
+    writeFile(dir.path / "stray.json", R"({"name":"stray"})");
+    std::filesystem::create_directories(dir.path / "empty");
+
+    WorkerPool pool(4);
+    const std::string root = dir.path.string();
+    const auto serial = manifest::scanDirectory(root, InstallType::User, kVariants, manifest::Reader::OnDemand,
+                                                nullptr, 0);
+    const auto parallel = manifest::scanDirectory(root, InstallType::User, kVariants, manifest::Reader::OnDemand,
+                                                  &pool, 8);
+    const auto dom = manifest::scanDirectory(root, InstallType::User, kVariants, manifest::Reader::Dom, &pool, 8);
+    LOGOS_ASSERT_EQ(serial.size(), static_cast<size_t>(30));
+    LOGOS_ASSERT_EQ(serial.front().name, std::string("pkg100"));
+    LOGOS_ASSERT_EQ(serial.back().name, std::string("pkg129"));
+    LOGOS_ASSERT_EQ(serial.front().mainFilePath, (dir.path / "pkg100" / "lib.so").string());
+    LOGOS_ASSERT_EQ(names(parallel), names(serial));
+    LOGOS_ASSERT_EQ(parallel.size(), dom.size());
+    for (size_t i = 0; i < dom.size(); ++i) LOGOS_ASSERT_TRUE(samePackage(parallel[i], dom[i]));
+    LOGOS_ASSERT_TRUE(manifest::scanDirectory(root + "/missing", InstallType::User, kVariants,
+                                              manifest::Reader::OnDemand, &pool, 8).empty());
+}
+
+LOGOS_TEST(setScanManifestReader_scans_directories_without_the_library) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir dir;
+    writeFile(dir.path / "embedded" / "core_b" / "manifest.json", R"({"name":"core_b","type":"core"})");
+    writeFile(dir.path / "embedded" / "core_a" / "manifest.json", R"({"name":"core_a","type":"core"})");
+    writeFile(dir.path / "ui" / "panel" / "manifest.json",
+              R"({"name":"panel","type":"ui","main":{"mock-variant":"panel.qml"}})");
+    writeFile(dir.path / "user" / "extra" / "manifest.json", R"({"name":"extra","type":"core"})");
+    PackageManagerImpl impl;
+    impl.setEmbeddedModulesDirectory((dir.path / "embedded").string());
+    impl.setEmbeddedUiPluginsDirectory((dir.path / "ui").string());
+    impl.setUserModulesDirectory((dir.path / "user").string());
+
+    LogosMap rejected = impl.setScanManifestReader("simd");
+    LOGOS_ASSERT_FALSE(rejected["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(rejected["error"].get<std::string>().empty());
+
+    LogosMap response = impl.setScanManifestReader("ondemand");
+    LOGOS_ASSERT_TRUE(response["success"].get<bool>());
+    LOGOS_ASSERT_EQ(response["directories"].get<int64_t>(), static_cast<int64_t>(3));
+    LOGOS_ASSERT_EQ(names(impl.getInstalledPackages()),
+                    (std::vector<std::string>{"core_a", "core_b", "panel", "extra"}));
+    LOGOS_ASSERT_EQ(names(impl.getInstalledUiPlugins()), (std::vector<std::string>{"panel"}));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("getInstalledPackages"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("getInstalledModules"));
+
+    LOGOS_ASSERT_TRUE(impl.setScanManifestReader("library")["success"].get<bool>());
+    impl.getInstalledPackages();
+    LOGOS_ASSERT_TRUE(t.cFunctionCalled("getInstalledPackages"));
+}
@@ -0,0 +1,93 @@
+// Unit tests for heap accounting (src/memory_stats.h) and the
+// getMemoryStats slot.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "memory_stats.h"
+#include "mocks/mock_package_manager_lib.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+int64_t subsystemBytes(LogosMap& stats, const char* name, const char* field) {
+    return stats["subsystems"][name][field].get<int64_t>();
+}
+
+} // namespace
+
+LOGOS_TEST(memstats_account_tracks_peak_and_rolls_up) {
+    memstats::Account total;
+    memstats::Account a(&total);
+    memstats::Account b(&total);
+    {
+        memstats::Charge first(a, 100);
+        memstats::Charge second(b, 50);
+        LOGOS_ASSERT_EQ(total.current(), static_cast<int64_t>(150));
+    }
+    memstats::Charge later(a, 120);
+    b.set(10);
+
+    LOGOS_ASSERT_EQ(a.current(), static_cast<int64_t>(120));
+    LOGOS_ASSERT_EQ(a.peak(), static_cast<int64_t>(120));
+    LOGOS_ASSERT_EQ(b.peak(), static_cast<int64_t>(50));
+    // Peak of the sum, not the sum of the peaks (170).
+    LOGOS_ASSERT_EQ(total.current(), static_cast<int64_t>(130));
+    LOGOS_ASSERT_EQ(total.peak(), static_cast<int64_t>(150));
+}
+
+LOGOS_TEST(memstats_heap_bytes_ignore_short_strings) {
+    LOGOS_ASSERT_EQ(memstats::heapBytes(std::string("abc")), static_cast<size_t>(0));
+    const std::string longer(100, 'x');
+    LOGOS_ASSERT_TRUE(memstats::heapBytes(longer) > 100);
+    const std::vector<std::string> v = {longer, "abc"};
+    LOGOS_ASSERT_TRUE(memstats::heapBytes(v) >= 2 * sizeof(std::string) + 101);
+}
+
+LOGOS_TEST(getMemoryStats_reports_scan_peak_and_sampled_subsystems) {
+    auto t = LogosTestContext("package_manager");
+    std::vector<InstalledPackage> packages(200);
+    for (size_t i = 0; i < packages.size(); ++i) {
+        packages[i].name = "package-with-a-long-enough-name-" + std::to_string(i);
+        packages[i].description = std::string(64, 'd');
+    }
+    setMockInstalledPackages(packages);
+
+    PackageManagerImpl impl;
+    impl.getInstalledPackages();
+    impl.countInstalledPackages("", "", "");  // builds the installed index
+    impl.setTracingEnabled(true);
+
+    LogosMap stats = impl.getMemoryStats();
+    LOGOS_ASSERT_TRUE(stats["success"].get<bool>());
+    // Released when the slot returned, but its peak remains.
+    LOGOS_ASSERT_EQ(subsystemBytes(stats, "scans", "bytes"), static_cast<int64_t>(0));
+    LOGOS_ASSERT_TRUE(subsystemBytes(stats, "scans", "peakBytes")
+                      > static_cast<int64_t>(200 * sizeof(InstalledPackage)));
+    LOGOS_ASSERT_TRUE(subsystemBytes(stats, "indexes", "bytes") > 0);
+    LOGOS_ASSERT_TRUE(subsystemBytes(stats, "trace", "bytes") > 0);
+    LOGOS_ASSERT_TRUE(subsystemBytes(stats, "metrics", "bytes") > 0);
+    int64_t sum = 0;
+    for (const auto& entry : stats["subsystems"].items()) sum += entry.value()["bytes"].get<int64_t>();
+    LOGOS_ASSERT_EQ(stats["totalBytes"].get<int64_t>(), sum);
+    LOGOS_ASSERT_TRUE(stats["peakTotalBytes"].get<int64_t>() >= stats["totalBytes"].get<int64_t>());
+    LOGOS_ASSERT_TRUE(stats["process"].contains("peakResidentBytes"));
+}
+
+LOGOS_TEST(getMemoryStats_samples_pending_action_state) {
+    auto t = LogosTestContext("package_manager");
+    PackageManagerImpl impl;
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 50; ++i) names.push_back("a-package-name-past-the-sso-limit-" + std::to_string(i));
+    LOGOS_ASSERT_TRUE(impl.requestMultiUninstall(names)["success"].get<bool>());
+    LogosMap pending = impl.getMemoryStats();
+    const int64_t pendingBytes = subsystemBytes(pending, "pendingAction", "bytes");
+    LOGOS_ASSERT_TRUE(pendingBytes > static_cast<int64_t>(50 * sizeof(std::string)));
+
+    impl.resetPendingAction();
+    LogosMap cleared = impl.getMemoryStats();
+    LOGOS_ASSERT_TRUE(subsystemBytes(cleared, "pendingAction", "bytes") < pendingBytes);
+    LOGOS_ASSERT_EQ(subsystemBytes(cleared, "pendingAction", "peakBytes"), pendingBytes);
+}
@@ -0,0 +1,109 @@
+// Unit tests for the metrics registry (src/metrics.h) and the Prometheus
+// text PackageManagerImpl exposes through getMetricsText / setMetricsFile.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "metrics.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+
+#include <string>
+
+using logos_test::EventCapture;
+
+namespace {
+
+bool hasLine(const std::string& text, const std::string& line) {
+    return text.find("\n" + line + "\n") != std::string::npos
+        || text.rfind(line + "\n", 0) == 0;
+}
+
+} // namespace
+
+LOGOS_TEST(metrics_registry_renders_prometheus_text) {
+    metrics::Registry r;
+    r.counter("jobs_total", "Jobs run.", {{"result", "ok"}}).inc(3);
+    r.gauge("queue_depth", "Queued jobs.").set(-2);
+    metrics::Histogram& h = r.histogram("job_seconds", "Job time.", {}, {0.1, 1});
+    h.observe(0.05);
+    h.observe(0.5);
+    h.observe(7);
+
+    const std::string text = r.render();
+    LOGOS_ASSERT_TRUE(hasLine(text, "# HELP jobs_total Jobs run."));
+    LOGOS_ASSERT_TRUE(hasLine(text, "# TYPE jobs_total counter"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "jobs_total{result=\"ok\"} 3"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "# TYPE queue_depth gauge"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "queue_depth -2"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "# TYPE job_seconds histogram"));
+    // Buckets are cumulative and end in +Inf.
+    LOGOS_ASSERT_TRUE(hasLine(text, "job_seconds_bucket{le=\"0.1\"} 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "job_seconds_bucket{le=\"1\"} 2"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "job_seconds_bucket{le=\"+Inf\"} 3"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "job_seconds_sum 7.55"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "job_seconds_count 3"));
+}
+
+LOGOS_TEST(metrics_registry_returns_same_series_for_same_labels) {
+    metrics::Registry r;
+    metrics::Counter& a = r.counter("c_total", "C.", {{"k", "v"}});
+    metrics::Counter& b = r.counter("c_total", "C.", {{"k", "v"}});
+    LOGOS_ASSERT_TRUE(&a == &b);
+    a.inc();
+    b.inc();
+    LOGOS_ASSERT_EQ(a.value(), static_cast<uint64_t>(2));
+    // One HELP/TYPE block per family however many series it has.
+    r.counter("c_total", "C.", {{"k", "w"}});
+    const std::string text = r.render();
+    LOGOS_ASSERT_EQ(text.find("# TYPE c_total"), text.rfind("# TYPE c_total"));
+}
+
+LOGOS_TEST(getMetricsText_counts_slot_calls_and_installs) {
+    auto t = LogosTestContext("package_manager");
+    t.mockCFunction("installPluginFile_result").returns("/tmp/foo");
+
+    PackageManagerImpl impl;
+    impl.installPlugin("/tmp/foo.lgx", false);
+    impl.getInstalledPackages();
+    impl.getInstalledPackages();
+
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_slot_duration_seconds_count{slot=\"getInstalledPackages\"} 2"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_slot_duration_seconds_count{slot=\"installPlugin\"} 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_installs_total{result=\"success\"} 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_signature_checks_total{result=\"unsigned\"} 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_install_phase_duration_seconds_count{phase=\"extract\"} 1"));
+}
+
+LOGOS_TEST(getMetricsText_reports_pending_action_and_timeout_outcome) {
+    auto t = LogosTestContext("package_manager");
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setAckTimeoutMsForTest(30);
+
+    LOGOS_ASSERT_TRUE(impl.requestInstall("foo", "v1", "", "")["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(hasLine(impl.getMetricsText(), "logos_package_manager_pending_action{op=\"install\"} 1"));
+
+    events.waitFor("installCancelled", 1000);
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_pending_action{op=\"install\"} 0"));
+    LOGOS_ASSERT_TRUE(hasLine(text,
+        "logos_package_manager_gated_outcomes_total{op=\"install\",outcome=\"timeout\"} 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_ack_timer_threads_started_total 1"));
+}
+
+LOGOS_TEST(setMetricsFile_writes_text_and_reports_bad_path) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    PackageManagerImpl impl;
+
+    const auto path = scratch.path / "package_manager.prom";
+    LOGOS_ASSERT_TRUE(impl.setMetricsFile(path.string(), 60000)["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(readFile(path).find("# TYPE logos_package_manager_slot_duration_seconds histogram")
+                      != std::string::npos);
+    LOGOS_ASSERT_TRUE(impl.setMetricsFile("", 0)["success"].get<bool>());
+
+    LogosMap bad = impl.setMetricsFile((scratch.path / "missing" / "x.prom").string(), 0);
+    LOGOS_ASSERT_FALSE(bad["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(bad.contains("error"));
+}
@@ -0,0 +1,209 @@
+// Unit tests for the column-wise installed index (src/package_index.h) and
+// the findInstalledPackages / countInstalledPackages slots it backs.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "package_index.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "test_packages.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<InstalledPackage> samplePackages() {
+    const auto detailed = [](const std::string& name, const std::string& type,
+                             const std::string& category) {
+        return TestPackage(name)
+            .displayName(name + " display")
+            .version("1.0.0")
+            .description("The " + name + " package, with a description long enough to leave SSO.")
+            .type(type)
+            .category(category)
+            .author("Logos")
+            .license("MIT")
+            .dependencies({"base", "net"})
+            .root("root-" + name)
+            .installedUnder("/opt");
+    };
+    return {
+        detailed("base", "core", "system").embedded(),
+        detailed("net", "core", "networking"),
+        detailed("wallet", "ui", "finance"),
+        detailed("chat", "core", "networking"),
+        detailed("shell", "ui", "system").embedded(),
+    };
+}
+
+bool hasLine(const std::string& text, const std::string& line) {
+    return text.find("\n" + line + "\n") != std::string::npos;
+}
+
+} // namespace
+
+LOGOS_TEST(package_index_round_trips_every_field) {
+    const auto packages = samplePackages();
+    PackageIndex index(packages);
+    LOGOS_ASSERT_EQ(index.size(), packages.size());
+
+    for (size_t i = 0; i < packages.size(); ++i) {
+        const InstalledPackage p = index.package(i);
+        const InstalledPackage& want = packages[i];
+        LOGOS_ASSERT_EQ(p.name, want.name);
+        LOGOS_ASSERT_EQ(p.displayName, want.displayName);
+        LOGOS_ASSERT_EQ(p.version, want.version);
+        LOGOS_ASSERT_EQ(p.description, want.description);
+        LOGOS_ASSERT_EQ(p.type, want.type);
+        LOGOS_ASSERT_EQ(p.category, want.category);
+        LOGOS_ASSERT_EQ(p.author, want.author);
+        LOGOS_ASSERT_EQ(p.license, want.license);
+        LOGOS_ASSERT_TRUE(p.dependencies == want.dependencies);
+        LOGOS_ASSERT_EQ(p.hashes.root, want.hashes.root);
+        LOGOS_ASSERT_TRUE(p.installType == want.installType);
+        LOGOS_ASSERT_EQ(p.installDir, want.installDir);
+        LOGOS_ASSERT_EQ(p.mainFilePath, want.mainFilePath);
+    }
+}
+
+LOGOS_TEST(package_index_interns_shared_values_and_filters) {
+    PackageIndex index(samplePackages());
+    // "net" is both a package name and a dependency: one id.
+    const uint32_t networking = index.find("networking");
+    LOGOS_ASSERT_TRUE(networking != PackageIndex::kNoId);
+    LOGOS_ASSERT_EQ(index.categoryId(1), index.categoryId(3));
+    LOGOS_ASSERT_EQ(index.find("net"), index.nameId(1));
+    LOGOS_ASSERT_EQ(index.find("no-such-value"), PackageIndex::kNoId);
+
+    PackageIndex::Filter userCore;
+    userCore.installType = static_cast<int>(InstallType::User);
+    userCore.kind = PackageIndex::KindCore;
+    LOGOS_ASSERT_EQ(index.count(userCore), static_cast<size_t>(2));
+
+    PackageIndex::Filter networkingCore = userCore;
+    networkingCore.category = networking;
+    const auto rows = index.rows(networkingCore);
+    LOGOS_ASSERT_EQ(rows.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(rows[0], static_cast<uint32_t>(1));
+    LOGOS_ASSERT_EQ(rows[1], static_cast<uint32_t>(3));
+
+    LOGOS_ASSERT_EQ(index.count(PackageIndex::Filter{}), static_cast<size_t>(5));
+    LOGOS_ASSERT_TRUE(index.memoryBytes() > 0);
+}
+
+LOGOS_TEST(findInstalledPackages_filters_and_reuses_the_cached_index) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages(samplePackages());
+    PackageManagerImpl impl;
+
+    LogosList core = impl.findInstalledPackages("user", "core", "networking");
+    LOGOS_ASSERT_EQ(core.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(core[0]["name"].get<std::string>(), std::string("net"));
+    LOGOS_ASSERT_EQ(core[1]["installType"].get<std::string>(), std::string("user"));
+
+    LOGOS_ASSERT_EQ(impl.findInstalledPackages("embedded", "", "").size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(impl.findInstalledPackages("", "plugin", "").size(), static_cast<size_t>(0));
+    LOGOS_ASSERT_EQ(impl.countInstalledPackages("", "ui", "")["count"].get<int64_t>(),
+                    static_cast<int64_t>(2));
+    LOGOS_ASSERT_EQ(impl.countInstalledPackages("", "", "unknown")["count"].get<int64_t>(),
+                    static_cast<int64_t>(0));
+
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_index_lookups_total{result=\"miss\"} 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_index_lookups_total{result=\"hit\"} 4"));
+    LogosMap stats = impl.getMemoryStats();
+    LOGOS_ASSERT_TRUE(stats["subsystems"]["indexes"]["bytes"].get<int64_t>() > 0);
+}
+
+LOGOS_TEST(installed_index_is_rebuilt_after_uninstall) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages(samplePackages());
+    t.mockCFunction("uninstallPackage_success").returns(true);
+    PackageManagerImpl impl;
+
+    LOGOS_ASSERT_EQ(impl.countInstalledPackages("user", "", "")["count"].get<int64_t>(),
+                    static_cast<int64_t>(3));
+    auto remaining = samplePackages();
+    remaining.erase(remaining.begin() + 2);  // wallet
+    LOGOS_ASSERT_TRUE(impl.uninstallPackage("wallet")["success"].get<bool>());
+    setMockInstalledPackages(remaining);
+
+    LOGOS_ASSERT_EQ(impl.countInstalledPackages("user", "", "")["count"].get<int64_t>(),
+                    static_cast<int64_t>(2));
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_index_invalidations_total 1"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_index_lookups_total{result=\"miss\"} 2"));
+}
+
+LOGOS_TEST(package_index_query_intersects_postings_and_counts_facets) {
+    auto packages = samplePackages();
+    packages[3].author = "Mallory";
+    packages[3].license = "GPL-3.0";
+    PackageIndex index(packages);
+
+    PackageIndex::Query q;
+    LOGOS_ASSERT_EQ(index.query(q).size(), static_cast<size_t>(5));
+    q.value[PackageIndex::FacetInstallType] = static_cast<uint32_t>(InstallType::User);
+    q.value[PackageIndex::FacetType] = index.find("core");
+    q.value[PackageIndex::FacetCategory] = index.find("networking");
+    LOGOS_ASSERT_TRUE(index.query(q) == (std::vector<uint32_t>{1, 3}));
+
+    q.value[PackageIndex::FacetAuthor] = index.find("Mallory");
+    LOGOS_ASSERT_TRUE(index.query(q) == (std::vector<uint32_t>{3}));
+    // The author facet ignores its own predicate: both authors of the
+    // user/core/networking rows are listed.
+    const auto authors = index.facetCounts(q, PackageIndex::FacetAuthor);
+    LOGOS_ASSERT_EQ(authors.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(authors[0].second, static_cast<uint32_t>(1));
+    // Every other facet is counted over the single matching row.
+    const auto licenses = index.facetCounts(q, PackageIndex::FacetLicense);
+    LOGOS_ASSERT_EQ(licenses.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(index.str(licenses[0].first), std::string("GPL-3.0"));
+
+    // A value no row carries matches nothing.
+    q.value[PackageIndex::FacetLicense] = PackageIndex::kNoId;
+    LOGOS_ASSERT_EQ(index.query(q).size(), static_cast<size_t>(0));
+    LOGOS_ASSERT_EQ(index.facetCounts(q, PackageIndex::FacetLicense).size(), static_cast<size_t>(1));
+}
+
+LOGOS_TEST(queryInstalledPackages_returns_matches_and_facets) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages(samplePackages());
+    PackageManagerImpl impl;
+
+    LogosMap filter = LogosMap::object();
+    filter["installType"] = "user";
+    filter["category"] = "networking";
+    LogosMap result = impl.queryInstalledPackages(filter, true);
+    LOGOS_ASSERT_TRUE(result["success"].get<bool>());
+    LOGOS_ASSERT_EQ(result["count"].get<int64_t>(), static_cast<int64_t>(2));
+    LOGOS_ASSERT_EQ(result["packages"].size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(result["packages"][0]["name"].get<std::string>(), std::string("net"));
+    // Categories among user packages, and install types among networking ones.
+    LOGOS_ASSERT_EQ(result["facets"]["category"]["networking"].get<int64_t>(), static_cast<int64_t>(2));
+    LOGOS_ASSERT_EQ(result["facets"]["category"]["finance"].get<int64_t>(), static_cast<int64_t>(1));
+    LOGOS_ASSERT_FALSE(result["facets"]["category"].contains("system"));
+    LOGOS_ASSERT_EQ(result["facets"]["installType"]["user"].get<int64_t>(), static_cast<int64_t>(2));
+    LOGOS_ASSERT_EQ(result["facets"]["type"]["core"].get<int64_t>(), static_cast<int64_t>(2));
+
+    // Facets only, with no filter: counts over everything installed.
+    result = impl.queryInstalledPackages(LogosMap::object(), false);
+    LOGOS_ASSERT_FALSE(result.contains("packages"));
+    LOGOS_ASSERT_EQ(result["count"].get<int64_t>(), static_cast<int64_t>(5));
+    LOGOS_ASSERT_EQ(result["facets"]["installType"]["embedded"].get<int64_t>(), static_cast<int64_t>(2));
+    LOGOS_ASSERT_EQ(result["facets"]["author"]["Logos"].get<int64_t>(), static_cast<int64_t>(5));
+
+    filter = LogosMap::object();
+    filter["author"] = "Nobody";
+    result = impl.queryInstalledPackages(filter, true);
+    LOGOS_ASSERT_TRUE(result["success"].get<bool>());
+    LOGOS_ASSERT_EQ(result["count"].get<int64_t>(), static_cast<int64_t>(0));
+
+    filter = LogosMap::object();
+    filter["maintainer"] = "x";
+    result = impl.queryInstalledPackages(filter, true);
+    LOGOS_ASSERT_FALSE(result["success"].get<bool>());
+    filter = LogosMap::object();
+    filter["installType"] = "system";
+    LOGOS_ASSERT_FALSE(impl.queryInstalledPackages(filter, true)["success"].get<bool>());
+}
@@ -12,6 +12,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <map>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -104,6 +105,20 @@ LOGOS_TEST(installPlugin_skipIfNotNewerVersion_passed_to_mock) {
     LOGOS_ASSERT_TRUE(t.cFunctionCalled("installPluginFile_skipIfNotNewer_false"));
 }
 
+LOGOS_TEST(upgradeFromFile_unloadable_lgx_fails_without_touching_lib) {
+    auto t = LogosTestContext("package_manager");
+    // The lgx mock's lgx_load returns null, as for a corrupt archive.
+    std::string lastEvent;
+    PackageManagerImpl impl;
+    ScopedEventSink _sink([&](const std::string& name, const std::string&) { lastEvent = name; });
+
+    LogosMap m = impl.upgradeFromFile("/broken.lgx");
+    LOGOS_ASSERT_FALSE(m["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(m["error"].get<std::string>().find("Failed to load LGX package") == 0);
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("installPluginFile"));
+    LOGOS_ASSERT_TRUE(lastEvent.empty());
+}
+
 LOGOS_TEST(setEmbeddedModulesDirectory_forwards_to_lib) {
     auto t = LogosTestContext("package_manager");
     PackageManagerImpl impl;
@@ -330,22 +345,25 @@ static DependencyTreeNode makeForwardTree() {
     return root;
 }
 
-// Reverse tree rooted at "dep":
+// Installed set whose reverse tree, rooted at "dep", is:
 //   dep
 //   └── parent_direct
 //       └── parent_transitive
-static DependentTreeNode makeReverseTree() {
-    DependentTreeNode root;
-    root.name = "dep";
-    DependentTreeNode directChild;
-    directChild.name = "parent_direct";
-    directChild.version = "1.2.3";
-    DependentTreeNode transitiveChild;
-    transitiveChild.name = "parent_transitive";
-    transitiveChild.version = "4.5.6";
-    directChild.children = {transitiveChild};
-    root.children = {directChild};
-    return root;
+// Dependents are answered from the module's reverse index, so the fixture is
+// the installed packages' dependency lists rather than a library tree.
+static void primeReverseInstalled() {
+    InstalledPackage dep;
+    dep.name = "dep";
+    dep.installType = InstallType::User;
+    InstalledPackage direct = dep;
+    direct.name = "parent_direct";
+    direct.version = "1.2.3";
+    direct.dependencies = {"dep"};
+    InstalledPackage transitive = dep;
+    transitive.name = "parent_transitive";
+    transitive.version = "4.5.6";
+    transitive.dependencies = {"parent_direct"};
+    setMockInstalledPackages({dep, direct, transitive});
 }
 
 LOGOS_TEST(resolveDependencies_recursive_returns_full_tree) {
@@ -393,7 +411,7 @@ LOGOS_TEST(resolveDependencies_unknown_returns_empty_object) {
 
 LOGOS_TEST(resolveDependents_recursive_returns_full_tree) {
     auto t = LogosTestContext("package_manager");
-    setMockDependentTree(makeReverseTree());
+    primeReverseInstalled();
 
     PackageManagerImpl impl;
 
@@ -408,12 +426,13 @@ LOGOS_TEST(resolveDependents_recursive_returns_full_tree) {
                     std::string("parent_transitive"));
     // No `direct` field in the new wire format.
     LOGOS_ASSERT_FALSE(out["children"][0].contains("direct"));
-    LOGOS_ASSERT_TRUE(t.cFunctionCalled("resolveDependents"));
+    // Answered from the reverse index, without a library walk.
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("resolveDependents"));
 }
 
 LOGOS_TEST(resolveDependents_non_recursive_clips_to_depth_one) {
     auto t = LogosTestContext("package_manager");
-    setMockDependentTree(makeReverseTree());
+    primeReverseInstalled();
 
     PackageManagerImpl impl;
 
@@ -476,7 +495,7 @@ LOGOS_TEST(resolveFlatDependencies_unknown_returns_empty_list) {
 
 LOGOS_TEST(resolveFlatDependents_recursive_flattens_tree) {
     auto t = LogosTestContext("package_manager");
-    setMockDependentTree(makeReverseTree());
+    primeReverseInstalled();
 
     PackageManagerImpl impl;
 
@@ -492,7 +511,7 @@ LOGOS_TEST(resolveFlatDependents_recursive_flattens_tree) {
 
 LOGOS_TEST(resolveFlatDependents_non_recursive_emits_children_only) {
     auto t = LogosTestContext("package_manager");
-    setMockDependentTree(makeReverseTree());
+    primeReverseInstalled();
 
     PackageManagerImpl impl;
 
@@ -598,15 +617,15 @@ LOGOS_TEST(requestUninstall_rejects_embedded_package) {
 
 LOGOS_TEST(requestUninstall_happy_emits_beforeUninstall_with_dependents) {
     auto t = LogosTestContext("package_manager");
-    primeInstalledUserPackage("foo");
-
-    // A listener-style reverse tree rooted at "foo" with one direct dependent.
-    DependentTreeNode root;
-    root.name = "foo";
-    DependentTreeNode parent;
+    // "foo" plus one installed package that depends on it.
+    InstalledPackage foo;
+    foo.name = "foo";
+    foo.type = "core";
+    foo.installType = InstallType::User;
+    InstalledPackage parent = foo;
     parent.name = "parent_pkg";
-    root.children = {parent};
-    setMockDependentTree(root);
+    parent.dependencies = {"foo"};
+    setMockInstalledPackages({foo, parent});
 
     EventCapture events;
     PackageManagerImpl impl;
@@ -876,6 +895,25 @@ LOGOS_TEST(confirmUpgrade_suppresses_event_on_uninstall_failure) {
     LOGOS_ASSERT_FALSE(events.has("upgradeUninstallDone"));
 }
 
+LOGOS_TEST(confirmUpgrade_then_installPlugin_honours_skipIfNotNewerVersion) {
+    auto t = LogosTestContext("package_manager");
+    primeInstalledUserPackage("foo", "core");
+    t.mockCFunction("uninstallPackage_success").returns(true);
+    t.mockCFunction("installPluginFile_result").returns("/modules/foo/foo_plugin.so");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    LOGOS_ASSERT_TRUE(impl.requestUpgrade("foo", "v2.0.0", 0, "")["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(impl.ackPendingAction("foo")["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(impl.confirmUpgrade("foo", "v2.0.0")["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(t.cFunctionCalled("uninstallPackage"));
+
+    // The follow-up install is an ordinary one.
+    impl.installPlugin("/tmp/foo.lgx", true);
+    LOGOS_ASSERT_TRUE(t.cFunctionCalled("installPluginFile_skipIfNotNewer_true"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("lgx_load"));
+}
+
 LOGOS_TEST(confirmUpgrade_tag_mismatch_returns_error) {
     auto t = LogosTestContext("package_manager");
     primeInstalledUserPackage("foo", "core");
@@ -1326,8 +1364,12 @@ LOGOS_TEST(resetPendingAction_allows_new_request) {
 namespace {
 // Prime N user-installed packages — installedDependentsNames lookups in
 // requestMultiUninstall need each one visible to isEmbedded.
-static void primeInstalledUserPackages(const std::vector<std::string>& names,
-                                       const std::string& type = "core") {
+// `dependencies` gives some of them dependency lists, which is what the
+// reverse index answers installedDependentsNames from.
+static void primeInstalledUserPackages(
+    const std::vector<std::string>& names,
+    const std::string& type = "core",
+    const std::map<std::string, std::vector<std::string>>& dependencies = {}) {
     std::vector<InstalledPackage> pkgs;
     pkgs.reserve(names.size());
     for (const auto& n : names) {
@@ -1335,6 +1377,8 @@ static void primeInstalledUserPackages(const std::vector<std::string>& names,
         p.name = n;
         p.type = type;
         p.installType = InstallType::User;
+        auto deps = dependencies.find(n);
+        if (deps != dependencies.end()) p.dependencies = deps->second;
         pkgs.push_back(p);
     }
     setMockInstalledPackages(pkgs);
@@ -1409,17 +1453,9 @@ LOGOS_TEST(requestMultiUninstall_rejects_when_already_pending) {
 
 LOGOS_TEST(requestMultiUninstall_emits_beforeMultiUninstall_with_names_and_dependents) {
     auto t = LogosTestContext("package_manager");
-    primeInstalledUserPackages({"foo", "bar"});
-
-    // The same dependent tree is returned for every resolveDependents call
-    // (mock semantics). Root="foo" with child "parent_pkg" — verifies the
-    // payload carries `installedDependents`.
-    DependentTreeNode root;
-    root.name = "foo";
-    DependentTreeNode parent;
-    parent.name = "parent_pkg";
-    root.children = {parent};
-    setMockDependentTree(root);
+    // "parent_pkg" depends on both batch members — verifies the payload
+    // carries `installedDependents`.
+    primeInstalledUserPackages({"foo", "bar", "parent_pkg"}, "core", {{"parent_pkg", {"foo", "bar"}}});
 
     EventCapture events;
     PackageManagerImpl impl;
@@ -1438,8 +1474,8 @@ LOGOS_TEST(requestMultiUninstall_emits_beforeMultiUninstall_with_names_and_depen
     LOGOS_ASSERT_EQ(payload["names"][0].get<std::string>(), std::string("foo"));
     LOGOS_ASSERT_EQ(payload["names"][1].get<std::string>(), std::string("bar"));
 
-    // installedDependents has at least parent_pkg (mock returns same tree
-    // for both packages, dedup keeps it just once).
+    // installedDependents has parent_pkg (a dependent of both packages,
+    // dedup keeps it just once).
     LOGOS_ASSERT_TRUE(payload["installedDependents"].is_array());
     bool hasParent = false;
     for (size_t i = 0; i < payload["installedDependents"].size(); ++i) {
@@ -1455,19 +1491,11 @@ LOGOS_TEST(requestMultiUninstall_emits_beforeMultiUninstall_with_names_and_depen
 
 LOGOS_TEST(requestMultiUninstall_dependents_excludes_batch_members) {
     auto t = LogosTestContext("package_manager");
-    primeInstalledUserPackages({"foo", "bar"});
-
-    // Tree where one of the dependents IS a member of the batch (`bar`).
+    // One of foo's dependents IS a member of the batch (`bar`).
     // The non-trivial logic under test: bar should NOT appear in
     // installedDependents because it's already being uninstalled.
-    DependentTreeNode root;
-    root.name = "foo";
-    DependentTreeNode barNode;
-    barNode.name = "bar";
-    DependentTreeNode parent;
-    parent.name = "parent_pkg";
-    root.children = {barNode, parent};
-    setMockDependentTree(root);
+    primeInstalledUserPackages({"foo", "bar", "parent_pkg"}, "core",
+                               {{"bar", {"foo"}}, {"parent_pkg", {"foo"}}});
 
     EventCapture events;
     PackageManagerImpl impl;
@@ -0,0 +1,70 @@
+#pragma once
+
+// InstalledPackage fixtures shared by the unit tests that feed the mocked
+// PackageManagerLib (setMockInstalledPackages) or build indexes directly.
+
+#include <package_manager_lib.h>
+#include <logos_json.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Builds an InstalledPackage: a user-installed core package called `name`
+// with every other field empty until set. Converts implicitly, so a
+// builder can stand wherever an InstalledPackage is expected:
+//
+//   setMockInstalledPackages({TestPackage("net").version("1.0.0"),
+//                             TestPackage("log").embedded().installedUnder("/opt")});
+class TestPackage {
+public:
+    explicit TestPackage(const std::string& name)
+    {
+        m_p.name = name;
+        m_p.type = "core";
+        m_p.installType = InstallType::User;
+    }
+
+    TestPackage& displayName(std::string v) { m_p.displayName = std::move(v); return *this; }
+    TestPackage& version(std::string v) { m_p.version = std::move(v); return *this; }
+    TestPackage& description(std::string v) { m_p.description = std::move(v); return *this; }
+    TestPackage& type(std::string v) { m_p.type = std::move(v); return *this; }
+    TestPackage& category(std::string v) { m_p.category = std::move(v); return *this; }
+    TestPackage& author(std::string v) { m_p.author = std::move(v); return *this; }
+    TestPackage& license(std::string v) { m_p.license = std::move(v); return *this; }
+    TestPackage& dependencies(std::vector<std::string> v) { m_p.dependencies = std::move(v); return *this; }
+    TestPackage& root(std::string v) { m_p.hashes.root = std::move(v); return *this; }
+    TestPackage& installType(InstallType v) { m_p.installType = v; return *this; }
+    TestPackage& embedded() { return installType(InstallType::Embedded); }
+    TestPackage& installDir(std::string v) { m_p.installDir = std::move(v); return *this; }
+    TestPackage& mainFilePath(std::string v) { m_p.mainFilePath = std::move(v); return *this; }
+    // <dir>/<name> as the install directory, <dir>/<name>/lib<name>.so as
+    // the main file.
+    TestPackage& installedUnder(const std::string& dir)
+    {
+        m_p.installDir = dir + "/" + m_p.name;
+        m_p.mainFilePath = m_p.installDir + "/lib" + m_p.name + ".so";
+        return *this;
+    }
+
+    operator InstalledPackage() const { return m_p; }
+    const InstalledPackage& get() const { return m_p; }
+
+private:
+    InstalledPackage m_p;
+};
+
+// Package names, in order, from scan results or a slot's LogosList.
+inline std::vector<std::string> names(const std::vector<InstalledPackage>& packages)
+{
+    std::vector<std::string> out;
+    for (const auto& p : packages) out.push_back(p.name);
+    return out;
+}
+
+inline std::vector<std::string> names(const LogosList& packages)
+{
+    std::vector<std::string> out;
+    for (const auto& p : packages) out.push_back(p["name"].get<std::string>());
+    return out;
+}
@@ -0,0 +1,188 @@
+// Unit tests for the packed query encoding (src/packed_encoding.h) and the
+// query slots' `encoding` parameter: every document must decode to exactly
+// what the slot returns without one.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "conversions.h"
+#include "packed_encoding.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "test_packages.h"
+
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+const packed::Format kFormats[] = {packed::Format::MessagePack, packed::Format::Cbor};
+
+InstalledPackage package(size_t i) {
+    const std::string id = std::to_string(i);
+    const std::string installDir = "/home/user/.local/share/logos/modules/package_" + id;
+    return TestPackage("package_" + id)
+        .displayName("Package " + id)
+        .version("1.2." + std::to_string(i % 7))
+        .description("Package number " + id + " with a typical one-line description")
+        .category("network")
+        .author("Logos")
+        .license("MIT")
+        .dependencies({"crypto", "log", "package_" + std::to_string(i + 1)})
+        .root("b3a1c9f0d2e47a6580c1d3e5f7091b2d4f6a8c0e2f4a6b8d0f1e3c5a7b9d1f3e")
+        .installType(i % 2 ? InstallType::User : InstallType::Embedded)
+        .installDir(installDir)
+        .mainFilePath(installDir + "/package_" + id + "_plugin.so");
+}
+
+DependencyTreeNode dependencyNode(const std::string& name, DependencyStatus status) {
+    DependencyTreeNode n;
+    n.name = name;
+    n.status = status;
+    n.version = "2.0.0";
+    n.installType = InstallType::Embedded;
+    return n;
+}
+
+DependencyTreeNode dependencyTree() {
+    DependencyTreeNode root = dependencyNode("root", DependencyStatus::Installed);
+    DependencyTreeNode a = dependencyNode("a", DependencyStatus::Installed);
+    a.children.push_back(dependencyNode("c", DependencyStatus::NotInstalled));
+    root.children.push_back(a);
+    root.children.push_back(dependencyNode("b", DependencyStatus::Cycle));
+    return root;
+}
+
+DependentTreeNode dependentTree() {
+    DependentTreeNode root;
+    root.name = "log";
+    root.version = "1.0.0";
+    root.type = "core";
+    root.installDir = "/modules/log";
+    DependentTreeNode child = root;
+    child.name = "net";
+    child.installDir = "/modules/net";
+    DependentTreeNode grandchild = child;
+    grandchild.name = "wallet";
+    child.children.push_back(grandchild);
+    root.children.push_back(child);
+    return root;
+}
+
+LogosMap decoded(const std::vector<uint8_t>& bytes, packed::Format f) {
+    LogosMap out;
+    std::string error;
+    if (!packed::decode(bytes, f, out, error)) return LogosMap("decode failed: " + error);
+    return out;
+}
+
+} // namespace
+
+LOGOS_TEST(packed_packages_decode_to_the_plain_list_and_are_smaller) {
+    std::vector<InstalledPackage> packages;
+    for (size_t i = 0; i < 200; ++i) packages.push_back(package(i));
+    const LogosList plain = conversions::toLogosList(packages);
+
+    for (packed::Format f : kFormats) {
+        const std::vector<uint8_t> bytes = packed::encode(packages, f);
+        LOGOS_ASSERT_EQ(decoded(bytes, f), plain);
+        // Keys and repeated values are written once.
+        LOGOS_ASSERT_TRUE(bytes.size() * 2 < plain.dump().size());
+        LOGOS_ASSERT_TRUE(bytes.size() * 2 < (f == packed::Format::Cbor ? LogosMap::to_cbor(plain).size()
+                                                                         : LogosMap::to_msgpack(plain).size()));
+    }
+    LOGOS_ASSERT_EQ(decoded(packed::encode({}, packed::Format::Cbor), packed::Format::Cbor), LogosList::array());
+}
+
+LOGOS_TEST(packed_slot_response_is_smaller_than_the_plain_result_as_json) {
+    auto t = LogosTestContext("package_manager");
+    std::vector<InstalledPackage> packages;
+    for (size_t i = 0; i < 200; ++i) packages.push_back(package(i));
+    setMockInstalledPackages(packages);
+    PackageManagerImpl impl;
+    // Compared as the whole response serialises, base64 included.
+    const size_t plain = impl.getInstalledPackages().dump().size();
+    for (const char* encoding : {"msgpack", "cbor"})
+        LOGOS_ASSERT_TRUE(impl.getInstalledPackages(encoding).dump().size() * 4 < plain * 3);
+}
+
+LOGOS_TEST(packed_trees_and_lists_decode_to_the_plain_shapes) {
+    const DependencyTreeNode deps = dependencyTree();
+    const DependentTreeNode dependents = dependentTree();
+    const int full = std::numeric_limits<int>::max();
+    for (packed::Format f : kFormats) {
+        for (int depth : {0, 1, full}) {
+            LOGOS_ASSERT_EQ(decoded(packed::encodeTree(&deps, depth, f), f), conversions::toLogosTreeMap(deps, depth));
+            LOGOS_ASSERT_EQ(decoded(packed::encodeTree(&dependents, depth, f), f),
+                            conversions::toLogosTreeMap(dependents, depth));
+        }
+        LOGOS_ASSERT_EQ(decoded(packed::encodeList(deps.children, f), f), conversions::toFlatLogosList(deps.children));
+        LOGOS_ASSERT_EQ(decoded(packed::encodeList(dependents.children, f), f),
+                        conversions::toFlatLogosList(dependents.children));
+        // An unknown root is an empty object, as on the plain slots.
+        LOGOS_ASSERT_EQ(decoded(packed::encodeTree(static_cast<const DependencyTreeNode*>(nullptr), full, f), f),
+                        LogosMap::object());
+    }
+
+    // A document in the other format, or cut short, is rejected.
+    std::vector<uint8_t> bytes = packed::encodeTree(&deps, full, packed::Format::MessagePack);
+    LogosMap out;
+    std::string error;
+    LOGOS_ASSERT_FALSE(packed::decode(bytes, packed::Format::Cbor, out, error));
+    bytes.resize(bytes.size() - 3);
+    LOGOS_ASSERT_FALSE(packed::decode(bytes, packed::Format::MessagePack, out, error));
+}
+
+LOGOS_TEST(packed_base64_round_trips_and_rejects_malformed_text) {
+    LOGOS_ASSERT_EQ(packed::toBase64({'f', 'o', 'o', 'b'}), std::string("Zm9vYg=="));
+    std::vector<uint8_t> bytes;
+    for (size_t n = 0; n < 64; ++n) {
+        std::vector<uint8_t> data(n);
+        for (size_t i = 0; i < n; ++i) data[i] = static_cast<uint8_t>(i * 37 + n);
+        LOGOS_ASSERT_TRUE(packed::fromBase64(packed::toBase64(data), bytes));
+        LOGOS_ASSERT_TRUE(bytes == data);
+    }
+    LOGOS_ASSERT_FALSE(packed::fromBase64("Zm9", bytes));
+    LOGOS_ASSERT_FALSE(packed::fromBase64("Zm=v", bytes));
+    LOGOS_ASSERT_FALSE(packed::fromBase64("Zg==Zg==", bytes));
+    LOGOS_ASSERT_FALSE(packed::fromBase64("Zm9v\n", bytes));
+}
+
+LOGOS_TEST(query_slots_return_the_plain_results_as_base64_when_given_an_encoding) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages({package(0), package(1)});
+    setMockDependencyTree(dependencyTree());
+
+    PackageManagerImpl impl;
+    auto bytesOf = [](const LogosMap& response) {
+        std::vector<uint8_t> bytes;
+        packed::fromBase64(response["data"].get<std::string>(), bytes);
+        return bytes;
+    };
+    auto data = [&](const LogosMap& response, packed::Format f) { return decoded(bytesOf(response), f); };
+    LogosList list = impl.getInstalledPackages("msgpack");
+    LOGOS_ASSERT_EQ(list.size(), static_cast<size_t>(1));
+    LogosMap response = list[0];
+    LOGOS_ASSERT_TRUE(response["success"].get<bool>());
+    LOGOS_ASSERT_EQ(response["encoding"].get<std::string>(), std::string("msgpack"));
+    LOGOS_ASSERT_TRUE(response["data"].is_string());
+    LOGOS_ASSERT_EQ(static_cast<size_t>(response["bytes"].get<int64_t>()), bytesOf(response).size());
+    LOGOS_ASSERT_EQ(data(response, packed::Format::MessagePack), impl.getInstalledPackages());
+
+    const packed::Format cbor = packed::Format::Cbor;
+    LOGOS_ASSERT_EQ(data(impl.resolveDependencies("root", true, "cbor"), cbor),
+                    impl.resolveDependencies("root", true));
+    LOGOS_ASSERT_EQ(data(impl.resolveDependents("log", false, "cbor"), cbor),
+                    impl.resolveDependents("log", false));
+    LOGOS_ASSERT_EQ(data(impl.resolveFlatDependencies("root", true, "cbor")[0], cbor),
+                    impl.resolveFlatDependencies("root", true));
+    LOGOS_ASSERT_EQ(data(impl.resolveFlatDependents("log", true, "cbor")[0], cbor),
+                    impl.resolveFlatDependents("log", true));
+    // An unknown root packs as an empty object, as the plain result.
+    LOGOS_ASSERT_EQ(data(impl.resolveDependents("ghost", true, "msgpack"), packed::Format::MessagePack),
+                    LogosMap::object());
+
+    response = impl.getInstalledPackages("json")[0];
+    LOGOS_ASSERT_FALSE(response["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(response["error"].get<std::string>().find("json") != std::string::npos);
+    LOGOS_ASSERT_FALSE(impl.resolveDependencies("root", true, "json")["success"].get<bool>());
+}
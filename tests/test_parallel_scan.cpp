@@ -0,0 +1,90 @@
+// Unit tests for the parallel directory scan (src/parallel_scan.h) and the
+// setParallelScan slot.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "parallel_scan.h"
+#include "worker_pool.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+#include "test_packages.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+LOGOS_TEST(parallel_scan_prefetches_every_manifest) {
+    ScratchDir dir;
+    for (int i = 0; i < 40; ++i)
+        writeFile(dir.path / ("pkg" + std::to_string(i)) / "manifest.json", "{\"name\":\"pkg\"}");
+    std::filesystem::create_directories(dir.path / "no_manifest");
+    writeFile(dir.path / "stray.txt", "not a package");
+
+    WorkerPool pool(4);
+    // Fanned out across the pool, and in turn below the threshold.
+    LOGOS_ASSERT_EQ(parallelscan::prefetchManifests(dir.path.string(), &pool, 8), static_cast<uint64_t>(40));
+    LOGOS_ASSERT_EQ(parallelscan::prefetchManifests(dir.path.string(), &pool, 1000), static_cast<uint64_t>(40));
+    LOGOS_ASSERT_EQ(parallelscan::prefetchManifests((dir.path / "missing").string(), &pool, 8),
+                    static_cast<uint64_t>(0));
+}
+
+LOGOS_TEST(parallel_scan_merges_in_directory_order_and_keeps_own_packages) {
+    const std::vector<parallelscan::Directory> dirs = {
+        {"/bundle/modules", false, InstallType::Embedded},
+        {"/bundle/plugins/", true, InstallType::Embedded},
+        {"/home/u/modules", false, InstallType::User},
+    };
+    // Every job reports the whole set, as a library with built-in defaults
+    // might; the first job finishes last.
+    const std::vector<InstalledPackage> everything = {
+        TestPackage("user_mod").installDir("/home/u/modules/user_mod"),
+        TestPackage("embedded_ui").type("ui").embedded().installDir("/bundle/plugins/embedded_ui"),
+        TestPackage("embedded_mod").embedded().installDir("/bundle/modules/embedded_mod"),
+        TestPackage("shadow").installDir("/bundle/modules/shadow"),
+        TestPackage("too_deep").embedded().installDir("/bundle/modules/nested/too_deep"),
+    };
+    WorkerPool pool(3);
+    parallelscan::Stats stats;
+    const auto merged = parallelscan::scan(
+        dirs,
+        [&](size_t i) {
+            if (i == 0) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return everything;
+        },
+        pool, 8, stats);
+    LOGOS_ASSERT_EQ(names(merged), (std::vector<std::string>{"embedded_mod", "embedded_ui", "user_mod"}));
+    LOGOS_ASSERT_EQ(stats.directories, static_cast<size_t>(3));
+}
+
+LOGOS_TEST(setParallelScan_scans_each_directory_once_in_library_order) {
+    auto t = LogosTestContext("package_manager");
+    // The mock reports these lists to every library instance; each job
+    // keeps only its own directory's packages.
+    setMockInstalledModules({TestPackage("u_mod").installDir("/user/modules/u_mod"),
+                             TestPackage("b_mod").embedded().installDir("/embedded/b/b_mod"),
+                             TestPackage("a_mod").embedded().installDir("/embedded/a/a_mod")});
+    setMockInstalledUiPlugins({TestPackage("u_ui").type("ui").installDir("/user/plugins/u_ui"),
+                               TestPackage("e_ui").type("ui").embedded().installDir("/embedded/ui/e_ui")});
+    PackageManagerImpl impl;
+    impl.setEmbeddedModulesDirectory("/embedded/a");
+    impl.addEmbeddedModulesDirectory("/embedded/b");
+    impl.setEmbeddedUiPluginsDirectory("/embedded/ui");
+    impl.setUserModulesDirectory("/user/modules");
+
+    LogosMap response = impl.setParallelScan(true, 0);
+    LOGOS_ASSERT_TRUE(response["success"].get<bool>());
+    LOGOS_ASSERT_EQ(response["directories"].get<int64_t>(), static_cast<int64_t>(4));
+    // Directories configured later join the scan.
+    impl.setUserUiPluginsDirectory("/user/plugins");
+
+    LOGOS_ASSERT_EQ(names(impl.getInstalledPackages()),
+                    (std::vector<std::string>{"a_mod", "b_mod", "e_ui", "u_mod", "u_ui"}));
+    LOGOS_ASSERT_EQ(names(impl.getInstalledModules()), (std::vector<std::string>{"a_mod", "b_mod", "u_mod"}));
+    LOGOS_ASSERT_EQ(names(impl.getInstalledUiPlugins()), (std::vector<std::string>{"e_ui", "u_ui"}));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("getInstalledPackages"));
+
+    LOGOS_ASSERT_FALSE(impl.setParallelScan(false, 0)["enabled"].get<bool>());
+    impl.getInstalledPackages();
+    LOGOS_ASSERT_TRUE(t.cFunctionCalled("getInstalledPackages"));
+}
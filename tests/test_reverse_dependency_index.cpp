@@ -0,0 +1,136 @@
+// Unit tests for the reverse dependency index
+// (src/reverse_dependency_index.h) and the dependents slots it answers.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "reverse_dependency_index.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+#include "test_packages.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Names = std::vector<std::string>;
+
+bool hasLine(const std::string& text, const std::string& line) {
+    return text.find(line + "\n") != std::string::npos;
+}
+
+} // namespace
+
+LOGOS_TEST(reverse_index_updates_only_changed_edges) {
+    ReverseDependencyIndex index;
+    LOGOS_ASSERT_TRUE(index.upsert("wallet", {"log", "crypto", "log"}));
+    LOGOS_ASSERT_TRUE(index.upsert("chat", {"log"}));
+    LOGOS_ASSERT_FALSE(index.upsert("chat", {"log"}));
+    LOGOS_ASSERT_EQ(index.edges(), static_cast<size_t>(3));
+    // Sorted by name, whatever order they arrived in.
+    LOGOS_ASSERT_EQ(index.dependents("log"), (Names{"chat", "wallet"}));
+    LOGOS_ASSERT_TRUE(index.dependents("ghost").empty());
+
+    LOGOS_ASSERT_TRUE(index.upsert("wallet", {"crypto", "storage"}));
+    LOGOS_ASSERT_EQ(index.dependents("log"), Names{"chat"});
+    LOGOS_ASSERT_EQ(index.dependents("storage"), Names{"wallet"});
+    LOGOS_ASSERT_EQ(index.edges(), static_cast<size_t>(3));
+
+    index.beginSync();
+    index.upsert("wallet", {"crypto", "storage"});
+    LOGOS_ASSERT_EQ(index.endSync(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(index.packages(), static_cast<size_t>(1));
+    LOGOS_ASSERT_TRUE(index.dependents("log").empty());
+    LOGOS_ASSERT_TRUE(index.remove("wallet"));
+    LOGOS_ASSERT_FALSE(index.remove("wallet"));
+    LOGOS_ASSERT_EQ(index.edges(), static_cast<size_t>(0));
+}
+
+LOGOS_TEST(resolveDependents_follows_uninstalls_and_cuts_cycles) {
+    auto t = LogosTestContext("package_manager");
+    // a <- b <- c <- a: a cycle through the installed set, plus d <- a.
+    std::vector<InstalledPackage> installed = {
+        TestPackage("a").dependencies({"c"}), TestPackage("d").dependencies({"a"}),
+        TestPackage("b").dependencies({"a"}), TestPackage("c").dependencies({"b"})};
+    setMockInstalledPackages(installed);
+    t.mockCFunction("uninstallPackage_success").returns(true);
+    PackageManagerImpl impl;
+
+    LogosMap tree = impl.resolveDependents("a", true);
+    LOGOS_ASSERT_EQ(tree["children"].size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(tree["children"][0]["name"].get<std::string>(), std::string("b"));
+    LOGOS_ASSERT_EQ(tree["children"][1]["name"].get<std::string>(), std::string("d"));
+    LOGOS_ASSERT_EQ(tree["children"][0]["children"][0]["name"].get<std::string>(), std::string("c"));
+    // The walk stops before revisiting "a".
+    LOGOS_ASSERT_TRUE(tree["children"][0]["children"][0]["children"].empty());
+    LOGOS_ASSERT_EQ(impl.resolveFlatDependents("a", true).size(), static_cast<size_t>(3));
+
+    // Uninstalling a dependent drops it from the next answer.
+    LOGOS_ASSERT_TRUE(impl.uninstallPackage("d")["success"].get<bool>());
+    installed.erase(installed.begin() + 1);
+    setMockInstalledPackages(installed);
+    LogosList direct = impl.resolveFlatDependents("a", false);
+    LOGOS_ASSERT_EQ(direct.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(direct[0]["name"].get<std::string>(), std::string("b"));
+    LOGOS_ASSERT_FALSE(t.cFunctionCalled("resolveDependents"));
+
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_reverse_index_updates_total{change=\"upserted\"} 4"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_reverse_index_updates_total{change=\"removed\"} 1"));
+}
+
+LOGOS_TEST(resolveDependents_expands_shared_dependents_per_path) {
+    auto t = LogosTestContext("package_manager");
+    // Four stacked diamonds: l<i+1>a and l<i+1>b both depend on l<i>a and
+    // l<i>b. As in the library's tree, each path gets its own copy.
+    std::vector<InstalledPackage> installed = {TestPackage("l0a"), TestPackage("l0b")};
+    const int layers = 4;
+    for (int i = 1; i <= layers; ++i) {
+        const Names below = {"l" + std::to_string(i - 1) + "a", "l" + std::to_string(i - 1) + "b"};
+        installed.push_back(TestPackage("l" + std::to_string(i) + "a").dependencies(below));
+        installed.push_back(TestPackage("l" + std::to_string(i) + "b").dependencies(below));
+    }
+    setMockInstalledPackages(installed);
+    PackageManagerImpl impl;
+
+    LogosMap tree = impl.resolveDependents("l0a", true);
+    size_t nodes = 0;
+    std::vector<const LogosMap*> stack{&tree};
+    while (!stack.empty()) {
+        const LogosMap* node = stack.back();
+        stack.pop_back();
+        ++nodes;
+        for (const auto& child : (*node)["children"]) stack.push_back(&child);
+    }
+    // 1 + 2 + 4 + ... + 2^layers.
+    LOGOS_ASSERT_EQ(nodes, static_cast<size_t>((1 << (layers + 1)) - 1));
+    LOGOS_ASSERT_EQ(tree["children"][0]["children"].size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(tree["children"][1]["children"].size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(impl.resolveFlatDependents("l0a", true).size(), static_cast<size_t>(2 * layers));
+}
+
+LOGOS_TEST(resolveDependents_notices_packages_installed_outside_the_module) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path modules = scratch.path / "modules";
+    fs::create_directories(modules / "log");
+    std::vector<InstalledPackage> installed = {TestPackage("log")};
+    setMockInstalledPackages(installed);
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory(modules.string());
+    LOGOS_ASSERT_TRUE(impl.resolveFlatDependents("log", false).empty());
+
+    // lgpm installs "chat" behind the module's back.
+    installed.push_back(TestPackage("chat").dependencies({"log"}));
+    setMockInstalledPackages(installed);
+    fs::create_directories(modules / "chat");
+    fs::last_write_time(modules, fs::last_write_time(modules) + std::chrono::seconds(1));
+    LogosList direct = impl.resolveFlatDependents("log", false);
+    LOGOS_ASSERT_EQ(direct.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(direct[0]["name"].get<std::string>(), std::string("chat"));
+    LOGOS_ASSERT_EQ(impl.resolveDependents("log", false)["children"].size(), static_cast<size_t>(1));
+}
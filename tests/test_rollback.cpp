@@ -0,0 +1,125 @@
+// Unit tests for the retained-previous-version slots (rollbackPackage,
+// purgeRollbackVersions). upgradeFromFile needs a real .lgx, which the mocked
+// lgx API cannot load, so these lay out <userDir>/.pm-previous/<name> the way
+// an upgrade leaves it.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+
+#include <filesystem>
+#include <string>
+
+using logos_test::EventCapture;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void writePackage(const fs::path& dir, const std::string& name, const std::string& version) {
+    writeFile(dir / "manifest.json",
+              "{\"name\":\"" + name + "\",\"version\":\"" + version
+              + "\",\"main\":\"" + name + "_plugin.so\"}");
+    writeFile(dir / (name + "_plugin.so"), version);
+}
+
+} // namespace
+
+LOGOS_TEST(rollbackPackage_swaps_retained_version_back_in) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path modules = scratch.path / "modules";
+    writePackage(modules / "foo", "foo", "2.0.0");
+    writePackage(modules / ".pm-previous" / "foo", "foo", "1.0.0");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory(modules.string());
+
+    LogosMap r = impl.rollbackPackage("foo");
+    LOGOS_ASSERT_TRUE(r["success"].get<bool>());
+    LOGOS_ASSERT_EQ(r["fromVersion"].get<std::string>(), std::string("2.0.0"));
+    LOGOS_ASSERT_EQ(r["toVersion"].get<std::string>(), std::string("1.0.0"));
+    LOGOS_ASSERT_EQ(readFile(modules / "foo" / "foo_plugin.so"), std::string("1.0.0"));
+
+    auto installed = events.all("corePluginFileInstalled");
+    LOGOS_ASSERT_EQ(installed.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(installed[0].data, (modules / "foo" / "foo_plugin.so").string());
+
+    // The version rolled back from is now the retained one.
+    LOGOS_ASSERT_EQ(readFile(modules / ".pm-previous" / "foo" / "foo_plugin.so"), std::string("2.0.0"));
+    LOGOS_ASSERT_TRUE(impl.rollbackPackage("foo")["success"].get<bool>());
+    LOGOS_ASSERT_EQ(readFile(modules / "foo" / "foo_plugin.so"), std::string("2.0.0"));
+}
+
+LOGOS_TEST(rollbackPackage_without_retained_version_fails) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    writePackage(scratch.path / "ui" / "bar", "bar", "1.0.0");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserUiPluginsDirectory((scratch.path / "ui").string());
+
+    LogosMap r = impl.rollbackPackage("bar");
+    LOGOS_ASSERT_FALSE(r["success"].get<bool>());
+    LOGOS_ASSERT_EQ(r["error"].get<std::string>(), std::string("No previous version of 'bar' is retained"));
+    LOGOS_ASSERT_EQ(events.size(), static_cast<size_t>(0));
+}
+
+LOGOS_TEST(rollbackPackage_rejects_path_like_names) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    const fs::path modules = scratch.path / "user" / "modules";
+    writePackage(modules / "foo", "foo", "1.0.0");
+    writePackage(modules / ".pm-previous" / "bar", "bar", "1.0.0");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory(modules.string());
+
+    // "../foo" would resolve the retained copy to the live <modules>/foo.
+    for (const std::string name : {"../foo", "..", ".", ""}) {
+        LogosMap r = impl.rollbackPackage(name);
+        LOGOS_ASSERT_FALSE(r["success"].get<bool>());
+    }
+    LOGOS_ASSERT_EQ(readFile(modules / "foo" / "foo_plugin.so"), std::string("1.0.0"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "user" / "foo"));
+    LOGOS_ASSERT_EQ(events.size(), static_cast<size_t>(0));
+}
+
+LOGOS_TEST(purgeRollbackVersions_removes_every_retained_copy) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    writePackage(scratch.path / "modules" / ".pm-previous" / "foo", "foo", "1.0.0");
+    writePackage(scratch.path / "ui" / ".pm-previous" / "bar", "bar", "1.0.0");
+
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    impl.setUserUiPluginsDirectory((scratch.path / "ui").string());
+
+    LogosMap r = impl.purgeRollbackVersions();
+    LOGOS_ASSERT_TRUE(r["success"].get<bool>());
+    LOGOS_ASSERT_EQ(r["removed"].size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / ".pm-previous"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "ui" / ".pm-previous"));
+}
+
+LOGOS_TEST(uninstallPackage_drops_retained_version) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    writePackage(scratch.path / "modules" / ".pm-previous" / "foo", "foo", "1.0.0");
+    InstalledPackage pkg;
+    pkg.name = "foo";
+    pkg.type = "core";
+    pkg.installType = InstallType::User;
+    setMockInstalledPackages({pkg});
+    t.mockCFunction("uninstallPackage_success").returns(true);
+
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+
+    LOGOS_ASSERT_TRUE(impl.uninstallPackage("foo")["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / ".pm-previous" / "foo"));
+}
@@ -0,0 +1,101 @@
+// Unit tests for the trigram search index (src/trigram_index.h) and the
+// searchInstalledPackages slot.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "trigram_index.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "test_packages.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<InstalledPackage> samplePackages() {
+    return {
+        TestPackage("wallet").type("ui").displayName("Wallet").description("Send and receive tokens"),
+        TestPackage("wallet_connect").type("ui").displayName("WalletConnect")
+            .description("Pair dApps with your wallet"),
+        TestPackage("chat").type("ui").displayName("Chat")
+            .description("Encrypted messaging; can share a wallet address"),
+        TestPackage("storage").type("ui").displayName("Storage").description("Codex-backed file storage"),
+    };
+}
+
+std::vector<std::string> keys(const std::vector<TrigramIndex::Match>& matches) {
+    std::vector<std::string> out;
+    for (const auto& m : matches) out.emplace_back(m.key);
+    return out;
+}
+
+bool hasLine(const std::string& text, const std::string& line) {
+    return text.find("\n" + line + "\n") != std::string::npos;
+}
+
+} // namespace
+
+LOGOS_TEST(trigram_index_ranks_name_matches_and_tolerates_typos) {
+    TrigramIndex index;
+    for (const auto& p : samplePackages()) index.upsert(p.name, p.displayName, p.description);
+
+    const auto exact = keys(index.search("Wallet", 0));
+    LOGOS_ASSERT_EQ(exact.size(), static_cast<size_t>(3));
+    LOGOS_ASSERT_EQ(exact[0], std::string("wallet"));
+    LOGOS_ASSERT_EQ(exact[1], std::string("wallet_connect"));
+    LOGOS_ASSERT_EQ(exact[2], std::string("chat"));
+
+    const auto typo = keys(index.search("walet", 1));
+    LOGOS_ASSERT_EQ(typo.size(), static_cast<size_t>(1));
+    LOGOS_ASSERT_EQ(typo[0], std::string("wallet"));
+
+    LOGOS_ASSERT_EQ(keys(index.search("codex", 0)), std::vector<std::string>{"storage"});
+    LOGOS_ASSERT_TRUE(index.search("zzzz", 0).empty());
+    LOGOS_ASSERT_TRUE(index.search("  ", 0).empty());
+}
+
+LOGOS_TEST(trigram_index_updates_incrementally) {
+    TrigramIndex index;
+    LOGOS_ASSERT_TRUE(index.upsert("chat", "Chat", "Encrypted messaging"));
+    LOGOS_ASSERT_FALSE(index.upsert("chat", "Chat", "Encrypted messaging"));
+    LOGOS_ASSERT_TRUE(index.upsert("chat", "Chat", "Group voice calls"));
+    LOGOS_ASSERT_TRUE(index.search("messaging", 0).empty());
+    LOGOS_ASSERT_EQ(keys(index.search("voice", 0)), std::vector<std::string>{"chat"});
+
+    // Enough churn to trigger compaction; survivors stay searchable.
+    for (int i = 0; i < 300; ++i)
+        index.upsert("pkg" + std::to_string(i), "Package " + std::to_string(i), "filler text");
+    index.beginSync();
+    index.upsert("chat", "Chat", "Group voice calls");
+    index.upsert("pkg7", "Package 7", "filler text");
+    LOGOS_ASSERT_EQ(index.endSync(), static_cast<size_t>(299));
+    LOGOS_ASSERT_EQ(index.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(keys(index.search("filler", 0)), std::vector<std::string>{"pkg7"});
+    LOGOS_ASSERT_EQ(keys(index.search("voice", 0)), std::vector<std::string>{"chat"});
+}
+
+LOGOS_TEST(searchInstalledPackages_returns_ranked_packages_and_follows_uninstall) {
+    auto t = LogosTestContext("package_manager");
+    setMockInstalledPackages(samplePackages());
+    t.mockCFunction("uninstallPackage_success").returns(true);
+    PackageManagerImpl impl;
+
+    LogosList found = impl.searchInstalledPackages("wallet", 2);
+    LOGOS_ASSERT_EQ(found.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(found[0]["name"].get<std::string>(), std::string("wallet"));
+    LOGOS_ASSERT_EQ(found[0]["displayName"].get<std::string>(), std::string("Wallet"));
+    LOGOS_ASSERT_TRUE(found[0]["score"].get<double>() > found[1]["score"].get<double>());
+
+    auto remaining = samplePackages();
+    remaining.erase(remaining.begin());
+    LOGOS_ASSERT_TRUE(impl.uninstallPackage("wallet")["success"].get<bool>());
+    setMockInstalledPackages(remaining);
+
+    found = impl.searchInstalledPackages("wallet", 0);
+    LOGOS_ASSERT_EQ(found.size(), static_cast<size_t>(2));
+    LOGOS_ASSERT_EQ(found[0]["name"].get<std::string>(), std::string("wallet_connect"));
+
+    const std::string text = impl.getMetricsText();
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_search_index_updates_total{change=\"upserted\"} 4"));
+    LOGOS_ASSERT_TRUE(hasLine(text, "logos_package_manager_search_index_updates_total{change=\"removed\"} 1"));
+}
@@ -0,0 +1,103 @@
+// Unit tests for semver precedence and packed keys (src/semver.h), the
+// compareVersions slot and inspectPackage's versionChange.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "package_index.h"
+#include "semver.h"
+#include "mocks/mock_package_manager_lib.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Ascending precedence, including the semver 2.0 spec's own example chain.
+const std::vector<std::string> kOrdered = {
+    "not-a-version", "1.0.0-alpha", "1.0.0-alpha.1", "1.0.0-alpha.beta", "1.0.0-beta",
+    "1.0.0-beta.2", "1.0.0-beta.11", "1.0.0-rc.1", "1.0.0", "1.0.1", "1.2", "v1.2.1",
+    "1.10.0", "2.0.0-0", "2.0.0-a", "2.0.0-a.very.long.prerelease.identifier.list", "2.0.0",
+    "2097152.0.0",
+};
+
+} // namespace
+
+LOGOS_TEST(semver_orders_versions_by_precedence_with_and_without_keys) {
+    for (size_t i = 0; i < kOrdered.size(); ++i) {
+        for (size_t j = 0; j < kOrdered.size(); ++j) {
+            const std::string& a = kOrdered[i];
+            const std::string& b = kOrdered[j];
+            const int want = i < j ? -1 : (i > j ? 1 : 0);
+            LOGOS_ASSERT_EQ(semver::compare(a, b), want);
+            LOGOS_ASSERT_EQ(semver::compare(semver::key(a), a, semver::key(b), b), want);
+        }
+    }
+    // Build metadata and a missing patch are ignored; leading zeros in
+    // numeric identifiers compare by value.
+    LOGOS_ASSERT_EQ(semver::compare("1.2.0+build.7", "1.2"), 0);
+    LOGOS_ASSERT_EQ(semver::compare("1.0.0-rc.01", "1.0.0-rc.1"), 0);
+
+    // Common shapes pack exactly; oversized ones fall back to parsing.
+    LOGOS_ASSERT_TRUE(semver::key("1.2.3").exact);
+    LOGOS_ASSERT_TRUE(semver::key("1.0.0-beta.11").exact);
+    LOGOS_ASSERT_FALSE(semver::key("2.0.0-a.very.long.prerelease.identifier.list").exact);
+    LOGOS_ASSERT_FALSE(semver::key("2097152.0.0").exact);
+    LOGOS_ASSERT_FALSE(semver::valid("1.0.0-"));
+    LOGOS_ASSERT_FALSE(semver::valid("1.2.3.4"));
+    LOGOS_ASSERT_FALSE(semver::valid("1..2"));
+}
+
+LOGOS_TEST(compareVersions_compares_pairs_and_rejects_malformed_entries) {
+    auto t = LogosTestContext("package_manager");
+    PackageManagerImpl impl;
+
+    LogosList pairs = LogosList::array();
+    pairs.push_back(LogosList::array({"1.0.0", "1.0.0-rc.1"}));
+    pairs.push_back(LogosList::array({"1.9.0", "1.10.0"}));
+    pairs.push_back(LogosList::array({"v2.0", "2.0.0"}));
+    LogosMap result = impl.compareVersions(pairs);
+    LOGOS_ASSERT_TRUE(result["success"].get<bool>());
+    LOGOS_ASSERT_EQ(result["results"].size(), static_cast<size_t>(3));
+    LOGOS_ASSERT_EQ(result["results"][0].get<int>(), 1);
+    LOGOS_ASSERT_EQ(result["results"][1].get<int>(), -1);
+    LOGOS_ASSERT_EQ(result["results"][2].get<int>(), 0);
+
+    pairs.push_back("1.0.0");
+    result = impl.compareVersions(pairs);
+    LOGOS_ASSERT_FALSE(result["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(result["error"].get<std::string>().find("Entry 3") != std::string::npos);
+}
+
+LOGOS_TEST(inspectPackage_reports_versionChange_against_the_installed_version) {
+    auto t = LogosTestContext("package_manager");
+    InstalledPackage installed;
+    installed.name = "net";
+    installed.version = "1.3.0-beta.2";
+    installed.type = "core";
+    installed.installType = InstallType::User;
+    setMockInstalledPackages({installed});
+    t.mockCFunction("lgx_load_ok").returns(true);
+    t.mockCFunction("lgx_get_name").returns("net");
+    PackageManagerImpl impl;
+
+    t.mockCFunction("lgx_get_version").returns("1.3.0");
+    LOGOS_ASSERT_EQ(impl.inspectPackage("/tmp/net.lgx")["versionChange"].get<std::string>(),
+                    std::string("upgrade"));
+    t.mockCFunction("lgx_get_version").returns("1.3.0-alpha");
+    LOGOS_ASSERT_EQ(impl.inspectPackage("/tmp/net.lgx")["versionChange"].get<std::string>(),
+                    std::string("downgrade"));
+    t.mockCFunction("lgx_get_version").returns("v1.3.0-beta.2+rebuild");
+    LOGOS_ASSERT_EQ(impl.inspectPackage("/tmp/net.lgx")["versionChange"].get<std::string>(),
+                    std::string("sidegrade"));
+}
+
+LOGOS_TEST(package_index_keeps_a_version_key_per_row) {
+    InstalledPackage a, b;
+    a.name = "a";
+    a.version = "1.0.0-rc.1";
+    b.name = "b";
+    b.version = "1.0.0";
+    PackageIndex index({a, b});
+    LOGOS_ASSERT_EQ(semver::compare(index.versionKey(0), index.version(0),
+                                    index.versionKey(1), index.version(1)), -1);
+}
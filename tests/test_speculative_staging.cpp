@@ -0,0 +1,123 @@
+// Unit tests for stagePendingPackage — background preparation of a pending
+// install / upgrade from a local .lgx while the confirmation dialog is open.
+//
+// The mocked library never writes files, so a staged extraction always ends
+// in "no package directory"; these cover the gating, the fall-back to the
+// normal confirm events, and that discarded staging leaves nothing behind.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "mocks/mock_package_manager_lib.h"
+#include "scratch_dir.h"
+
+#include <filesystem>
+#include <string>
+
+using logos_test::EventCapture;
+
+namespace fs = std::filesystem;
+
+LOGOS_TEST(stagePendingPackage_requires_matching_pending_request) {
+    auto t = LogosTestContext("package_manager");
+    ScratchDir scratch;
+    writeFile(scratch.path / "foo.lgx", "lgx");
+
+    PackageManagerImpl impl;
+    LogosMap r = impl.stagePendingPackage("foo", (scratch.path / "foo.lgx").string());
+    LOGOS_ASSERT_FALSE(r["success"].get<bool>());
+    LOGOS_ASSERT_EQ(r["error"].get<std::string>(), std::string("No pending install or upgrade for 'foo'"));
+
+    LOGOS_ASSERT_TRUE(impl.requestInstall("foo", "v1.0.0", "", "")["success"].get<bool>());
+    r = impl.stagePendingPackage("foo", (scratch.path / "missing.lgx").string());
+    LOGOS_ASSERT_FALSE(r["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(r["error"].get<std::string>().find("LGX file not found") != std::string::npos);
+}
+
+LOGOS_TEST(stagePendingPackage_rejects_archive_for_another_package) {
+    auto t = LogosTestContext("package_manager");
+    t.mockCFunction("lgx_load_ok").returns(true);
+    t.mockCFunction("lgx_get_name").returns("bar");
+    ScratchDir scratch;
+    writeFile(scratch.path / "bar.lgx", "lgx");
+
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    LOGOS_ASSERT_TRUE(impl.requestInstall("foo", "v1.0.0", "", "")["success"].get<bool>());
+
+    LogosMap r = impl.stagePendingPackage("foo", (scratch.path / "bar.lgx").string());
+    LOGOS_ASSERT_FALSE(r["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(r["error"].get<std::string>().find("contains 'bar', not 'foo'") != std::string::npos);
+}
+
+LOGOS_TEST(confirmInstall_falls_back_to_installApproved_when_staging_fails) {
+    auto t = LogosTestContext("package_manager");
+    t.mockCFunction("lgx_load_ok").returns(true);
+    t.mockCFunction("lgx_get_name").returns("foo");
+    // Extraction fails: installPluginFile returns an empty result.
+    t.mockCFunction("installPluginFile_error").returns("signature required");
+    ScratchDir scratch;
+    writeFile(scratch.path / "foo.lgx", "lgx");
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    impl.setUserModulesDirectory((scratch.path / "modules").string());
+    LOGOS_ASSERT_TRUE(impl.requestInstall("foo", "v1.0.0", "https://repo", "")["success"].get<bool>());
+    LogosMap staged = impl.stagePendingPackage("foo", (scratch.path / "foo.lgx").string());
+    LOGOS_ASSERT_TRUE(staged["staging"].get<bool>());
+    LOGOS_ASSERT_TRUE(impl.ackPendingAction("foo")["success"].get<bool>());
+
+    LogosMap r = impl.confirmInstall("foo");
+    LOGOS_ASSERT_TRUE(r["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(r.contains("committed"));
+    LOGOS_ASSERT_EQ(r["stagingError"].get<std::string>(), std::string("signature required"));
+    LOGOS_ASSERT_TRUE(events.has("installApproved"));
+    LOGOS_ASSERT_FALSE(events.has("corePluginFileInstalled"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / ".pm-staging"));
+}
+
+LOGOS_TEST(cancelInstall_discards_staged_work) {
+    auto t = LogosTestContext("package_manager");
+    t.mockCFunction("lgx_load_ok").returns(true);
+    t.mockCFunction("lgx_get_name").returns("foo");
+    ScratchDir scratch;
+    writeFile(scratch.path / "foo.lgx", "lgx");
+
+    EventCapture events;
+    {
+        PackageManagerImpl impl;
+        impl.setUserModulesDirectory((scratch.path / "modules").string());
+        LOGOS_ASSERT_TRUE(impl.requestInstall("foo", "v1.0.0", "", "")["success"].get<bool>());
+        LOGOS_ASSERT_TRUE(impl.stagePendingPackage("foo", (scratch.path / "foo.lgx").string())["success"].get<bool>());
+        LOGOS_ASSERT_TRUE(impl.ackPendingAction("foo")["success"].get<bool>());
+        LOGOS_ASSERT_TRUE(impl.cancelInstall("foo")["success"].get<bool>());
+        // Destruction drains the pool, so the staging task has finished and
+        // cleaned up after itself by the time the scope ends.
+    }
+    LOGOS_ASSERT_TRUE(events.has("installCancelled"));
+    LOGOS_ASSERT_FALSE(fs::exists(scratch.path / "modules" / ".pm-staging"));
+}
+
+LOGOS_TEST(confirmUpgrade_without_usable_staging_keeps_normal_flow) {
+    auto t = LogosTestContext("package_manager");
+    InstalledPackage pkg;
+    pkg.name = "foo";
+    pkg.type = "core";
+    pkg.installType = InstallType::User;
+    setMockInstalledPackages({pkg});
+    ScratchDir scratch;
+    writeFile(scratch.path / "foo.lgx", "lgx");
+    t.mockCFunction("uninstallPackage_success").returns(true);
+
+    EventCapture events;
+    PackageManagerImpl impl;
+    LOGOS_ASSERT_TRUE(impl.requestUpgrade("foo", "v2.0.0", 0, "")["success"].get<bool>());
+    // The archive header cannot be read, so nothing is staged.
+    LogosMap staged = impl.stagePendingPackage("foo", (scratch.path / "foo.lgx").string());
+    LOGOS_ASSERT_FALSE(staged["success"].get<bool>());
+    LOGOS_ASSERT_TRUE(impl.ackPendingAction("foo")["success"].get<bool>());
+
+    LogosMap r = impl.confirmUpgrade("foo", "v2.0.0");
+    LOGOS_ASSERT_TRUE(r["success"].get<bool>());
+    LOGOS_ASSERT_FALSE(r.contains("committed"));
+    LOGOS_ASSERT_TRUE(events.has("upgradeUninstallDone"));
+}
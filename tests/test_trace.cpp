@@ -0,0 +1,89 @@
+// Unit tests for the trace-event recorder (src/trace.h) and the
+// setTracingEnabled / getTraceJson slots.
+
+#include <logos_test.h>
+#include "package_manager_impl.h"
+#include "trace.h"
+#include "mocks/mock_package_manager_lib.h"
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::set<std::string> eventNames(const std::string& json) {
+    std::set<std::string> names;
+    LogosMap doc = LogosMap::parse(json);
+    for (const auto& e : doc["traceEvents"]) names.insert(e["name"].get<std::string>());
+    return names;
+}
+
+} // namespace
+
+LOGOS_TEST(trace_recorder_ignores_spans_while_disabled) {
+    trace::Recorder rec;
+    { trace::Span s(rec, "before", "test"); }
+    rec.enable(8);
+    { trace::Span s(rec, "during", "test"); }
+    rec.disable();
+    { trace::Span s(rec, "after", "test"); }
+
+    LogosMap doc = LogosMap::parse(rec.toChromeJson());
+    LOGOS_ASSERT_EQ(doc["traceEvents"].size(), static_cast<size_t>(1));
+    const auto& e = doc["traceEvents"][0];
+    LOGOS_ASSERT_EQ(e["name"].get<std::string>(), std::string("during"));
+    LOGOS_ASSERT_EQ(e["cat"].get<std::string>(), std::string("test"));
+    LOGOS_ASSERT_EQ(e["ph"].get<std::string>(), std::string("X"));
+    LOGOS_ASSERT_TRUE(e.contains("ts") && e.contains("dur") && e.contains("tid"));
+}
+
+LOGOS_TEST(trace_recorder_keeps_newest_events_when_ring_wraps) {
+    trace::Recorder rec;
+    rec.enable(4);
+    const char* names[] = {"e0", "e1", "e2", "e3", "e4", "e5"};
+    for (const char* n : names) rec.record(n, "test", 0, 1);
+
+    LOGOS_ASSERT_EQ(rec.recordedCount(), static_cast<uint64_t>(6));
+    LOGOS_ASSERT_EQ(eventNames(rec.toChromeJson()), (std::set<std::string>{"e2", "e3", "e4", "e5"}));
+
+    // Re-enabling starts a fresh recording on the same ring.
+    rec.enable();
+    LOGOS_ASSERT_EQ(LogosMap::parse(rec.toChromeJson())["traceEvents"].size(), static_cast<size_t>(0));
+}
+
+LOGOS_TEST(trace_recorder_concurrent_writers_produce_valid_json) {
+    trace::Recorder rec;
+    rec.enable(1024);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&rec]() {
+            for (int i = 0; i < 2000; ++i) { trace::Span s(rec, "work", "test"); }
+        });
+    }
+    // Dumping while writers run must still yield parseable JSON.
+    const std::string midway = rec.toChromeJson();
+    for (auto& th : threads) th.join();
+
+    LOGOS_ASSERT_TRUE(LogosMap::parse(midway).contains("traceEvents"));
+    LOGOS_ASSERT_EQ(rec.recordedCount(), static_cast<uint64_t>(8000));
+    LOGOS_ASSERT_EQ(LogosMap::parse(rec.toChromeJson())["traceEvents"].size(), static_cast<size_t>(1024));
+}
+
+LOGOS_TEST(getTraceJson_records_slot_and_phase_spans) {
+    auto t = LogosTestContext("package_manager");
+    PackageManagerImpl impl;
+    impl.getInstalledPackages();  // not traced
+    LOGOS_ASSERT_TRUE(impl.setTracingEnabled(true)["enabled"].get<bool>());
+    impl.getInstalledPackages();
+    impl.resolveDependencies("foo", true);
+
+    const auto names = eventNames(impl.getTraceJson());
+    LOGOS_ASSERT_TRUE(names.count("getInstalledPackages"));
+    LOGOS_ASSERT_TRUE(names.count("scan getInstalledPackages"));
+    LOGOS_ASSERT_TRUE(names.count("toLogosList"));
+    LOGOS_ASSERT_TRUE(names.count("resolveDependencies"));
+    LOGOS_ASSERT_EQ(LogosMap::parse(impl.getTraceJson())["traceEvents"].size(),
+                    static_cast<size_t>(5));
+}
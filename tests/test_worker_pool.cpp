@@ -0,0 +1,59 @@
+// Unit tests for WorkerPool (src/worker_pool.h) — the bounded pool
+// PackageManagerImpl uses to fan install/scan/audit work across cores.
+
+#include <logos_test.h>
+#include "worker_pool.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+LOGOS_TEST(workerPool_parallelFor_visits_every_index_once) {
+    WorkerPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallelFor(hits.size(), [&](size_t i) { hits[i].fetch_add(1); });
+    for (const auto& h : hits)
+        LOGOS_ASSERT_EQ(h.load(), 1);
+}
+
+LOGOS_TEST(workerPool_parallelFor_results_merge_by_index) {
+    // Completion order is arbitrary; writing into slot i keeps the merged
+    // output identical to a serial loop.
+    WorkerPool pool(3);
+    std::vector<std::string> out(64);
+    pool.parallelFor(out.size(), [&](size_t i) { out[i] = "entry-" + std::to_string(i); });
+    for (size_t i = 0; i < out.size(); ++i)
+        LOGOS_ASSERT_EQ(out[i], "entry-" + std::to_string(i));
+}
+
+LOGOS_TEST(workerPool_parallelFor_rethrows_first_error_after_draining) {
+    WorkerPool pool(2);
+    std::atomic<int> ran{0};
+    bool threw = false;
+    try {
+        pool.parallelFor(50, [&](size_t i) {
+            ran.fetch_add(1);
+            if (i == 7) throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    LOGOS_ASSERT_TRUE(threw);
+    LOGOS_ASSERT_EQ(ran.load(), 50);
+}
+
+LOGOS_TEST(workerPool_parallelFor_nested_call_does_not_deadlock) {
+    WorkerPool pool(1);
+    std::atomic<int> total{0};
+    pool.parallelFor(4, [&](size_t) {
+        pool.parallelFor(4, [&](size_t) { total.fetch_add(1); });
+    });
+    LOGOS_ASSERT_EQ(total.load(), 16);
+}
+
+LOGOS_TEST(workerPool_submit_returns_value_through_future) {
+    WorkerPool pool(2);
+    auto f = pool.submit([]() { return 42; });
+    LOGOS_ASSERT_EQ(f.get(), 42);
+}